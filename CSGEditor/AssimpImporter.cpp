@@ -0,0 +1,44 @@
+#include "AssimpImporter.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <stdexcept>
+
+namespace {
+	void AddNode(TriangleMesh& mesh, const aiScene* scene, const aiNode* node, aiMatrix4x4 transform) {
+		transform = transform * node->mTransformation;
+		for (unsigned int m = 0; m < node->mNumMeshes; ++m) {
+			const aiMesh* source = scene->mMeshes[node->mMeshes[m]];
+			if (!(source->mPrimitiveTypes & aiPrimitiveType_TRIANGLE))
+				continue; // points and lines
+			uint32_t base = (uint32_t)mesh.positions.size();
+			for (unsigned int v = 0; v < source->mNumVertices; ++v) {
+				aiVector3D p = transform * source->mVertices[v];
+				mesh.positions.push_back(glm::vec3(p.x, p.y, p.z));
+			}
+			for (unsigned int f = 0; f < source->mNumFaces; ++f) {
+				const aiFace& face = source->mFaces[f];
+				if (face.mNumIndices != 3)
+					continue;
+				for (int k = 0; k < 3; ++k)
+					mesh.indices.push_back(base + face.mIndices[k]);
+			}
+		}
+		for (unsigned int c = 0; c < node->mNumChildren; ++c)
+			AddNode(mesh, scene, node->mChildren[c], transform);
+	}
+}
+
+TriangleMesh AssimpImporter::Read(const std::string& fileName)
+{
+	// the vertices are joined, so the winding numbers see closed surfaces where the file has split normals or uvs
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(fileName, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
+	if (scene == nullptr || scene->mRootNode == nullptr)
+		throw std::runtime_error("Can't import " + fileName + ": " + importer.GetErrorString());
+
+	TriangleMesh mesh;
+	AddNode(mesh, scene, scene->mRootNode, aiMatrix4x4());
+	return mesh;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "TriangleMesh.h"
+#include <string>
+
+/// <summary>
+/// Reads the triangles of every mesh of a model file with assimp, which knows many more formats than the built in readers of TriangleMesh.
+/// The nodes' transforms are applied, so the meshes are where the modeling tool showed them. Editor only, the command line tools are built
+/// without assimp (see TriangleMesh::SetImporter).
+/// </summary>
+class AssimpImporter
+{
+public:
+	/// <summary>
+	/// Throws std::runtime_error with assimp's message if the file can't be read.
+	/// </summary>
+	static TriangleMesh Read(const std::string& fileName);
+};
@@ -0,0 +1,43 @@
+#include "BakeTextures.h"
+
+#include <algorithm>
+
+BakeTextures::~BakeTextures()
+{
+	for (auto& texture : textures)
+		glDeleteTextures(1, &texture.id);
+}
+
+void BakeTextures::Upload(const std::vector<std::shared_ptr<const DistanceBake>>& bakes)
+{
+	std::vector<Texture> uploaded;
+	for (auto& bake : bakes) {
+		auto old = std::find_if(textures.begin(), textures.end(), [&](const Texture& t) { return t.bake == bake; });
+		if (old != textures.end()) {
+			uploaded.push_back(*old);
+			textures.erase(old);
+			continue;
+		}
+
+		Texture texture{ bake, 0 };
+		glCreateTextures(GL_TEXTURE_3D, 1, &texture.id);
+		glTextureStorage3D(texture.id, 1, GL_R32F, bake->resolution.x, bake->resolution.y, bake->resolution.z);
+		glTextureSubImage3D(texture.id, 0, 0, 0, 0, bake->resolution.x, bake->resolution.y, bake->resolution.z, GL_RED, GL_FLOAT, bake->values.data());
+		glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(texture.id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture.id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture.id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		uploaded.push_back(texture);
+	}
+
+	for (auto& texture : textures) // not used any more
+		glDeleteTextures(1, &texture.id);
+	textures = std::move(uploaded);
+}
+
+void BakeTextures::Bind() const
+{
+	for (size_t i = 0; i < textures.size(); ++i)
+		glBindTextureUnit(firstUnit + (GLuint)i, textures[i].id);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "DistanceBake.h"
+#include <GL/glew.h>
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// 3D textures holding the DistanceBakes sampled by the generated sdf (see SDFGenerator::GetUsedBakes), one R32F texture per bake with
+/// linear filtering and clamp to edge, as DistanceBake::Sample expects.
+/// </summary>
+class BakeTextures
+{
+public:
+	static constexpr GLuint firstUnit = 2; // units 0 and 1 are used by the present pass of the tiled renderer
+
+	BakeTextures() = default;
+	~BakeTextures();
+
+	BakeTextures(const BakeTextures&) = delete;
+	BakeTextures& operator=(const BakeTextures&) = delete;
+
+	/// <summary>
+	/// Makes the i-th texture hold bakes[i]. Textures of bakes that were uploaded before are kept, the ones not in bakes are deleted.
+	/// </summary>
+	void Upload(const std::vector<std::shared_ptr<const DistanceBake>>& bakes);
+
+	size_t Count() const { return textures.size(); }
+
+	/// <summary>
+	/// Binds the i-th texture to unit firstUnit + i.
+	/// </summary>
+	void Bind() const;
+
+private:
+	struct Texture {
+		std::shared_ptr<const DistanceBake> bake;
+		GLuint id;
+	};
+	std::vector<Texture> textures;
+};
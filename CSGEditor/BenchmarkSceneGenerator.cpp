@@ -0,0 +1,201 @@
+#include "BenchmarkSceneGenerator.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+	ordered_json Vec3ToJson(glm::vec3 v) {
+		return { {"x", v.x}, {"y", v.y}, {"z", v.z} };
+	}
+
+	// interleaves the bits of the quantized coordinates, sorting by it keeps nearby points together
+	uint32_t MortonCode(glm::vec3 unitPos) {
+		auto expand = [](uint32_t v) {
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		};
+		glm::uvec3 q = glm::uvec3(glm::clamp(unitPos * 1024.0f, glm::vec3(0), glm::vec3(1023)));
+		return (expand(q.x) << 2) | (expand(q.y) << 1) | expand(q.z);
+	}
+
+	ordered_json Union(ordered_json inputs) {
+		return {
+			{ "operator", "union" },
+			{ "translate", Vec3ToJson(glm::vec3(0)) },
+			{ "rotate", Vec3ToJson(glm::vec3(0)) },
+			{ "scale", 1.0f },
+			{ "offset", 0.0f },
+			{ "inputs", inputs }
+		};
+	}
+}
+
+namespace {
+	// spread is the half size of the region the translations are drawn from
+	ordered_json RandomPrimitive(std::mt19937& rng, const std::function<float(float, float)>& range, bool allowPlanes, float spread) {
+		const char* types[] = { "sphere", "box", "cylinder", "torus", "ellipsoid", "plane" };
+		std::string type = types[rng() % (allowPlanes ? 6 : 5)];
+
+		ordered_json j = {
+			{ "primitive", type },
+			{ "translate", Vec3ToJson(glm::vec3(range(-spread, spread), range(-spread, spread), range(-spread, spread))) },
+			{ "rotate", Vec3ToJson(glm::vec3(range(0, 360), range(0, 360), range(0, 360))) },
+			{ "scale", range(0.5f, 1.5f) },
+			{ "offset", rng() % 3 == 0 ? range(0, 0.1f) : 0.0f }
+		};
+		if (type == "box")
+			j["dimensions"] = Vec3ToJson(glm::vec3(range(0.5f, 1), range(0.5f, 1), range(0.5f, 1)));
+		else if (type == "cylinder") {
+			j["radius"] = range(0.2f, 0.5f);
+			j["height"] = range(0.5f, 1);
+		}
+		else if (type == "torus") {
+			j["major_radius"] = range(0.3f, 0.4f);
+			j["minor_radius"] = range(0.05f, 0.15f);
+		}
+		else if (type == "ellipsoid")
+			j["radii"] = Vec3ToJson(glm::vec3(range(0.2f, 0.5f), range(0.2f, 0.5f), range(0.2f, 0.5f)));
+		else if (type == "plane") {
+			j["n"] = Vec3ToJson(glm::normalize(glm::vec3(range(-1, 1), range(-1, 1), range(-1, 1)) + glm::vec3(0, 0.01f, 0)));
+			j["h"] = range(0.5f, 1.5f);
+		}
+		return j;
+	}
+
+	// Uniform choices made most trees empty: an intersection of inputs scattered in [-1, 1]^3 rarely has a common point, and one empty
+	// input empties every intersection above it. So the root and the operators below it are unions, the other operators are weighted
+	// towards the unions, the inputs of intersections are drawn close to each other and the cutters of substractions are shrunk. Planes
+	// only appear in the cutters, which keeps the solid bounded.
+	ordered_json RandomTree(int primitiveCount, std::mt19937& rng, const std::function<float(float, float)>& range, int level = 0, float spread = 1,
+		bool cutter = false) {
+		if (primitiveCount == 1)
+			return RandomPrimitive(rng, range, cutter && rng() % 4 == 0, spread);
+
+		const char* types[] = { "union", "smooth union", "substract", "smooth substract", "intersect", "smooth intersect" };
+		const int weights[] = { 4, 2, 2, 1, 1, 1 };
+		int pick = rng() % (level < 2 ? weights[0] + weights[1] : 11);
+		int t = 0;
+		while (pick >= weights[t])
+			pick -= weights[t++];
+		std::string type = types[t];
+		bool smooth = type.rfind("smooth", 0) == 0;
+		bool intersect = type.find("intersect") != std::string::npos, substract = type.find("substract") != std::string::npos;
+		float childSpread = intersect ? 0.25f * spread : spread;
+
+		// smooth operators take exactly two inputs
+		int inputCount = smooth ? 2 : std::min(primitiveCount, 2 + (int)(rng() % 3));
+		ordered_json inputs = ordered_json::array();
+		int remaining = primitiveCount;
+		for (int i = 0; i < inputCount; ++i) {
+			int count = i + 1 == inputCount ? remaining : std::max(1, (int)(remaining / (inputCount - i) * range(0.5f, 1.5f)));
+			count = std::min(count, remaining - (inputCount - i - 1));
+			ordered_json input = RandomTree(count, rng, range, level + 1, childSpread, cutter || (substract && i > 0));
+			if (substract && i > 0)
+				input["scale"] = 0.6f * input["scale"].get<float>();
+			inputs.push_back(std::move(input));
+			remaining -= count;
+		}
+
+		float translate = 0.5f * spread;
+		ordered_json j = {
+			{ "operator", type },
+			{ "translate", Vec3ToJson(glm::vec3(range(-translate, translate), range(-translate, translate), range(-translate, translate))) },
+			{ "rotate", Vec3ToJson(glm::vec3(range(0, 360), range(0, 360), range(0, 360))) },
+			{ "scale", range(0.7f, 1.3f) },
+			{ "offset", rng() % 4 == 0 ? range(0, 0.1f) : 0.0f }
+		};
+		if (smooth)
+			j["k"] = range(0.05f, 0.5f);
+		j["inputs"] = inputs;
+		return j;
+	}
+}
+
+ordered_json BenchmarkSceneGenerator::GenerateRandomTree(int primitiveCount, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::function<float(float, float)> range = [&](float lo, float hi) { return lo + (hi - lo) * unit(rng); };
+
+	ordered_json scene = ordered_json::array();
+	scene.push_back(RandomTree(std::max(primitiveCount, 1), rng, range));
+	return scene;
+}
+
+ordered_json BenchmarkSceneGenerator::Generate(int primitiveCount, unsigned int seed, int fanOut)
+{
+	primitiveCount = std::max(primitiveCount, 1);
+	fanOut = std::max(fanOut, 2);
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto range = [&](float lo, float hi) { return lo + (hi - lo) * unit(rng); };
+
+	// roughly one primitive per unit cube
+	float side = std::cbrt((float)primitiveCount);
+
+	struct Leaf {
+		uint32_t code;
+		ordered_json json;
+	};
+	std::vector<Leaf> leaves;
+	leaves.reserve(primitiveCount);
+
+	const char* types[] = { "sphere", "box", "cylinder", "torus", "ellipsoid" };
+	for (int i = 0; i < primitiveCount; ++i) {
+		glm::vec3 unitPos(unit(rng), unit(rng), unit(rng));
+		std::string type = types[rng() % 5];
+
+		ordered_json j = {
+			{ "primitive", type },
+			{ "translate", Vec3ToJson((unitPos - 0.5f) * side) },
+			{ "rotate", Vec3ToJson(glm::vec3(range(0, 360), range(0, 360), range(0, 360))) },
+			{ "scale", range(0.3f, 0.6f) },
+			{ "offset", 0.0f }
+		};
+		if (type == "box")
+			j["dimensions"] = Vec3ToJson(glm::vec3(range(0.5f, 1), range(0.5f, 1), range(0.5f, 1)));
+		else if (type == "cylinder") {
+			j["radius"] = range(0.2f, 0.5f);
+			j["height"] = range(0.5f, 1);
+		}
+		else if (type == "torus") {
+			j["major_radius"] = range(0.3f, 0.4f);
+			j["minor_radius"] = range(0.05f, 0.15f);
+		}
+		else if (type == "ellipsoid")
+			j["radii"] = Vec3ToJson(glm::vec3(range(0.2f, 0.5f), range(0.2f, 0.5f), range(0.2f, 0.5f)));
+
+		leaves.push_back({ MortonCode(unitPos), j });
+	}
+
+	std::sort(leaves.begin(), leaves.end(), [](const Leaf& a, const Leaf& b) { return a.code < b.code; });
+
+	std::vector<ordered_json> level;
+	level.reserve(leaves.size());
+	for (auto& leaf : leaves)
+		level.push_back(std::move(leaf.json));
+
+	// group neighbours into unions until a single root remains
+	while (level.size() > 1) {
+		std::vector<ordered_json> next;
+		for (size_t i = 0; i < level.size(); i += fanOut) {
+			ordered_json inputs = ordered_json::array();
+			for (size_t k = i; k < std::min(level.size(), i + fanOut); ++k)
+				inputs.push_back(std::move(level[k]));
+			next.push_back(Union(std::move(inputs)));
+		}
+		level = std::move(next);
+	}
+
+	ordered_json scene = ordered_json::array();
+	scene.push_back(std::move(level.front()));
+	return scene;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <json.hpp>
+
+using namespace nlohmann;
+
+/// <summary>
+/// Generates large random scenes for measuring the sdf generators and the data-driven (bvh) sdf.
+/// </summary>
+class BenchmarkSceneGenerator
+{
+public:
+	/// <summary>
+	/// Generates primitiveCount random bounded primitives scattered in a cube whose volume grows with the count (so the density stays the same).
+	/// The primitives are grouped into nested unions of at most fanOut inputs, spatially close primitives ending up in the same union.
+	/// </summary>
+	/// <returns>the scene in the format of the saved graphs (an array containing the root)</returns>
+	static ordered_json Generate(int primitiveCount, unsigned int seed = 1, int fanOut = 16);
+
+	/// <summary>
+	/// Generates a random tree of primitiveCount primitives using every primitive and operator type (including planes and the smooth operators),
+	/// with random transforms, scales and offsets on every node. The choices are biased towards bounded, non-empty solids.
+	/// Meant for checking the evaluators against each other, not for timing.
+	/// </summary>
+	/// <returns>the scene in the format of the saved graphs (an array containing the root)</returns>
+	static ordered_json GenerateRandomTree(int primitiveCount, unsigned int seed = 1);
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <limits>
+#include <algorithm>
+
+/// <summary>
+/// Axis aligned bounding box. An infinite box is used for unbounded shapes (eg.: planes), an empty box never occurs:
+/// operators that would produce one keep a conservative input box instead.
+/// </summary>
+struct BoundingBox
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	BoundingBox() : min(0), max(0) {}
+	BoundingBox(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+
+	static BoundingBox FromHalfSize(glm::vec3 halfSize) { return BoundingBox(-halfSize, halfSize); }
+	static BoundingBox Infinite() {
+		const float inf = std::numeric_limits<float>::infinity();
+		return BoundingBox(glm::vec3(-inf), glm::vec3(inf));
+	}
+
+	bool IsInfinite() const {
+		return glm::any(glm::isinf(min)) || glm::any(glm::isinf(max));
+	}
+	bool IsEmpty() const { return glm::any(glm::greaterThan(min, max)); }
+
+	glm::vec3 Center() const { return (min + max) * 0.5f; }
+	glm::vec3 HalfSize() const { return (max - min) * 0.5f; }
+
+	/// <summary>
+	/// Grows the box by d in every direction. Negative values are ignored, the box stays conservative.
+	/// </summary>
+	BoundingBox Expanded(float d) const {
+		if (d <= 0 || IsInfinite())
+			return *this;
+		return BoundingBox(min - glm::vec3(d), max + glm::vec3(d));
+	}
+
+	BoundingBox Scaled(float s) const {
+		if (IsInfinite())
+			return *this;
+		return BoundingBox(glm::min(min * s, max * s), glm::max(min * s, max * s));
+	}
+
+	/// <summary>
+	/// Returns the bounding box of this box transformed by an affine matrix.
+	/// </summary>
+	BoundingBox Transformed(const glm::mat4& m) const {
+		if (IsInfinite())
+			return *this;
+		glm::vec3 center = glm::vec3(m * glm::vec4(Center(), 1));
+		glm::mat3 absM = glm::mat3(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+		glm::vec3 half = absM * HalfSize();
+		return BoundingBox(center - half, center + half);
+	}
+
+	/// <summary>
+	/// Parameter range [tNear, tFar] of the ray origin + t * direction inside the box (slab test), invDirection is 1 / direction.
+	/// Returns false if the ray misses the box. An infinite box contains the whole ray.
+	/// </summary>
+	bool IntersectRay(glm::vec3 origin, glm::vec3 invDirection, float& tNear, float& tFar) const {
+		tNear = -std::numeric_limits<float>::infinity();
+		tFar = std::numeric_limits<float>::infinity();
+		if (IsInfinite())
+			return true;
+		for (int axis = 0; axis < 3; ++axis) {
+			float t0 = (min[axis] - origin[axis]) * invDirection[axis];
+			float t1 = (max[axis] - origin[axis]) * invDirection[axis];
+			// a NaN (origin on a slab plane of an axis the ray is parallel to) leaves the range unchanged
+			tNear = std::max(tNear, std::min(t0, t1));
+			tFar = std::min(tFar, std::max(t0, t1));
+		}
+		return tNear <= tFar;
+	}
+
+	static BoundingBox Union(const BoundingBox& a, const BoundingBox& b) {
+		return BoundingBox(glm::min(a.min, b.min), glm::max(a.max, b.max));
+	}
+
+	/// <summary>
+	/// Intersection of the two boxes. If they don't overlap, a is returned, which still contains the (empty) intersection.
+	/// </summary>
+	static BoundingBox Intersection(const BoundingBox& a, const BoundingBox& b) {
+		BoundingBox r(glm::max(a.min, b.min), glm::min(a.max, b.max));
+		return r.IsEmpty() ? a : r;
+	}
+};
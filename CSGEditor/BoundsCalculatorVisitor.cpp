@@ -0,0 +1,49 @@
+#include "BoundsCalculatorVisitor.h"
+
+#include <glm/gtx/transform.hpp>
+
+void BoundsCalculatorVisitor::operator()(std::shared_ptr<PrimitiveNode> primNode)
+{
+	// the offset is subtracted in the primitive's own units, before scaling
+	BoundingBox box = primNode->primitive->GetBoundingBox()
+		.Expanded(primNode->radius)
+		.Scaled(primNode->scale)
+		.Transformed(TranslateRotate(*primNode));
+	bounds[primNode.get()] = box;
+}
+
+void BoundsCalculatorVisitor::operator()(std::shared_ptr<OperatorNode> opNode)
+{
+	if (opNode->InputCount() < 1) { // invalid graph, the generator will report it
+		bounds[opNode.get()] = BoundingBox::Infinite();
+		return;
+	}
+
+	std::vector<BoundingBox> inputBounds;
+	for (auto input : *opNode) {
+		input->visit(this);
+		inputBounds.push_back(bounds[input.get()]);
+	}
+
+	// the offset is subtracted after the scaling correction, in the parent's units
+	BoundingBox box = opNode->operatorDescription->CombineBounds(inputBounds)
+		.Scaled(opNode->scale)
+		.Transformed(TranslateRotate(*opNode))
+		.Expanded(opNode->radius);
+	bounds[opNode.get()] = box;
+}
+
+std::unordered_map<const Node*, BoundingBox> BoundsCalculatorVisitor::CalculateBounds(std::shared_ptr<Node> root)
+{
+	bounds.clear();
+	root->visit(this);
+	return std::move(bounds);
+}
+
+glm::mat4 BoundsCalculatorVisitor::TranslateRotate(const Node& node)
+{
+	return glm::translate(node.translate) *
+		glm::rotate(node.rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(node.rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(node.rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0));
+}
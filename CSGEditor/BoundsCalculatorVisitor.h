@@ -0,0 +1,26 @@
+#pragma once
+#include "NodeVisitor.h"
+#include "BoundingBox.h"
+#include <unordered_map>
+
+/// <summary>
+/// Calculates conservative axis aligned bounds for every node of a graph, expressed in the coordinate system of the node's parent
+/// (ie.: the node's own transform, scale and offset are already applied).
+/// </summary>
+class BoundsCalculatorVisitor : public NodeVisitor
+{
+public:
+	virtual void operator()(std::shared_ptr<PrimitiveNode> primNode) override;
+	virtual void operator()(std::shared_ptr<OperatorNode> opNode) override;
+
+	/// <summary>
+	/// Calculates the bounds of every node reachable from root.
+	/// </summary>
+	/// <returns>A map containing each node's bounds in its parent's coordinate system</returns>
+	std::unordered_map<const Node*, BoundingBox> CalculateBounds(std::shared_ptr<Node> root);
+
+private:
+	std::unordered_map<const Node*, BoundingBox> bounds;
+
+	static glm::mat4 TranslateRotate(const Node& node);
+};
@@ -0,0 +1,58 @@
+#include "BrickOctree.h"
+#include "TapeEvaluator.h"
+#include "TapeSimplifier.h"
+
+#include <cmath>
+
+void BrickOctree::Visit(const Tape& tape, glm::uvec3 min, uint32_t size, const BrickFunction& onBrick, const PrunedFunction& onPruned)
+{
+	if (size <= brickSize) {
+		onBrick(tape, min);
+		return;
+	}
+
+	uint32_t half = size / 2;
+	glm::uvec3 childMin[8];
+	for (int c = 0; c < 8; ++c)
+		childMin[c] = min + glm::uvec3(c & 1, (c >> 1) & 1, (c >> 2) & 1) * half;
+	pruningTests += 8;
+
+	if (pruning == MeshPruning::Distance) {
+		x.resize(8);
+		y.resize(8);
+		z.resize(8);
+		values.resize(8);
+		for (int c = 0; c < 8; ++c) {
+			glm::vec3 center = grid.Box(childMin[c], half).Center();
+			x[c] = center.x;
+			y[c] = center.y;
+			z[c] = center.z;
+		}
+		TapeEvaluator::Evaluate(tape, x.data(), y.data(), z.data(), values.data(), 8);
+		float reach = tape.lipschitz * glm::length(glm::vec3(half * grid.cellSize * 0.5f));
+		float centerValues[8];
+		std::copy(values.begin(), values.begin() + 8, centerValues); // the children reuse the arrays
+		for (int c = 0; c < 8; ++c) {
+			if (std::abs(centerValues[c]) <= reach)
+				Visit(tape, childMin[c], half, onBrick, onPruned);
+			else if (onPruned)
+				onPruned(childMin[c], half, centerValues[c] < 0);
+		}
+		return;
+	}
+
+	for (int c = 0; c < 8; ++c) {
+		Interval value = TapeEvaluator::EvaluateInterval(tape, grid.Box(childMin[c], half), &choices);
+		if (value.lower > 0 || value.upper < 0) {
+			if (onPruned)
+				onPruned(childMin[c], half, value.upper < 0);
+		}
+		else if (TapeSimplifier::CanSimplify(choices)) {
+			Tape simplified = TapeSimplifier::Simplify(tape, choices);
+			Visit(simplified, childMin[c], half, onBrick, onPruned);
+		}
+		else {
+			Visit(tape, childMin[c], half, onBrick, onPruned);
+		}
+	}
+}
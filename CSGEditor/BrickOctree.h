@@ -0,0 +1,60 @@
+#pragma once
+#include "Tape.h"
+#include "BoundingBox.h"
+#include <functional>
+#include <vector>
+
+/// <summary>
+/// How the meshers prove that a node of their octree doesn't contain the surface.
+/// </summary>
+enum class MeshPruning {
+	Interval, // TapeEvaluator::EvaluateInterval over the node, which also simplifies the tape for the node's children
+	Distance // |value at the center| larger than Tape::lipschitz times the half diagonal, one batch evaluation for 8 nodes
+};
+
+/// <summary>
+/// The lattice of a mesher: 2^depth cells per axis starting at origin, points addressed by their integer coordinates.
+/// Positions are always computed from the coordinates the same way, so neighbouring blocks get bitwise equal points.
+/// </summary>
+struct MeshGrid {
+	glm::vec3 origin;
+	float cellSize;
+
+	glm::vec3 Point(glm::uvec3 p) const { return origin + glm::vec3(p) * cellSize; }
+	BoundingBox Box(glm::uvec3 min, uint32_t size) const { return BoundingBox(Point(min), Point(min + glm::uvec3(size))); }
+};
+
+/// <summary>
+/// The recursion shared by the meshers inside one block of the grid: nodes are split into 8 until they are bricks of brickSize^3 cells,
+/// skipping the nodes that are proven not to contain the surface. Every point of the block ends up in a brick or in a pruned node.
+/// </summary>
+class BrickOctree
+{
+public:
+	/// <summary>
+	/// Called for every brick that may contain the surface, with a tape that is valid inside of it.
+	/// </summary>
+	using BrickFunction = std::function<void(const Tape& tape, glm::uvec3 min)>;
+
+	/// <summary>
+	/// Called for every node proven not to contain the surface, inside tells its sign.
+	/// </summary>
+	using PrunedFunction = std::function<void(glm::uvec3 min, uint32_t size, bool inside)>;
+
+	BrickOctree(const MeshGrid& grid, uint32_t brickSize, MeshPruning pruning) : grid(grid), brickSize(brickSize), pruning(pruning) {}
+
+	size_t pruningTests = 0; // counted over all Visit calls
+
+	/// <summary>
+	/// Visits the node of size^3 cells at min (size is brickSize times a power of 2), which is assumed to contain the surface.
+	/// onPruned may be empty.
+	/// </summary>
+	void Visit(const Tape& tape, glm::uvec3 min, uint32_t size, const BrickFunction& onBrick, const PrunedFunction& onPruned);
+
+private:
+	const MeshGrid& grid;
+	uint32_t brickSize;
+	MeshPruning pruning;
+	std::vector<float> x, y, z, values;
+	std::vector<TapeChoice> choices;
+};
@@ -0,0 +1,40 @@
+#include "BvhBuffers.h"
+
+#include <algorithm>
+
+BvhBuffers::~BvhBuffers()
+{
+	if (primitiveBuffer != 0)
+		glDeleteBuffers(1, &primitiveBuffer);
+	if (nodeBuffer != 0)
+		glDeleteBuffers(1, &nodeBuffer);
+}
+
+void BvhBuffers::Upload(const PrimitiveBVH& bvh)
+{
+	using GpuPrimitive = PrimitiveBVH::GpuPrimitive;
+	using GpuNode = PrimitiveBVH::GpuNode;
+	auto& primitives = bvh.GetPrimitives();
+	auto& nodes = bvh.GetNodes();
+
+	if (primitiveBuffer == 0)
+		glCreateBuffers(1, &primitiveBuffer);
+	if (nodeBuffer == 0)
+		glCreateBuffers(1, &nodeBuffer);
+
+	// buffers can't be empty, keep at least one (unused) element
+	glNamedBufferData(primitiveBuffer, std::max<size_t>(primitives.size(), 1) * sizeof(GpuPrimitive), nullptr, GL_STATIC_DRAW);
+	glNamedBufferSubData(primitiveBuffer, 0, primitives.size() * sizeof(GpuPrimitive), primitives.data());
+
+	// the node array is preceded by a header: unbounded primitive count, node count
+	glm::ivec4 header(bvh.UnboundedCount(), (int)nodes.size(), 0, 0);
+	glNamedBufferData(nodeBuffer, sizeof(header) + std::max<size_t>(nodes.size(), 1) * sizeof(GpuNode), nullptr, GL_STATIC_DRAW);
+	glNamedBufferSubData(nodeBuffer, 0, sizeof(header), &header);
+	glNamedBufferSubData(nodeBuffer, sizeof(header), nodes.size() * sizeof(GpuNode), nodes.data());
+}
+
+void BvhBuffers::Bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, primitiveBinding, primitiveBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, nodeBinding, nodeBuffer);
+}
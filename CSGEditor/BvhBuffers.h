@@ -0,0 +1,33 @@
+#pragma once
+#include "PrimitiveBVH.h"
+#include <GL/glew.h>
+
+/// <summary>
+/// Shader storage buffers holding the primitives and nodes of a PrimitiveBVH, as read by Shaders/bvh_sdf.frag.
+/// </summary>
+class BvhBuffers
+{
+public:
+	static constexpr GLuint primitiveBinding = 0;
+	static constexpr GLuint nodeBinding = 1;
+
+	BvhBuffers() = default;
+	~BvhBuffers();
+
+	BvhBuffers(const BvhBuffers&) = delete;
+	BvhBuffers& operator=(const BvhBuffers&) = delete;
+
+	/// <summary>
+	/// Uploads the result of the last Build of the bvh into the buffers.
+	/// </summary>
+	void Upload(const PrimitiveBVH& bvh);
+
+	/// <summary>
+	/// Binds the buffers to primitiveBinding and nodeBinding.
+	/// </summary>
+	void Bind() const;
+
+private:
+	GLuint primitiveBuffer = 0;
+	GLuint nodeBuffer = 0;
+};
@@ -0,0 +1,225 @@
+#include "CppGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+	// shortest decimal form that reads back as the same float
+	std::string Literal(float f) {
+		if (std::isnan(f))
+			return "std::numeric_limits<float>::quiet_NaN()";
+		if (std::isinf(f))
+			return f > 0 ? "std::numeric_limits<float>::infinity()" : "-std::numeric_limits<float>::infinity()";
+
+		std::ostringstream s;
+		s << std::setprecision(9) << f;
+		std::string text = s.str();
+		if (text.find_first_of(".e") == std::string::npos)
+			text += ".0";
+		return text + "f";
+	}
+
+	// " + f" or " - |f|", same value
+	std::string Offset(float f) {
+		if (f == 0)
+			return "";
+		return f < 0 ? " - " + Literal(-f) : " + " + Literal(f);
+	}
+
+	// row of invTransform * (x, y, z, 1) without the terms that are 0, which the compiler may not drop on its own (0 * inf is NaN)
+	std::string TransformedCoordinate(const glm::mat4& m, int row) {
+		const char* names[] = { "x[i]", "y[i]", "z[i]" };
+		std::string expr;
+		for (int column = 0; column < 3; ++column) {
+			float f = m[column][row];
+			if (f == 0)
+				continue;
+			std::string term = f == 1 ? std::string(names[column]) : std::string(names[column]) + " * " + Literal(f);
+			expr += expr.empty() ? term : " + " + term;
+		}
+		if (expr.empty())
+			return "N(" + Literal(m[3][row]) + ")";
+		return expr + Offset(m[3][row]);
+	}
+
+	std::string PrimitiveCall(const TapeInstruction& ins, const TapePrimitive& prim) {
+		const glm::vec4& p = prim.params;
+		std::string point = TransformedCoordinate(prim.invTransform, 0) + ", "
+			+ TransformedCoordinate(prim.invTransform, 1) + ", "
+			+ TransformedCoordinate(prim.invTransform, 2);
+		std::string call;
+		switch (ins.op) {
+		case TapeOpCode::Sphere:
+			call = "sdf::sphere(0.5f, " + point + ")";
+			break;
+		case TapeOpCode::Box:
+			call = "sdf::cube(" + Literal(p.x) + ", " + Literal(p.y) + ", " + Literal(p.z) + ", " + point + ")";
+			break;
+		case TapeOpCode::Cylinder:
+			call = "sdf::cylinder(" + Literal(p.x) + ", " + Literal(p.y) + ", " + point + ")";
+			break;
+		case TapeOpCode::Torus:
+			call = "sdf::torus(" + Literal(p.x) + ", " + Literal(p.y) + ", " + point + ")";
+			break;
+		case TapeOpCode::Ellipsoid:
+			call = "sdf::ellipsoid(" + Literal(p.x) + ", " + Literal(p.y) + ", " + Literal(p.z) + ", " + point + ")";
+			break;
+		case TapeOpCode::Mesh:
+			throw std::invalid_argument("The generated code can't sample the bakes of meshes.");
+		default:
+			call = "sdf::plane(" + Literal(p.x) + ", " + Literal(p.y) + ", " + Literal(p.z) + ", " + Literal(p.w) + ", " + point + ")";
+			break;
+		}
+
+		// same rounding as TapeEvaluator: subtracting 0 and multiplying by 1 change nothing
+		if (prim.radius != 0)
+			call = "(" + call + Offset(-prim.radius) + ")";
+		if (prim.scale != 1)
+			call += " * " + Literal(prim.scale);
+		return call;
+	}
+
+	std::string OperatorCall(const TapeInstruction& ins, const std::string& a, const std::string& b) {
+		switch (ins.op) {
+		case TapeOpCode::Union:
+			return "dmin(" + a + ", " + b + ")";
+		case TapeOpCode::Intersection:
+			return "dmax(" + a + ", " + b + ")";
+		case TapeOpCode::Substraction:
+			return "dmax(" + a + ", -" + b + ")";
+		case TapeOpCode::SmoothUnion:
+			return "sdf::smooth_union(" + a + ", " + b + ", " + Literal(ins.k) + ")";
+		case TapeOpCode::SmoothIntersection:
+			return "sdf::smooth_intersection(" + a + ", " + b + ", " + Literal(ins.k) + ")";
+		case TapeOpCode::SmoothSubstraction:
+			return "sdf::smooth_substraction(" + a + ", " + b + ", " + Literal(ins.k) + ")";
+		default: { // ScaleOffset
+			std::string expr = a;
+			if (ins.scale != 1)
+				expr += " * " + Literal(ins.scale);
+			expr += Offset(-ins.offset);
+			return expr;
+		}
+		}
+	}
+
+	// the batch functions around the sdf, they only depend on the maximal derivative order
+	const char* drivers = R"(
+	// the last block of a batch is padded by repeating its last point
+	void LoadBlock(const float* p, size_t n, float* lanes) {
+		for (size_t i = 0; i < blockSize; ++i)
+			lanes[i] = p[i < n ? i : n - 1];
+	}
+
+	template<int Order>
+	void EvaluateDual(const float* x, const float* y, const float* z, float* parts, size_t count) {
+		using D = Dual<Order, simd::vfloat>;
+		float lanes[3][blockSize];
+		float results[D::size][blockSize];
+		D p[3][vectors], result[vectors];
+		for (size_t begin = 0; begin < count; begin += blockSize) {
+			size_t n = count - begin < blockSize ? count - begin : blockSize;
+			LoadBlock(x + begin, n, lanes[0]);
+			LoadBlock(y + begin, n, lanes[1]);
+			LoadBlock(z + begin, n, lanes[2]);
+			for (int axis = 0; axis < 3; ++axis)
+				for (size_t v = 0; v < vectors; ++v)
+					p[axis][v] = D::Variable(simd::vfloat::Load(lanes[axis] + v * width), axis);
+			Sdf(p[0], p[1], p[2], result);
+			for (size_t v = 0; v < vectors; ++v)
+				for (int k = 0; k < D::size; ++k)
+					result[v].d[k].Store(results[k] + v * width);
+			for (size_t i = 0; i < n; ++i)
+				for (int k = 0; k < D::size; ++k)
+					parts[(begin + i) * D::size + k] = results[k][i];
+		}
+	}
+}
+
+extern "C" CSG_JIT_EXPORT void csg_sdf(const float* x, const float* y, const float* z, float* distances, size_t count) {
+	float lanes[3][blockSize];
+	float results[blockSize];
+	simd::vfloat p[3][vectors], result[vectors];
+	for (size_t begin = 0; begin < count; begin += blockSize) {
+		size_t n = count - begin < blockSize ? count - begin : blockSize;
+		LoadBlock(x + begin, n, lanes[0]);
+		LoadBlock(y + begin, n, lanes[1]);
+		LoadBlock(z + begin, n, lanes[2]);
+		for (int axis = 0; axis < 3; ++axis)
+			for (size_t v = 0; v < vectors; ++v)
+				p[axis][v] = simd::vfloat::Load(lanes[axis] + v * width);
+		Sdf(p[0], p[1], p[2], result);
+		for (size_t v = 0; v < vectors; ++v)
+			result[v].Store(results + v * width);
+		for (size_t i = 0; i < n; ++i)
+			distances[begin + i] = results[i];
+	}
+}
+)";
+}
+
+std::string CppGenerator::Generate(const Tape& tape, int maxOrder)
+{
+	if (tape.instructions.empty())
+		throw std::runtime_error("The tape is empty.");
+
+	std::ostringstream code;
+	code << "// generated by CppGenerator from a tape of " << tape.instructions.size() << " instructions\n"
+		<< "#include \"SdfFormulas.h\"\n"
+		<< "#include \"Dual.h\"\n"
+		<< "#include <cstddef>\n"
+		<< "#include <limits>\n\n"
+		<< "#if defined(_WIN32)\n"
+		<< "#define CSG_JIT_EXPORT __declspec(dllexport)\n"
+		<< "#define CSG_JIT_PART __declspec(noinline)\n"
+		<< "#else\n"
+		<< "#define CSG_JIT_EXPORT __attribute__((visibility(\"default\")))\n"
+		<< "#define CSG_JIT_PART __attribute__((noinline, flatten))\n" // the inliner gives up on long functions otherwise
+		<< "#endif\n\n"
+		<< "namespace {\n"
+		<< "\tconstexpr size_t width = simd::vfloat::width;\n"
+		<< "\tconstexpr size_t vectors = " << blockVectors << ";\n"
+		<< "\tconstexpr size_t blockSize = width * vectors;\n\n"
+		<< "\ttemplate<typename N>\n"
+		<< "\tstruct Registers {\n"
+		<< "\t\tN ";
+	for (uint32_t r = 0; r < tape.registerCount; ++r)
+		code << (r ? ", r" : "r") << r << "[vectors]";
+	code << ";\n\t};\n";
+
+	// the instructions are split into functions of partSize instructions: the optimizer's cost grows faster than linearly with the function size
+	size_t partCount = (tape.instructions.size() + partSize - 1) / partSize;
+	for (size_t part = 0; part < partCount; ++part) {
+		code << "\n\ttemplate<typename N>\n"
+			<< "\tCSG_JIT_PART void Part" << part << "(const N* x, const N* y, const N* z, Registers<N>& r) {\n"
+			<< "\t\tusing sdf::dmin;\n"
+			<< "\t\tusing sdf::dmax;\n";
+		size_t end = std::min(tape.instructions.size(), (part + 1) * partSize);
+		for (size_t i = part * partSize; i < end; ++i) {
+			const TapeInstruction& ins = tape.instructions[i];
+			std::string expr = ins.IsPrimitive()
+				? PrimitiveCall(ins, tape.primitives[ins.primitive])
+				: OperatorCall(ins, "r.r" + std::to_string(ins.a) + "[i]", "r.r" + std::to_string(ins.b) + "[i]");
+			code << "\t\tfor (size_t i = 0; i < vectors; ++i) r.r" << ins.out << "[i] = " << expr << ";\n";
+		}
+		code << "\t}\n";
+	}
+
+	code << "\n\ttemplate<typename N>\n"
+		<< "\tvoid Sdf(const N* x, const N* y, const N* z, N* result) {\n"
+		<< "\t\tRegisters<N> r;\n";
+	for (size_t part = 0; part < partCount; ++part)
+		code << "\t\tPart" << part << "(x, y, z, r);\n";
+	code << "\t\tfor (size_t i = 0; i < vectors; ++i) result[i] = r.r" << tape.resultRegister << "[i];\n"
+		<< "\t}\n"
+		<< drivers;
+
+	code << "\nextern \"C\" CSG_JIT_EXPORT int csg_abi_version() { return " << abiVersion << "; }\n";
+	for (int order = 1; order <= maxOrder; ++order)
+		code << "\nextern \"C\" CSG_JIT_EXPORT void csg_sdf_d" << order
+			<< "(const float* x, const float* y, const float* z, float* parts, size_t count) { EvaluateDual<" << order << ">(x, y, z, parts, count); }\n";
+	return code.str();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Tape.h"
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// Emits a C++ translation unit evaluating a tape, the CPU counterpart of SDFGenerator: every instruction becomes one statement
+/// with its transform, parameters and smoothing baked in as literals, so the compiler optimizes across the whole sdf.
+/// The statements call the templates of SdfFormulas.h and Dual.h, so the CSGEditor directory must be on the include path (see JitSdf).
+///
+/// The unit exports these extern "C" functions, all taking the points as separate x, y, z arrays:
+///   int csg_abi_version() returns abiVersion,
+///   void csg_sdf(const float* x, const float* y, const float* z, float* distances, size_t count),
+///   void csg_sdf_d1 .. csg_sdf_d[maxOrder](const float* x, const float* y, const float* z, float* parts, size_t count),
+///   where parts receives Dual<Order>::size floats per point, in the order of Dual::d.
+/// </summary>
+class CppGenerator
+{
+public:
+	static constexpr int abiVersion = 1;
+
+	/// <summary>
+	/// Simd vectors evaluated together by every statement, like the blocks of TapeEvaluator: the independent iterations hide the latency of the formulas.
+	/// </summary>
+	static constexpr int blockVectors = 8;
+
+	/// <summary>
+	/// Instructions per generated function, bounds the compile time of large graphs.
+	/// </summary>
+	static constexpr size_t partSize = 32;
+
+	/// <summary>
+	/// Throws std::invalid_argument for tapes that sample bakes (meshes): the code only contains constants.
+	/// </summary>
+	static std::string Generate(const Tape& tape, int maxOrder = 1);
+};
@@ -0,0 +1,274 @@
+#include "CpuRenderer.h"
+#include "TapeEvaluator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace {
+	// the functions below are the ones of trace.frag with the same names
+
+	glm::vec3 color_by_steps(int steps) {
+		float ratio = steps / float(CpuRenderer::maxSteps);
+		glm::vec3 rgb(0);
+		rgb.r = std::min(1.0f, ratio * 3);
+		rgb.g = glm::clamp((ratio - 1.0f / 3) * 3, 0.0f, 1.0f);
+		rgb.b = glm::clamp((ratio - 2.0f / 3) * 3, 0.0f, 1.0f);
+		return rgb;
+	}
+
+	glm::mat3 adjoint(const glm::mat3& m) {
+		return glm::mat3( // column major, like in glsl
+			m[1][1] * m[2][2] - m[2][1] * m[1][2], -(m[1][0] * m[2][2] - m[2][0] * m[1][2]), m[1][0] * m[2][1] - m[2][0] * m[1][1],
+			-(m[0][1] * m[2][2] - m[2][1] * m[0][2]), m[0][0] * m[2][2] - m[2][0] * m[0][2], -(m[0][0] * m[2][1] - m[2][0] * m[0][1]),
+			m[0][1] * m[1][2] - m[1][1] * m[0][2], -(m[0][0] * m[1][2] - m[1][0] * m[0][2]), m[0][0] * m[1][1] - m[1][0] * m[0][1]
+		);
+	}
+
+	float gaussian_curvature(const glm::vec3& gradient, const glm::mat3& hessian) {
+		return glm::dot(glm::transpose(adjoint(hessian)) * gradient, gradient) / std::pow(glm::length(gradient), 4.0f);
+	}
+
+	float mean_curvature(const glm::vec3& gradient, const glm::mat3& hessian) {
+		return (glm::dot(glm::transpose(hessian) * gradient, gradient) - glm::dot(gradient, gradient) * (hessian[0][0] + hessian[1][1] + hessian[2][2]))
+			/ (2 * std::pow(glm::length(gradient), 3.0f));
+	}
+
+	glm::vec4 color_by_curvature(float curvature, float visMultiplier) {
+		if (curvature >= 0)
+			return glm::mix(glm::vec4(1), glm::vec4(0, 1, 0, 1), curvature * visMultiplier);
+		return glm::mix(glm::vec4(1), glm::vec4(1, 0, 0, 1), -curvature * visMultiplier);
+	}
+
+	glm::vec3 dual_gradient(const Dual<2>& d) { return glm::vec3(d.d[1], d.d[2], d.d[3]); }
+
+	glm::mat3 dual_hessian(const Dual<2>& d) {
+		using D = Dual<2>;
+		return glm::mat3(
+			d.d[D::Idx(2, 0, 0)], d.d[D::Idx(1, 1, 0)], d.d[D::Idx(1, 0, 1)],
+			d.d[D::Idx(1, 1, 0)], d.d[D::Idx(0, 2, 0)], d.d[D::Idx(0, 1, 1)],
+			d.d[D::Idx(1, 0, 1)], d.d[D::Idx(0, 1, 1)], d.d[D::Idx(0, 0, 2)]
+		);
+	}
+
+	/// Points of a tile waiting for one batch evaluation.
+	struct Batch {
+		std::vector<float> x, y, z, distances;
+
+		void Clear() { x.clear(); y.clear(); z.clear(); }
+		void Add(glm::vec3 p) { x.push_back(p.x); y.push_back(p.y); z.push_back(p.z); }
+		size_t Size() const { return x.size(); }
+
+		// returns the number of evaluated points
+		size_t Evaluate(const Tape& tape) {
+			distances.resize(x.size());
+			TapeEvaluator::Evaluate(tape, x.data(), y.data(), z.data(), distances.data(), x.size());
+			return x.size();
+		}
+	};
+
+	// central difference stencil of approx_gradient: +x, -x, +y, -y, +z, -z
+	void AddGradientStencil(Batch& batch, glm::vec3 p, float eps) {
+		for (int axis = 0; axis < 3; ++axis) {
+			glm::vec3 offset(0);
+			offset[axis] = eps;
+			batch.Add(p + offset);
+			batch.Add(p - offset);
+		}
+	}
+
+	// differences of the stencil starting at first, not yet divided by 2 * eps
+	glm::vec3 StencilDifferences(const Batch& batch, size_t first) {
+		const float* d = batch.distances.data() + first;
+		return glm::vec3(d[0] - d[1], d[2] - d[3], d[4] - d[5]);
+	}
+}
+
+Image CpuRenderer::Render(const Tape& tape, glm::vec3 eye, const glm::mat4& viewProj, int width, int height, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	Image image(width, height, background);
+	glm::mat4 invViewProj = glm::inverse(viewProj);
+
+	std::vector<Tile> tiles;
+	for (int y = 0; y < height; y += tileSize)
+		for (int x = 0; x < width; x += tileSize)
+			tiles.push_back({ x, y, std::min(x + tileSize, width), std::min(y + tileSize, height) });
+
+	// one tile per chunk: the threads take the next unrendered tile when they finish one, so expensive tiles don't hold the others back
+	std::atomic<size_t> evaluations{ 0 };
+	pool.ParallelFor(tiles.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			evaluations += RenderTile(tape, eye, invViewProj, image, tiles[i]);
+	});
+
+	stats.rays = size_t(width) * height;
+	stats.sdfEvaluations = evaluations;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return image;
+}
+
+size_t CpuRenderer::RenderTile(const Tape& tape, glm::vec3 eye, const glm::mat4& invViewProj, Image& image, const Tile& tile) const
+{
+	const int width = tile.x1 - tile.x0;
+	const size_t count = size_t(width) * (tile.y1 - tile.y0);
+	size_t evaluations = 0;
+	Batch batch;
+
+	// get_ray, the rows of the image go from top to bottom
+	std::vector<glm::vec3> rays(count), positions(count, eye);
+	for (size_t i = 0; i < count; ++i) {
+		int px = tile.x0 + int(i % width), py = tile.y0 + int(i / width);
+		glm::vec2 uv((px + 0.5f) / image.width * 2 - 1, 1 - (py + 0.5f) / image.height * 2);
+		glm::vec4 a = invViewProj * glm::vec4(uv.x, uv.y, -1, 1);
+		glm::vec4 b = invViewProj * glm::vec4(uv.x, uv.y, 1, 1);
+		rays[i] = glm::normalize(glm::vec3(b) / b.w - glm::vec3(a) / a.w);
+	}
+
+	// sphere tracing, all rays of the tile advance together
+	batch.Add(eye);
+	evaluations += batch.Evaluate(tape);
+	std::vector<float> dist(count, batch.distances[0]), t(count, 0.0f);
+	std::vector<int> steps(count, maxSteps);
+	std::vector<uint32_t> active, stillActive;
+	for (uint32_t i = 0; i < count; ++i)
+		if (dist[i] > stopDist)
+			active.push_back(i);
+
+	while (!active.empty()) {
+		batch.Clear();
+		for (uint32_t i : active) {
+			--steps[i];
+			positions[i] += rays[i] * dist[i];
+			t[i] += dist[i];
+			batch.Add(positions[i]);
+		}
+		evaluations += batch.Evaluate(tape);
+
+		stillActive.clear();
+		for (size_t j = 0; j < active.size(); ++j) {
+			uint32_t i = active[j];
+			dist[i] = batch.distances[j];
+			if (steps[i] > 0 && dist[i] > stopDist && t[i] < maxDist)
+				stillActive.push_back(i);
+		}
+		std::swap(active, stillActive);
+	}
+
+	// pixels that are decided without derivatives
+	std::vector<uint32_t> hits;
+	for (uint32_t i = 0; i < count; ++i) {
+		glm::vec4& color = image.At(tile.x0 + int(i % width), tile.y0 + int(i / width));
+		const glm::vec3& pos = positions[i];
+		if (steps[i] == maxSteps) // out of steps
+			color = glm::vec4(1, 1, 0, 1);
+		else if (displayMode == DisplayMode::Steps)
+			color = glm::vec4(color_by_steps(maxSteps - steps[i]), 1);
+		else if (t[i] >= maxDist || std::isinf(pos.x) || std::isinf(pos.y) || std::isinf(pos.z))
+			continue; // discard
+		else
+			hits.push_back(i);
+	}
+	if (hits.empty())
+		return evaluations;
+
+	const bool curvature = displayMode == DisplayMode::GaussianCurvature || displayMode == DisplayMode::MeanCurvature;
+	const bool needsApproxNormal = !useAutoDiff || displayMode == DisplayMode::NormalError;
+	const bool needsDual = useAutoDiff || displayMode == DisplayMode::NormalError;
+	const bool needsApproxCurvature = curvature && !useAutoDiff;
+
+	// dual numbers: first order for the normals, second order for the curvatures
+	std::vector<Dual<2>> duals2;
+	std::vector<Dual<1>> duals1;
+	if (needsDual) {
+		batch.Clear();
+		for (uint32_t i : hits)
+			batch.Add(positions[i]);
+		if (curvature) {
+			duals2.resize(hits.size());
+			TapeEvaluator::EvaluateDerivatives(tape, batch.x.data(), batch.y.data(), batch.z.data(), duals2.data(), hits.size());
+		}
+		else {
+			duals1.resize(hits.size());
+			TapeEvaluator::EvaluateDerivatives(tape, batch.x.data(), batch.y.data(), batch.z.data(), duals1.data(), hits.size());
+		}
+		evaluations += hits.size();
+	}
+
+	// central differences: approx_normal (or approx_gradient), and for the curvatures the gradients around the point for approx_hessian
+	Batch differences;
+	const size_t stencilsPerHit = needsApproxCurvature ? 7 : 1;
+	if (needsApproxNormal || needsApproxCurvature) {
+		for (uint32_t i : hits) {
+			AddGradientStencil(differences, positions[i], eps);
+			if (needsApproxCurvature) {
+				for (int axis = 0; axis < 3; ++axis) {
+					glm::vec3 offset(0);
+					offset[axis] = eps;
+					AddGradientStencil(differences, positions[i] + offset, eps);
+					AddGradientStencil(differences, positions[i] - offset, eps);
+				}
+			}
+		}
+		evaluations += differences.Evaluate(tape);
+	}
+
+	for (size_t h = 0; h < hits.size(); ++h) {
+		uint32_t i = hits[h];
+		glm::vec4& color = image.At(tile.x0 + int(i % width), tile.y0 + int(i / width));
+		const glm::vec3& pos = positions[i];
+		size_t stencil = h * stencilsPerHit * 6;
+
+		glm::vec3 dualNormal(0), approxNormal(0);
+		if (needsDual)
+			dualNormal = glm::normalize(curvature ? dual_gradient(duals2[h]) : glm::vec3(duals1[h].d[1], duals1[h].d[2], duals1[h].d[3]));
+		if (needsApproxNormal)
+			approxNormal = glm::normalize(StencilDifferences(differences, stencil));
+		glm::vec3 normal = useAutoDiff ? dualNormal : approxNormal;
+
+		if (displayMode == DisplayMode::Normals) {
+			color = glm::vec4(normal, 1);
+			continue;
+		}
+		if (displayMode == DisplayMode::NormalError) {
+			color = glm::vec4(glm::abs(dualNormal - approxNormal) * 5.0f, 1);
+			continue;
+		}
+		if (curvature && useAutoDiff) {
+			glm::vec3 gradient = dual_gradient(duals2[h]);
+			glm::mat3 hessian = dual_hessian(duals2[h]);
+			float k = displayMode == DisplayMode::GaussianCurvature ? gaussian_curvature(gradient, hessian) : mean_curvature(gradient, hessian);
+			color = color_by_curvature(k, visMultiplier);
+			continue;
+		}
+		if (curvature) {
+			glm::vec3 gradient = StencilDifferences(differences, stencil) / (2 * eps);
+			glm::vec3 g[6]; // approx_gradient at +x, -x, +y, -y, +z, -z
+			for (int s = 0; s < 6; ++s)
+				g[s] = StencilDifferences(differences, stencil + 6 * (s + 1)) / (2 * eps);
+			glm::mat3 hessian = glm::mat3(g[0] - g[1], g[2] - g[3], g[4] - g[5]) / (2 * eps);
+			if (displayMode == DisplayMode::GaussianCurvature) {
+				float k = gaussian_curvature(gradient, hessian);
+				color = std::isnan(k) ? glm::vec4(1, 0, 1, 1) : color_by_curvature(k, visMultiplier);
+			}
+			else {
+				color = color_by_curvature(mean_curvature(gradient, hessian), visMultiplier);
+			}
+			continue;
+		}
+
+		if (std::isnan(normal.x)) {
+			color = glm::vec4(1, 0, 1, 1);
+			continue;
+		}
+
+		// phong shading
+		glm::vec3 view = eye - pos;
+		float kd = 0.5f;
+		float diffuse = kd * std::max(0.0f, glm::dot(normal, toLight));
+		float specular = 0.5f * std::pow(std::max(glm::dot(glm::normalize(view), glm::reflect(-toLight, normal)), 0.0f), 30.0f);
+		color = glm::vec4(diffuse, diffuse, diffuse, 1) + glm::vec4(specular, specular, specular, 1);
+	}
+	return evaluations;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "Tape.h"
+#include "ImageIO.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+
+/// <summary>
+/// Same values as the DISPLAY_MODE_ defines of Shaders/trace.frag (and App::DisplayMode).
+/// </summary>
+enum class DisplayMode {
+	Shaded = 0,
+	Steps = 1,
+	Normals = 2,
+	GaussianCurvature = 3,
+	MeanCurvature = 4,
+	NormalError = 5
+};
+
+struct RenderStats {
+	size_t rays = 0;
+	size_t sdfEvaluations = 0; // points evaluated, for tracing and for the derivatives
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// CPU port of Shaders/trace.frag: sphere traces a tape with the same constants and shades the hits with the same display modes,
+/// for machines without a usable GPU and for batch renders from the command line.
+/// The image is split into tiles that the threads of the pool take one by one. The rays of a tile advance together,
+/// so each step is a single batch evaluation (TapeEvaluator::Evaluate) over the rays still marching.
+/// </summary>
+class CpuRenderer
+{
+public:
+	// sphere tracing settings of trace.frag
+	static constexpr int maxSteps = 500;
+	static constexpr float stopDist = 0.0001f;
+	static constexpr float maxDist = 1000.0f;
+
+	DisplayMode displayMode = DisplayMode::Shaded;
+	float visMultiplier = 0.1f; // strength of the curvature colors
+	bool useAutoDiff = false; // derivatives with dual numbers instead of central differences
+	float eps = 0.01f; // step of the central differences
+	glm::vec3 toLight = glm::normalize(glm::vec3(1.5f, 2.0f, 1.0f)); // same as App::dirToLight
+	glm::vec4 background = glm::vec4(1); // the editor clears to white, discarded pixels show this
+	int tileSize = 16;
+
+	/// <summary>
+	/// Renders the sdf seen from eye with the projection * view matrix viewProj. Row 0 of the image is the top of the view.
+	/// </summary>
+	Image Render(const Tape& tape, glm::vec3 eye, const glm::mat4& viewProj, int width, int height, ThreadPool& pool = ThreadPool::Global());
+
+	/// <summary>
+	/// Counters of the last Render call.
+	/// </summary>
+	const RenderStats& Stats() const { return stats; }
+
+private:
+	RenderStats stats;
+
+	struct Tile {
+		int x0, y0, x1, y1;
+	};
+
+	size_t RenderTile(const Tape& tape, glm::vec3 eye, const glm::mat4& invViewProj, Image& image, const Tile& tile) const;
+};
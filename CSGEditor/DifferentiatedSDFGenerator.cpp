@@ -1,7 +1,10 @@
 #include "DifferentiatedSDFGenerator.h"
+#include "SDFGenerator.h"
 #include "exceptions.h"
 #include "ShaderLibManager.h"
 
+#include <algorithm>
+
 #include <glm/gtx/transform.hpp>
 
 #define NOT_ASSIGNED -1
@@ -23,9 +26,37 @@ void DifferentiatedSDFGenerator::operator()(std::shared_ptr<OperatorNode> opnode
 	transformStack.push(transformMatrix);
 
 	// traverse children, generate their code
-	for (auto nb : *opnode) {
-		nb->visit(this);
+	bool guarded = useBoundingGuards && opnode->operatorDescription->SupportsGuards();
+	int accumulator = NOT_ASSIGNED; // holds the operator applied to the inputs generated so far, only needed for guarding more than two inputs
+	std::string accumulatedName;
+	for (int i = 0; i < opnode->InputCount(); ++i) {
+		auto input = (*opnode)[i];
+		if (!guarded || i == 0) {
+			input->visit(this);
+			if (!guarded)
+				continue;
+		}
+		else {
+			VisitGuarded(opnode, input, accumulatedName);
+		}
+
+		std::string inputName = regNamePrefix + std::to_string(TraversalId(input));
+		if (i == 0 && opnode->InputCount() > 2) {
+			accumulator = AllocateRegister();
+			accumulatedName = regNamePrefix + std::to_string(accumulator);
+			code << accumulatedName << " = " << inputName << ";\n";
+		}
+		else if (i == 0) {
+			accumulatedName = inputName;
+		}
+		else if (accumulator != NOT_ASSIGNED && i + 1 < opnode->InputCount()) {
+			code << accumulatedName << " = (";
+			opnode->operatorDescription->GenerateShader(code, { accumulatedName, inputName });
+			code << ");\n";
+		}
 	}
+	if (accumulator != NOT_ASSIGNED)
+		FreeRegister(accumulator);
 
 	transformStack.pop();
 
@@ -80,11 +111,7 @@ void DifferentiatedSDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primN
 
 	auto invTransform = glm::inverse(transform); // inverse for moving the sampling point instead of the primitive
 
-	if (!createdInvVar) { // define variables for holding the inv transf mtx + the sampling coordinate
-		code << "mat4 " << invTransformVarName << ";\n";
-		code << "dnum3 " << transfSampleCoordName << ";\n";
-		createdInvVar = true;
-	}
+	createdInvVar = true; // the variables holding the inv transf mtx + the sampling coordinate are declared at the beginning of the function
 
 	// fill inv transf mtx
 	code << invTransformVarName << "[0] = " << createVec4(invTransform[0]) << ";\n";
@@ -95,16 +122,21 @@ void DifferentiatedSDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primN
 	// compute sampling coordinate for sampling the primitive in its basic (non-transformed) form
 	code << transfSampleCoordName << " = " << "div3(asDnum3(mat_mul(" << invTransformVarName << ", dnum4(" << sampleCoordName << ".x, " << sampleCoordName << ".y, " << sampleCoordName << ".z, " << "constant(1.0)))), " << "constant("<<primNode->scale << ")); \n";
 
-	if (reg == registerCount) { // declare variable for storing result if it hasn't been declared yet.
-		registerCount++;
-		code << "dnum " << regName << ";\n";
-	}
-
 	code << regName << " = mul(";
 	if (primNode->radius != 0) // offset
 		code << "sub(";
-	code << "d_"; // call primitive shader generation 
-	primNode->primitive->GenerateShader(code, transfSampleCoordName);
+	if (auto bake = primNode->primitive->GetBake()) { // imported meshes, see SDFGenerator::GenerateBakeLookup
+		size_t sampler = std::find(usedBakes.begin(), usedBakes.end(), bake) - usedBakes.begin();
+		if (sampler == usedBakes.size())
+			usedBakes.push_back(bake);
+		sampledBakes = true;
+		code << "d_baked(" << SDFGenerator::BakeSamplerName(sampler) << ", " << transfSampleCoordName << ", " << bake->min << ", " << bake->size
+			<< ", " << bake->band << ")";
+	}
+	else {
+		code << "d_"; // call primitive shader generation
+		primNode->primitive->GenerateShader(code, transfSampleCoordName);
+	}
 
 	if (primNode->radius != 0) // offset
 		code << ", constant(" << primNode->radius << "))";
@@ -115,22 +147,89 @@ void DifferentiatedSDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primN
 
 std::string DifferentiatedSDFGenerator::GenerateFromRoot(std::shared_ptr<Node> root)
 {
-	code.clear();
+	code.str("");
 	createdInvVar = false;
 	createdTempVec3 = false;
 	nextRegister = 0;
 	freeRegisters.clear();
+	usedBakes = declaredBakes;
+	sampledBakes = false;
 	while (!transformStack.empty())
 		transformStack.pop();
 	transformStack.push(glm::identity<glm::mat4>());
 
-	code << "dnum dsdf(dnum3 "<< sampleCoordName<<") {\n";
+	if (useBoundingGuards)
+		bounds = BoundsCalculatorVisitor().CalculateBounds(root);
+
 	root->visit(this);
 	transformStack.pop();
 
-	code << "return " << regNamePrefix << TraversalId(root) << ";\n}\n";
+	// variables are declared at the beginning of the function, because guarded code is generated inside if blocks
+	std::stringstream function;
+	for (size_t i = declaredBakes.size(); i < usedBakes.size(); ++i)
+		function << "uniform sampler3D " << SDFGenerator::BakeSamplerName(i) << ";\n";
+	if (sampledBakes) {
+		// r_baked of SDFGenerator on dual numbers: outside of the box the distance to it plus band, inside the trilinear filtering of
+		// texture() (GL_LINEAR, clamp to edge) written out, so the weights carry the derivatives
+		function << "dnum d_baked(sampler3D bake, dnum3 p, vec3 bmin, vec3 bsize, float band) {\n";
+		function << "vec3 center = bmin + 0.5 * bsize;\n";
+		function << "vec3 real = vec3(realValue(p.x), realValue(p.y), realValue(p.z));\n";
+		function << "if (max(abs(real - center) - 0.5 * bsize, 0.0) != vec3(0)) return add(d_cube(0.5 * bsize, sub3(p, constant3(center))), constant(band));\n";
+		function << "ivec3 size = textureSize(bake, 0);\n";
+		function << "vec3 scale = vec3(size) / bsize;\n"; // texel space, the centers of the texels are at integers
+		function << "dnum tx = sub(mul(sub(p.x, constant(bmin.x)), scale.x), constant(0.5));\n";
+		function << "dnum ty = sub(mul(sub(p.y, constant(bmin.y)), scale.y), constant(0.5));\n";
+		function << "dnum tz = sub(mul(sub(p.z, constant(bmin.z)), scale.z), constant(0.5));\n";
+		function << "vec3 base = floor(vec3(realValue(tx), realValue(ty), realValue(tz)));\n";
+		function << "dnum fx = sub(tx, constant(base.x)), fy = sub(ty, constant(base.y)), fz = sub(tz, constant(base.z));\n";
+		function << "float c[8];\n";
+		function << "for (int k = 0; k < 8; ++k) c[k] = texelFetch(bake, clamp(ivec3(base) + ivec3(k & 1, (k >> 1) & 1, k >> 2), ivec3(0), size - 1), 0).r;\n";
+		function << "dnum x00 = add(constant(c[0]), mul(fx, c[1] - c[0])), x10 = add(constant(c[2]), mul(fx, c[3] - c[2]));\n";
+		function << "dnum x01 = add(constant(c[4]), mul(fx, c[5] - c[4])), x11 = add(constant(c[6]), mul(fx, c[7] - c[6]));\n";
+		function << "dnum y0 = add(x00, mul(fy, sub(x10, x00))), y1 = add(x01, mul(fy, sub(x11, x01)));\n";
+		function << "return add(y0, mul(fz, sub(y1, y0)));\n}\n";
+	}
+	function << "dnum dsdf(dnum3 "<< sampleCoordName<<") {\n";
+	if (useBoundingGuards) // the guards compare real distances
+		function << "vec3 " << realSampleCoordName << " = vec3(realValue(" << sampleCoordName << ".x), realValue(" << sampleCoordName << ".y), realValue(" << sampleCoordName << ".z));\n";
+	if (createdInvVar) { // define variables for holding the inv transf mtx + the sampling coordinate
+		function << "mat4 " << invTransformVarName << ";\n";
+		function << "dnum3 " << transfSampleCoordName << ";\n";
+	}
+	for (int i = 0; i < nextRegister; ++i)
+		function << "dnum " << regNamePrefix << i << ";\n";
+
+	function << code.str();
+	function << "return " << regNamePrefix << TraversalId(root) << ";\n}\n";
 	TraversalId(root) = NOT_ASSIGNED;
-	return ShaderLibManager::GenerateFromTemplate(code.str(), true);
+	return ShaderLibManager::GenerateFromTemplate(function.str(), true);
+}
+
+void DifferentiatedSDFGenerator::VisitGuarded(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<Node> input, const std::string& accumulatedName)
+{
+	// generate the input's code separately: the register holding its value is only known afterwards
+	std::stringstream inputCode;
+	std::swap(code, inputCode);
+	input->visit(this);
+	std::swap(code, inputCode);
+
+	BoundingBox box = bounds.at(input.get()).Transformed(transformStack.top());
+	if (box.IsInfinite()) {
+		code << inputCode.str();
+		return;
+	}
+	box = box.Expanded(1e-4f * (1 + glm::length(box.max - box.min))); // make up for the rounding of the printed constants
+
+	// the registers hold distances in the operator's units, the box is in world space
+	float unitScale = glm::length(glm::vec3(transformStack.top()[0]));
+	std::string inputName = regNamePrefix + std::to_string(TraversalId(input));
+
+	code << inputName << " = _constant_(r_box_bound(" << realSampleCoordName << ", " << box.Center() << ", " << box.HalfSize() << ") / " << unitScale << ");\n";
+	code << "if (!(";
+	opnode->operatorDescription->GenerateGuardCondition(code, accumulatedName, inputName);
+	code << ")) {\n";
+	code << inputCode.str();
+	code << "}\n";
 }
 
 int DifferentiatedSDFGenerator::AllocateRegister()
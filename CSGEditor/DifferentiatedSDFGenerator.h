@@ -1,7 +1,11 @@
 #pragma once
 #include "NodeVisitor.h"
+#include "BoundsCalculatorVisitor.h"
+#include "DistanceBake.h"
+#include <memory>
 #include <stack>
 #include <sstream>
+#include <vector>
 
 /// <summary>
 /// Implements a modified depth first traversal of the graph for generating the dual sdf
@@ -20,6 +24,23 @@ public:
 	/// <returns> the glsl code of the dual sdf</returns>
 	std::string GenerateFromRoot(std::shared_ptr<Node> root);
 
+	/// <summary>
+	/// If true, the inputs of operators are only evaluated if the distance to their bounding box can change the result (see Operator::GenerateGuardCondition).
+	/// </summary>
+	bool useBoundingGuards = false;
+
+	/// <summary>
+	/// The bakes whose samplers (SDFGenerator::BakeSamplerName) are already declared by the real sdf that is compiled together with this one,
+	/// ie.: its SDFGenerator::GetUsedBakes(). Imported meshes sample their bakes with dual numbers from the same samplers, bakes that aren't
+	/// in the list get the next samplers, declared by the dual sdf.
+	/// </summary>
+	std::vector<std::shared_ptr<const DistanceBake>> declaredBakes;
+
+	/// <summary>
+	/// declaredBakes followed by the bakes the last generated dual sdf added, in the order of their samplers.
+	/// </summary>
+	const std::vector<std::shared_ptr<const DistanceBake>>& GetUsedBakes() const { return usedBakes; }
+
 private:
 	std::stack<glm::mat4> transformStack;
 
@@ -33,15 +54,23 @@ private:
 	bool createdTempVec3 = false;
 	std::string tempVec3Name = "tmpv3";
 
-	int registerCount = 0;
+	std::unordered_map<const Node*, BoundingBox> bounds; // bounds of every node in its parent's coordinate system, only calculated if guards are used
+	std::vector<std::shared_ptr<const DistanceBake>> usedBakes;
+	bool sampledBakes = false; // whether d_baked is needed
 
 	const std::string regNamePrefix = "var";
 	const std::string sampleCoordName = "pos";
 	const std::string transfSampleCoordName = "posTransf";
+	const std::string realSampleCoordName = "posReal";
 
 	int AllocateRegister();
 	void FreeRegister(int id);
 
+	/// <summary>
+	/// Generates the code of an operator's input inside an if block, which is skipped if the distance to the input's bounding box can't change the operator's result.
+	/// </summary>
+	void VisitGuarded(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<Node> input, const std::string& accumulatedName);
+
 	std::string createVec4(glm::vec4 v);
 };
 
@@ -0,0 +1,268 @@
+#include "DistanceBake.h"
+#include "BoundsCalculatorVisitor.h"
+#include "NodeJsonSerializer.h"
+#include "TapeEvaluator.h"
+#include "TapeGenerator.h"
+#include "TapeSimplifier.h"
+
+#include <glm/gtx/component_wise.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+	// FNV-1a
+	uint64_t Hash(const std::string& s, uint64_t h = 14695981039346656037ull) {
+		for (unsigned char c : s) {
+			h ^= c;
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	std::string Serialize(std::shared_ptr<Node> subtree) {
+		return NodeJsonSerializer().GenerateFromRoot(subtree).dump();
+	}
+
+	// the settings are part of the key of a bake too
+	uint64_t BakeHash(const std::string& json, int resolution, float bandVoxels) {
+		return Hash(std::to_string(resolution) + " " + std::to_string(bandVoxels), Hash(json));
+	}
+
+	constexpr int brickSize = 8;
+}
+
+float DistanceBake::Sample(glm::vec3 p) const
+{
+	glm::vec3 gradient;
+	return Sample(p, gradient);
+}
+
+float DistanceBake::Sample(glm::vec3 p, glm::vec3& gradient) const
+{
+	glm::vec3 outside = glm::max(glm::abs(p - (min + 0.5f * size)) - 0.5f * size, 0.0f);
+	if (outside.x > 0 || outside.y > 0 || outside.z > 0) {
+		float length = glm::length(outside);
+		gradient = glm::sign(p - (min + 0.5f * size)) * outside / length;
+		return length + band;
+	}
+
+	// texel centers are at (i + 0.5) voxels, the outermost half voxels see the border texels only
+	glm::vec3 scale = glm::vec3(resolution) / size;
+	glm::vec3 u = (p - min) * scale - 0.5f;
+	glm::vec3 t = glm::clamp(u, glm::vec3(0), glm::vec3(resolution - 1));
+	glm::ivec3 i = glm::min(glm::ivec3(t), resolution - 2); // the bake is at least 2 voxels wide
+	glm::vec3 f = t - glm::vec3(i);
+	float result = 0;
+	gradient = glm::vec3(0);
+	for (int c = 0; c < 8; ++c) {
+		glm::ivec3 o(c & 1, (c >> 1) & 1, c >> 2);
+		glm::vec3 w = glm::mix(1.0f - f, f, glm::vec3(o));
+		glm::vec3 dw = glm::mix(glm::vec3(-1), glm::vec3(1), glm::vec3(o)); // derivatives of the weights by f
+		glm::ivec3 v = i + o;
+		float value = values[((size_t)v.z * resolution.y + v.y) * resolution.x + v.x];
+		result += w.x * w.y * w.z * value;
+		gradient += glm::vec3(dw.x * w.y * w.z, w.x * dw.y * w.z, w.x * w.y * dw.z) * value;
+	}
+	// the clamped coordinates don't change along their axis
+	gradient *= glm::mix(scale, glm::vec3(0), glm::vec3(glm::notEqual(u, t)));
+	return result;
+}
+
+DistanceBake DistanceBake::Grid(const BoundingBox& bounds, int resolution, float bandVoxels)
+{
+	if (bounds.IsInfinite())
+		throw std::invalid_argument("DistanceBake: can't bake an unbounded shape.");
+	if (!(bandVoxels > 0))
+		throw std::invalid_argument("DistanceBake: the band has to be wider than 0 voxels.");
+
+	// a margin of whole voxels, at least band + 1 voxel wide, on every side
+	int margin = (int)std::ceil(bandVoxels) + 1;
+	float longest = glm::compMax(bounds.max - bounds.min);
+	if (resolution <= 2 * margin || !(longest > 0))
+		throw std::invalid_argument("DistanceBake: the resolution is too low for the band, or the shape is empty.");
+
+	DistanceBake bake;
+	float voxel = longest / (resolution - 2 * margin);
+	bake.resolution = glm::ivec3(glm::ceil((bounds.max - bounds.min) / voxel - 1e-3f)) + 2 * margin;
+	bake.resolution = glm::max(bake.resolution, 2 * margin + 1);
+	bake.size = glm::vec3(bake.resolution) * voxel;
+	bake.min = bounds.Center() - 0.5f * bake.size;
+	bake.band = bandVoxels * voxel;
+	bake.values.resize((size_t)bake.resolution.x * bake.resolution.y * bake.resolution.z);
+	return bake;
+}
+
+SubtreeBaker::~SubtreeBaker()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+uint64_t SubtreeBaker::ContentHash(std::shared_ptr<Node> subtree)
+{
+	return Hash(Serialize(subtree));
+}
+
+DistanceBake SubtreeBaker::Bake(std::shared_ptr<Node> subtree, int resolution, float bandVoxels, ThreadPool& pool, BakeStats* stats)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	BoundingBox bounds = BoundsCalculatorVisitor().CalculateBounds(subtree).at(subtree.get());
+	DistanceBake bake = DistanceBake::Grid(bounds, resolution, bandVoxels);
+	float voxel = bake.VoxelSize();
+	bake.contentHash = ContentHash(subtree);
+
+	Tape tape = TapeGenerator().GenerateFromRoot(subtree);
+	glm::ivec3 bricks = (bake.resolution + brickSize - 1) / brickSize;
+	size_t brickCount = (size_t)bricks.x * bricks.y * bricks.z;
+	std::atomic<size_t> pruned{ 0 }, samples{ 0 };
+
+	pool.ParallelFor(brickCount, 1, [&](size_t begin, size_t end) {
+		std::vector<float> x, y, z, distances;
+		std::vector<TapeChoice> choices;
+		for (size_t b = begin; b < end; ++b) {
+			glm::ivec3 first = glm::ivec3((int)(b % bricks.x), (int)(b / bricks.x % bricks.y), (int)(b / bricks.x / bricks.y)) * brickSize;
+			glm::ivec3 last = glm::min(first + brickSize, bake.resolution);
+			auto fill = [&](auto value) {
+				for (int k = first.z, i = 0; k < last.z; ++k)
+					for (int j = first.y; j < last.y; ++j)
+						for (int l = first.x; l < last.x; ++l, ++i)
+							bake.values[((size_t)k * bake.resolution.y + j) * bake.resolution.x + l] = value(i);
+			};
+
+			// the box through the sample points of the brick
+			BoundingBox box(bake.min + (glm::vec3(first) + 0.5f) * voxel, bake.min + (glm::vec3(last) - 0.5f) * voxel);
+			Interval value = TapeEvaluator::EvaluateInterval(tape, box, &choices);
+			if (value.lower >= bake.band || value.upper <= -bake.band) {
+				float clamped = value.lower >= bake.band ? bake.band : -bake.band;
+				fill([&](int) { return clamped; });
+				++pruned;
+				continue;
+			}
+
+			x.clear();
+			y.clear();
+			z.clear();
+			for (int k = first.z; k < last.z; ++k)
+				for (int j = first.y; j < last.y; ++j)
+					for (int l = first.x; l < last.x; ++l) {
+						glm::vec3 p = bake.min + (glm::vec3(l, j, k) + 0.5f) * voxel;
+						x.push_back(p.x);
+						y.push_back(p.y);
+						z.push_back(p.z);
+					}
+			distances.resize(x.size());
+			if (TapeSimplifier::CanSimplify(choices))
+				TapeEvaluator::Evaluate(TapeSimplifier::Simplify(tape, choices), x.data(), y.data(), z.data(), distances.data(), x.size());
+			else
+				TapeEvaluator::Evaluate(tape, x.data(), y.data(), z.data(), distances.data(), x.size());
+			samples += x.size();
+			fill([&](int i) { return glm::clamp(distances[i], -bake.band, bake.band); });
+		}
+	});
+
+	if (stats) {
+		stats->bricks = brickCount;
+		stats->prunedBricks = pruned;
+		stats->samples = samples;
+		stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	return bake;
+}
+
+std::shared_ptr<const DistanceBake> SubtreeBaker::Find(std::shared_ptr<Node> subtree)
+{
+	std::string json = Serialize(subtree);
+	uint64_t hash = BakeHash(json, resolution, bandVoxels);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Entry& entry = entries[subtree.get()];
+	if (entry.hash == hash)
+		return entry.bake;
+	if (entry.pendingHash == hash)
+		return nullptr;
+
+	entry.pendingHash = hash;
+	Job job{ subtree.get(), hash, std::move(json), resolution, bandVoxels };
+	auto queued = std::find_if(jobs.begin(), jobs.end(), [&](const Job& j) { return j.node == job.node; });
+	if (queued != jobs.end())
+		*queued = std::move(job);
+	else
+		jobs.push_back(std::move(job));
+	if (!worker.joinable())
+		worker = std::thread(&SubtreeBaker::WorkerLoop, this);
+	jobAvailable.notify_one();
+	return nullptr;
+}
+
+bool SubtreeBaker::TakeFinished()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool result = finished;
+	finished = false;
+	return result;
+}
+
+std::vector<std::string> SubtreeBaker::TakeErrors()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return std::exchange(errors, {});
+}
+
+void SubtreeBaker::Retain(const std::vector<const Node*>& nodes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = entries.begin(); it != entries.end();) {
+		if (std::find(nodes.begin(), nodes.end(), it->first) == nodes.end())
+			it = entries.erase(it);
+		else
+			++it;
+	}
+	jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const Job& j) { return entries.count(j.node) == 0; }), jobs.end());
+}
+
+void SubtreeBaker::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		jobAvailable.wait(lock, [&] { return stopping || !jobs.empty(); });
+		if (stopping)
+			return;
+		Job job = std::move(jobs.front());
+		jobs.erase(jobs.begin());
+		lock.unlock();
+
+		std::shared_ptr<DistanceBake> bake;
+		std::string error;
+		try {
+			auto roots = NodeJsonSerializer::Deserialize("[" + job.json + "]");
+			if (roots.empty())
+				throw std::runtime_error("the subtree can't be serialized");
+			bake = std::make_shared<DistanceBake>(Bake(roots.front(), job.resolution, job.bandVoxels));
+		}
+		catch (std::exception& e) {
+			error = std::string("Baking failed: ") + e.what();
+		}
+
+		lock.lock();
+		auto it = entries.find(job.node);
+		if (it == entries.end() || it->second.pendingHash != job.hash)
+			continue; // dropped, or changed again while it was baked: a newer job is queued
+		it->second.hash = job.hash;
+		it->second.bake = bake;
+		it->second.pendingHash = 0;
+		if (bake)
+			finished = true;
+		else
+			errors.push_back(error);
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "Node.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Distances of a subtree sampled on a regular grid, in the coordinate system of the subtree's parent (like the register of the subtree
+/// in the generated sdf). The samples are at the centers of the voxels of the box [min, min + size], x fastest, and are clamped to
+/// [-band, band]: only a narrow band around the surface keeps exact values, the rest just tells inside from outside.
+/// The box is the subtree's bounds grown by more than band + one voxel, so the samples next to its faces are all band and the distance to
+/// the box plus band is a lower bound of the distance outside of it.
+/// </summary>
+struct DistanceBake {
+	glm::vec3 min = glm::vec3(0);
+	glm::vec3 size = glm::vec3(0);
+	glm::ivec3 resolution = glm::ivec3(0);
+	float band = 0;
+	std::vector<float> values;
+	uint64_t contentHash = 0; // SubtreeBaker::ContentHash of the baked subtree
+
+	// bound of the gradient of Sample: neighbouring samples differ by at most a voxel, so every partial derivative of the interpolation
+	// is at most 1
+	static constexpr float lipschitz = 1.7320508f; // sqrt(3)
+
+	float VoxelSize() const { return size.x / resolution.x; }
+	size_t Bytes() const { return values.capacity() * sizeof(float); }
+
+	/// <summary>
+	/// The value the shader reads at p: trilinear filtering like a GL_LINEAR, clamp to edge sampler3D inside the box, the distance to the box
+	/// plus band outside of it.
+	/// </summary>
+	float Sample(glm::vec3 p) const;
+
+	/// <summary>
+	/// Same as Sample, also writes the gradient of the returned value (of the trilinear interpolation inside the box) into gradient.
+	/// </summary>
+	float Sample(glm::vec3 p, glm::vec3& gradient) const;
+
+	/// <summary>
+	/// An unfilled bake of the box around bounds: resolution voxels along its longest side, a margin of at least band + 1 voxel on every
+	/// side, values sized but not set. Throws std::invalid_argument for unbounded or empty bounds, bands of 0 voxels and too low resolutions.
+	/// </summary>
+	static DistanceBake Grid(const BoundingBox& bounds, int resolution, float bandVoxels);
+};
+
+struct BakeStats {
+	size_t bricks = 0;
+	size_t prunedBricks = 0; // entirely outside the band, filled without evaluating the sdf
+	size_t samples = 0; // sdf evaluations
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Bakes subtrees into DistanceBakes that the shader samples instead of evaluating the subtree (see SDFGenerator::bakes).
+/// The static functions bake on the calling thread. An instance keeps the bakes of the nodes the user marked as baked and rebakes them on
+/// a background thread when their content changes: until the new bake is finished, Find returns nothing and the subtree is evaluated as it is.
+/// </summary>
+class SubtreeBaker
+{
+public:
+	int resolution = 96; // voxels along the longest side of the box
+	float bandVoxels = 3; // half width of the band around the surface in voxels
+
+	SubtreeBaker() = default;
+	~SubtreeBaker();
+
+	SubtreeBaker(const SubtreeBaker&) = delete;
+	SubtreeBaker& operator=(const SubtreeBaker&) = delete;
+
+	/// <summary>
+	/// Hash of everything that determines the distances of the subtree: its serialized nodes, including the transform of its root.
+	/// </summary>
+	static uint64_t ContentHash(std::shared_ptr<Node> subtree);
+
+	/// <summary>
+	/// Samples the subtree on the grid described at DistanceBake. Bricks of 8^3 samples whose interval bounds are outside the band are
+	/// filled with +-band without evaluating them. Throws std::invalid_argument for unbounded or empty subtrees and too small resolutions,
+	/// shader_gen_exception for invalid graphs.
+	/// </summary>
+	static DistanceBake Bake(std::shared_ptr<Node> subtree, int resolution, float bandVoxels, ThreadPool& pool = ThreadPool::Global(),
+		BakeStats* stats = nullptr);
+
+	/// <summary>
+	/// The bake of the subtree's current content, or nullptr if it isn't ready. If there is no bake of the current content (and it isn't
+	/// being baked), a copy of the subtree is queued for baking in the background. Call from one thread only.
+	/// </summary>
+	std::shared_ptr<const DistanceBake> Find(std::shared_ptr<Node> subtree);
+
+	/// <summary>
+	/// True if a background bake finished since the last call: Find would return something new, so the shader should be regenerated.
+	/// </summary>
+	bool TakeFinished();
+
+	/// <summary>
+	/// Messages of the background bakes that failed since the last call.
+	/// </summary>
+	std::vector<std::string> TakeErrors();
+
+	/// <summary>
+	/// Drops the bakes of the nodes that are not in nodes (eg.: no longer marked as baked or deleted).
+	/// </summary>
+	void Retain(const std::vector<const Node*>& nodes);
+
+private:
+	struct Entry {
+		uint64_t hash = 0; // of the content the bake (or the failure) belongs to
+		std::shared_ptr<const DistanceBake> bake; // nullptr if baking failed
+		uint64_t pendingHash = 0; // content queued or being baked, 0 if none
+	};
+
+	struct Job {
+		const Node* node;
+		uint64_t hash;
+		std::string json; // the subtree is rebuilt from it on the worker, the editor keeps changing the original
+		int resolution;
+		float bandVoxels;
+	};
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::unordered_map<const Node*, Entry> entries;
+	std::vector<Job> jobs; // at most one per node, a newer content replaces the queued one
+	std::vector<std::string> errors;
+	bool finished = false;
+	bool stopping = false;
+	std::thread worker;
+
+	void WorkerLoop();
+};
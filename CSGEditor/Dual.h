@@ -0,0 +1,345 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include "SimdFloat.h"
+
+/// <summary>
+/// Compile time versions of the tables ShaderLibManager writes into the shader constants, and the term lists derived from them.
+/// Everything here is evaluated by the compiler, the operators of Dual only read the results.
+/// </summary>
+namespace dual_tables {
+
+	constexpr int Triangular(int n) { return n * (n + 1) / 2; }
+	constexpr int Tetrahedral(int n) { return n * (n + 1) * (n + 2) / 6; }
+
+	constexpr int Choose(int n, int k) {
+		int result = 1;
+		for (int i = 1; i <= k; ++i)
+			result = result * (n - k + i) / i;
+		return result;
+	}
+
+	/// <summary>
+	/// Same as the IDX macro of number.frag: position of the partial derivative d^(x+y+z) / dx^x dy^y dz^z inside Dual::d.
+	/// </summary>
+	constexpr int Idx(int x, int y, int z) {
+		return Tetrahedral(x + y + z) + Triangular(x + y + z + 1) - Triangular(x + y + 1) + y;
+	}
+
+	/// <summary>
+	/// result.d[target] += coefficient * a.d[left] * b.d[right], one entry per term of the general Leibniz rule used by mul.
+	/// </summary>
+	struct MulTerm {
+		int target, left, right;
+		float coefficient;
+	};
+
+	/// <summary>
+	/// result.d[target] += f^(groupCount)(d[0]) * product of d[factors[i]] for i < groupCount, one entry per set partition (Faa di Bruno).
+	/// </summary>
+	template<int Order>
+	struct ChainTerm {
+		int target;
+		int groupCount;
+		int factors[Order > 0 ? Order : 1];
+	};
+
+	template<int Order, typename F>
+	constexpr void ForEachMulTerm(F&& f) {
+		for (int x = 0; x <= Order; ++x)
+			for (int y = 0; x + y <= Order; ++y)
+				for (int z = 0; x + y + z <= Order; ++z)
+					for (int i = 0; x + y + z + i <= Order; ++i)
+						for (int j = 0; x + y + z + i + j <= Order; ++j)
+							for (int k = 0; x + y + z + i + j + k <= Order; ++k)
+								f(MulTerm{ Idx(x + i, y + j, z + k), Idx(x, y, z), Idx(i, j, k),
+									float(Choose(x + i, x) * Choose(y + j, y) * Choose(z + k, z)) });
+	}
+
+	/// <summary>
+	/// Same partition enumeration as ShaderLibManager::GenerateChainRuleFunc, see the comments there.
+	/// </summary>
+	template<int Order, typename F>
+	constexpr void ForEachChainTerm(F&& f) {
+		for (int x = 0; x <= Order; ++x) {
+			for (int y = 0; x + y <= Order; ++y) {
+				for (int z = 0; x + y + z <= Order; ++z) {
+					int n = x + y + z;
+					if (n == 0)
+						continue;
+
+					int partition[Order + 1] = {};
+					int max[Order + 1] = {};
+					for (int i = 0; i < n; ++i) {
+						partition[i] = 1;
+						max[i] = 1;
+					}
+					max[0] = 0;
+
+					bool next = true;
+					while (next) {
+						ChainTerm<Order> term{ Idx(x, y, z), partition[n - 1] > max[n - 1] ? partition[n - 1] : max[n - 1], {} };
+						int counts[Order + 1][3] = {};
+						for (int i = 0; i < n; ++i)
+							++counts[partition[i] - 1][i < x ? 0 : (i < x + y ? 1 : 2)];
+						for (int g = 0; g < term.groupCount; ++g)
+							term.factors[g] = Idx(counts[g][0], counts[g][1], counts[g][2]);
+						f(term);
+
+						// NextPartition
+						next = false;
+						for (int i = n - 1; i > 0; --i) {
+							if (partition[i] <= max[i]) {
+								++partition[i];
+								for (int j = i + 1; j < n; ++j) {
+									partition[j] = 1;
+									max[j] = max[j - 1] > partition[j - 1] ? max[j - 1] : partition[j - 1];
+								}
+								next = true;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template<int Order>
+	constexpr int MulTermCount() {
+		int count = 0;
+		ForEachMulTerm<Order>([&](const MulTerm&) { ++count; });
+		return count;
+	}
+
+	template<int Order>
+	constexpr int ChainTermCount() {
+		int count = 0;
+		ForEachChainTerm<Order>([&](const ChainTerm<Order>&) { ++count; });
+		return count;
+	}
+
+	template<int Order>
+	constexpr std::array<MulTerm, MulTermCount<Order>()> MulTerms() {
+		std::array<MulTerm, MulTermCount<Order>()> terms{};
+		int i = 0;
+		ForEachMulTerm<Order>([&](const MulTerm& t) { terms[i++] = t; });
+		return terms;
+	}
+
+	template<int Order>
+	constexpr std::array<ChainTerm<Order>, ChainTermCount<Order>()> ChainTerms() {
+		std::array<ChainTerm<Order>, ChainTermCount<Order>()> terms{};
+		int i = 0;
+		ForEachChainTerm<Order>([&](const ChainTerm<Order>& t) { terms[i++] = t; });
+		return terms;
+	}
+}
+
+/// <summary>
+/// C++ counterpart of dnum from Shaders/number.frag: the value and all partial derivatives up to Order with respect to x, y and z,
+/// stored in the same layout (see dual_tables::Idx), so results can be compared to the shaders element by element.
+/// T is float (or double) for single points or simd::vfloat for a batch of points, one per lane.
+/// Unlike the shader, the order is a template parameter: the loops of mul and of the chain rule are expanded at compile time.
+/// </summary>
+template<int Order, typename T = float>
+struct Dual {
+	static_assert(Order >= 0, "the derivative order can not be negative");
+
+	static constexpr int order = Order;
+	static constexpr int size = dual_tables::Tetrahedral(Order + 1);
+
+	T d[size];
+
+	Dual() = default;
+
+	Dual(T value) {
+		d[0] = value;
+		for (int i = 1; i < size; ++i)
+			d[i] = T(0.0f);
+	}
+
+	static Dual Constant(T value) { return Dual(value); }
+
+	/// <summary>
+	/// The coordinate along axis (0: x, 1: y, 2: z) with the value val, same as variable3 in number.frag.
+	/// </summary>
+	static Dual Variable(T value, int axis) {
+		Dual result(value);
+		if (Order > 0)
+			result.d[1 + axis] = T(1.0f);
+		return result;
+	}
+
+	static constexpr int Idx(int x, int y, int z) { return dual_tables::Idx(x, y, z); }
+
+	/// <summary>
+	/// d^(x+y+z) f / dx^x dy^y dz^z
+	/// </summary>
+	const T& Partial(int x, int y, int z) const { return d[Idx(x, y, z)]; }
+
+	/// <summary>
+	/// Applies f using its derivatives at the real part, derivatives[s] = f^(s)(d[0]).
+	/// This is the generic form of the functions ShaderLibManager::GenerateChainRuleFunc writes for the shaders.
+	/// </summary>
+	Dual ChainRule(const T(&derivatives)[Order + 1]) const {
+		Dual result(derivatives[0]);
+		ApplyChainTerms(result, derivatives, std::make_index_sequence<chainTerms.size()>());
+		return result;
+	}
+
+	friend Dual operator+(const Dual& a, const Dual& b) {
+		Dual result;
+		for (int i = 0; i < size; ++i) result.d[i] = a.d[i] + b.d[i];
+		return result;
+	}
+
+	friend Dual operator-(const Dual& a, const Dual& b) {
+		Dual result;
+		for (int i = 0; i < size; ++i) result.d[i] = a.d[i] - b.d[i];
+		return result;
+	}
+
+	friend Dual operator-(const Dual& a) {
+		Dual result;
+		for (int i = 0; i < size; ++i) result.d[i] = -a.d[i];
+		return result;
+	}
+
+	friend Dual operator*(const Dual& a, const Dual& b) {
+		Dual result;
+		for (int i = 0; i < size; ++i) result.d[i] = T(0.0f);
+		ApplyMulTerms(result, a, b, std::make_index_sequence<mulTerms.size()>());
+		return result;
+	}
+
+	/// <summary>
+	/// number.frag divides by multiplying both sides with the conjugate until the divisor is real,
+	/// here the divisor is inverted with the chain rule instead: fewer multiplications, same derivatives.
+	/// </summary>
+	friend Dual operator/(const Dual& a, const Dual& b) { return a * Reciprocal(b); }
+
+	// operations with constants only touch the parts that change
+	friend Dual operator+(const Dual& a, T b) { Dual result = a; result.d[0] = a.d[0] + b; return result; }
+	friend Dual operator+(T a, const Dual& b) { Dual result = b; result.d[0] = a + b.d[0]; return result; }
+	friend Dual operator-(const Dual& a, T b) { Dual result = a; result.d[0] = a.d[0] - b; return result; }
+	friend Dual operator-(T a, const Dual& b) { Dual result = -b; result.d[0] = a - b.d[0]; return result; }
+
+	friend Dual operator*(const Dual& a, T b) {
+		Dual result;
+		for (int i = 0; i < size; ++i) result.d[i] = a.d[i] * b;
+		return result;
+	}
+
+	friend Dual operator*(T a, const Dual& b) { return b * a; }
+
+	friend Dual operator/(const Dual& a, T b) {
+		Dual result;
+		for (int i = 0; i < size; ++i) result.d[i] = a.d[i] / b;
+		return result;
+	}
+
+	friend Dual operator/(T a, const Dual& b) { return Reciprocal(b) * a; }
+
+	/// <summary>
+	/// 1/x, f^(n)(x) = -n * f^(n-1)(x) / x
+	/// </summary>
+	friend Dual Reciprocal(const Dual& a) {
+		T derivatives[Order + 1];
+		T inv = T(1.0f) / a.d[0];
+		derivatives[0] = inv;
+		for (int n = 1; n <= Order; ++n)
+			derivatives[n] = derivatives[n - 1] * inv * T(float(-n));
+		return a.ChainRule(derivatives);
+	}
+
+private:
+	static constexpr auto mulTerms = dual_tables::MulTerms<Order>();
+	static constexpr auto chainTerms = dual_tables::ChainTerms<Order>();
+
+	template<size_t... I>
+	static void ApplyMulTerms(Dual& result, const Dual& a, const Dual& b, std::index_sequence<I...>) {
+		((result.d[mulTerms[I].target] = result.d[mulTerms[I].target] +
+			(mulTerms[I].coefficient == 1.0f
+				? a.d[mulTerms[I].left] * b.d[mulTerms[I].right]
+				: a.d[mulTerms[I].left] * b.d[mulTerms[I].right] * T(mulTerms[I].coefficient))), ...);
+	}
+
+	template<size_t I>
+	void ApplyChainTerm(Dual& result, const T(&derivatives)[Order + 1]) const {
+		constexpr auto term = chainTerms[I];
+		T tmp = derivatives[term.groupCount];
+		for (int g = 0; g < term.groupCount; ++g)
+			tmp = tmp * d[term.factors[g]];
+		result.d[term.target] = result.d[term.target] + tmp;
+	}
+
+	template<size_t... I>
+	void ApplyChainTerms(Dual& result, const T(&derivatives)[Order + 1], std::index_sequence<I...>) const {
+		(ApplyChainTerm<I>(result, derivatives), ...);
+	}
+};
+
+// Functions used by the templates of SdfFormulas.h, found by argument dependent lookup.
+// The branches compare real parts only, like dmin, dmax and dabs of number.frag.
+// dsin and dcos need a scalar T (float or double), there is no vector sine in SimdFloat.h.
+
+template<int Order, typename T>
+T realValue(const Dual<Order, T>& a) { return a.d[0]; }
+
+template<int Order, typename T>
+Dual<Order, T> select(bool m, const Dual<Order, T>& a, const Dual<Order, T>& b) { return m ? a : b; }
+
+template<int Order>
+Dual<Order, simd::vfloat> select(simd::vmask m, const Dual<Order, simd::vfloat>& a, const Dual<Order, simd::vfloat>& b) {
+	Dual<Order, simd::vfloat> result;
+	for (int i = 0; i < Dual<Order, simd::vfloat>::size; ++i)
+		result.d[i] = simd::select(m, a.d[i], b.d[i]);
+	return result;
+}
+
+template<int Order, typename T>
+Dual<Order, T> dmin(const Dual<Order, T>& a, const Dual<Order, T>& b) { return select(a.d[0] <= b.d[0], a, b); }
+
+template<int Order, typename T>
+Dual<Order, T> dmax(const Dual<Order, T>& a, const Dual<Order, T>& b) { return select(a.d[0] >= b.d[0], a, b); }
+
+template<int Order, typename T>
+Dual<Order, T> dabs(const Dual<Order, T>& a) { return select(a.d[0] < T(0.0f), -a, a); }
+
+/// <summary>
+/// f^(n)(x) = (1/2 - (n-1)) * f^(n-1)(x) / x, the list app.cpp passes to GenerateChainRuleFunc for dsqrt, for any order.
+/// </summary>
+template<int Order, typename T>
+Dual<Order, T> dsqrt(const Dual<Order, T>& a) {
+	using std::sqrt;
+	using simd::sqrt;
+	T derivatives[Order + 1];
+	derivatives[0] = sqrt(a.d[0]);
+	T inv = T(1.0f) / a.d[0];
+	for (int n = 1; n <= Order; ++n)
+		derivatives[n] = derivatives[n - 1] * inv * T(0.5f - float(n - 1));
+	return a.ChainRule(derivatives);
+}
+
+template<int Order, typename T>
+Dual<Order, T> dsin(const Dual<Order, T>& a) {
+	T s = std::sin(a.d[0]), c = std::cos(a.d[0]);
+	T cycle[4] = { s, c, -s, -c };
+	T derivatives[Order + 1];
+	for (int n = 0; n <= Order; ++n)
+		derivatives[n] = cycle[n % 4];
+	return a.ChainRule(derivatives);
+}
+
+template<int Order, typename T>
+Dual<Order, T> dcos(const Dual<Order, T>& a) {
+	T s = std::sin(a.d[0]), c = std::cos(a.d[0]);
+	T cycle[4] = { c, -s, -c, s };
+	T derivatives[Order + 1];
+	for (int n = 0; n <= Order; ++n)
+		derivatives[n] = cycle[n % 4];
+	return a.ChainRule(derivatives);
+}
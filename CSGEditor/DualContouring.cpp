@@ -0,0 +1,673 @@
+#include "DualContouring.h"
+#include "MarchingCubes.h"
+#include "IntervalOctree.h"
+#include "TapeEvaluator.h"
+#include "MeshAttributes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	// Morton codes of coordinates with up to 21 bits: siblings in the octree are consecutive when sorted, the parent's code is code >> 3
+	uint64_t Spread(uint32_t v) {
+		uint64_t x = v & 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffull;
+		x = (x | x << 16) & 0x1f0000ff0000ffull;
+		x = (x | x << 8) & 0x100f00f00f00f00full;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	}
+
+	uint32_t Compact(uint64_t x) {
+		x &= 0x1249249249249249ull;
+		x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+		x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+		x = (x ^ (x >> 8)) & 0x1f0000ff0000ffull;
+		x = (x ^ (x >> 16)) & 0x1f00000000ffffull;
+		x = (x ^ (x >> 32)) & 0x1fffffull;
+		return (uint32_t)x;
+	}
+
+	uint64_t Morton(glm::uvec3 p) { return Spread(p.x) | Spread(p.y) << 1 | Spread(p.z) << 2; }
+	glm::uvec3 FromMorton(uint64_t code) { return glm::uvec3(Compact(code), Compact(code >> 1), Compact(code >> 2)); }
+
+	uint64_t LeafKey(glm::uvec3 min) { return uint64_t(min.x) | uint64_t(min.y) << 21 | uint64_t(min.z) << 42; }
+
+	// sum of the squared distances to planes through p with the normal n: x^T A x - 2 x^T b + c, in doubles because merged cells
+	// add up hundreds of planes
+	struct Qef {
+		double ata[6] = {}; // xx, xy, xz, yy, yz, zz
+		glm::dvec3 atb{ 0 };
+		double btb = 0;
+		glm::dvec3 massSum{ 0 };
+		uint32_t count = 0;
+
+		void Add(glm::vec3 p, glm::vec3 n) {
+			glm::dvec3 dn(n);
+			double d = glm::dot(dn, glm::dvec3(p));
+			ata[0] += dn.x * dn.x;
+			ata[1] += dn.x * dn.y;
+			ata[2] += dn.x * dn.z;
+			ata[3] += dn.y * dn.y;
+			ata[4] += dn.y * dn.z;
+			ata[5] += dn.z * dn.z;
+			atb += dn * d;
+			btb += d * d;
+			massSum += glm::dvec3(p);
+			++count;
+		}
+
+		void Add(const Qef& other) {
+			for (int i = 0; i < 6; ++i)
+				ata[i] += other.ata[i];
+			atb += other.atb;
+			btb += other.btb;
+			massSum += other.massSum;
+			count += other.count;
+		}
+
+		glm::dvec3 MassPoint() const { return massSum / double(count); }
+
+		glm::dvec3 A(glm::dvec3 x) const {
+			return glm::dvec3(ata[0] * x.x + ata[1] * x.y + ata[2] * x.z, ata[1] * x.x + ata[3] * x.y + ata[4] * x.z,
+				ata[2] * x.x + ata[4] * x.y + ata[5] * x.z);
+		}
+
+		double Residual(glm::dvec3 x) const { return std::max(0.0, glm::dot(x, A(x)) - 2 * glm::dot(x, atb) + btb); }
+
+		// the minimizer closest to the mass point, ignoring the eigenvectors of A with eigenvalues below threshold times the largest one
+		glm::dvec3 Solve(double threshold) const {
+			double a[3][3] = { { ata[0], ata[1], ata[2] }, { ata[1], ata[3], ata[4] }, { ata[2], ata[4], ata[5] } };
+			double v[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+			// cyclic Jacobi rotations, a few sweeps diagonalize a 3x3 matrix to double precision
+			for (int sweep = 0; sweep < 8; ++sweep) {
+				double offDiagonal = std::abs(a[0][1]) + std::abs(a[0][2]) + std::abs(a[1][2]);
+				if (offDiagonal < 1e-14 * (std::abs(a[0][0]) + std::abs(a[1][1]) + std::abs(a[2][2])))
+					break;
+				for (auto [p, q] : { std::pair<int, int>{ 0, 1 }, { 0, 2 }, { 1, 2 } }) {
+					if (a[p][q] == 0)
+						continue;
+					double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+					double t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta * theta + 1));
+					double c = 1 / std::sqrt(t * t + 1), s = t * c;
+					for (int k = 0; k < 3; ++k) {
+						double akp = a[k][p], akq = a[k][q];
+						a[k][p] = c * akp - s * akq;
+						a[k][q] = s * akp + c * akq;
+					}
+					for (int k = 0; k < 3; ++k) {
+						double apk = a[p][k], aqk = a[q][k];
+						a[p][k] = c * apk - s * aqk;
+						a[q][k] = s * apk + c * aqk;
+					}
+					for (int k = 0; k < 3; ++k) {
+						double vkp = v[k][p], vkq = v[k][q];
+						v[k][p] = c * vkp - s * vkq;
+						v[k][q] = s * vkp + c * vkq;
+					}
+				}
+			}
+
+			glm::dvec3 mass = MassPoint();
+			glm::dvec3 r = atb - A(mass);
+			double largest = std::max(a[0][0], std::max(a[1][1], a[2][2]));
+			glm::dvec3 x = mass;
+			for (int i = 0; i < 3; ++i) {
+				if (a[i][i] <= threshold * largest)
+					continue;
+				glm::dvec3 e(v[0][i], v[1][i], v[2][i]);
+				x += e * (glm::dot(e, r) / a[i][i]);
+			}
+			return x;
+		}
+	};
+
+	// a grid edge with a sign change that belongs to its block (its lower end is in the block)
+	struct Crossing {
+		glm::uvec3 lowerEnd;
+		uint8_t axis;
+		bool lowerInside;
+	};
+
+	// what the second pass needs of a block
+	struct BlockResult {
+		std::vector<glm::vec3> positions; // of the leaves
+		std::vector<uint64_t> keys; // of the leaves
+		std::vector<uint8_t> onFace; // of the leaves, 1 if the leaf touches a face of the block, where quads of the neighbours may use it
+		std::vector<std::pair<uint64_t, uint32_t>> leafOfCell; // Morton code of a cell with crossings in the block -> its leaf, sorted
+		std::vector<Crossing> crossings;
+
+		size_t Bytes() const {
+			return positions.capacity() * sizeof(glm::vec3) + keys.capacity() * sizeof(uint64_t) + onFace.capacity()
+				+ leafOfCell.capacity() * sizeof(std::pair<uint64_t, uint32_t>) + crossings.capacity() * sizeof(Crossing);
+		}
+	};
+
+	// a cell of the block's octree, keyed by the Morton code of its coordinates in cells of its level
+	struct Node {
+		uint64_t code;
+		Qef qef;
+		glm::vec3 vertex; // relative to the block's lower corner
+		uint32_t parent = 0; // in the next level
+		uint32_t firstChild = 0, childCount = 0;
+		uint32_t leafIndex = 0;
+		bool leaf = false; // has a vertex
+		bool merged = false; // its parent is a leaf instead
+	};
+
+	// an edge of a brick with a sign change, t bracketing the crossing between the ends lower and lower + axis
+	struct BrickEdge {
+		glm::uvec3 lower;
+		uint8_t axis;
+		bool lowerInside;
+		float ta, tb, va, vb;
+	};
+
+	// per thread memory of the first pass, only grows
+	struct BlockWork {
+		std::vector<float> lattice, x, y, z, values;
+		std::vector<Dual<1>> derivatives;
+		std::vector<BrickEdge> edges;
+		std::vector<glm::vec3> points, normals;
+		std::vector<uint32_t> undefined; // edges whose gradient is undefined at the crossing
+		std::vector<int32_t> nodeOfCell; // of the brick
+		std::vector<std::vector<Node>> levels;
+		std::vector<uint32_t> candidates;
+		size_t bricks = 0, samples = 0;
+
+		void Reserve(size_t count) {
+			for (auto* v : { &x, &y, &z, &values })
+				if (v->size() < count)
+					v->resize(count);
+			if (derivatives.size() < count)
+				derivatives.resize(count);
+		}
+
+		size_t Bytes() const {
+			size_t bytes = (lattice.capacity() + x.capacity() + y.capacity() + z.capacity() + values.capacity()) * sizeof(float)
+				+ derivatives.capacity() * sizeof(Dual<1>) + edges.capacity() * sizeof(BrickEdge) + (points.capacity() + normals.capacity()) * sizeof(glm::vec3)
+				+ nodeOfCell.capacity() * sizeof(int32_t) + (undefined.capacity() + candidates.capacity()) * sizeof(uint32_t);
+			for (auto& level : levels)
+				bytes += level.capacity() * sizeof(Node);
+			return bytes;
+		}
+	};
+
+	// the first pass over one block: Hermite data of the bricks, then the bottom up simplification
+	class BlockSimplifier {
+	public:
+		BlockSimplifier(const DualContouring& settings, const MeshGrid& grid, uint32_t brickSize, glm::uvec3 blockMin, uint32_t blockCells,
+			BlockWork& work, BlockResult& result)
+			: settings(settings), grid(grid), brickSize(brickSize), blockMin(blockMin), blockCells(blockCells),
+			blockOrigin(grid.Point(blockMin)), work(work), result(result) {}
+
+		void Brick(const Tape& tape, glm::uvec3 min) {
+			const uint32_t b = brickSize, n = b + 1;
+			size_t count = size_t(n) * n * n;
+			work.Reserve(count);
+			size_t i = 0;
+			for (uint32_t z = 0; z < n; ++z)
+				for (uint32_t y = 0; y < n; ++y)
+					for (uint32_t x = 0; x < n; ++x, ++i) {
+						glm::vec3 p = grid.Point(min + glm::uvec3(x, y, z));
+						work.x[i] = p.x;
+						work.y[i] = p.y;
+						work.z[i] = p.z;
+					}
+			TapeEvaluator::Evaluate(tape, work.x.data(), work.y.data(), work.z.data(), work.values.data(), count);
+			work.lattice.assign(work.values.begin(), work.values.begin() + count);
+			++work.bricks;
+			work.samples += count;
+
+			auto index = [n](glm::uvec3 p) { return size_t(p.z) * n * n + size_t(p.y) * n + p.x; };
+			work.edges.clear();
+			for (uint32_t z = 0; z < n; ++z)
+				for (uint32_t y = 0; y < n; ++y)
+					for (uint32_t x = 0; x < n; ++x)
+						for (int axis = 0; axis < 3; ++axis) {
+							glm::uvec3 lower(x, y, z), upper = lower;
+							if (lower[axis] == b)
+								continue;
+							++upper[axis];
+							float va = work.lattice[index(lower)], vb = work.lattice[index(upper)];
+							if ((va < 0) != (vb < 0))
+								work.edges.push_back({ lower, (uint8_t)axis, va < 0, 0.0f, 1.0f, va, vb });
+						}
+			if (work.edges.empty())
+				return;
+
+			// regula falsi on all the edges of the brick at once
+			const size_t edgeCount = work.edges.size();
+			work.Reserve(edgeCount);
+			auto setPoint = [&](size_t e, float t) {
+				const BrickEdge& edge = work.edges[e];
+				glm::uvec3 upper = edge.lower;
+				++upper[edge.axis];
+				glm::vec3 pa = grid.Point(min + edge.lower), pb = grid.Point(min + upper);
+				glm::vec3 p = pa + (pb - pa) * t;
+				work.x[e] = p.x;
+				work.y[e] = p.y;
+				work.z[e] = p.z;
+				return p;
+			};
+			auto interpolate = [](const BrickEdge& edge) {
+				return std::clamp(edge.ta - edge.va * (edge.tb - edge.ta) / (edge.vb - edge.va), edge.ta, edge.tb);
+			};
+			for (uint32_t iteration = 0; iteration < settings.rootIterations; ++iteration) {
+				for (size_t e = 0; e < edgeCount; ++e)
+					setPoint(e, interpolate(work.edges[e]));
+				TapeEvaluator::Evaluate(tape, work.x.data(), work.y.data(), work.z.data(), work.values.data(), edgeCount);
+				work.samples += edgeCount;
+				for (size_t e = 0; e < edgeCount; ++e) {
+					BrickEdge& edge = work.edges[e];
+					float t = interpolate(edge), f = work.values[e];
+					if ((f < 0) == (edge.va < 0)) {
+						edge.ta = t;
+						edge.va = f;
+					}
+					else {
+						edge.tb = t;
+						edge.vb = f;
+					}
+				}
+			}
+			work.points.resize(edgeCount);
+			for (size_t e = 0; e < edgeCount; ++e)
+				work.points[e] = setPoint(e, interpolate(work.edges[e]));
+
+			// exact normals, exactly on a kink (like the faces of a box, where regula falsi converges to the zero) the gradient may be
+			// undefined: then it is taken slightly outside along the edge
+			TapeEvaluator::EvaluateDerivatives<1>(tape, work.x.data(), work.y.data(), work.z.data(), work.derivatives.data(), edgeCount);
+			work.samples += edgeCount;
+			std::vector<glm::vec3>& normals = work.normals;
+			std::vector<uint32_t>& undefined = work.undefined;
+			normals.resize(edgeCount);
+			undefined.clear();
+			for (size_t e = 0; e < edgeCount; ++e) {
+				const Dual<1>& d = work.derivatives[e];
+				glm::vec3 gradient(d.d[1], d.d[2], d.d[3]);
+				float g2 = glm::dot(gradient, gradient);
+				if (g2 > 0 && std::isfinite(g2))
+					normals[e] = gradient / std::sqrt(g2);
+				else
+					undefined.push_back((uint32_t)e);
+			}
+			if (!undefined.empty()) {
+				for (size_t k = 0; k < undefined.size(); ++k) {
+					const BrickEdge& edge = work.edges[undefined[k]];
+					glm::vec3 p = work.points[undefined[k]];
+					p[edge.axis] += (edge.lowerInside ? 1e-3f : -1e-3f) * grid.cellSize;
+					work.x[k] = p.x;
+					work.y[k] = p.y;
+					work.z[k] = p.z;
+				}
+				TapeEvaluator::EvaluateDerivatives<1>(tape, work.x.data(), work.y.data(), work.z.data(), work.derivatives.data(), undefined.size());
+				work.samples += undefined.size();
+				for (size_t k = 0; k < undefined.size(); ++k) {
+					const Dual<1>& d = work.derivatives[k];
+					glm::vec3 gradient(d.d[1], d.d[2], d.d[3]);
+					float g2 = glm::dot(gradient, gradient);
+					glm::vec3 along(0);
+					along[work.edges[undefined[k]].axis] = work.edges[undefined[k]].lowerInside ? 1.0f : -1.0f;
+					normals[undefined[k]] = g2 > 0 && std::isfinite(g2) ? gradient / std::sqrt(g2) : along;
+				}
+			}
+
+			// every crossing adds its plane to the cells around its edge that are in this brick, the brick owns the crossing if its lower end is inside
+			work.nodeOfCell.assign(size_t(b) * b * b, -1);
+			std::vector<Node>& cells = work.levels[0];
+			for (size_t e = 0; e < edgeCount; ++e) {
+				const BrickEdge& edge = work.edges[e];
+				int u = (edge.axis + 1) % 3, v = (edge.axis + 2) % 3;
+				glm::vec3 point = work.points[e] - blockOrigin;
+				for (int k = 0; k < 4; ++k) {
+					glm::ivec3 cell(edge.lower);
+					cell[u] -= k & 1;
+					cell[v] -= k >> 1;
+					if (cell[u] < 0 || cell[v] < 0 || cell[u] >= (int)b || cell[v] >= (int)b)
+						continue;
+					int32_t& node = work.nodeOfCell[(size_t(cell.z) * b + cell.y) * b + cell.x];
+					if (node < 0) {
+						node = (int32_t)cells.size();
+						cells.push_back(Node());
+						cells.back().code = Morton(min - blockMin + glm::uvec3(cell));
+					}
+					cells[node].qef.Add(point, normals[e]);
+				}
+				if (edge.lower.x < b && edge.lower.y < b && edge.lower.z < b)
+					result.crossings.push_back({ min + edge.lower, edge.axis, edge.lowerInside });
+			}
+		}
+
+		// merges the cells bottom up and fills the leaves of the result, the tape is valid in the whole block
+		void Simplify(const Tape& tape) {
+			const double cellSize = grid.cellSize;
+			std::vector<Node>& cells = work.levels[0];
+			std::sort(cells.begin(), cells.end(), [](const Node& a, const Node& b) { return a.code < b.code; });
+			for (Node& cell : cells) {
+				glm::dvec3 lower = glm::dvec3(FromMorton(cell.code)) * cellSize;
+				glm::dvec3 x = cell.qef.Solve(settings.singularThreshold);
+				if (!Inside(x, lower, cellSize, cellSize * 1e-3))
+					x = cell.qef.MassPoint();
+				cell.vertex = glm::vec3(x);
+				cell.leaf = true;
+			}
+
+			size_t levelCount = 1;
+			const double tolerance = double(settings.maxError) * settings.maxError * cellSize * cellSize;
+			for (uint32_t level = 0; (2u << level) <= blockCells && settings.maxError > 0; ++level) {
+				std::vector<Node>& children = work.levels[level];
+				std::vector<Node>& parents = work.levels[level + 1];
+				parents.clear();
+				work.candidates.clear();
+				for (size_t first = 0; first < children.size();) {
+					size_t last = first;
+					bool leaves = true;
+					Node parent;
+					parent.code = children[first].code >> 3;
+					for (; last < children.size() && children[last].code >> 3 == parent.code; ++last) {
+						leaves &= children[last].leaf;
+						parent.qef.Add(children[last].qef);
+						children[last].parent = (uint32_t)parents.size();
+					}
+					parent.firstChild = (uint32_t)first;
+					parent.childCount = uint32_t(last - first);
+					if (leaves)
+						work.candidates.push_back((uint32_t)parents.size());
+					parents.push_back(parent);
+					first = last;
+				}
+				levelCount = level + 2;
+				if (work.candidates.empty())
+					break;
+
+				// the signs at the 27 points of the children's corners, evaluated for all candidates at once
+				const uint32_t size = 2u << level;
+				const size_t pointCount = work.candidates.size() * 27;
+				work.Reserve(pointCount);
+				size_t i = 0;
+				for (uint32_t candidate : work.candidates) {
+					glm::uvec3 lower = blockMin + FromMorton(parents[candidate].code) * size;
+					for (uint32_t z = 0; z < 3; ++z)
+						for (uint32_t y = 0; y < 3; ++y)
+							for (uint32_t x = 0; x < 3; ++x, ++i) {
+								glm::vec3 p = grid.Point(lower + glm::uvec3(x, y, z) * (size / 2));
+								work.x[i] = p.x;
+								work.y[i] = p.y;
+								work.z[i] = p.z;
+							}
+				}
+				TapeEvaluator::Evaluate(tape, work.x.data(), work.y.data(), work.z.data(), work.values.data(), pointCount);
+				work.samples += pointCount;
+
+				size_t mergedCount = 0;
+				for (size_t c = 0; c < work.candidates.size(); ++c) {
+					Node& parent = parents[work.candidates[c]];
+					if (!SignsAllowMerge(&work.values[c * 27]))
+						continue;
+					glm::dvec3 x = parent.qef.Solve(settings.singularThreshold);
+					glm::dvec3 lower = glm::dvec3(FromMorton(parent.code)) * (cellSize * size);
+					if (parent.qef.Residual(x) > tolerance || !Inside(x, lower, cellSize * size, 0))
+						continue;
+					parent.vertex = glm::vec3(x);
+					parent.leaf = true;
+					for (uint32_t k = 0; k < parent.childCount; ++k)
+						children[parent.firstChild + k].merged = true;
+					++mergedCount;
+				}
+				if (mergedCount == 0)
+					break;
+			}
+
+			for (size_t level = 0; level < levelCount; ++level) {
+				for (Node& node : work.levels[level]) {
+					if (!node.leaf || node.merged)
+						continue;
+					node.leafIndex = (uint32_t)result.positions.size();
+					result.positions.push_back(blockOrigin + node.vertex);
+					glm::uvec3 lower = FromMorton(node.code) << uint32_t(level);
+					result.keys.push_back(LeafKey(blockMin + lower));
+					result.onFace.push_back(glm::any(glm::equal(lower, glm::uvec3(0))) || glm::any(glm::equal(lower + (1u << level), glm::uvec3(blockCells))));
+				}
+			}
+			result.leafOfCell.reserve(cells.size());
+			for (const Node& cell : cells) {
+				const Node* node = &cell;
+				for (size_t level = 0; node->merged; ++level)
+					node = &work.levels[level + 1][node->parent];
+				result.leafOfCell.push_back({ cell.code, node->leafIndex });
+			}
+		}
+
+	private:
+		const DualContouring& settings;
+		const MeshGrid& grid;
+		uint32_t brickSize;
+		glm::uvec3 blockMin;
+		uint32_t blockCells;
+		glm::vec3 blockOrigin;
+		BlockWork& work;
+		BlockResult& result;
+
+		static bool Inside(glm::dvec3 x, glm::dvec3 lower, double size, double margin) {
+			return glm::all(glm::greaterThanEqual(x, lower - margin)) && glm::all(glm::lessThanEqual(x, lower + size + margin));
+		}
+
+		// merging keeps the topology of the children if the sign at each edge midpoint, face center and the center of the merged cell
+		// equals the sign at one of the corners of its edge, face or cell (values at (x, y, z) in {0, 1, 2}^3, x fastest)
+		static bool SignsAllowMerge(const float* values) {
+			for (int z = 0; z < 3; ++z)
+				for (int y = 0; y < 3; ++y)
+					for (int x = 0; x < 3; ++x) {
+						int p[3] = { x, y, z };
+						if (x != 1 && y != 1 && z != 1)
+							continue;
+						bool inside = values[x + 3 * y + 9 * z] < 0, matched = false;
+						for (int c = 0; c < 8 && !matched; ++c) {
+							int corner[3];
+							for (int axis = 0; axis < 3; ++axis)
+								corner[axis] = p[axis] == 1 ? ((c >> axis) & 1) * 2 : p[axis];
+							matched = (values[corner[0] + 3 * corner[1] + 9 * corner[2]] < 0) == inside;
+						}
+						if (!matched)
+							return false;
+					}
+			return true;
+		}
+	};
+
+	// per thread memory of the second pass
+	struct ChunkWork {
+		MeshChunk chunk;
+		std::unordered_map<uint64_t, uint32_t> vertexOfKey;
+
+		size_t Bytes() const { return chunk.Bytes() + vertexOfKey.size() * (sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(void*)); }
+	};
+}
+
+size_t DualContouring::Extract(const Tape& tape, const BoundingBox& box, uint32_t depth, const Sink& sink, ThreadPool& pool)
+{
+	if (depth > maxDepth)
+		throw std::invalid_argument("DualContouring: the depth is limited to " + std::to_string(maxDepth) + ".");
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = DualContouringStats();
+
+	uint32_t brickDepth = 0;
+	while ((2u << brickDepth) <= brickSize && brickDepth < depth)
+		++brickDepth;
+	const uint32_t brick = 1u << brickDepth;
+	const uint32_t octreeDepth = std::min(blockDepth, depth - brickDepth);
+	const uint32_t blockCells = 1u << (depth - octreeDepth);
+
+	BoundingBox cube = MarchingCubes::GridCube(box);
+	MeshGrid grid{ cube.min, (cube.max.x - cube.min.x) / float(1u << depth) };
+
+	IntervalOctree octree;
+	octree.Build(tape, cube, octreeDepth, pool);
+	std::vector<uint32_t> blocks = octree.SurfaceCells();
+	stats.blocks = blocks.size();
+	const size_t octreeBytes = octree.Cells().capacity() * sizeof(OctreeCell);
+
+	std::vector<glm::uvec3> blockMins(blocks.size());
+	std::unordered_map<uint64_t, uint32_t> blockOfCode;
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		blockMins[b] = glm::uvec3(glm::round((octree.Cells()[blocks[b]].box.min - grid.origin) / grid.cellSize));
+		blockOfCode[Morton(blockMins[b] / blockCells)] = (uint32_t)b;
+	}
+
+	// first pass: Hermite data and leaves of every block
+	std::vector<BlockResult> results(blocks.size());
+	std::atomic<size_t> bricks{ 0 }, pruningTests{ 0 }, samples{ 0 }, cells{ 0 };
+	std::vector<size_t> scratchBytes(pool.ThreadCount(), 0);
+	pool.ParallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+		thread_local BlockWork work;
+		if (work.levels.size() < depth + 1)
+			work.levels.resize(depth + 1);
+		BrickOctree bricksOfBlock(grid, brick, pruning);
+		for (size_t b = begin; b < end; ++b) {
+			const OctreeCell& cell = octree.Cells()[blocks[b]];
+			work.levels[0].clear();
+			work.bricks = work.samples = 0;
+			bricksOfBlock.pruningTests = 0;
+			BlockSimplifier simplifier(*this, grid, brick, blockMins[b], blockCells, work, results[b]);
+			bricksOfBlock.Visit(*cell.tape, blockMins[b], blockCells,
+				[&](const Tape& brickTape, glm::uvec3 brickMin) { simplifier.Brick(brickTape, brickMin); }, nullptr);
+			cells += work.levels[0].size();
+			simplifier.Simplify(*cell.tape);
+
+			bricks += work.bricks;
+			pruningTests += bricksOfBlock.pruningTests;
+			samples += work.samples;
+			size_t& bytes = scratchBytes[ThreadPool::ThreadIndex()];
+			bytes = std::max(bytes, work.Bytes());
+		}
+	});
+	size_t resultBytes = 0, crossings = 0, leaves = 0;
+	for (const BlockResult& result : results) {
+		resultBytes += result.Bytes();
+		crossings += result.crossings.size();
+		leaves += result.positions.size();
+	}
+
+	// the leaf of a grid cell with crossings, false for cells outside of the blocks
+	auto leafOf = [&](glm::uvec3 cell, uint32_t& block, uint32_t& leaf) {
+		auto found = blockOfCode.find(Morton(cell / blockCells));
+		if (found == blockOfCode.end())
+			return false;
+		const auto& leafOfCell = results[found->second].leafOfCell;
+		uint64_t code = Morton(cell - blockMins[found->second]);
+		auto it = std::lower_bound(leafOfCell.begin(), leafOfCell.end(), std::make_pair(code, uint32_t(0)));
+		if (it == leafOfCell.end() || it->first != code)
+			return false;
+		block = found->second;
+		leaf = it->second;
+		return true;
+	};
+
+	// second pass: a quad around every crossed edge, the chunks wait for the ones before them like in MarchingCubes
+	std::mutex sinkMutex;
+	std::vector<MeshChunk> waiting(blocks.size());
+	std::vector<bool> ready(blocks.size(), false);
+	size_t nextBlock = 0, waitingBytes = 0, peakWaitingBytes = 0;
+	std::atomic<size_t> triangles{ 0 };
+	std::vector<size_t> chunkBytes(pool.ThreadCount(), 0);
+	pool.ParallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+		thread_local ChunkWork work;
+		for (size_t b = begin; b < end; ++b) {
+			work.chunk.Clear();
+			work.vertexOfKey.clear();
+			auto vertex = [&](uint32_t block, uint32_t leaf) {
+				auto [it, inserted] = work.vertexOfKey.try_emplace(results[block].keys[leaf], (uint32_t)work.chunk.positions.size());
+				if (inserted) {
+					work.chunk.positions.push_back(results[block].positions[leaf]);
+					work.chunk.keys.push_back(results[block].keys[leaf]);
+					work.chunk.shared.push_back(block != b || results[block].onFace[leaf]);
+				}
+				return it->second;
+			};
+
+			for (const Crossing& crossing : results[b].crossings) {
+				int u = (crossing.axis + 1) % 3, v = (crossing.axis + 2) % 3;
+				if (crossing.lowerEnd[u] == 0 || crossing.lowerEnd[v] == 0)
+					continue;
+				// counter-clockwise around the axis, which points outside if the lower end is inside
+				static constexpr int around[4][2] = { { 1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 } };
+				uint32_t quad[4], count = 0;
+				bool complete = true;
+				for (int k = 0; k < 4 && complete; ++k) {
+					glm::uvec3 cell = crossing.lowerEnd;
+					cell[u] -= around[k][0];
+					cell[v] -= around[k][1];
+					uint32_t block, leaf;
+					complete = leafOf(cell, block, leaf);
+					if (complete)
+						quad[k] = vertex(block, leaf);
+				}
+				if (!complete)
+					continue;
+				if (!crossing.lowerInside)
+					std::swap(quad[1], quad[3]);
+
+				// cells in the same leaf are next to each other around the edge
+				uint32_t distinct[4];
+				for (int k = 0; k < 4; ++k)
+					if (quad[k] != quad[(k + 3) % 4])
+						distinct[count++] = quad[k];
+				if (count == 4) {
+					const auto& p = work.chunk.positions;
+					bool shorter02 = glm::distance(p[distinct[0]], p[distinct[2]]) <= glm::distance(p[distinct[1]], p[distinct[3]]);
+					if (shorter02)
+						work.chunk.indices.insert(work.chunk.indices.end(), { distinct[0], distinct[1], distinct[2], distinct[0], distinct[2], distinct[3] });
+					else
+						work.chunk.indices.insert(work.chunk.indices.end(), { distinct[0], distinct[1], distinct[3], distinct[1], distinct[2], distinct[3] });
+				}
+				else if (count == 3) {
+					work.chunk.indices.insert(work.chunk.indices.end(), { distinct[0], distinct[1], distinct[2] });
+				}
+			}
+			// the leaves of the neighbours are outside of the block, where its tape isn't valid
+			if (curvatures)
+				MeshAttributes::Curvatures(tape, work.chunk, grid.cellSize * 1e-2f);
+			else if (normals)
+				MeshAttributes::Normals(tape, work.chunk, grid.cellSize * 1e-2f);
+			if (normals || curvatures)
+				samples += work.chunk.VertexCount();
+			triangles += work.chunk.TriangleCount();
+
+			std::lock_guard<std::mutex> lock(sinkMutex);
+			chunkBytes[ThreadPool::ThreadIndex()] = std::max(chunkBytes[ThreadPool::ThreadIndex()], work.Bytes());
+			if (b != nextBlock) {
+				waitingBytes += work.chunk.Bytes();
+				peakWaitingBytes = std::max(peakWaitingBytes, waitingBytes);
+				waiting[b] = std::move(work.chunk);
+				ready[b] = true;
+				continue;
+			}
+			sink(work.chunk);
+			for (++nextBlock; nextBlock < blocks.size() && ready[nextBlock]; ++nextBlock) {
+				sink(waiting[nextBlock]);
+				waitingBytes -= waiting[nextBlock].Bytes();
+				waiting[nextBlock] = MeshChunk();
+			}
+		}
+	});
+
+	stats.bricks = bricks;
+	stats.pruningTests = pruningTests;
+	stats.samples = samples;
+	stats.crossings = crossings;
+	stats.cells = cells;
+	stats.leaves = leaves;
+	stats.triangles = triangles;
+	stats.peakBytes = octreeBytes + resultBytes + peakWaitingBytes;
+	for (size_t t = 0; t < scratchBytes.size(); ++t)
+		stats.peakBytes += std::max(scratchBytes[t], chunkBytes[t]);
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return stats.triangles;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Tape.h"
+#include "MeshChunk.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include "BrickOctree.h"
+#include <functional>
+
+struct DualContouringStats {
+	size_t blocks = 0; // surface cells of the coarse interval octree, simplified and meshed in parallel
+	size_t bricks = 0;
+	size_t pruningTests = 0;
+	size_t samples = 0; // points evaluated: lattices, root refinement, normals and topology tests
+	size_t crossings = 0; // grid edges with a sign change, each with a point and a normal
+	size_t cells = 0; // grid cells with a vertex before the simplification
+	size_t leaves = 0; // vertices left after merging cells
+	size_t triangles = 0;
+	size_t peakBytes = 0; // Hermite data and leaves of all blocks, the chunks waiting for their turn and the per thread scratch memory
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Dual contouring of Hermite data on a virtual grid of 2^depth cells per axis over a cube, which keeps the sharp edges and corners
+/// that marching cubes cuts off.
+///
+/// The blocks of an IntervalOctree are subdivided down to bricks like in MarchingCubes. Every grid edge with a sign change gets its
+/// crossing point (regula falsi on the edge) and the exact normal there from TapeEvaluator::EvaluateDerivatives. Each cell with crossings
+/// gets the vertex that minimizes the squared distances to the tangent planes of its crossings (a quadric error function, QEF),
+/// solved with an eigen decomposition that keeps underdetermined directions at the mean of the crossing points.
+/// Then the cells of each block are merged bottom up into octree leaves of up to the whole block while the merged QEF stays below
+/// maxError, the vertex stays inside the merged cell and the signs in the cell allow it (the test of Ju et al. on the corners, edge
+/// midpoints, face centers and center), so flat and cylindrical parts take few triangles. Finally every crossed edge is turned into a
+/// quad between the leaves of its 4 cells, split into triangles, or into one triangle where two of them are in the same leaf.
+///
+/// Both passes run in parallel over the blocks and the chunks are handed to the sink in a fixed order, one per block.
+/// The key of a vertex holds the grid coordinates of the lower corner of its leaf: key = x | y << 21 | z << 42. The leaves that touch
+/// a face of their block, including all the leaves of neighbouring blocks in a chunk, are marked as shared.
+/// </summary>
+class DualContouring
+{
+public:
+	/// <summary>
+	/// Receives the chunk of one block, called by one thread at a time in block order. The chunk is reused after the call.
+	/// </summary>
+	using Sink = std::function<void(const MeshChunk& chunk)>;
+
+	static constexpr uint32_t maxDepth = 21;
+
+	MeshPruning pruning = MeshPruning::Interval;
+	uint32_t blockDepth = 3; // cells are never merged across blocks: fewer, larger blocks allow more simplification
+	uint32_t brickSize = 8;
+	float maxError = 0.05f; // largest QEF residual of merged cells, as a distance in cells (0 disables the simplification)
+	float singularThreshold = 0.02f; // eigenvalues of the QEF below this fraction of the largest one are dropped
+	uint32_t rootIterations = 4; // regula falsi steps for the crossing points, exact after the first one where the function is linear
+	bool normals = false; // fill MeshChunk::normals, see MeshAttributes::Normals
+	bool curvatures = false; // fill the normals, curvatures and principal directions of MeshChunk, see MeshAttributes::Curvatures
+
+	/// <summary>
+	/// Meshes the zero set inside the cube around box (see MarchingCubes::GridCube) with 2^depth cells per axis.
+	/// Returns the number of triangles. Throws std::invalid_argument for depths above maxDepth.
+	/// </summary>
+	size_t Extract(const Tape& tape, const BoundingBox& box, uint32_t depth, const Sink& sink, ThreadPool& pool = ThreadPool::Global());
+
+	const DualContouringStats& Stats() const { return stats; }
+
+private:
+	DualContouringStats stats;
+};
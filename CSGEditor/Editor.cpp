@@ -425,10 +425,10 @@ void Editor::CopyToClipBoard(ClipBoard& cb)
         }
     }
 
-    std::vector<NodeHandle> selectionRoots;
+    std::vector<std::shared_ptr<Node>> selectionRoots;
     for (int i = 0; i < count; ++i) {
         if (isRoot[i])
-            selectionRoots.push_back(nodes[nodeIds[i].Get()]);
+            selectionRoots.push_back(nodes[nodeIds[i].Get()]->node);
     }
 
     ImGui::SetClipboardText(NodeJsonSerializer::Serialize(selectionRoots).c_str());
@@ -550,7 +550,7 @@ void Editor::ConnectNodes(NodeHandle from, NodeHandle to)
     auto inPin = to.node->GetFirstFreeInput();
 
     if (!AllowConnection(*outPin, *inPin))
-        throw std::exception("Invalid connection");
+        throw std::runtime_error("Invalid connection");
 
     CreateLink(outPin, inPin);
 }
@@ -47,7 +47,6 @@ public:
 		friend struct std::hash<NodeHandle>;
 		friend struct std::equal_to<NodeHandle>;
 		friend class Persistence;
-		friend class NodeJsonSerializer;
 	public:
 		NodeHandle(std::shared_ptr<GuiNode> node);
 
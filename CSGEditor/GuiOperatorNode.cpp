@@ -1,4 +1,5 @@
 #include "GuiOperatorNode.h"
+#include "GuiParameterDrawer.h"
 #include "CircleCheck.h"
 #include <algorithm>
 
@@ -57,7 +58,8 @@ bool GuiOperatorNode::DrawPart()
     typeComboBox.Draw();
 
     auto opNode = std::static_pointer_cast<OperatorNode>(node);
-    updated |= opNode->operatorDescription->NodeEditorDraw();
+    updated |= OperatorParameterDrawer::Draw(*opNode->operatorDescription);
+    updated |= ImGui::Checkbox("Baked", &opNode->baked);
 
     ImGui::PopItemWidth();
     ImGui::PopID();
@@ -71,7 +73,6 @@ bool GuiOperatorNode::DrawPopups()
     GuiNode::DrawPopups();
 
     auto opNode = std::static_pointer_cast<OperatorNode>(node);
-    updated |= opNode->operatorDescription->NodeEditorPopup();
     if (typeComboBox.DrawPopup()) {
         updated = true;
         opNode->operatorDescription = OperatorTypes::Create(opNode->operatorIdx);
@@ -0,0 +1,81 @@
+#include "GuiParameterDrawer.h"
+#include "utils.h"
+#include <nfd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+
+bool PrimitiveParameterDrawer::Draw(Primitive& primitive)
+{
+    PrimitiveParameterDrawer drawer;
+    primitive.Accept(drawer);
+    return drawer.changed;
+}
+
+void PrimitiveParameterDrawer::operator()(Box& box)
+{
+    changed = utils::InputVec3("dimensions", box.dimensions, 2);
+}
+
+void PrimitiveParameterDrawer::operator()(Cylinder& cylinder)
+{
+    changed =
+        ImGui::InputFloat("radius", &cylinder.radius) ||
+        ImGui::InputFloat("height", &cylinder.height);
+}
+
+void PrimitiveParameterDrawer::operator()(Torus& torus)
+{
+    changed =
+        ImGui::InputFloat("major radius", &torus.major_radius) ||
+        ImGui::InputFloat("minor radius", &torus.minor_radius);
+}
+
+void PrimitiveParameterDrawer::operator()(Ellipsoid& ellipsoid)
+{
+    changed = utils::InputVec3("radii", ellipsoid.radii, 2);
+}
+
+void PrimitiveParameterDrawer::operator()(Plane& plane)
+{
+    if (ImGui::InputFloat3("n", &plane.n[0], 3, ImGuiInputTextFlags_EnterReturnsTrue)) {
+        changed = true;
+        plane.n = glm::normalize(plane.n);
+    }
+    changed = ImGui::InputFloat("h", &plane.h) || changed;
+}
+
+void PrimitiveParameterDrawer::operator()(Mesh& mesh)
+{
+    ImGui::Text("%s", mesh.file.empty() ? "no file" : std::filesystem::path(mesh.file).filename().string().c_str());
+    if (ImGui::Button("Open model")) {
+        nfdchar_t* path = NULL;
+        if (NFD_OpenDialog("obj,ply,stl,fbx,gltf,glb,dae,3ds", NULL, &path) == NFD_OKAY) {
+            mesh.file = path;
+            std::free(path);
+            changed = true;
+        }
+    }
+    if (ImGui::InputInt("resolution", &mesh.resolution, 16, 64, ImGuiInputTextFlags_EnterReturnsTrue)) {
+        mesh.resolution = std::max(mesh.resolution, 16);
+        changed = true;
+    }
+
+    // the app loads the new file in the background (see App::LoadMeshes), the shader keeps using the previous bake until then
+    if (!mesh.IsLoaded())
+        ImGui::Text("loading...");
+    else if (!mesh.error.empty())
+        ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "%s", mesh.error.c_str());
+}
+
+bool OperatorParameterDrawer::Draw(Operator& op)
+{
+    OperatorParameterDrawer drawer;
+    op.Accept(drawer);
+    return drawer.changed;
+}
+
+void OperatorParameterDrawer::DrawSmooth(SmoothOperator& op)
+{
+    changed = ImGui::InputFloat("k", &op.k);
+}
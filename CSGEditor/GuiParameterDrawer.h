@@ -0,0 +1,53 @@
+#pragma once
+#include "Primitive.h"
+#include "Operator.h"
+
+/// <summary>
+/// Draws the imgui widgets for the parameters of a primitive inside its node in the graph editor.
+/// Kept on the editor side, so the primitives themselves don't depend on the gui.
+/// </summary>
+class PrimitiveParameterDrawer : public PrimitiveVisitor
+{
+public:
+	/// <summary>
+	/// Draws the widgets of the given primitive.
+	/// </summary>
+	/// <returns>whether any of the parameters changed</returns>
+	static bool Draw(Primitive& primitive);
+
+	virtual void operator()(Sphere& sphere) override {}
+	virtual void operator()(Box& box) override;
+	virtual void operator()(Cylinder& cylinder) override;
+	virtual void operator()(Torus& torus) override;
+	virtual void operator()(Ellipsoid& ellipsoid) override;
+	virtual void operator()(Plane& plane) override;
+	virtual void operator()(Mesh& mesh) override;
+
+private:
+	bool changed = false;
+};
+
+/// <summary>
+/// Draws the imgui widgets for the parameters of an operator inside its node in the graph editor.
+/// </summary>
+class OperatorParameterDrawer : public OperatorVisitor
+{
+public:
+	/// <summary>
+	/// Draws the widgets of the given operator.
+	/// </summary>
+	/// <returns>whether any of the parameters changed</returns>
+	static bool Draw(Operator& op);
+
+	virtual void operator()(Union& op) override {}
+	virtual void operator()(Intersection& op) override {}
+	virtual void operator()(Substraction& op) override {}
+	virtual void operator()(SmoothUnion& op) override { DrawSmooth(op); }
+	virtual void operator()(SmoothIntersection& op) override { DrawSmooth(op); }
+	virtual void operator()(SmoothSubstraction& op) override { DrawSmooth(op); }
+
+private:
+	bool changed = false;
+
+	void DrawSmooth(SmoothOperator& op);
+};
@@ -1,4 +1,5 @@
 #include "GuiPrimitiveNode.h"
+#include "GuiParameterDrawer.h"
 
 /*
          GUI PRIMITIVE NODE
@@ -17,7 +18,7 @@ bool GuiPrimitiveNode::DrawPart()
     typeComboBox.Draw();
 
     auto primNode = std::static_pointer_cast<PrimitiveNode>(node);
-    updated |= primNode->primitive->NodeEditorDraw();
+    updated |= PrimitiveParameterDrawer::Draw(*primNode->primitive);
 
     ImGui::PopItemWidth();
     ImGui::PopID();
@@ -32,7 +33,6 @@ bool GuiPrimitiveNode::DrawPopups()
     GuiNode::DrawPopups();
 
     auto primNode = std::static_pointer_cast<PrimitiveNode>(node);
-    updated |= primNode->primitive->NodeEditorPopup();
     if (typeComboBox.DrawPopup()) {
         updated = true;
         primNode->primitive = PrimitiveTypes::Create(primNode->primitiveIdx);
@@ -0,0 +1,269 @@
+#include "ImageIO.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace {
+	std::ofstream OpenForWriting(const std::string& fileName) {
+		std::ofstream f(fileName, std::ios::binary);
+		if (!f.is_open())
+			throw std::runtime_error("Can't write " + fileName);
+		return f;
+	}
+
+	// png and zlib checksums
+
+	uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+		static const std::array<uint32_t, 256> table = [] {
+			std::array<uint32_t, 256> t{};
+			for (uint32_t n = 0; n < 256; ++n) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				t[n] = c;
+			}
+			return t;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	uint32_t Adler32(const std::vector<uint8_t>& data) {
+		uint32_t a = 1, b = 0;
+		for (uint8_t byte : data) {
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	void AppendBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back(uint8_t(v >> shift));
+	}
+
+	void WriteChunk(std::ofstream& f, const char type[4], const std::vector<uint8_t>& data) {
+		std::vector<uint8_t> chunk;
+		AppendBigEndian(chunk, (uint32_t)data.size());
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		AppendBigEndian(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+		f.write((const char*)chunk.data(), chunk.size());
+	}
+
+	// exr is little endian
+	template<typename T>
+	void AppendLittleEndian(std::vector<uint8_t>& out, T v) {
+		uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, &v, sizeof(T));
+		out.insert(out.end(), bytes, bytes + sizeof(T)); // all supported platforms are little endian
+	}
+
+	void AppendAttribute(std::vector<uint8_t>& out, const std::string& name, const std::string& type, const std::vector<uint8_t>& value) {
+		out.insert(out.end(), name.begin(), name.end());
+		out.push_back(0);
+		out.insert(out.end(), type.begin(), type.end());
+		out.push_back(0);
+		AppendLittleEndian<int32_t>(out, (int32_t)value.size());
+		out.insert(out.end(), value.begin(), value.end());
+	}
+
+	template<typename T>
+	T ReadLittleEndian(const std::vector<uint8_t>& data, size_t& pos) {
+		if (pos + sizeof(T) > data.size())
+			throw std::runtime_error("Unexpected end of the exr file.");
+		T v;
+		std::memcpy(&v, data.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return v;
+	}
+
+	std::string ReadString(const std::vector<uint8_t>& data, size_t& pos) {
+		size_t end = pos;
+		while (end < data.size() && data[end] != 0)
+			++end;
+		if (end == data.size())
+			throw std::runtime_error("Unexpected end of the exr file.");
+		std::string s(data.begin() + pos, data.begin() + end);
+		pos = end + 1;
+		return s;
+	}
+}
+
+void ImageIO::WritePng(const Image& image, const std::string& fileName)
+{
+	// scanlines with filter type 0 (none)
+	std::vector<uint8_t> raw;
+	raw.reserve(size_t(image.height) * (image.width * 4 + 1));
+	for (int y = 0; y < image.height; ++y) {
+		raw.push_back(0);
+		for (int x = 0; x < image.width; ++x) {
+			glm::vec4 c = glm::clamp(image.At(x, y), 0.0f, 1.0f);
+			for (int i = 0; i < 4; ++i)
+				raw.push_back(uint8_t(c[i] * 255.0f + 0.5f));
+		}
+	}
+
+	// zlib stream of stored (uncompressed) deflate blocks
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	size_t pos = 0;
+	do {
+		size_t length = std::min<size_t>(raw.size() - pos, 65535);
+		zlib.push_back(pos + length == raw.size() ? 1 : 0);
+		zlib.push_back(uint8_t(length));
+		zlib.push_back(uint8_t(length >> 8));
+		zlib.push_back(uint8_t(~length));
+		zlib.push_back(uint8_t(~length >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+		pos += length;
+	} while (pos < raw.size());
+	AppendBigEndian(zlib, Adler32(raw));
+
+	std::vector<uint8_t> header;
+	AppendBigEndian(header, (uint32_t)image.width);
+	AppendBigEndian(header, (uint32_t)image.height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bits per channel, RGBA, deflate, no filters, not interlaced
+
+	auto f = OpenForWriting(fileName);
+	const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	f.write((const char*)signature, sizeof(signature));
+	WriteChunk(f, "IHDR", header);
+	WriteChunk(f, "IDAT", zlib);
+	WriteChunk(f, "IEND", {});
+	if (!f)
+		throw std::runtime_error("Failed to write " + fileName);
+}
+
+void ImageIO::WriteExr(const Image& image, const std::string& fileName)
+{
+	std::vector<uint8_t> out;
+	AppendLittleEndian<uint32_t>(out, 20000630); // magic number
+	AppendLittleEndian<uint32_t>(out, 2); // version 2, single part scanline file
+
+	// channels are stored in alphabetical order
+	const char* channelNames[] = { "A", "B", "G", "R" };
+	const int channelComponents[] = { 3, 2, 1, 0 };
+	std::vector<uint8_t> channels;
+	for (const char* name : channelNames) {
+		channels.push_back(name[0]);
+		channels.push_back(0);
+		AppendLittleEndian<int32_t>(channels, 2); // FLOAT
+		AppendLittleEndian<uint32_t>(channels, 0); // pLinear and reserved
+		AppendLittleEndian<int32_t>(channels, 1); // x sampling
+		AppendLittleEndian<int32_t>(channels, 1); // y sampling
+	}
+	channels.push_back(0);
+
+	std::vector<uint8_t> window;
+	for (int32_t v : { 0, 0, image.width - 1, image.height - 1 })
+		AppendLittleEndian<int32_t>(window, v);
+	std::vector<uint8_t> one, center;
+	AppendLittleEndian<float>(one, 1.0f);
+	AppendLittleEndian<float>(center, 0.0f);
+	AppendLittleEndian<float>(center, 0.0f);
+
+	AppendAttribute(out, "channels", "chlist", channels);
+	AppendAttribute(out, "compression", "compression", { 0 });
+	AppendAttribute(out, "dataWindow", "box2i", window);
+	AppendAttribute(out, "displayWindow", "box2i", window);
+	AppendAttribute(out, "lineOrder", "lineOrder", { 0 });
+	AppendAttribute(out, "pixelAspectRatio", "float", one);
+	AppendAttribute(out, "screenWindowCenter", "v2f", center);
+	AppendAttribute(out, "screenWindowWidth", "float", one);
+	out.push_back(0);
+
+	// one scanline per block: offset table, then y, size and the channels one after the other
+	const uint32_t lineSize = uint32_t(image.width) * 4 * sizeof(float);
+	uint64_t offset = out.size() + uint64_t(image.height) * sizeof(uint64_t);
+	for (int y = 0; y < image.height; ++y) {
+		AppendLittleEndian<uint64_t>(out, offset);
+		offset += 8 + lineSize;
+	}
+	for (int y = 0; y < image.height; ++y) {
+		AppendLittleEndian<int32_t>(out, y);
+		AppendLittleEndian<uint32_t>(out, lineSize);
+		for (int c : channelComponents)
+			for (int x = 0; x < image.width; ++x)
+				AppendLittleEndian<float>(out, image.At(x, y)[c]);
+	}
+
+	auto f = OpenForWriting(fileName);
+	f.write((const char*)out.data(), out.size());
+	if (!f)
+		throw std::runtime_error("Failed to write " + fileName);
+}
+
+Image ImageIO::ReadExr(const std::string& fileName)
+{
+	std::ifstream f(fileName, std::ios::binary);
+	if (!f.is_open())
+		throw std::runtime_error("Can't open " + fileName);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+	size_t pos = 0;
+	if (ReadLittleEndian<uint32_t>(data, pos) != 20000630)
+		throw std::runtime_error(fileName + " is not an exr file.");
+	if ((ReadLittleEndian<uint32_t>(data, pos) & 0xFFFFFF00u) != 0)
+		throw std::runtime_error(fileName + ": only single part scanline exr files are supported.");
+
+	std::vector<std::string> channels;
+	int32_t window[4] = {};
+	for (std::string name = ReadString(data, pos); !name.empty(); name = ReadString(data, pos)) {
+		std::string type = ReadString(data, pos);
+		int32_t size = ReadLittleEndian<int32_t>(data, pos);
+		size_t valueEnd = pos + size;
+		if (name == "channels") {
+			for (std::string channel = ReadString(data, pos); !channel.empty(); channel = ReadString(data, pos)) {
+				if (ReadLittleEndian<int32_t>(data, pos) != 2)
+					throw std::runtime_error(fileName + ": only 32 bit float channels are supported.");
+				pos += 12; // pLinear, reserved, sampling
+				channels.push_back(channel);
+			}
+		}
+		else if (name == "compression" && data.at(pos) != 0) {
+			throw std::runtime_error(fileName + ": only uncompressed exr files are supported.");
+		}
+		else if (name == "dataWindow") {
+			for (int32_t& v : window)
+				v = ReadLittleEndian<int32_t>(data, pos);
+		}
+		pos = valueEnd;
+	}
+
+	Image image(window[2] - window[0] + 1, window[3] - window[1] + 1, glm::vec4(0, 0, 0, 1));
+	std::map<std::string, int> components = { {"R", 0}, {"G", 1}, {"B", 2}, {"A", 3} };
+	pos += size_t(image.height) * sizeof(uint64_t); // the blocks follow the offset table in order for uncompressed increasing y files
+	for (int line = 0; line < image.height; ++line) {
+		int32_t y = ReadLittleEndian<int32_t>(data, pos) - window[1];
+		ReadLittleEndian<uint32_t>(data, pos);
+		if (y < 0 || y >= image.height)
+			throw std::runtime_error(fileName + ": invalid scanline.");
+		for (const std::string& channel : channels) {
+			auto component = components.find(channel);
+			for (int x = 0; x < image.width; ++x) {
+				float v = ReadLittleEndian<float>(data, pos);
+				if (component != components.end())
+					image.At(x, y)[component->second] = v;
+			}
+		}
+	}
+	return image;
+}
+
+void ImageIO::Write(const Image& image, const std::string& fileName)
+{
+	std::string extension = fileName.size() >= 4 ? fileName.substr(fileName.size() - 4) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (extension == ".exr")
+		WriteExr(image, fileName);
+	else
+		WritePng(image, fileName);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// RGBA float image, rows from top to bottom.
+/// </summary>
+struct Image {
+	int width = 0;
+	int height = 0;
+	std::vector<glm::vec4> pixels;
+
+	Image() = default;
+	Image(int width, int height, glm::vec4 fill = glm::vec4(0)) : width(width), height(height), pixels(size_t(width) * height, fill) {}
+
+	glm::vec4& At(int x, int y) { return pixels[size_t(y) * width + x]; }
+	const glm::vec4& At(int x, int y) const { return pixels[size_t(y) * width + x]; }
+};
+
+/// <summary>
+/// Minimal image files without external libraries, for the headless tools.
+/// PNG is written as 8 bit RGBA with uncompressed deflate blocks (values are clamped to [0, 1] like in an RGBA8 framebuffer),
+/// EXR as uncompressed 32 bit float RGBA scanlines, which keeps the unclamped values for comparisons.
+/// All functions throw std::runtime_error on failure.
+/// </summary>
+class ImageIO
+{
+public:
+	static void WritePng(const Image& image, const std::string& fileName);
+	static void WriteExr(const Image& image, const std::string& fileName);
+
+	/// <summary>
+	/// Reads uncompressed scanline EXR files with 32 bit float channels, like the ones WriteExr writes.
+	/// Missing color channels are 0, missing alpha is 1.
+	/// </summary>
+	static Image ReadExr(const std::string& fileName);
+
+	/// <summary>
+	/// Writes as EXR if the file name ends with .exr, as PNG otherwise.
+	/// </summary>
+	static void Write(const Image& image, const std::string& fileName);
+};
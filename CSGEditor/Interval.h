@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// <summary>
+/// Closed interval of floats, a number type for the templates of SdfFormulas.h and TapeEvaluator::EvaluateBlock:
+/// evaluating the sdf with intervals as coordinates gives bounds of the distance over a whole box.
+/// The bounds are conservative up to float rounding (no outward rounding), which is far below the cell sizes the octree works with.
+/// </summary>
+struct Interval {
+	float lower;
+	float upper;
+
+	Interval() = default;
+	Interval(float value) : lower(value), upper(value) {}
+	Interval(float lower, float upper) : lower(lower), upper(upper) {}
+
+	static Interval Everything() {
+		const float inf = std::numeric_limits<float>::infinity();
+		return Interval(-inf, inf);
+	}
+
+	static Interval Hull(const Interval& a, const Interval& b) {
+		return Interval(std::min(a.lower, b.lower), std::max(a.upper, b.upper));
+	}
+
+	bool Contains(float value) const { return lower <= value && value <= upper; }
+	float Width() const { return upper - lower; }
+};
+
+/// <summary>
+/// Result of comparing intervals: the comparison may be true for some values and false for others.
+/// </summary>
+struct IntervalMask {
+	bool canBeTrue;
+	bool canBeFalse;
+};
+
+inline Interval operator+(const Interval& a, const Interval& b) { return Interval(a.lower + b.lower, a.upper + b.upper); }
+inline Interval operator-(const Interval& a, const Interval& b) { return Interval(a.lower - b.upper, a.upper - b.lower); }
+inline Interval operator-(const Interval& a) { return Interval(-a.upper, -a.lower); }
+
+inline Interval operator*(const Interval& a, const Interval& b) {
+	float p0 = a.lower * b.lower, p1 = a.lower * b.upper, p2 = a.upper * b.lower, p3 = a.upper * b.upper;
+	return Interval(std::min(std::min(p0, p1), std::min(p2, p3)), std::max(std::max(p0, p1), std::max(p2, p3)));
+}
+
+// the constants of the formulas and the tape are mostly scalars, these avoid the four products
+inline Interval operator*(const Interval& a, float b) {
+	if (b == 0)
+		return Interval(0.0f); // not NaN for infinite bounds
+	return b > 0 ? Interval(a.lower * b, a.upper * b) : Interval(a.upper * b, a.lower * b);
+}
+inline Interval operator*(float a, const Interval& b) { return b * a; }
+inline Interval operator/(const Interval& a, float b) { return b >= 0 ? Interval(a.lower / b, a.upper / b) : Interval(a.upper / b, a.lower / b); }
+
+inline Interval operator/(const Interval& a, const Interval& b) {
+	if (b.lower <= 0 && b.upper >= 0)
+		return Interval::Everything();
+	return a * Interval(1.0f / b.upper, 1.0f / b.lower);
+}
+
+inline IntervalMask operator<(const Interval& a, const Interval& b) { return { a.lower < b.upper, a.upper >= b.lower }; }
+inline IntervalMask operator>(const Interval& a, const Interval& b) { return { a.upper > b.lower, a.lower <= b.upper }; }
+inline IntervalMask operator<=(const Interval& a, const Interval& b) { return { a.lower <= b.upper, a.upper > b.lower }; }
+inline IntervalMask operator>=(const Interval& a, const Interval& b) { return { a.upper >= b.lower, a.lower < b.upper }; }
+inline IntervalMask operator&(IntervalMask a, IntervalMask b) { return { a.canBeTrue && b.canBeTrue, a.canBeFalse || b.canBeFalse }; }
+inline IntervalMask operator|(IntervalMask a, IntervalMask b) { return { a.canBeTrue || b.canBeTrue, a.canBeFalse && b.canBeFalse }; }
+inline IntervalMask operator!(IntervalMask a) { return { a.canBeFalse, a.canBeTrue }; }
+
+// Functions used by the templates of SdfFormulas.h, found by argument dependent lookup.
+
+inline Interval realValue(const Interval& a) { return a; }
+
+/// <summary>
+/// Both branches are possible if the mask is undecided, so the result covers both.
+/// </summary>
+inline Interval select(IntervalMask m, const Interval& a, const Interval& b) {
+	if (!m.canBeFalse)
+		return a;
+	if (!m.canBeTrue)
+		return b;
+	return Interval::Hull(a, b);
+}
+
+inline Interval dmin(const Interval& a, const Interval& b) { return Interval(std::min(a.lower, b.lower), std::min(a.upper, b.upper)); }
+inline Interval dmax(const Interval& a, const Interval& b) { return Interval(std::max(a.lower, b.lower), std::max(a.upper, b.upper)); }
+
+inline Interval dabs(const Interval& a) {
+	if (a.lower >= 0)
+		return a;
+	if (a.upper <= 0)
+		return -a;
+	return Interval(0.0f, std::max(-a.lower, a.upper));
+}
+
+inline Interval dsqrt(const Interval& a) { return Interval(std::sqrt(std::max(a.lower, 0.0f)), std::sqrt(std::max(a.upper, 0.0f))); }
+
+/// <summary>
+/// x * x, without the negative part a product of independent intervals would have.
+/// </summary>
+inline Interval square(const Interval& a) {
+	Interval abs = dabs(a);
+	return Interval(abs.lower * abs.lower, abs.upper * abs.upper);
+}
+
+// exact bounds of the lengths, preferred over the generic templates of SdfFormulas.h
+inline Interval dlength(const Interval& x, const Interval& y) { return dsqrt(square(x) + square(y)); }
+inline Interval dlength(const Interval& x, const Interval& y, const Interval& z) { return dsqrt(square(x) + square(y) + square(z)); }
@@ -0,0 +1,107 @@
+#include "IntervalOctree.h"
+#include "TapeEvaluator.h"
+#include "TapeSimplifier.h"
+
+#include <stdexcept>
+
+namespace {
+	BoundingBox ChildBox(const BoundingBox& box, int child) {
+		glm::vec3 center = box.Center();
+		glm::vec3 min(child & 1 ? center.x : box.min.x, child & 2 ? center.y : box.min.y, child & 4 ? center.z : box.min.z);
+		glm::vec3 max(child & 1 ? box.max.x : center.x, child & 2 ? box.max.y : center.y, child & 4 ? box.max.z : center.z);
+		return BoundingBox(min, max);
+	}
+}
+
+CellState IntervalOctree::Classify(const Interval& value)
+{
+	if (value.lower > 0)
+		return CellState::Outside;
+	if (value.upper < 0)
+		return CellState::Inside;
+	return CellState::Ambiguous;
+}
+
+void IntervalOctree::EvaluateCell(OctreeCell& cell, const std::shared_ptr<const Tape>& tape) const
+{
+	if (!simplifyTapes) {
+		cell.value = TapeEvaluator::EvaluateInterval(*tape, cell.box);
+		cell.state = Classify(cell.value);
+		cell.tape = tape;
+		return;
+	}
+
+	thread_local std::vector<TapeChoice> choices;
+	cell.value = TapeEvaluator::EvaluateInterval(*tape, cell.box, &choices);
+	cell.state = Classify(cell.value);
+	// the tapes of proven cells are never evaluated
+	if (cell.state == CellState::Ambiguous && TapeSimplifier::CanSimplify(choices))
+		cell.tape = std::make_shared<const Tape>(TapeSimplifier::Simplify(*tape, choices));
+	else
+		cell.tape = tape;
+}
+
+void IntervalOctree::Build(const Tape& tape, const BoundingBox& box, uint32_t maxDepth, ThreadPool& pool)
+{
+	if (box.IsInfinite())
+		throw std::runtime_error("The octree needs a finite box.");
+
+	this->maxDepth = maxDepth;
+	cells.clear();
+
+	OctreeCell root;
+	root.box = box;
+	root.depth = 0;
+	EvaluateCell(root, std::make_shared<const Tape>(tape));
+	cells.push_back(root);
+
+	// breadth first, one level at a time: the children of all ambiguous cells of a level are independent
+	std::vector<uint32_t> level{ 0 };
+	for (uint32_t depth = 1; depth <= maxDepth && !level.empty(); ++depth) {
+		std::vector<uint32_t> parents;
+		for (uint32_t i : level)
+			if (cells[i].state == CellState::Ambiguous)
+				parents.push_back(i);
+
+		size_t first = cells.size();
+		cells.resize(first + parents.size() * 8);
+		pool.ParallelFor(parents.size(), 16, [&](size_t begin, size_t end) {
+			for (size_t p = begin; p < end; ++p) {
+				size_t firstChild = first + p * 8;
+				cells[parents[p]].firstChild = (int32_t)firstChild;
+				for (int c = 0; c < 8; ++c) {
+					OctreeCell& child = cells[firstChild + c];
+					child.box = ChildBox(cells[parents[p]].box, c);
+					child.depth = depth;
+					EvaluateCell(child, cells[parents[p]].tape);
+				}
+			}
+		});
+
+		level.clear();
+		for (size_t i = first; i < cells.size(); ++i)
+			level.push_back((uint32_t)i);
+	}
+}
+
+std::vector<uint32_t> IntervalOctree::SurfaceCells() const
+{
+	std::vector<uint32_t> result;
+	for (uint32_t i = 0; i < cells.size(); ++i)
+		if (cells[i].state == CellState::Ambiguous && cells[i].depth == maxDepth)
+			result.push_back(i);
+	return result;
+}
+
+int32_t IntervalOctree::FindLeaf(glm::vec3 p) const
+{
+	if (cells.empty() || glm::any(glm::lessThan(p, Root().box.min)) || glm::any(glm::greaterThan(p, Root().box.max)))
+		return -1;
+
+	int32_t i = 0;
+	while (!cells[i].IsLeaf()) {
+		glm::vec3 center = cells[i].box.Center();
+		i = cells[i].firstChild + (p.x >= center.x ? 1 : 0) + (p.y >= center.y ? 2 : 0) + (p.z >= center.z ? 4 : 0);
+	}
+	return i;
+}
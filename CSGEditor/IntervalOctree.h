@@ -0,0 +1,69 @@
+#pragma once
+#include "Tape.h"
+#include "Interval.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// What the interval evaluation proved about a cell.
+/// </summary>
+enum class CellState : uint8_t {
+	Inside, // the distance is negative everywhere in the cell
+	Outside, // the distance is positive everywhere in the cell
+	Ambiguous // the surface may cross the cell
+};
+
+struct OctreeCell {
+	BoundingBox box;
+	Interval value;
+	CellState state;
+	uint32_t depth;
+	int32_t firstChild = -1; // the 8 children are stored consecutively, child c has the upper half along x if (c & 1), y if (c & 2), z if (c & 4)
+	std::shared_ptr<const Tape> tape; // gives the sdf inside the cell, shared with the parent unless the cell allowed further simplification
+
+	bool IsLeaf() const { return firstChild < 0; }
+};
+
+/// <summary>
+/// Octree over the sdf of a tape, built with interval arithmetic (TapeEvaluator::EvaluateInterval): cells proven to be fully inside
+/// or outside are not subdivided, so only the cells near the surface are refined down to the maximum depth.
+/// Meant as the first step of the CPU meshing, ray casting and region queries, which then only look at the ambiguous leaves.
+/// Each ambiguous cell also gets its tape simplified to the operands that can win inside it (see TapeSimplifier), its children start from that tape,
+/// so deep cells of large scenes only evaluate the few primitives near them.
+/// </summary>
+class IntervalOctree
+{
+public:
+	/// <summary>
+	/// Subdivides box (must be finite) until maxDepth. Cells of the same depth are evaluated in parallel.
+	/// </summary>
+	void Build(const Tape& tape, const BoundingBox& box, uint32_t maxDepth, ThreadPool& pool = ThreadPool::Global());
+
+	/// <summary>
+	/// If false, every cell uses the complete tape. Only useful to measure what the simplification gains.
+	/// </summary>
+	bool simplifyTapes = true;
+
+	const std::vector<OctreeCell>& Cells() const { return cells; }
+	const OctreeCell& Root() const { return cells.front(); }
+	uint32_t MaxDepth() const { return maxDepth; }
+
+	/// <summary>
+	/// Indices of the ambiguous cells of the maximum depth, the only ones that may contain the surface.
+	/// </summary>
+	std::vector<uint32_t> SurfaceCells() const;
+
+	/// <summary>
+	/// Index of the leaf containing p, or -1 if p is outside of the root box.
+	/// </summary>
+	int32_t FindLeaf(glm::vec3 p) const;
+
+private:
+	std::vector<OctreeCell> cells;
+	uint32_t maxDepth = 0;
+
+	static CellState Classify(const Interval& value);
+	void EvaluateCell(OctreeCell& cell, const std::shared_ptr<const Tape>& tape) const;
+};
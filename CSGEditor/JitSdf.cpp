@@ -0,0 +1,231 @@
+#include "JitSdf.h"
+#include "CppGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// FNV-1a
+	uint64_t Hash(const std::string& s) {
+		uint64_t h = 14695981039346656037ull;
+		for (unsigned char c : s) {
+			h ^= c;
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	std::string Environment(const char* name) {
+		const char* value = std::getenv(name);
+		return value ? value : "";
+	}
+
+	// for the shell
+	std::string Quoted(const std::string& s) {
+		std::string result = "'";
+		for (char c : s)
+			result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+		return result + "'";
+	}
+
+	std::string ReadFile(const std::string& fileName) {
+		std::ifstream f(fileName);
+		return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>{});
+	}
+
+	// the contents of the headers the code includes with quotes from directory, and of the ones they include, in the order of inclusion
+	std::string IncludedHeaders(const std::string& code, const std::string& directory, std::vector<std::string>& visited) {
+		std::string contents;
+		std::istringstream lines(code);
+		for (std::string line; std::getline(lines, line);) {
+			size_t directive = line.find("#include \"");
+			if (directive == std::string::npos)
+				continue;
+			size_t begin = directive + 10, end = line.find('"', begin);
+			std::string header = line.substr(begin, end - begin);
+			if (end == std::string::npos || std::find(visited.begin(), visited.end(), header) != visited.end())
+				continue;
+			visited.push_back(header);
+			std::string content = ReadFile((std::filesystem::path(directory) / header).string());
+			contents += header + '\n' + content + '\n' + IncludedHeaders(content, directory, visited);
+		}
+		return contents;
+	}
+}
+
+std::string JitSdf::DefaultCompiler()
+{
+	std::string compiler = Environment("CSG_JIT_CXX");
+	if (!compiler.empty())
+		return compiler;
+#ifdef CSG_JIT_COMPILER
+	return CSG_JIT_COMPILER;
+#else
+	return "c++";
+#endif
+}
+
+std::string JitSdf::DefaultCacheDirectory()
+{
+	std::string directory = Environment("CSG_JIT_CACHE");
+	if (!directory.empty())
+		return directory;
+	if (!Environment("XDG_CACHE_HOME").empty())
+		return Environment("XDG_CACHE_HOME") + "/csg_jit";
+	if (!Environment("HOME").empty())
+		return Environment("HOME") + "/.cache/csg_jit";
+	return (std::filesystem::temp_directory_path() / "csg_jit").string();
+}
+
+std::string JitSdf::DefaultIncludeDirectory()
+{
+	std::string directory = Environment("CSG_JIT_INCLUDE");
+	if (!directory.empty())
+		return directory;
+#ifdef CSG_JIT_INCLUDE_DIR
+	return CSG_JIT_INCLUDE_DIR;
+#else
+	return "."; // the editor runs from the CSGEditor directory
+#endif
+}
+
+JitSdf::~JitSdf()
+{
+	if (worker.joinable())
+		worker.join();
+	Unload();
+}
+
+void JitSdf::Compile(const Tape& tape)
+{
+	if (worker.joinable())
+		worker.join();
+	state.store(JitState::Idle, std::memory_order_release);
+	Unload();
+
+	this->tape = tape;
+	error.clear();
+	fromCache = false;
+
+	std::string source;
+	try {
+		source = CppGenerator::Generate(tape, maxOrder);
+	}
+	catch (std::invalid_argument& e) { // the tape is used
+		error = e.what();
+		state.store(JitState::Failed, std::memory_order_release);
+		return;
+	}
+	std::ostringstream name;
+	// the headers are part of the key, a library compiled against older versions of them is stale
+	std::vector<std::string> visited;
+	name << "csg_" << std::hex << Hash(source + '\n' + IncludedHeaders(source, includeDirectory, visited) + compiler + ' ' + flags);
+	libraryPath = (std::filesystem::path(cacheDirectory) / (name.str() + ".so")).string();
+
+	state.store(JitState::Compiling, std::memory_order_release);
+	worker = std::thread([this, source] {
+		try {
+			Load(source);
+			state.store(JitState::Ready, std::memory_order_release);
+		}
+		catch (std::exception& e) {
+			error = e.what();
+			Unload();
+			state.store(JitState::Failed, std::memory_order_release);
+		}
+	});
+}
+
+bool JitSdf::Wait()
+{
+	if (worker.joinable())
+		worker.join();
+	return IsNative();
+}
+
+void JitSdf::Load(const std::string& source)
+{
+#ifdef _WIN32
+	throw std::runtime_error("The native backend needs dlopen, it is not available on this platform.");
+#else
+	namespace fs = std::filesystem;
+	fromCache = fs::exists(libraryPath);
+	if (!fromCache) {
+		fs::create_directories(cacheDirectory);
+		std::string base = libraryPath.substr(0, libraryPath.size() - 3);
+		std::string sourcePath = base + ".cpp";
+		std::string logPath = base + ".log";
+		// written under a temporary name and renamed, so other processes never load a half written library
+		std::string temporaryPath = base + "." + std::to_string(getpid()) + ".tmp";
+		{
+			std::ofstream f(sourcePath);
+			f << source;
+			if (!f)
+				throw std::runtime_error("Can't write " + sourcePath);
+		}
+
+		std::string command = compiler + " " + flags + " -shared -fPIC -I" + Quoted(includeDirectory) + " " + Quoted(sourcePath)
+			+ " -o " + Quoted(temporaryPath) + " > " + Quoted(logPath) + " 2>&1";
+		if (std::system(command.c_str()) != 0) {
+			std::remove(temporaryPath.c_str());
+			throw std::runtime_error("Compiling " + sourcePath + " failed:\n" + ReadFile(logPath));
+		}
+		fs::rename(temporaryPath, libraryPath);
+	}
+
+	library = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (!library)
+		throw std::runtime_error(std::string("Can't load ") + libraryPath + ": " + dlerror());
+
+	auto version = reinterpret_cast<int (*)()>(dlsym(library, "csg_abi_version"));
+	if (!version || version() != CppGenerator::abiVersion)
+		throw std::runtime_error(libraryPath + " was generated for a different interface.");
+
+	sdf = reinterpret_cast<NativeFunction>(dlsym(library, "csg_sdf"));
+	if (!sdf)
+		throw std::runtime_error(libraryPath + " has no csg_sdf.");
+	for (int order = 1; order <= maxOrder; ++order) {
+		auto f = reinterpret_cast<NativeFunction>(dlsym(library, ("csg_sdf_d" + std::to_string(order)).c_str()));
+		if (!f)
+			throw std::runtime_error(libraryPath + " has no derivatives of order " + std::to_string(order) + ".");
+		dualSdf.push_back(f);
+	}
+#endif
+}
+
+void JitSdf::Unload()
+{
+	sdf = nullptr;
+	dualSdf.clear();
+#ifndef _WIN32
+	if (library)
+		dlclose(library);
+#endif
+	library = nullptr;
+}
+
+void JitSdf::Evaluate(const float* x, const float* y, const float* z, float* distances, size_t count) const
+{
+	if (IsNative())
+		sdf(x, y, z, distances, count);
+	else
+		TapeEvaluator::Evaluate(tape, x, y, z, distances, count);
+}
+
+void JitSdf::EvaluateParallel(const float* x, const float* y, const float* z, float* distances, size_t count, ThreadPool& pool) const
+{
+	const size_t grain = TapeEvaluator::blockSize * 64;
+	pool.ParallelFor(count, grain, [&](size_t begin, size_t end) {
+		Evaluate(x + begin, y + begin, z + begin, distances + begin, end - begin);
+	});
+}
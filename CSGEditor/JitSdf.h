@@ -0,0 +1,107 @@
+#pragma once
+#include "TapeEvaluator.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class JitState { Idle, Compiling, Ready, Failed };
+
+/// <summary>
+/// Native code for a tape: the C++ of CppGenerator is compiled with the system compiler into a shared library in the background
+/// and loaded with dlopen. Until it is loaded (or if compiling fails) the evaluation functions fall back to TapeEvaluator,
+/// so they can be used right after Compile.
+/// The libraries are cached under cacheDirectory by the hash of the generated code, the headers it includes from includeDirectory and the
+/// compiler command. The code contains every constant of the graph, so equal graphs reuse the library, even across runs, until the headers
+/// change.
+/// Only supported where dlopen is available, elsewhere the state becomes Failed and the tape is always used.
+/// </summary>
+class JitSdf
+{
+public:
+	std::string compiler = DefaultCompiler(); // $CSG_JIT_CXX, the compiler of the build, or c++
+	std::string flags = "-O3 -march=native -std=c++17";
+	std::string cacheDirectory = DefaultCacheDirectory(); // $CSG_JIT_CACHE, or csg_jit in the user's cache directory
+	std::string includeDirectory = DefaultIncludeDirectory(); // $CSG_JIT_INCLUDE or the CSGEditor directory of the build, see CppGenerator
+	int maxOrder = 1; // highest derivative order compiled, higher orders use the tape (each order adds about as much compile time as the values)
+
+	JitSdf() = default;
+	JitSdf(const JitSdf&) = delete;
+	JitSdf& operator=(const JitSdf&) = delete;
+	~JitSdf();
+
+	/// <summary>
+	/// Copies the tape as fallback and starts loading its library (from the cache or by compiling it) on a background thread.
+	/// Waits for the previous compilation first, must not be called while other threads evaluate.
+	/// </summary>
+	void Compile(const Tape& tape);
+
+	/// <summary>
+	/// Blocks until the background work is done, returns true if the native code is used.
+	/// </summary>
+	bool Wait();
+
+	JitState State() const { return state.load(std::memory_order_acquire); }
+	bool IsNative() const { return State() == JitState::Ready; }
+
+	/// <summary>
+	/// Compiler output or loader error after a failure.
+	/// </summary>
+	const std::string& Error() const { return error; }
+
+	/// <summary>
+	/// True if the library was found in the cache instead of being compiled.
+	/// </summary>
+	bool FromCache() const { return fromCache; }
+
+	/// <summary>
+	/// Path of the shared library, known after Compile.
+	/// </summary>
+	const std::string& LibraryPath() const { return libraryPath; }
+
+	/// <summary>
+	/// Same contract as TapeEvaluator::Evaluate.
+	/// </summary>
+	void Evaluate(const float* x, const float* y, const float* z, float* distances, size_t count) const;
+
+	void EvaluateParallel(const float* x, const float* y, const float* z, float* distances, size_t count, ThreadPool& pool = ThreadPool::Global()) const;
+
+	/// <summary>
+	/// Same contract as TapeEvaluator::EvaluateDerivatives.
+	/// </summary>
+	template<int Order>
+	void EvaluateDerivatives(const float* x, const float* y, const float* z, Dual<Order>* results, size_t count) const;
+
+	static std::string DefaultCompiler();
+	static std::string DefaultCacheDirectory();
+	static std::string DefaultIncludeDirectory();
+
+private:
+	using NativeFunction = void (*)(const float* x, const float* y, const float* z, float* out, size_t count);
+
+	Tape tape;
+	std::thread worker;
+	std::atomic<JitState> state{ JitState::Idle };
+	std::string error;
+	std::string libraryPath;
+	bool fromCache = false;
+
+	// written by the worker before the state becomes Ready
+	void* library = nullptr;
+	NativeFunction sdf = nullptr;
+	std::vector<NativeFunction> dualSdf; // index Order - 1
+
+	void Load(const std::string& source);
+	void Unload();
+};
+
+template<int Order>
+inline void JitSdf::EvaluateDerivatives(const float* x, const float* y, const float* z, Dual<Order>* results, size_t count) const
+{
+	static_assert(sizeof(Dual<Order>) == Dual<Order>::size * sizeof(float), "the native code writes the parts of a point contiguously");
+	if (IsNative() && Order <= (int)dualSdf.size())
+		dualSdf[Order - 1](x, y, z, reinterpret_cast<float*>(results), count);
+	else
+		TapeEvaluator::EvaluateDerivatives<Order>(tape, x, y, z, results, count);
+}
@@ -0,0 +1,66 @@
+#include "LipschitzCalculatorVisitor.h"
+#include "TapeEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+void LipschitzCalculatorVisitor::operator()(std::shared_ptr<PrimitiveNode> primNode)
+{
+	Set(primNode.get(), primNode->primitive->GetLipschitzBound(), primNode->primitive->GetInteriorLipschitzBound());
+}
+
+void LipschitzCalculatorVisitor::operator()(std::shared_ptr<OperatorNode> opNode)
+{
+	if (opNode->InputCount() < 1) { // invalid graph, the generator will report it
+		Set(opNode.get(), 1.0f, 1.0f);
+		return;
+	}
+
+	std::vector<float> exterior, interior;
+	for (auto input : *opNode) {
+		input->visit(this);
+		exterior.push_back(lipschitz[input.get()]);
+		interior.push_back(interiorLipschitz[input.get()]);
+	}
+	Operator& op = *opNode->operatorDescription;
+	Set(opNode.get(), op.CombineLipschitz(exterior, interior), op.CombineInteriorLipschitz(exterior, interior));
+}
+
+// the offset moves the surface: growing it puts outer points of the formula inside, shrinking it puts inner points outside
+void LipschitzCalculatorVisitor::Set(const Node* node, float exterior, float interior)
+{
+	lipschitz[node] = node->radius < 0 ? std::max(exterior, interior) : exterior;
+	interiorLipschitz[node] = node->radius > 0 ? std::max(exterior, interior) : interior;
+}
+
+std::unordered_map<const Node*, float> LipschitzCalculatorVisitor::CalculateLipschitz(std::shared_ptr<Node> root)
+{
+	lipschitz.clear();
+	interiorLipschitz.clear();
+	root->visit(this);
+	return std::move(lipschitz);
+}
+
+float LipschitzCalculatorVisitor::SampleLipschitz(const Tape& tape, const BoundingBox& box, size_t count, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<float> x(count), y(count), z(count);
+	for (size_t i = 0; i < count; ++i) {
+		x[i] = box.min.x + (box.max.x - box.min.x) * unit(rng);
+		y[i] = box.min.y + (box.max.y - box.min.y) * unit(rng);
+		z[i] = box.min.z + (box.max.z - box.min.z) * unit(rng);
+	}
+	std::vector<Dual<1>> results(count);
+	TapeEvaluator::EvaluateDerivatives<1>(tape, x.data(), y.data(), z.data(), results.data(), count);
+
+	float result = 0;
+	for (const Dual<1>& r : results) {
+		float length = std::sqrt(r.d[1] * r.d[1] + r.d[2] * r.d[2] + r.d[3] * r.d[3]);
+		if (r.d[0] > 0 && std::isfinite(length)) // singular formulas are NaN exactly on some surfaces
+			result = std::max(result, length);
+	}
+	return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "NodeVisitor.h"
+#include "Tape.h"
+#include "BoundingBox.h"
+#include <unordered_map>
+
+/// <summary>
+/// Calculates a conservative Lipschitz constant for every node of a graph: an upper bound of the length of the subtree's gradient outside
+/// of its surface, ie.: how many times its value may overestimate the distance to the surface. Sphere tracing is safe with steps of
+/// value / L, and may take longer steps than the value where L < 1 is proven. The bound is infinite where the gradient is unbounded.
+/// Node transforms don't change the bound (the scale is uniform and the generated code corrects it). The bounds inside of the subtrees
+/// are tracked too, because substractions turn the inside of their inputs into the outside of the result, and offsets move points
+/// across the surface. Primitives and operators give their own bounds (Primitive::GetLipschitzBound, Operator::CombineLipschitz).
+/// </summary>
+class LipschitzCalculatorVisitor : public NodeVisitor
+{
+public:
+	virtual void operator()(std::shared_ptr<PrimitiveNode> primNode) override;
+	virtual void operator()(std::shared_ptr<OperatorNode> opNode) override;
+
+	/// <summary>
+	/// Calculates the bound of every node reachable from root.
+	/// </summary>
+	/// <returns>A map containing each node's Lipschitz bound</returns>
+	std::unordered_map<const Node*, float> CalculateLipschitz(std::shared_ptr<Node> root);
+
+	/// <summary>
+	/// Sampled check of a bound: the largest gradient length (dual numbers) at count random points of box where the tape is positive.
+	/// Stays below Tape::lipschitz if the analytic bound holds, and shows how much tighter it could be.
+	/// </summary>
+	static float SampleLipschitz(const Tape& tape, const BoundingBox& box, size_t count, unsigned int seed = 1);
+
+private:
+	std::unordered_map<const Node*, float> lipschitz;
+	std::unordered_map<const Node*, float> interiorLipschitz;
+
+	void Set(const Node* node, float exterior, float interior);
+};
@@ -0,0 +1,288 @@
+#include "MarchingCubes.h"
+#include "IntervalOctree.h"
+#include "TapeEvaluator.h"
+#include "MeshAttributes.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	// corner c of a cell is at (c & 1, (c >> 1) & 1, (c >> 2) & 1), the first corner of every edge is its lower end
+	constexpr int edgeCorners[12][2] = {
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, // along x
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, // along y
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } // along z
+	};
+	constexpr int faceCorners[6][4] = { { 0, 2, 6, 4 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 5, 7, 6 } };
+
+	int EdgeAxis(int edge) { return edge / 4; }
+
+	glm::vec3 CornerOffset(int corner) { return glm::vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1); }
+
+	int EdgeOf(int a, int b) {
+		for (int e = 0; e < 12; ++e)
+			if ((edgeCorners[e][0] == a && edgeCorners[e][1] == b) || (edgeCorners[e][0] == b && edgeCorners[e][1] == a))
+				return e;
+		return -1;
+	}
+
+	// Triangles of each case (bit c set if corner c is inside), as edge indices. Instead of the classic hand written table they are derived
+	// from the faces: every face of the cell contributes the segments between its crossed edges, an ambiguous face cuts off its two inside corners.
+	// The segments form closed loops, which are oriented to face the outside corners and split into fans.
+	using CaseTable = std::array<std::vector<uint8_t>, 256>;
+
+	CaseTable BuildCaseTable() {
+		CaseTable table;
+		for (int mask = 1; mask < 255; ++mask) {
+			auto inside = [mask](int corner) { return ((mask >> corner) & 1) != 0; };
+
+			int neighbours[12][2];
+			int neighbourCount[12] = {};
+			auto connect = [&](int a, int b) {
+				neighbours[a][neighbourCount[a]++] = b;
+				neighbours[b][neighbourCount[b]++] = a;
+			};
+			for (auto& q : faceCorners) {
+				int crossed[4], count = 0;
+				for (int i = 0; i < 4; ++i)
+					if (inside(q[i]) != inside(q[(i + 1) % 4]))
+						crossed[count++] = EdgeOf(q[i], q[(i + 1) % 4]);
+				if (count == 2) {
+					connect(crossed[0], crossed[1]);
+				}
+				else if (count == 4) {
+					for (int k = 0; k < 4; ++k)
+						if (inside(q[k]))
+							connect(EdgeOf(q[(k + 3) % 4], q[k]), EdgeOf(q[k], q[(k + 1) % 4]));
+				}
+			}
+
+			bool visited[12] = {};
+			for (int start = 0; start < 12; ++start) {
+				if (neighbourCount[start] == 0 || visited[start])
+					continue;
+				std::vector<int> loop;
+				for (int previous = -1, current = start; !visited[current];) {
+					visited[current] = true;
+					loop.push_back(current);
+					int next = neighbours[current][0] != previous ? neighbours[current][0] : neighbours[current][1];
+					previous = current;
+					current = next;
+				}
+
+				// Newell normal of the loop through the edge midpoints, it has to point from the inside corners to the outside ones
+				glm::vec3 normal(0), outward(0);
+				for (size_t i = 0; i < loop.size(); ++i) {
+					const int* e = edgeCorners[loop[i]];
+					const int* f = edgeCorners[loop[(i + 1) % loop.size()]];
+					glm::vec3 a = (CornerOffset(e[0]) + CornerOffset(e[1])) * 0.5f, b = (CornerOffset(f[0]) + CornerOffset(f[1])) * 0.5f;
+					normal += glm::vec3((a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y));
+					outward += inside(e[0]) ? CornerOffset(e[1]) - CornerOffset(e[0]) : CornerOffset(e[0]) - CornerOffset(e[1]);
+				}
+				if (glm::dot(normal, outward) < 0)
+					std::reverse(loop.begin(), loop.end());
+
+				for (size_t i = 1; i + 1 < loop.size(); ++i)
+					table[mask].insert(table[mask].end(), { (uint8_t)loop[0], (uint8_t)loop[i], (uint8_t)loop[i + 1] });
+			}
+		}
+		return table;
+	}
+
+	const CaseTable& Cases() {
+		static const CaseTable table = BuildCaseTable();
+		return table;
+	}
+
+	uint64_t EdgeKey(glm::uvec3 lowerEnd, int axis) {
+		// the lower end of an edge on the far faces of the grid is at 2^depth, so the fields can't be packed into 21 bits each
+		return uint64_t(axis) + 3 * (lowerEnd.x + MarchingCubes::keySpan * (lowerEnd.y + MarchingCubes::keySpan * lowerEnd.z));
+	}
+
+	// per thread memory of the block being extracted, only grows
+	struct BlockWork {
+		MeshChunk chunk;
+		std::unordered_map<uint64_t, uint32_t> vertexOfKey;
+		std::vector<float> x, y, z, values;
+		glm::uvec3 blockMin;
+		uint32_t blockCells;
+		size_t bricks = 0, samples = 0;
+
+		size_t Bytes() const {
+			return chunk.Bytes() + vertexOfKey.size() * (sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(void*))
+				+ (x.capacity() + y.capacity() + z.capacity() + values.capacity()) * sizeof(float);
+		}
+	};
+
+	class BlockExtractor {
+	public:
+		BlockExtractor(const MeshGrid& grid, uint32_t brickSize, BlockWork& work) : grid(grid), brickSize(brickSize), work(work) {}
+
+		// samples the (brickSize + 1)^3 lattice points of the brick at once and polygonizes its cells
+		void Brick(const Tape& tape, glm::uvec3 min) {
+			const uint32_t n = brickSize + 1;
+			size_t i = 0;
+			for (uint32_t z = 0; z < n; ++z)
+				for (uint32_t y = 0; y < n; ++y)
+					for (uint32_t x = 0; x < n; ++x, ++i) {
+						glm::vec3 p = grid.Point(min + glm::uvec3(x, y, z));
+						work.x[i] = p.x;
+						work.y[i] = p.y;
+						work.z[i] = p.z;
+					}
+			TapeEvaluator::Evaluate(tape, work.x.data(), work.y.data(), work.z.data(), work.values.data(), i);
+			++work.bricks;
+			work.samples += i;
+
+			const CaseTable& cases = Cases();
+			auto index = [n](uint32_t x, uint32_t y, uint32_t z) { return size_t(z) * n * n + size_t(y) * n + x; };
+			for (uint32_t z = 0; z < brickSize; ++z)
+				for (uint32_t y = 0; y < brickSize; ++y)
+					for (uint32_t x = 0; x < brickSize; ++x) {
+						size_t corners[8];
+						int mask = 0;
+						for (int c = 0; c < 8; ++c) {
+							corners[c] = index(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1));
+							mask |= work.values[corners[c]] < 0 ? 1 << c : 0;
+						}
+						for (uint8_t edge : cases[mask])
+							work.chunk.indices.push_back(Vertex(min + glm::uvec3(x, y, z), edge, corners));
+					}
+		}
+
+		uint32_t Vertex(glm::uvec3 cell, int edge, const size_t corners[8]) {
+			int a = edgeCorners[edge][0], b = edgeCorners[edge][1];
+			glm::uvec3 lowerEnd = cell + glm::uvec3(CornerOffset(a));
+			uint64_t key = EdgeKey(lowerEnd, EdgeAxis(edge));
+			auto [it, inserted] = work.vertexOfKey.try_emplace(key, (uint32_t)work.chunk.positions.size());
+			if (!inserted)
+				return it->second;
+
+			// one end is negative, the other one isn't: t is in (0, 1]
+			float va = work.values[corners[a]], vb = work.values[corners[b]];
+			float t = va / (va - vb);
+			glm::vec3 pa = grid.Point(lowerEnd), pb = grid.Point(cell + glm::uvec3(CornerOffset(b)));
+			work.chunk.positions.push_back(pa + (pb - pa) * t);
+			work.chunk.keys.push_back(key);
+			// the edges in the faces of the block are shared with its neighbours
+			bool shared = false;
+			for (int axis = 0; axis < 3; ++axis)
+				shared |= axis != EdgeAxis(edge) && (lowerEnd[axis] == work.blockMin[axis] || lowerEnd[axis] == work.blockMin[axis] + work.blockCells);
+			work.chunk.shared.push_back(shared);
+			return it->second;
+		}
+
+	private:
+		const MeshGrid& grid;
+		uint32_t brickSize;
+		BlockWork& work;
+	};
+}
+
+BoundingBox MarchingCubes::GridCube(const BoundingBox& box)
+{
+	glm::vec3 half = box.HalfSize();
+	float side = std::max(half.x, std::max(half.y, half.z));
+	return BoundingBox(box.Center() - glm::vec3(side), box.Center() + glm::vec3(side));
+}
+
+size_t MarchingCubes::Extract(const Tape& tape, const BoundingBox& box, uint32_t depth, const Sink& sink, ThreadPool& pool)
+{
+	if (depth > maxDepth)
+		throw std::invalid_argument("MarchingCubes: the depth is limited to " + std::to_string(maxDepth) + ".");
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = MesherStats();
+
+	// the bricks have to fit into the blocks, which have to fit into the grid
+	uint32_t brickDepth = 0;
+	while ((2u << brickDepth) <= brickSize && brickDepth < depth)
+		++brickDepth;
+	const uint32_t brick = 1u << brickDepth;
+	const uint32_t octreeDepth = std::min(blockDepth, depth - brickDepth);
+	const uint32_t blockCells = 1u << (depth - octreeDepth);
+
+	BoundingBox cube = GridCube(box);
+	MeshGrid grid{ cube.min, (cube.max.x - cube.min.x) / float(1u << depth) };
+
+	IntervalOctree octree;
+	octree.Build(tape, cube, octreeDepth, pool);
+	std::vector<uint32_t> blocks = octree.SurfaceCells();
+	stats.blocks = blocks.size();
+	const size_t octreeBytes = octree.Cells().capacity() * sizeof(OctreeCell);
+
+	// finished chunks wait here until the ones before them are delivered
+	std::mutex sinkMutex;
+	std::vector<MeshChunk> waiting(blocks.size());
+	std::vector<bool> ready(blocks.size(), false);
+	size_t nextBlock = 0, waitingBytes = 0, peakWaitingBytes = 0;
+	std::atomic<size_t> bricks{ 0 }, pruningTests{ 0 }, samples{ 0 }, vertices{ 0 }, triangles{ 0 };
+	std::vector<size_t> scratchBytes(pool.ThreadCount(), 0);
+
+	pool.ParallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+		thread_local BlockWork work;
+		size_t latticeSize = size_t(brick + 1) * (brick + 1) * (brick + 1);
+		for (auto* v : { &work.x, &work.y, &work.z, &work.values })
+			v->resize(latticeSize);
+		BrickOctree bricksOfBlock(grid, brick, pruning);
+		BlockExtractor extractor(grid, brick, work);
+		auto onBrick = [&](const Tape& brickTape, glm::uvec3 brickMin) { extractor.Brick(brickTape, brickMin); };
+
+		for (size_t b = begin; b < end; ++b) {
+			const OctreeCell& cell = octree.Cells()[blocks[b]];
+			glm::uvec3 min = glm::uvec3(glm::round((cell.box.min - grid.origin) / grid.cellSize));
+			work.chunk.Clear();
+			work.vertexOfKey.clear();
+			work.blockMin = min;
+			work.blockCells = blockCells;
+			work.bricks = work.samples = 0;
+			bricksOfBlock.pruningTests = 0;
+			bricksOfBlock.Visit(*cell.tape, min, blockCells, onBrick, nullptr);
+			if (curvatures)
+				MeshAttributes::Curvatures(*cell.tape, work.chunk, grid.cellSize * 1e-2f);
+			else if (normals)
+				MeshAttributes::Normals(*cell.tape, work.chunk, grid.cellSize * 1e-2f);
+			if (normals || curvatures)
+				work.samples += work.chunk.VertexCount();
+
+			bricks += work.bricks;
+			pruningTests += bricksOfBlock.pruningTests;
+			samples += work.samples;
+			vertices += work.chunk.VertexCount();
+			triangles += work.chunk.TriangleCount();
+
+			std::lock_guard<std::mutex> lock(sinkMutex);
+			scratchBytes[ThreadPool::ThreadIndex()] = std::max(scratchBytes[ThreadPool::ThreadIndex()], work.Bytes());
+			if (b != nextBlock) {
+				waitingBytes += work.chunk.Bytes();
+				peakWaitingBytes = std::max(peakWaitingBytes, waitingBytes);
+				waiting[b] = std::move(work.chunk);
+				ready[b] = true;
+				continue;
+			}
+			sink(work.chunk);
+			for (++nextBlock; nextBlock < blocks.size() && ready[nextBlock]; ++nextBlock) {
+				sink(waiting[nextBlock]);
+				waitingBytes -= waiting[nextBlock].Bytes();
+				waiting[nextBlock] = MeshChunk();
+			}
+		}
+	});
+
+	stats.bricks = bricks;
+	stats.pruningTests = pruningTests;
+	stats.samples = samples;
+	stats.vertices = vertices;
+	stats.triangles = triangles;
+	stats.peakBytes = octreeBytes + peakWaitingBytes;
+	for (size_t bytes : scratchBytes)
+		stats.peakBytes += bytes;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return stats.triangles;
+}
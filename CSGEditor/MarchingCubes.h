@@ -0,0 +1,67 @@
+#pragma once
+#include "Tape.h"
+#include "MeshChunk.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include "BrickOctree.h"
+#include <cstdint>
+#include <functional>
+
+struct MesherStats {
+	size_t blocks = 0; // surface cells of the coarse interval octree, extracted in parallel
+	size_t bricks = 0; // nodes of brickSize cells that were sampled densely
+	size_t pruningTests = 0;
+	size_t samples = 0; // lattice points evaluated
+	size_t vertices = 0; // summed over the chunks, the vertices on chunk borders are counted once per chunk
+	size_t triangles = 0;
+	size_t peakBytes = 0; // largest memory held by the octree, the chunks waiting for their turn and the per thread scratch memory
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Marching cubes on a virtual grid of 2^depth cells per axis over a cube, for meshes at resolutions that can't be sampled densely.
+///
+/// An IntervalOctree finds the cells of a coarse level that may contain the surface (blocks). The blocks are independent:
+/// each is subdivided further with its own simplified tape, pruning the nodes that can't contain the surface (see BrickOctree),
+/// down to bricks of brickSize^3 cells, whose lattice is evaluated in one batch and polygonized with marching cubes.
+/// Every grid cell that is left has its full neighbourhood sampled at the same resolution, so the mesh has no cracks, and the ambiguous
+/// faces of marching cubes are resolved by their corner signs alone (the negative corners are separated), identically from both sides.
+///
+/// The blocks are extracted in parallel and handed to the sink in a fixed order as one chunk each, so the output doesn't depend on the
+/// thread count. A vertex is keyed by the grid edge it lies on: key = axis + 3 * (x + keySpan * (y + keySpan * z)) with the grid
+/// coordinates of the edge's lower end, equal in every chunk that shares it. The vertices on the faces of a block are marked as shared.
+/// </summary>
+class MarchingCubes
+{
+public:
+	/// <summary>
+	/// Receives the chunk of one block, called by one thread at a time in block order. The chunk is reused after the call.
+	/// </summary>
+	using Sink = std::function<void(const MeshChunk& chunk)>;
+
+	static constexpr uint32_t maxDepth = 20;
+	static constexpr uint64_t keySpan = (1ull << maxDepth) + 1; // values of a grid coordinate in the vertex keys: 0..2^depth
+	static_assert(keySpan * keySpan * keySpan <= UINT64_MAX / 3, "the edge keys don't fit 64 bits at maxDepth");
+
+	MeshPruning pruning = MeshPruning::Interval;
+	uint32_t blockDepth = 6; // octree depth of the blocks, lowered if needed to keep a brick per block
+	uint32_t brickSize = 8; // cells per axis sampled at once, power of 2
+	bool normals = false; // fill MeshChunk::normals, see MeshAttributes::Normals
+	bool curvatures = false; // fill the normals, curvatures and principal directions of MeshChunk, see MeshAttributes::Curvatures
+
+	/// <summary>
+	/// Meshes the zero set inside the cube around box (box must be finite, its longest side is used for all axes) with 2^depth cells per axis.
+	/// Returns the number of triangles. Throws std::invalid_argument for depths above maxDepth.
+	/// </summary>
+	size_t Extract(const Tape& tape, const BoundingBox& box, uint32_t depth, const Sink& sink, ThreadPool& pool = ThreadPool::Global());
+
+	const MesherStats& Stats() const { return stats; }
+
+	/// <summary>
+	/// The cube that Extract meshes for box.
+	/// </summary>
+	static BoundingBox GridCube(const BoundingBox& box);
+
+private:
+	MesherStats stats;
+};
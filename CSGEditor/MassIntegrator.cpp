@@ -0,0 +1,284 @@
+#include "MassIntegrator.h"
+#include "IntervalOctree.h"
+#include "TapeEvaluator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace {
+	// integrals over the solid part of a region: of 1, x and x x^T, and the area of the surface in it
+	// children whose value is farther from the linearization of their parent than this times their half diagonal mark an edge or a corner
+	constexpr double featureDeviation = 0.02;
+
+	struct Moments {
+		double volume = 0;
+		glm::dvec3 first = glm::dvec3(0);
+		glm::dmat3 second = glm::dmat3(0);
+		double area = 0;
+
+		// fraction of a box of size 2 * half, its volume placed at c with the spread of the box: exact for a full box centered at c
+		void AddBox(glm::dvec3 half, double fraction, glm::dvec3 c) {
+			double v = fraction * 8 * half.x * half.y * half.z;
+			volume += v;
+			first += v * c;
+			second += v * (glm::outerProduct(c, c) + glm::dmat3(half.x * half.x / 3, 0, 0, 0, half.y * half.y / 3, 0, 0, 0, half.z * half.z / 3));
+		}
+
+		Moments& operator+=(const Moments& m) {
+			volume += m.volume;
+			first += m.first;
+			second += m.second;
+			area += m.area;
+			return *this;
+		}
+	};
+
+	// a subcell of a surface cell with the estimate from its center
+	struct Subcell {
+		glm::dvec3 center, half;
+		Moments estimate;
+		bool exact;
+		double value;
+		glm::dvec3 gradient;
+	};
+
+	// volume fraction of the unit cube where m . u < t (m >= 0), and its derivative by t: a sum over the corners of the cube of the
+	// truncated powers (t - m . corner)^k / (k! * product of m). Components much smaller than the largest one are moved into t, which
+	// keeps the sum from cancelling
+	void PlaneCut(glm::dvec3 m, double t, double& fraction, double& slope) {
+		fraction = 0;
+		slope = 0;
+		if (t < 0)
+			return;
+		if (t > m.x + m.y + m.z) {
+			fraction = 1;
+			return;
+		}
+
+		double scale = std::max(m.x, std::max(m.y, m.z));
+		m /= scale;
+		t /= scale;
+		double large[3], product = 1;
+		int k = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (m[i] > 1e-3) {
+				large[k++] = m[i];
+				product *= m[i];
+			}
+			else {
+				t -= 0.5 * m[i];
+			}
+		}
+
+		double power = 0, derivative = 0;
+		for (int corner = 0; corner < (1 << k); ++corner) {
+			double s = t, sign = 1;
+			for (int i = 0; i < k; ++i) {
+				if (corner & (1 << i)) {
+					s -= large[i];
+					sign = -sign;
+				}
+			}
+			if (s > 0) {
+				power += sign * std::pow(s, k);
+				derivative += sign * std::pow(s, k - 1);
+			}
+			else if (s == 0 && k == 1) {
+				derivative += 0.5 * sign; // a plane on the face of the cube, the other half of its area is in the neighbour
+			}
+		}
+		double factorial = k == 3 ? 6 : k == 2 ? 2 : 1;
+		fraction = glm::clamp(power / (factorial * product), 0.0, 1.0);
+		slope = std::max(derivative * k / (factorial * product), 0.0) / scale;
+	}
+
+	Subcell Estimate(glm::dvec3 center, glm::dvec3 half, const Dual<1>& v, float lipschitz) {
+		Subcell s{ center, half, Moments(), true, v.d[0], glm::dvec3(v.d[1], v.d[2], v.d[3]) };
+		double value = s.value;
+		double reach = lipschitz * glm::length(half);
+		if (value >= reach)
+			return s;
+		if (value <= -reach) {
+			s.estimate.AddBox(half, 1, center);
+			return s;
+		}
+
+		s.exact = false;
+		glm::dvec3 gradient = s.gradient;
+		double length = glm::length(gradient);
+		if (!(length > 1e-12) || !std::isfinite(length) || !std::isfinite(value)) {
+			s.estimate.AddBox(half, value < 0 ? 1 : value > 0 ? 0 : 0.5, center);
+			return s;
+		}
+
+		// the plane through the zero of the linearization, the solid is on the side of -normal. In the coordinates u of the subcell
+		// scaled to [0, 1] and mirrored to a normal >= 0, it is the part with 2 * half * |normal| . u < width - distance
+		glm::dvec3 normal = gradient / length;
+		double distance = value / length;
+		double width = glm::dot(half, glm::abs(normal)); // half the extent of the subcell along the normal
+		double fraction, slope;
+		PlaneCut(2.0 * half * glm::abs(normal), width - distance, fraction, slope);
+		double volume = 8 * half.x * half.y * half.z;
+		// the centroid of the solid part is taken to move along the normal like that of a slab
+		s.estimate.AddBox(half, fraction, center - normal * (width * (1 - fraction)));
+		s.estimate.area = volume * slope;
+		return s;
+	}
+}
+
+MassProperties MassIntegrator::Integrate(const Tape& tape, const BoundingBox& box, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = MassStats();
+
+	IntervalOctree octree;
+	octree.Build(tape, box, octreeDepth, pool);
+
+	Moments inside;
+	std::vector<uint32_t> surfaceCells = octree.SurfaceCells();
+	for (const OctreeCell& cell : octree.Cells()) {
+		if (cell.IsLeaf() && cell.state == CellState::Inside) {
+			inside.AddBox(glm::dvec3(cell.box.HalfSize()), 1, glm::dvec3(cell.box.Center()));
+			++stats.insideCells;
+		}
+	}
+	stats.boundaryCells = surfaceCells.size();
+
+	// first estimates of the surface cells from their centers, they give the totals the tolerance is relative to
+	std::vector<Subcell> roots(surfaceCells.size());
+	pool.ParallelFor(surfaceCells.size(), 64, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			const OctreeCell& cell = octree.Cells()[surfaceCells[c]];
+			glm::vec3 p = cell.box.Center();
+			Dual<1> v;
+			TapeEvaluator::EvaluateDerivatives<1>(*cell.tape, &p.x, &p.y, &p.z, &v, 1);
+			roots[c] = Estimate(glm::dvec3(p), glm::dvec3(cell.box.HalfSize()), v, cell.tape->lipschitz);
+		}
+	});
+	double volume = inside.volume, area = 0, cellVolume = 0;
+	for (const Subcell& s : roots) {
+		volume += s.estimate.volume;
+		area += s.estimate.area;
+		cellVolume += 8 * s.half.x * s.half.y * s.half.z;
+	}
+	if (area == 0 && !roots.empty()) // no surface seen at the centers, take the faces of the cells
+		area = roots.size() * std::pow(cellVolume / roots.size(), 2.0 / 3);
+	// tolerance per unit of volume of the surface cells
+	double volumeTolerance = cellVolume > 0 ? tolerance * volume / cellVolume : 0;
+	double areaTolerance = cellVolume > 0 ? tolerance * area / cellVolume : 0;
+
+	std::vector<Moments> results(surfaceCells.size());
+	std::vector<glm::dvec2> errors(surfaceCells.size()), featureErrors(surfaceCells.size());
+	std::atomic<size_t> evaluations{ 0 }, unconverged{ 0 };
+	pool.ParallelFor(surfaceCells.size(), 1, [&](size_t begin, size_t end) {
+		thread_local std::vector<Subcell> active, next;
+		thread_local std::vector<float> x, y, z;
+		thread_local std::vector<Dual<1>> values;
+		size_t localEvaluations = 0, localUnconverged = 0;
+
+		for (size_t c = begin; c < end; ++c) {
+			const OctreeCell& cell = octree.Cells()[surfaceCells[c]];
+			const Tape& cellTape = *cell.tape;
+			Moments& result = results[c];
+			if (roots[c].exact) { // the intervals of the octree were not tight enough to prove it
+				result = roots[c].estimate;
+				continue;
+			}
+			active.assign(1, roots[c]);
+
+			// one level of subcells at a time, their children are evaluated in one batch
+			for (int level = 0; level < maxLevels && !active.empty(); ++level) {
+				size_t n = active.size() * 8;
+				x.resize(n);
+				y.resize(n);
+				z.resize(n);
+				values.resize(n);
+				for (size_t i = 0; i < active.size(); ++i) {
+					for (int k = 0; k < 8; ++k) {
+						glm::dvec3 offset(k & 1 ? 0.5 : -0.5, k & 2 ? 0.5 : -0.5, k & 4 ? 0.5 : -0.5);
+						glm::dvec3 p = active[i].center + offset * active[i].half;
+						x[i * 8 + k] = (float)p.x;
+						y[i * 8 + k] = (float)p.y;
+						z[i * 8 + k] = (float)p.z;
+					}
+				}
+				TapeEvaluator::EvaluateDerivatives<1>(cellTape, x.data(), y.data(), z.data(), values.data(), n);
+				localEvaluations += n;
+
+				next.clear();
+				for (size_t i = 0; i < active.size(); ++i) {
+					const Subcell& parent = active[i];
+					Subcell children[8];
+					Moments sum;
+					bool feature = false;
+					for (int k = 0; k < 8; ++k) {
+						glm::dvec3 p(x[i * 8 + k], y[i * 8 + k], z[i * 8 + k]);
+						children[k] = Estimate(p, parent.half * 0.5, values[i * 8 + k], cellTape.lipschitz);
+						sum += children[k].estimate;
+						double linear = parent.value + glm::dot(parent.gradient, p - parent.center);
+						feature = feature || !(std::abs(children[k].value - linear) <= featureDeviation * glm::length(children[k].half));
+					}
+
+					// the difference is about 3 times the error of the children where the surface is smooth. At edges and corners the
+					// planes only converge linearly, it is about their error, and they are refined as far as possible
+					glm::dvec2 error = (glm::dvec2(parent.estimate.volume, parent.estimate.area) - glm::dvec2(sum.volume, sum.area)) / (feature ? 1.0 : 3.0);
+					double share = 8 * parent.half.x * parent.half.y * parent.half.z;
+					bool converged = !feature && level + 1 >= minLevels && std::abs(error.x) <= volumeTolerance * share && std::abs(error.y) <= areaTolerance * share;
+					if (converged || level + 1 == maxLevels) {
+						result += sum;
+						if (feature)
+							featureErrors[c] += glm::abs(error);
+						else
+							errors[c] += error;
+						localUnconverged += converged ? 0 : 1;
+						continue;
+					}
+					for (const Subcell& child : children) {
+						if (child.exact)
+							result += child.estimate;
+						else
+							next.push_back(child);
+					}
+				}
+				std::swap(active, next);
+			}
+			// subcells left without children: only possible with maxLevels = 0
+			for (const Subcell& s : active)
+				result += s.estimate;
+		}
+		evaluations += localEvaluations;
+		unconverged += localUnconverged;
+	});
+
+	// summed in a fixed order, so the result doesn't depend on the threads
+	Moments total = inside;
+	glm::dvec2 error(0), featureError(0);
+	for (size_t c = 0; c < results.size(); ++c) {
+		total += results[c];
+		error += errors[c];
+		featureError += featureErrors[c];
+	}
+
+	MassProperties result;
+	result.volume = total.volume;
+	result.area = total.area;
+	result.mass = density * total.volume;
+	// the errors of smooth subcells partly cancel, the sum is mostly the bias of the planes on curved surfaces. Edges and corners are
+	// cut off by the planes, their errors add up
+	result.volumeError = std::abs(error.x) + featureError.x;
+	result.areaError = std::abs(error.y) + featureError.y;
+	if (total.volume > 0) {
+		result.centroid = total.first / total.volume;
+		glm::dmat3 central = total.second - total.volume * glm::outerProduct(result.centroid, result.centroid);
+		double trace = central[0][0] + central[1][1] + central[2][2];
+		result.inertia = density * (trace * glm::dmat3(1) - central);
+	}
+
+	stats.evaluations = evaluations;
+	stats.unconverged = unconverged;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return result;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Tape.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+
+struct MassProperties {
+	double volume = 0;
+	double area = 0;
+	double mass = 0; // volume times the density
+	glm::dvec3 centroid = glm::dvec3(0);
+	glm::dmat3 inertia = glm::dmat3(0); // inertia tensor about the centroid, for the density
+	double volumeError = 0; // estimated absolute errors of volume and area
+	double areaError = 0;
+};
+
+struct MassStats {
+	size_t insideCells = 0; // octree leaves integrated exactly
+	size_t boundaryCells = 0;
+	size_t evaluations = 0; // points evaluated inside the boundary cells
+	size_t unconverged = 0; // boundary subcells that hit maxLevels before meeting their share of the tolerance
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Volume, surface area, centroid and inertia tensor of the solid of a tape (where it is negative).
+///
+/// An IntervalOctree splits the box: leaves proven inside are integrated exactly as boxes, leaves proven outside are skipped. The surface cells
+/// are refined adaptively, in parallel: a subcell is estimated from the value and gradient at its center, taking the surface as the plane
+/// of the linearization, with the exact volume and area of the part of the subcell cut off by it. Subcells whose center is farther from
+/// the surface than their half diagonal (by the Lipschitz bound) are exact. After minLevels, a subcell whose estimate differs from the sum
+/// of its 8 children by more than its share of the tolerance is replaced by its children, until maxLevels. Subcells whose children are
+/// far from its plane (edges, corners) are always refined to maxLevels: the planes cut their edges off, so there the area only converges
+/// linearly with the size of the subcells. The differences of the accepted estimates give the error estimates, which are not bounds.
+/// </summary>
+class MassIntegrator
+{
+public:
+	uint32_t octreeDepth = 5;
+	int minLevels = 2; // subdivisions of every surface cell of the octree, edges that only clip a subcell are missed by its children
+	int maxLevels = 4;
+	double tolerance = 1e-3; // target of the estimated errors of volume and area, relative to them
+	double density = 1;
+
+	/// <summary>
+	/// Integrates the part of the solid inside box (must be finite), which should contain all of it.
+	/// </summary>
+	MassProperties Integrate(const Tape& tape, const BoundingBox& box, ThreadPool& pool = ThreadPool::Global());
+
+	const MassStats& Stats() const { return stats; }
+
+private:
+	MassStats stats;
+};
@@ -0,0 +1,140 @@
+#include "MeshAttributes.h"
+#include "TapeEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+	// scratch memory of the calling thread, only grows
+	struct Work {
+		std::vector<float> x, y, z, values;
+		std::vector<Dual<1>> derivatives;
+		std::vector<Dual<2>> secondDerivatives;
+	};
+
+	Work& ThreadWork() {
+		thread_local Work work;
+		return work;
+	}
+
+	// the vertices to the coordinates of the work
+	void GatherPositions(const MeshChunk& chunk, Work& work) {
+		const size_t count = chunk.VertexCount();
+		for (auto* v : { &work.x, &work.y, &work.z })
+			v->resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			work.x[i] = chunk.positions[i].x;
+			work.y[i] = chunk.positions[i].y;
+			work.z[i] = chunk.positions[i].z;
+		}
+	}
+
+	// chunk.normals from the gradients of the derivatives, with central differences where they are undefined
+	template<int Order>
+	void FillNormals(const Tape& tape, MeshChunk& chunk, const std::vector<Dual<Order>>& derivatives, float fallbackStep, Work& work) {
+		const size_t count = chunk.VertexCount();
+		chunk.normals.resize(count);
+		std::vector<uint32_t> undefined;
+		for (size_t i = 0; i < count; ++i) {
+			const Dual<Order>& d = derivatives[i];
+			glm::vec3 gradient(d.d[1], d.d[2], d.d[3]);
+			float g2 = glm::dot(gradient, gradient);
+			if (g2 > 0 && std::isfinite(g2))
+				chunk.normals[i] = gradient / std::sqrt(g2);
+			else
+				undefined.push_back((uint32_t)i);
+		}
+		if (undefined.empty())
+			return;
+
+		// 6 points around each of them
+		size_t n = undefined.size() * 6;
+		for (auto* v : { &work.x, &work.y, &work.z, &work.values })
+			v->resize(std::max(v->size(), n));
+		for (size_t k = 0; k < undefined.size(); ++k)
+			for (int j = 0; j < 6; ++j) {
+				glm::vec3 p = chunk.positions[undefined[k]];
+				p[j / 2] += j % 2 == 0 ? fallbackStep : -fallbackStep;
+				work.x[k * 6 + j] = p.x;
+				work.y[k * 6 + j] = p.y;
+				work.z[k * 6 + j] = p.z;
+			}
+		TapeEvaluator::Evaluate(tape, work.x.data(), work.y.data(), work.z.data(), work.values.data(), n);
+		for (size_t k = 0; k < undefined.size(); ++k) {
+			const float* v = &work.values[k * 6];
+			glm::vec3 gradient(v[0] - v[1], v[2] - v[3], v[4] - v[5]);
+			float length = glm::length(gradient);
+			chunk.normals[undefined[k]] = length > 0 && std::isfinite(length) ? gradient / length : glm::vec3(0);
+		}
+	}
+
+	// an orthonormal basis of the plane perpendicular to the unit vector n, with t1 x t2 = n (zero vectors for n = 0)
+	void TangentBasis(glm::vec3 n, glm::vec3& t1, glm::vec3& t2) {
+		glm::vec3 a = glm::abs(n);
+		glm::vec3 axis = a.x <= a.y && a.x <= a.z ? glm::vec3(1, 0, 0) : a.y <= a.z ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1);
+		glm::vec3 t = glm::cross(axis, n);
+		float length = glm::length(t);
+		t1 = length > 0 ? t / length : glm::vec3(0);
+		t2 = glm::cross(n, t1);
+	}
+}
+
+void MeshAttributes::Normals(const Tape& tape, MeshChunk& chunk, float fallbackStep)
+{
+	Work& work = ThreadWork();
+	GatherPositions(chunk, work);
+	work.derivatives.resize(chunk.VertexCount());
+	TapeEvaluator::EvaluateDerivatives<1>(tape, work.x.data(), work.y.data(), work.z.data(), work.derivatives.data(), chunk.VertexCount());
+	FillNormals(tape, chunk, work.derivatives, fallbackStep, work);
+}
+
+void MeshAttributes::Curvatures(const Tape& tape, MeshChunk& chunk, float fallbackStep)
+{
+	const size_t count = chunk.VertexCount();
+	Work& work = ThreadWork();
+	GatherPositions(chunk, work);
+	work.secondDerivatives.resize(count);
+	TapeEvaluator::EvaluateDerivatives<2>(tape, work.x.data(), work.y.data(), work.z.data(), work.secondDerivatives.data(), count);
+	FillNormals(tape, chunk, work.secondDerivatives, fallbackStep, work);
+
+	using D = Dual<2>;
+	chunk.gaussianCurvatures.resize(count);
+	chunk.meanCurvatures.resize(count);
+	for (auto& directions : chunk.principalDirections)
+		directions.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		const float* d = work.secondDerivatives[i].d;
+		glm::vec3 gradient(d[1], d[2], d[3]);
+		glm::mat3 hessian(
+			d[D::Idx(2, 0, 0)], d[D::Idx(1, 1, 0)], d[D::Idx(1, 0, 1)],
+			d[D::Idx(1, 1, 0)], d[D::Idx(0, 2, 0)], d[D::Idx(0, 1, 1)],
+			d[D::Idx(1, 0, 1)], d[D::Idx(0, 1, 1)], d[D::Idx(0, 0, 2)]
+		);
+		float length = glm::length(gradient);
+		bool defined = length > 0 && std::isfinite(length);
+		for (int c = 0; c < 3; ++c)
+			defined = defined && std::isfinite(hessian[c].x + hessian[c].y + hessian[c].z);
+
+		glm::vec3 t1, t2;
+		TangentBasis(defined ? gradient / length : chunk.normals[i], t1, t2);
+		if (!defined) {
+			chunk.gaussianCurvatures[i] = 0;
+			chunk.meanCurvatures[i] = 0;
+			chunk.principalDirections[0][i] = t1;
+			chunk.principalDirections[1][i] = t2;
+			continue;
+		}
+
+		// the shape operator in the basis t1, t2 is symmetric: [a b; b c]
+		glm::vec3 h1 = hessian * t1, h2 = hessian * t2;
+		float a = glm::dot(t1, h1) / length, b = glm::dot(t1, h2) / length, c = glm::dot(t2, h2) / length;
+		chunk.gaussianCurvatures[i] = a * c - b * b;
+		chunk.meanCurvatures[i] = -0.5f * (a + c);
+		float angle = 0.5f * std::atan2(2 * b, a - c); // of the eigenvector of the larger eigenvalue from t1
+		float cos = std::cos(angle), sin = std::sin(angle);
+		chunk.principalDirections[0][i] = cos * t1 + sin * t2;
+		chunk.principalDirections[1][i] = cos * t2 - sin * t1;
+	}
+}
+
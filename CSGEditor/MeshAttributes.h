@@ -0,0 +1,28 @@
+#pragma once
+#include "Tape.h"
+#include "MeshChunk.h"
+
+/// <summary>
+/// Vertex attributes of mesh chunks from the exact derivatives of the SDF (TapeEvaluator::EvaluateDerivatives), evaluated in batches,
+/// instead of estimating them from the triangles downstream.
+/// </summary>
+class MeshAttributes
+{
+public:
+	/// <summary>
+	/// Fills chunk.normals with the normalized gradients at the vertices. The tape has to be valid at all of them.
+	/// Where the gradient is undefined (eg.: exactly on the faces of a box, where the distance to the box has a kink) central differences
+	/// with the step fallbackStep are used instead.
+	/// </summary>
+	static void Normals(const Tape& tape, MeshChunk& chunk, float fallbackStep);
+
+	/// <summary>
+	/// Fills chunk.normals like Normals, and the curvatures of the level set through each vertex from the gradient and the Hessian (second
+	/// order dual numbers): the shape operator is the Hessian projected onto the tangent plane and divided by the length of the gradient.
+	/// Its eigenvalues are the principal curvatures k1 >= k2, positive where the surface bends away from the normal (convex solids), and
+	/// chunk.principalDirections are its eigenvectors. gaussianCurvatures are k1 k2 and meanCurvatures -(k1 + k2) / 2, the signs of the
+	/// curvature display modes of the renderer. The directions of umbilic points (eg.: all of a sphere) are arbitrary tangents.
+	/// Where the derivatives are undefined the curvatures are 0 and the directions tangents of the normal.
+	/// </summary>
+	static void Curvatures(const Tape& tape, MeshChunk& chunk, float fallbackStep);
+};
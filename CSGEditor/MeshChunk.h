@@ -0,0 +1,40 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// A piece of an extracted triangle mesh, as the meshers hand it to their sink. Vertices on the border of a chunk are repeated in the
+/// neighbouring chunks with the same key, so the chunks can be written one by one and still be welded into a crack-free mesh.
+/// </summary>
+struct MeshChunk {
+	std::vector<glm::vec3> positions;
+	std::vector<uint64_t> keys; // identifies the vertex in the whole mesh, see the mesher for what it encodes
+	std::vector<uint8_t> shared; // 1 for the vertices that other chunks may repeat, empty if any vertex may be repeated
+	std::vector<glm::vec3> normals; // unit normals from the derivatives of the SDF if the mesher was asked for them, else empty
+	// the curvatures of the level set through the vertex if the mesher was asked for them (see MeshAttributes::Curvatures), else empty
+	std::vector<float> gaussianCurvatures;
+	std::vector<float> meanCurvatures;
+	std::vector<glm::vec3> principalDirections[2]; // unit tangents, of the largest and the smallest principal curvature
+	std::vector<uint32_t> indices; // 3 per triangle, into positions, counter-clockwise seen from outside (positive distances)
+
+	size_t VertexCount() const { return positions.size(); }
+	size_t TriangleCount() const { return indices.size() / 3; }
+	size_t Bytes() const {
+		return (positions.capacity() + normals.capacity() + principalDirections[0].capacity() + principalDirections[1].capacity()) * sizeof(glm::vec3)
+			+ keys.capacity() * sizeof(uint64_t) + shared.capacity() + (gaussianCurvatures.capacity() + meanCurvatures.capacity()) * sizeof(float)
+			+ indices.capacity() * sizeof(uint32_t);
+	}
+
+	void Clear() {
+		positions.clear();
+		keys.clear();
+		shared.clear();
+		normals.clear();
+		gaussianCurvatures.clear();
+		meanCurvatures.clear();
+		principalDirections[0].clear();
+		principalDirections[1].clear();
+		indices.clear();
+	}
+};
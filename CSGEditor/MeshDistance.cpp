@@ -0,0 +1,385 @@
+#include "MeshDistance.h"
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace {
+	constexpr int brickSize = 8;
+
+	// closest point of the triangle to p (Ericson: Real-Time Collision Detection, 5.1.5), returns the squared distance
+	float SquaredDistance(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+		glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0 && d2 <= 0)
+			return glm::dot(ap, ap);
+
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0 && d4 <= d3)
+			return glm::dot(bp, bp);
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			glm::vec3 q = a + ab * (d1 / (d1 - d3));
+			return glm::dot(p - q, p - q);
+		}
+
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0 && d5 <= d6)
+			return glm::dot(cp, cp);
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			glm::vec3 q = a + ac * (d2 / (d2 - d6));
+			return glm::dot(p - q, p - q);
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+			glm::vec3 q = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			return glm::dot(p - q, p - q);
+		}
+
+		float denominator = 1 / (va + vb + vc);
+		glm::vec3 q = a + ab * (vb * denominator) + ac * (vc * denominator);
+		return glm::dot(p - q, p - q);
+	}
+
+	float SquaredDistance(glm::vec3 p, const BoundingBox& box) {
+		glm::vec3 d = glm::max(glm::max(box.min - p, p - box.max), 0.0f);
+		return glm::dot(d, d);
+	}
+
+	// signed solid angle of the triangle seen from p (Van Oosterom and Strackee), positive if p is behind it
+	float SolidAngle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+		a -= p;
+		b -= p;
+		c -= p;
+		float la = glm::length(a), lb = glm::length(b), lc = glm::length(c);
+		float numerator = glm::dot(a, glm::cross(b, c));
+		float denominator = la * lb * lc + glm::dot(a, b) * lc + glm::dot(b, c) * la + glm::dot(c, a) * lb;
+		return 2 * std::atan2(numerator, denominator);
+	}
+
+	// FNV-1a of the vertices and the triangles
+	uint64_t Hash(const TriangleMesh& mesh) {
+		uint64_t h = 14695981039346656037ull;
+		auto add = [&](const void* data, size_t bytes) {
+			for (size_t i = 0; i < bytes; ++i) {
+				h ^= static_cast<const unsigned char*>(data)[i];
+				h *= 1099511628211ull;
+			}
+		};
+		add(mesh.positions.data(), mesh.positions.size() * sizeof(glm::vec3));
+		add(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		return h;
+	}
+}
+
+TriangleBVH::TriangleBVH(const TriangleMesh& mesh)
+{
+	uint32_t count = (uint32_t)mesh.TriangleCount();
+	std::vector<uint32_t> order(count);
+	std::vector<glm::vec3> centroids(count);
+	for (uint32_t t = 0; t < count; ++t) {
+		order[t] = t;
+		centroids[t] = (mesh.positions[mesh.indices[3 * t]] + mesh.positions[mesh.indices[3 * t + 1]] + mesh.positions[mesh.indices[3 * t + 2]]) / 3.0f;
+	}
+	if (count == 0)
+		return;
+
+	nodes.reserve(2 * count / leafSize + 1);
+	nodes.emplace_back();
+	Build(0, order, centroids, 0, count);
+
+	triangles.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t* index = &mesh.indices[3 * order[i]];
+		triangles[i] = { mesh.positions[index[0]], mesh.positions[index[1]], mesh.positions[index[2]] };
+	}
+
+	// the bounds and the dipoles from the bottom up, the children are always after their parent
+	for (size_t n = nodes.size(); n-- > 0;) {
+		Node& node = nodes[n];
+		if (node.count > 0) {
+			node.box = BoundingBox(triangles[node.first].a, triangles[node.first].a);
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				const Triangle& t = triangles[i];
+				node.box.min = glm::min(glm::min(node.box.min, t.a), glm::min(t.b, t.c));
+				node.box.max = glm::max(glm::max(node.box.max, t.a), glm::max(t.b, t.c));
+				glm::vec3 normal = 0.5f * glm::cross(t.b - t.a, t.c - t.a);
+				float area = glm::length(normal);
+				node.areaNormal += normal;
+				node.center += area * (t.a + t.b + t.c) / 3.0f;
+				node.area += area;
+			}
+			node.center = node.area > 0 ? node.center / node.area : node.box.Center();
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				const Triangle& t = triangles[i];
+				node.radius = std::max({ node.radius, glm::distance(node.center, t.a), glm::distance(node.center, t.b), glm::distance(node.center, t.c) });
+			}
+			continue;
+		}
+
+		const Node& left = nodes[node.first];
+		const Node& right = nodes[node.first + 1];
+		node.box = BoundingBox::Union(left.box, right.box);
+		node.areaNormal = left.areaNormal + right.areaNormal;
+		node.area = left.area + right.area;
+		node.center = node.area > 0 ? (left.area * left.center + right.area * right.center) / node.area : node.box.Center();
+		node.radius = std::max(glm::distance(node.center, left.center) + left.radius, glm::distance(node.center, right.center) + right.radius);
+	}
+}
+
+void TriangleBVH::Build(uint32_t node, std::vector<uint32_t>& order, const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end)
+{
+	if (end - begin <= leafSize) {
+		nodes[node].first = begin;
+		nodes[node].count = end - begin;
+		return;
+	}
+
+	// median split along the longest side of the centroids' bounds
+	BoundingBox centers(centroids[order[begin]], centroids[order[begin]]);
+	for (uint32_t i = begin; i < end; ++i) {
+		centers.min = glm::min(centers.min, centroids[order[i]]);
+		centers.max = glm::max(centers.max, centroids[order[i]]);
+	}
+	glm::vec3 extent = centers.max - centers.min;
+	int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+	uint32_t middle = begin + (end - begin) / 2;
+	std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+		[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+	uint32_t left = (uint32_t)nodes.size();
+	nodes[node].first = left;
+	nodes.emplace_back();
+	nodes.emplace_back();
+	Build(left, order, centroids, begin, middle);
+	Build(left + 1, order, centroids, middle, end);
+}
+
+float TriangleBVH::Distance(glm::vec3 p, float maxDistance) const
+{
+	if (nodes.empty())
+		return maxDistance;
+
+	float best = maxDistance * maxDistance;
+	uint32_t stack[64];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const Node& node = nodes[stack[--size]];
+		if (SquaredDistance(p, node.box) >= best)
+			continue; // a closer triangle was found since the node was pushed
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				best = std::min(best, SquaredDistance(p, triangles[i].a, triangles[i].b, triangles[i].c));
+			continue;
+		}
+
+		// the closer child is pushed last, so it's visited first
+		float left = SquaredDistance(p, nodes[node.first].box);
+		float right = SquaredDistance(p, nodes[node.first + 1].box);
+		uint32_t nearChild = left <= right ? node.first : node.first + 1;
+		uint32_t farChild = 2 * node.first + 1 - nearChild;
+		if (std::max(left, right) < best)
+			stack[size++] = farChild;
+		if (std::min(left, right) < best)
+			stack[size++] = nearChild;
+	}
+	return std::min(std::sqrt(best), maxDistance);
+}
+
+float TriangleBVH::WindingNumber(glm::vec3 p) const
+{
+	if (nodes.empty())
+		return 0;
+
+	float solidAngle = 0;
+	uint32_t stack[64];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const Node& node = nodes[stack[--size]];
+		glm::vec3 toCenter = node.center - p;
+		float distance = glm::length(toCenter);
+		if (distance > beta * node.radius) {
+			solidAngle += glm::dot(toCenter, node.areaNormal) / (distance * distance * distance);
+			continue;
+		}
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				solidAngle += SolidAngle(p, triangles[i].a, triangles[i].b, triangles[i].c);
+			continue;
+		}
+		stack[size++] = node.first;
+		stack[size++] = node.first + 1;
+	}
+	return solidAngle / (4 * glm::pi<float>());
+}
+
+DistanceBake MeshDistance::Bake(const TriangleMesh& mesh, int resolution, float bandVoxels, ThreadPool& pool, BakeStats* stats)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	DistanceBake bake = DistanceBake::Grid(mesh.Bounds(), resolution, bandVoxels);
+	float voxel = bake.VoxelSize();
+	bake.contentHash = Hash(mesh);
+	TriangleBVH bvh(mesh);
+
+	glm::ivec3 bricks = (bake.resolution + brickSize - 1) / brickSize;
+	size_t brickCount = (size_t)bricks.x * bricks.y * bricks.z;
+	std::atomic<size_t> pruned{ 0 }, samples{ 0 };
+
+	pool.ParallelFor(brickCount, 1, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; ++b) {
+			glm::ivec3 first = glm::ivec3((int)(b % bricks.x), (int)(b / bricks.x % bricks.y), (int)(b / bricks.x / bricks.y)) * brickSize;
+			glm::ivec3 last = glm::min(first + brickSize, bake.resolution);
+			auto fill = [&](auto value) {
+				for (int k = first.z; k < last.z; ++k)
+					for (int j = first.y; j < last.y; ++j)
+						for (int i = first.x; i < last.x; ++i)
+							bake.values[((size_t)k * bake.resolution.y + j) * bake.resolution.x + i] =
+								value(bake.min + (glm::vec3(i, j, k) + 0.5f) * voxel);
+			};
+
+			// if the closest triangle is farther than the band from every sample of the brick, they are all on the side of the center
+			glm::vec3 center = bake.min + 0.5f * glm::vec3(first + last) * voxel;
+			float reach = bake.band + 0.5f * glm::length(glm::vec3(last - first - 1)) * voxel;
+			if (bvh.Distance(center, reach) >= reach) {
+				float clamped = bvh.WindingNumber(center) > 0.5f ? -bake.band : bake.band;
+				fill([&](glm::vec3) { return clamped; });
+				++pruned;
+				continue;
+			}
+
+			// no triangle is closer to a sample than its distance, so a neighbour inside that ball is on the same side: the winding number
+			// is only evaluated next to the surface, and at the first sample
+			glm::ivec3 size = last - first;
+			for (int k = first.z; k < last.z; ++k)
+				for (int j = first.y; j < last.y; ++j)
+					for (int i = first.x; i < last.x; ++i) {
+						glm::vec3 p = bake.min + (glm::vec3(i, j, k) + 0.5f) * voxel;
+						size_t index = ((size_t)k * bake.resolution.y + j) * bake.resolution.x + i;
+						float distance = bvh.Distance(p, bake.band);
+						float sign = 0;
+						size_t neighbours[3] = { i > first.x ? index - 1 : SIZE_MAX, j > first.y ? index - bake.resolution.x : SIZE_MAX,
+							k > first.z ? index - (size_t)bake.resolution.x * bake.resolution.y : SIZE_MAX };
+						for (size_t neighbour : neighbours)
+							if (neighbour != SIZE_MAX && std::max(distance, std::abs(bake.values[neighbour])) > voxel) {
+								sign = bake.values[neighbour] < 0 ? -1.0f : 1.0f;
+								break;
+							}
+						if (sign == 0)
+							sign = bvh.WindingNumber(p) > 0.5f ? -1.0f : 1.0f;
+						bake.values[index] = sign * distance;
+					}
+			samples += (size_t)size.x * size.y * size.z;
+		}
+	});
+
+	if (stats) {
+		stats->bricks = brickCount;
+		stats->prunedBricks = pruned;
+		stats->samples = samples;
+		stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	return bake;
+}
+
+std::shared_ptr<const DistanceBake> MeshDistance::Load(const std::string& fileName, int resolution, float bandVoxels)
+{
+	// a file that changed on disk is a new key, the bakes of its old content are dropped when the last user releases them
+	std::error_code error;
+	auto modified = std::filesystem::last_write_time(fileName, error).time_since_epoch().count();
+	auto key = std::make_tuple(fileName, (int64_t)modified, resolution, bandVoxels);
+
+	static std::mutex mutex;
+	static std::map<decltype(key), std::weak_ptr<const DistanceBake>> cache;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (auto bake = cache[key].lock())
+		return bake;
+
+	auto bake = std::make_shared<const DistanceBake>(Bake(TriangleMesh::Read(fileName), resolution, bandVoxels));
+	for (auto it = cache.begin(); it != cache.end();)
+		it = it->second.expired() ? cache.erase(it) : std::next(it);
+	cache[key] = bake;
+	return bake;
+}
+
+MeshLoader::~MeshLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+bool MeshLoader::Find(const std::string& fileName, int resolution, float bandVoxels, std::shared_ptr<const DistanceBake>& bake,
+	std::string& error)
+{
+	Key key(fileName, resolution, bandVoxels);
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(key);
+	if (it != entries.end()) {
+		if (!it->second.done)
+			return false;
+		bake = std::move(it->second.bake);
+		error = std::move(it->second.error);
+		entries.erase(it);
+		return true;
+	}
+
+	entries[key];
+	jobs.push_back(key);
+	if (!worker.joinable())
+		worker = std::thread(&MeshLoader::WorkerLoop, this);
+	jobAvailable.notify_one();
+	return false;
+}
+
+bool MeshLoader::TakeFinished()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool result = finished;
+	finished = false;
+	return result;
+}
+
+void MeshLoader::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		jobAvailable.wait(lock, [&] { return stopping || !jobs.empty(); });
+		if (stopping)
+			return;
+		Key key = std::move(jobs.front());
+		jobs.erase(jobs.begin());
+		lock.unlock();
+
+		Entry result;
+		result.done = true;
+		try {
+			result.bake = MeshDistance::Load(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+		}
+		catch (std::exception& e) {
+			result.error = e.what();
+		}
+
+		lock.lock();
+		entries[key] = std::move(result);
+		finished = true;
+	}
+}
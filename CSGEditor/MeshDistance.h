@@ -0,0 +1,131 @@
+#pragma once
+#include "TriangleMesh.h"
+#include "DistanceBake.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/// <summary>
+/// Bounding volume hierarchy of the triangles of a mesh for distance and inside / outside queries. The queries don't change it, any number
+/// of threads can run them at the same time.
+/// </summary>
+class TriangleBVH
+{
+public:
+	static constexpr uint32_t leafSize = 4; // triangles per leaf at most
+	float beta = 2; // the winding number sums the triangles of a node exactly if p is closer than beta times the node's radius
+
+	explicit TriangleBVH(const TriangleMesh& mesh);
+
+	/// <summary>
+	/// Distance from p to the closest triangle, or maxDistance if every triangle is farther. The nodes farther than the closest triangle
+	/// found so far (or maxDistance) are skipped and the closer child is visited first, so small maxDistances are cheap.
+	/// </summary>
+	float Distance(glm::vec3 p, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	/// <summary>
+	/// Generalized winding number at p: 1 inside and 0 outside of a closed mesh, a smooth transition between them across its holes,
+	/// so above 0.5 is inside even for imperfect meshes. Far nodes (see beta) are summed as a single dipole of their area weighted
+	/// normals, like the fast winding numbers of Barill et al.
+	/// </summary>
+	float WindingNumber(glm::vec3 p) const;
+
+	size_t NodeCount() const { return nodes.size(); }
+
+private:
+	struct Triangle {
+		glm::vec3 a, b, c;
+	};
+
+	struct Node {
+		BoundingBox box;
+		uint32_t first = 0; // first triangle of a leaf, the left child of an inner node (the right one is first + 1)
+		uint32_t count = 0; // triangles of a leaf, 0 for inner nodes
+		glm::vec3 areaNormal = glm::vec3(0); // sum of the normals of the triangles times their area
+		glm::vec3 center = glm::vec3(0); // area weighted centroid of the triangles
+		float area = 0;
+		float radius = 0; // bound of the distance of the vertices from center
+	};
+
+	std::vector<Triangle> triangles; // in the order of the leaves
+	std::vector<Node> nodes;
+
+	void Build(uint32_t node, std::vector<uint32_t>& order, const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end);
+};
+
+/// <summary>
+/// Signed distances of triangle meshes baked into DistanceBakes: the distance to the closest triangle, negative where the winding number
+/// is above 0.5. The imported Mesh primitive is sampled from them, like the baked subtrees.
+/// </summary>
+class MeshDistance
+{
+public:
+	/// <summary>
+	/// Samples the mesh on the grid described at DistanceBake, in the coordinates of its vertices. Bricks of 8^3 samples that are farther
+	/// from every triangle than the band are filled with +-band by the winding number at their center. Throws std::invalid_argument like
+	/// DistanceBake::Grid.
+	/// </summary>
+	static DistanceBake Bake(const TriangleMesh& mesh, int resolution, float bandVoxels, ThreadPool& pool = ThreadPool::Global(),
+		BakeStats* stats = nullptr);
+
+	/// <summary>
+	/// The bake of a model file (see TriangleMesh::Read). Bakes are shared while they are in use: loading the same unchanged file with the
+	/// same settings again returns the existing one. Throws std::runtime_error if the file can't be read and std::invalid_argument for
+	/// invalid settings.
+	/// </summary>
+	static std::shared_ptr<const DistanceBake> Load(const std::string& fileName, int resolution, float bandVoxels);
+};
+
+/// <summary>
+/// Loads model files with MeshDistance::Load on a background thread, so the editor keeps running while a mesh is read and baked.
+/// </summary>
+class MeshLoader
+{
+public:
+	MeshLoader() = default;
+	~MeshLoader();
+
+	MeshLoader(const MeshLoader&) = delete;
+	MeshLoader& operator=(const MeshLoader&) = delete;
+
+	/// <summary>
+	/// True if the load of the file with these settings is finished: bake is set, or error tells why it failed. Otherwise the load is
+	/// queued (unless it already is) and false is returned. A finished load is reported once, a later call loads the file again. Call
+	/// from one thread only.
+	/// </summary>
+	bool Find(const std::string& fileName, int resolution, float bandVoxels, std::shared_ptr<const DistanceBake>& bake, std::string& error);
+
+	/// <summary>
+	/// True if a load finished since the last call: Find would return something new.
+	/// </summary>
+	bool TakeFinished();
+
+private:
+	using Key = std::tuple<std::string, int, float>;
+
+	struct Entry {
+		bool done = false;
+		std::shared_ptr<const DistanceBake> bake; // nullptr if loading failed
+		std::string error;
+	};
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::map<Key, Entry> entries; // queued, being loaded or finished but not yet taken by Find
+	std::vector<Key> jobs;
+	bool finished = false;
+	bool stopping = false;
+	std::thread worker;
+
+	void WorkerLoop();
+};
@@ -0,0 +1,237 @@
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+void MeshWriter::Output::Open(const std::string& name)
+{
+	fileName = name;
+	file.open(name, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Can't write " + name);
+	buffer.resize(bufferSize);
+}
+
+void MeshWriter::Output::Write(const void* data, size_t bytes)
+{
+	if (used + bytes > buffer.size())
+		Flush();
+	std::memcpy(buffer.data() + used, data, bytes);
+	used += bytes;
+}
+
+void MeshWriter::Output::Flush()
+{
+	file.write(buffer.data(), used);
+	used = 0;
+	if (!file)
+		throw std::runtime_error("Failed to write " + fileName);
+}
+
+MeshWriter::MeshWriter(const std::string& fileName, MeshFormat format, bool normals, bool weld, bool curvatures)
+	: format(format), normals(normals), weld(weld), curvatures(curvatures)
+{
+	if (curvatures && format == MeshFormat::Obj)
+		throw std::invalid_argument("MeshWriter: OBJ files can't store curvatures, " + fileName + " should be a PLY file.");
+	output.Open(fileName);
+	if (format == MeshFormat::Obj) {
+		output.file << "# " << (normals ? "vertices with normals" : "vertices") << ", then the triangles that use them, chunk by chunk\n";
+		return;
+	}
+
+	output.file << "ply\nformat binary_little_endian 1.0\nelement vertex ";
+	vertexCountPosition = output.file.tellp();
+	output.file << std::string(countWidth, ' ') << "\nproperty float x\nproperty float y\nproperty float z\n";
+	if (normals)
+		output.file << "property float nx\nproperty float ny\nproperty float nz\n";
+	if (curvatures) {
+		output.file << "property float gaussian_curvature\nproperty float mean_curvature\n";
+		output.file << "property float dir1x\nproperty float dir1y\nproperty float dir1z\nproperty float dir2x\nproperty float dir2y\nproperty float dir2z\n";
+	}
+	output.file << "element face ";
+	faceCountPosition = output.file.tellp();
+	output.file << std::string(countWidth, ' ') << "\nproperty list uchar int vertex_indices\nend_header\n";
+	faces.Open(fileName + ".faces");
+}
+
+MeshWriter::~MeshWriter()
+{
+	try {
+		Close();
+	}
+	catch (...) {
+	}
+}
+
+MeshFormat MeshWriter::FormatOf(const std::string& fileName)
+{
+	std::string extension = fileName.substr(std::min(fileName.size(), fileName.rfind('.')));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (extension == ".ply")
+		return MeshFormat::Ply;
+	if (extension == ".obj")
+		return MeshFormat::Obj;
+	throw std::invalid_argument("MeshWriter: " + fileName + " is neither .ply nor .obj.");
+}
+
+void MeshWriter::Append(const MeshChunk& chunk)
+{
+	if (closed)
+		throw std::runtime_error("MeshWriter: " + output.fileName + " is already closed.");
+	if (normals && chunk.normals.size() != chunk.VertexCount())
+		throw std::invalid_argument("MeshWriter: the chunk has no normals.");
+	if (curvatures && (chunk.gaussianCurvatures.size() != chunk.VertexCount() || chunk.meanCurvatures.size() != chunk.VertexCount()
+		|| chunk.principalDirections[0].size() != chunk.VertexCount() || chunk.principalDirections[1].size() != chunk.VertexCount()))
+		throw std::invalid_argument("MeshWriter: the chunk has no curvatures.");
+
+	// indices in the file: the next ones for the vertices written by this chunk, earlier ones for welded vertices
+	indexOfVertex.resize(chunk.VertexCount());
+	size_t written = stats.vertices;
+	for (size_t i = 0; i < chunk.VertexCount(); ++i) {
+		if (!weld || (!chunk.shared.empty() && !chunk.shared[i])) {
+			indexOfVertex[i] = (uint32_t)written++;
+			continue;
+		}
+		auto [it, inserted] = sharedVertices.try_emplace(chunk.keys[i], (uint32_t)written);
+		if (inserted)
+			++written;
+		else
+			++stats.weldedVertices;
+		indexOfVertex[i] = it->second;
+	}
+
+	if (format == MeshFormat::Ply)
+		WritePly(chunk);
+	else
+		WriteObj(chunk);
+	stats.vertices = written;
+	stats.triangles += chunk.TriangleCount();
+	++stats.chunks;
+
+	size_t bytes = output.buffer.capacity() + faces.buffer.capacity() + indexOfVertex.capacity() * sizeof(uint32_t)
+		+ sharedVertices.size() * (sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(void*)) + sharedVertices.bucket_count() * sizeof(void*);
+	stats.peakBytes = std::max(stats.peakBytes, bytes);
+}
+
+void MeshWriter::WritePly(const MeshChunk& chunk)
+{
+	size_t next = stats.vertices;
+	for (size_t i = 0; i < chunk.VertexCount(); ++i) {
+		if (indexOfVertex[i] != next)
+			continue; // welded to a vertex of an earlier chunk, or a copy of one of this chunk
+		++next;
+		float vertex[14] = { chunk.positions[i].x, chunk.positions[i].y, chunk.positions[i].z };
+		size_t size = 3;
+		auto add = [&](glm::vec3 v) {
+			vertex[size++] = v.x;
+			vertex[size++] = v.y;
+			vertex[size++] = v.z;
+		};
+		if (normals)
+			add(chunk.normals[i]);
+		if (curvatures) {
+			vertex[size++] = chunk.gaussianCurvatures[i];
+			vertex[size++] = chunk.meanCurvatures[i];
+			add(chunk.principalDirections[0][i]);
+			add(chunk.principalDirections[1][i]);
+		}
+		output.Write(vertex, size * sizeof(float)); // all supported platforms are little endian
+	}
+
+	char face[13];
+	face[0] = 3;
+	for (size_t t = 0; t < chunk.indices.size(); t += 3) {
+		for (int k = 0; k < 3; ++k) {
+			int32_t index = (int32_t)indexOfVertex[chunk.indices[t + k]];
+			std::memcpy(face + 1 + k * sizeof(int32_t), &index, sizeof(int32_t));
+		}
+		faces.Write(face, sizeof(face));
+	}
+}
+
+void MeshWriter::WriteObj(const MeshChunk& chunk)
+{
+	char line[128];
+	auto vector = [&](const char* prefix, glm::vec3 v) {
+		size_t length = std::strlen(prefix);
+		std::memcpy(line, prefix, length);
+		char* end = line + length;
+		for (int axis = 0; axis < 3; ++axis) {
+			*end++ = ' ';
+			end = std::to_chars(end, end + 32, v[axis]).ptr; // shortest text that reads back to the same float
+		}
+		*end++ = '\n';
+		output.Write(line, end - line);
+	};
+
+	size_t next = stats.vertices;
+	for (size_t i = 0; i < chunk.VertexCount(); ++i) {
+		if (indexOfVertex[i] != next)
+			continue;
+		++next;
+		vector("v", chunk.positions[i]);
+		if (normals)
+			vector("vn", chunk.normals[i]);
+	}
+
+	// OBJ counts from 1, the normal of a vertex has the same index as the vertex
+	for (size_t t = 0; t < chunk.indices.size(); t += 3) {
+		char* end = line;
+		*end++ = 'f';
+		for (int k = 0; k < 3; ++k) {
+			uint32_t index = indexOfVertex[chunk.indices[t + k]] + 1;
+			*end++ = ' ';
+			end = std::to_chars(end, end + 10, index).ptr;
+			if (normals) {
+				*end++ = '/';
+				*end++ = '/';
+				end = std::to_chars(end, end + 10, index).ptr;
+			}
+		}
+		*end++ = '\n';
+		output.Write(line, end - line);
+	}
+}
+
+void MeshWriter::Close()
+{
+	if (closed)
+		return;
+	closed = true;
+	output.Flush();
+
+	if (format == MeshFormat::Ply) {
+		faces.Flush();
+		faces.file.close();
+		std::ifstream spooled(faces.fileName, std::ios::binary);
+		while (spooled) {
+			spooled.read(output.buffer.data(), output.buffer.size());
+			output.used = (size_t)spooled.gcount();
+			output.Flush();
+		}
+		spooled.close();
+		std::remove(faces.fileName.c_str());
+
+		auto patch = [&](std::streampos position, size_t count) {
+			char text[countWidth + 1];
+			std::snprintf(text, sizeof(text), "%-*zu", (int)countWidth, count);
+			output.file.seekp(position);
+			output.file.write(text, countWidth);
+		};
+		stats.bytes = (size_t)output.file.tellp();
+		patch(vertexCountPosition, stats.vertices);
+		patch(faceCountPosition, stats.triangles);
+	}
+	else {
+		stats.bytes = (size_t)output.file.tellp();
+	}
+
+	output.file.close();
+	if (!output.file)
+		throw std::runtime_error("Failed to write " + output.fileName);
+	sharedVertices = {};
+}
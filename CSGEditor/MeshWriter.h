@@ -0,0 +1,87 @@
+#pragma once
+#include "MeshChunk.h"
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class MeshFormat {
+	Ply, // binary little endian
+	Obj
+};
+
+struct MeshWriterStats {
+	size_t chunks = 0;
+	size_t vertices = 0; // written, after welding
+	size_t weldedVertices = 0; // shared vertices of chunks that were already written by an earlier chunk
+	size_t triangles = 0;
+	size_t bytes = 0; // size of the file
+	size_t peakBytes = 0; // buffers and the keys of the shared vertices
+};
+
+/// <summary>
+/// Writes the chunks of a mesher to a PLY or OBJ file while they are produced (as the sink of MarchingCubes or DualContouring),
+/// so the mesh never has to fit in memory. The output goes through large buffers written with one call each.
+///
+/// The vertices of each chunk are written as they come; the ones marked shared (see MeshChunk::shared) are remembered by their key,
+/// so the copies in later chunks are welded to the first one. That map is the only memory that grows with the mesh, with the number of
+/// vertices on the faces of the mesher's blocks. Without weld, border vertices are written once per chunk and the memory only depends on
+/// the buffer size.
+///
+/// PLY stores all vertices before all faces, so the faces go to a temporary file next to the output (name + ".faces") that Close appends.
+/// The header reserves room for the counts, which Close fills in like in PointCloudWriter.
+/// Throws std::runtime_error if a file can't be written.
+/// </summary>
+class MeshWriter
+{
+public:
+	/// <summary>
+	/// With normals, every chunk has to have MeshChunk::normals (std::invalid_argument otherwise). With curvatures, every chunk has to have
+	/// the curvatures and principal directions, which become the PLY vertex properties gaussian_curvature, mean_curvature, dir1x, dir1y,
+	/// dir1z, dir2x, dir2y and dir2z. OBJ has no place for them, std::invalid_argument.
+	/// </summary>
+	MeshWriter(const std::string& fileName, MeshFormat format, bool normals = false, bool weld = true, bool curvatures = false);
+	~MeshWriter();
+
+	/// <summary>
+	/// Ply for .ply, Obj for .obj (any case), throws std::invalid_argument for other extensions.
+	/// </summary>
+	static MeshFormat FormatOf(const std::string& fileName);
+
+	void Append(const MeshChunk& chunk);
+
+	/// <summary>
+	/// Writes the final counts and closes the file. Called by the destructor if needed (errors are lost there).
+	/// </summary>
+	void Close();
+
+	const MeshWriterStats& Stats() const { return stats; }
+
+private:
+	// an output file with its buffer
+	struct Output {
+		std::string fileName;
+		std::ofstream file;
+		std::vector<char> buffer;
+		size_t used = 0;
+
+		void Open(const std::string& name);
+		void Write(const void* data, size_t bytes); // flushes first if the buffer is full
+		void Flush();
+	};
+
+	static constexpr size_t bufferSize = 4 << 20;
+	static constexpr size_t countWidth = 20; // wide enough for any count, padded with spaces which PLY readers skip
+
+	MeshFormat format;
+	bool normals, weld, curvatures;
+	Output output, faces;
+	std::streampos vertexCountPosition, faceCountPosition;
+	std::unordered_map<uint64_t, uint32_t> sharedVertices; // key -> index in the file
+	std::vector<uint32_t> indexOfVertex; // of the chunk being written
+	MeshWriterStats stats;
+	bool closed = false;
+
+	void WritePly(const MeshChunk& chunk);
+	void WriteObj(const MeshChunk& chunk);
+};
@@ -1,6 +1,5 @@
 #include "Node.h"
 #include "NodeVisitor.h"
-#include "GuiPrimitiveNode.h"
 
 void OperatorNode::visit(NodeVisitor* visitor)
 {
@@ -20,9 +19,10 @@ std::shared_ptr<Node> OperatorNode::clone()
 	clone->rotate = rotate;
 	clone->scale = scale;
 	clone->radius = radius;
-	clone->guiNode = std::shared_ptr<GuiPrimitiveNode>(nullptr); // should be assigned after the copy is done, by the class doing the copy
+	clone->guiNode.reset(); // should be assigned after the copy is done, by the class doing the copy
 	clone->operatorIdx = operatorIdx;
 	clone->operatorDescription = operatorDescription->clone();
+	clone->baked = baked;
 	return clone;
 }
 
@@ -45,7 +45,7 @@ std::shared_ptr<Node> PrimitiveNode::clone()
 	clone->rotate = rotate;
 	clone->scale = scale;
 	clone->radius = radius;
-	clone->guiNode = std::shared_ptr<GuiPrimitiveNode>(nullptr); // should be assigned after the copy is done, by the class doing the copy
+	clone->guiNode.reset(); // should be assigned after the copy is done, by the class doing the copy
 	clone->primitiveIdx = primitiveIdx;
 	clone->primitive = primitive->clone();
 	return clone;
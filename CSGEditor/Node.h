@@ -49,6 +49,10 @@ struct OperatorNode : public Node
 {
 	size_t operatorIdx = 0;
 	std::unique_ptr<Operator> operatorDescription;
+	/// <summary>
+	/// If true, the shader samples a distance texture baked from this subtree instead of evaluating it (see SubtreeBaker)
+	/// </summary>
+	bool baked = false;
 
 	virtual void visit(NodeVisitor* visitor) override;
 	virtual std::shared_ptr<Node> clone() override;
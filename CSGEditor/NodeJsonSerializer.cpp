@@ -1,4 +1,5 @@
 #include "NodeJsonSerializer.h"
+#include <iomanip>
 
 ordered_json NodeJsonSerializer::GenerateFromRoot(std::shared_ptr<Node> root)
 {
@@ -16,12 +17,12 @@ ordered_json NodeJsonSerializer::GenerateFromRoot(std::shared_ptr<Node> root)
 	return jsonStack.top();
 }
 
-std::string NodeJsonSerializer::Serialize(std::vector<Editor::NodeHandle> roots)
+std::string NodeJsonSerializer::Serialize(std::vector<std::shared_ptr<Node>> roots)
 {
 	NodeJsonSerializer serializer;
 	ordered_json j;
-	for (auto nh : roots) {
-		j += serializer.GenerateFromRoot(nh.node->node);
+	for (auto root : roots) {
+		j += serializer.GenerateFromRoot(root);
 	}
 
 	std::stringstream str;
@@ -30,19 +31,23 @@ std::string NodeJsonSerializer::Serialize(std::vector<Editor::NodeHandle> roots)
 	return str.str();
 }
 
-void NodeJsonSerializer::DeserializeInto(Editor& nodes, std::string jsonString)
+std::vector<std::shared_ptr<Node>> NodeJsonSerializer::Deserialize(std::string jsonString)
 {
 	ordered_json j = ordered_json::parse(jsonString);
+	std::vector<std::shared_ptr<Node>> roots;
 
 	if (j.is_null())
-		return;
+		return roots;
 
 	if (!j.is_array())
-		throw std::exception("Json format error: expected array as root object.");
+		throw std::runtime_error("Json format error: expected array as root object.");
 
 	for (ordered_json rootObj : j) {
-		LoadTree(nodes, rootObj);
+		auto root = LoadTree(rootObj);
+		if (root != nullptr)
+			roots.push_back(root);
 	}
+	return roots;
 }
 
 void NodeJsonSerializer::operator()(std::shared_ptr<PrimitiveNode> primNode)
@@ -81,6 +86,8 @@ void NodeJsonSerializer::operator()(std::shared_ptr<OperatorNode> opNode)
 	};
 
 	opNode->operatorDescription->SaveToJson(j);
+	if (opNode->baked) // only written if set, so older files and readers are not affected
+		j["baked"] = true;
 
 	j["inputs"] = inputList;
 
@@ -91,9 +98,8 @@ void NodeJsonSerializer::operator()(std::shared_ptr<OperatorNode> opNode)
 }
 
 
-Editor::NodeHandle NodeJsonSerializer::LoadTree(Editor& nodes, ordered_json& j)
+std::shared_ptr<Node> NodeJsonSerializer::LoadTree(ordered_json& j)
 {
-	std::cout << "LOAD TREE: " << std::setw(2) << j << "\n";
 	if (j.contains("operator")) {
 		auto opNode = OperatorNode::Create();
 		auto typeName = j["operator"].get<std::string>();
@@ -102,20 +108,20 @@ Editor::NodeHandle NodeJsonSerializer::LoadTree(Editor& nodes, ordered_json& j)
 		opNode->rotate = getOrDefault<glm::vec3>(j, "rotate", glm::vec3());
 		opNode->scale = getOrDefault<float>(j, "scale", 1.0f);
 		opNode->radius = getOrDefault<float>(j, "offset", 0.0f);
+		opNode->baked = getOrDefault<bool>(j, "baked", false);
 
 		opNode->operatorDescription = OperatorTypes::Create(j, typeName);
 
-		auto opNodeHandle = nodes.AddNode(opNode);
-
 		if (j.contains("inputs")) {
 			auto inputs = j["inputs"];
 			for (ordered_json inputJson : inputs) {
-				auto node = LoadTree(nodes, inputJson);
-				nodes.ConnectNodes(node, opNodeHandle);
+				auto node = LoadTree(inputJson);
+				if (node != nullptr)
+					opNode->AddInputBack(node);
 			}
 		}
 
-		return opNodeHandle;
+		return opNode;
 	}
 	else if (j.contains("primitive")) {
 
@@ -129,24 +135,11 @@ Editor::NodeHandle NodeJsonSerializer::LoadTree(Editor& nodes, ordered_json& j)
 
 		primNode->primitive = PrimitiveTypes::Create(j, typeName);
 
-		return nodes.AddNode(primNode);
+		return primNode;
 	}
 	else {
 		std::cerr << "JSON LOADER: Unknown node type\n";
-		return std::shared_ptr<GuiNode>(nullptr);
+		return nullptr;
 	}
 }
 
-
-
-void glm::to_json(ordered_json& j, const glm::vec3& v)
-{
-	j = { {"x", v.x}, { "y", v.y }, { "z", v.z } };
-}
-
-void glm::from_json(const ordered_json& j, glm::vec3& v)
-{
-	v.x = j["x"].get<float>();
-	v.y = j["y"].get<float>();
-	v.z = j["z"].get<float>();
-}
\ No newline at end of file
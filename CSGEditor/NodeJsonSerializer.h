@@ -1,12 +1,12 @@
 #pragma once
 #include "NodeVisitor.h"
-#include "Editor.h"
+#include "core_utils.h"
 #include <stack>
 #include <sstream>
 
 /// <summary>
 /// Uses a modified depth first traversal of the graph for serializing its nodes.
-/// Also responsible for deserializing and adding the loaded graph to an Editor instance
+/// Also responsible for deserializing the graph (adding it to an Editor instance is done by Persistence).
 /// Details in docs.
 /// </summary>
 class NodeJsonSerializer : public NodeVisitor {
@@ -15,10 +15,15 @@ public:
 	void operator()(std::shared_ptr<OperatorNode> opNode);
 	ordered_json GenerateFromRoot(std::shared_ptr<Node> root);
 
-	static std::string Serialize(std::vector<Editor::NodeHandle> roots);
-	static void DeserializeInto(Editor& nodes, std::string jsonString);
+	static std::string Serialize(std::vector<std::shared_ptr<Node>> roots);
+
+	/// <summary>
+	/// Parses the graphs in the json string.
+	/// </summary>
+	/// <returns>the root of every tree in the string, operators already have their inputs set</returns>
+	static std::vector<std::shared_ptr<Node>> Deserialize(std::string jsonString);
 private:
-	static Editor::NodeHandle LoadTree(Editor& nodes, ordered_json& root);
+	static std::shared_ptr<Node> LoadTree(ordered_json& root);
 	std::stack<ordered_json> jsonStack;
 	int depth;
 
@@ -26,12 +31,6 @@ private:
 	static t getOrDefault(ordered_json& j, std::string key, t default_value);
 };
 
-namespace glm {
-	void to_json(ordered_json& j, const glm::vec3& v);
-	void from_json(const ordered_json& j, glm::vec3& v);
-}
-
-
 template<typename t>
 inline t NodeJsonSerializer::getOrDefault(ordered_json& j, std::string key, t default_value)
 {
@@ -1,8 +1,23 @@
 #include "Operator.h"
 #include "exceptions.h"
 
-std::vector<std::string> OperatorTypes::names;
-bool OperatorTypes::nameListGenerated;
+#include <algorithm>
+
+namespace {
+	float Largest(const std::vector<float>& bounds, size_t first = 0) {
+		float result = 0;
+		for (size_t i = first; i < bounds.size(); ++i)
+			result = std::max(result, bounds[i]);
+		return result;
+	}
+}
+
+void Union::Accept(OperatorVisitor& visitor) { visitor(*this); }
+void Intersection::Accept(OperatorVisitor& visitor) { visitor(*this); }
+void Substraction::Accept(OperatorVisitor& visitor) { visitor(*this); }
+void SmoothUnion::Accept(OperatorVisitor& visitor) { visitor(*this); }
+void SmoothIntersection::Accept(OperatorVisitor& visitor) { visitor(*this); }
+void SmoothSubstraction::Accept(OperatorVisitor& visitor) { visitor(*this); }
 
 std::ostream& Union::GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) {
 	for (int i = 0; i < inputRegisterNames.size() - 1; ++i) {
@@ -71,3 +86,120 @@ std::ostream& SmoothSubstraction::GenerateShader(std::ostream& code, std::vector
 	SmoothOperator::GenerateShader(code, inputRegisterNames);
 	return code << "_TEMPLATE_smooth_substraction(" << inputRegisterNames[0] << ", " << inputRegisterNames[1] << ", " << k << ")";
 }
+
+BoundingBox Operator::CombineBounds(const std::vector<BoundingBox>& inputBounds)
+{
+	BoundingBox result = inputBounds.front();
+	for (auto& b : inputBounds)
+		result = BoundingBox::Union(result, b);
+	return result;
+}
+
+// min and max pick the gradient of one input, the blending term of the smooth operators mixes them with weights summing to 1. Where min
+// or max is positive, the input it picks is positive too
+float Operator::CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& /*interior*/)
+{
+	return Largest(exterior);
+}
+
+float Operator::CombineInteriorLipschitz(const std::vector<float>& /*exterior*/, const std::vector<float>& interior)
+{
+	return Largest(interior);
+}
+
+// if the bound is already farther than the closest input, the input can't be the minimum
+std::ostream& Union::GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound)
+{
+	return code << "_realValue_(" << bound << ") > _realValue_(" << accumulated << ")";
+}
+
+BoundingBox Intersection::CombineBounds(const std::vector<BoundingBox>& inputBounds)
+{
+	BoundingBox result = inputBounds.front();
+	for (auto& b : inputBounds)
+		result = BoundingBox::Intersection(result, b);
+	return result;
+}
+
+// only outside of the input's box: there the bound is a positive lower bound of the input, it becomes the maximum and the result stays
+// outside and conservative. Inside the box the bound is 0, which would turn every point inside the other inputs into a surface point
+std::ostream& Intersection::GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound)
+{
+	return code << "_realValue_(" << bound << ") > 0.0 && _realValue_(" << bound << ") > _realValue_(" << accumulated << ")";
+}
+
+// outside of the input's box -input <= -bound < accumulated, the substracted input can't become the maximum. Inside it the bound is 0 and
+// the guard only holds where accumulated > 0: the point is outside of what the input is substracted from, the result is at least
+// accumulated, so max(accumulated, -0) keeps the sign and doesn't overestimate the distance
+std::ostream& Substraction::GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound)
+{
+	return code << "_realValue_(" << bound << ") > -_realValue_(" << accumulated << ")";
+}
+
+// the substracted inputs are negated: outside of the result the maximum may be one of them, which is then inside of itself
+float Substraction::CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior)
+{
+	return std::max(exterior.front(), Largest(interior, 1));
+}
+
+float Substraction::CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior)
+{
+	return std::max(interior.front(), Largest(exterior, 1));
+}
+
+// smin subtracts at most k/6, the surface can grow by that much
+BoundingBox SmoothUnion::CombineBounds(const std::vector<BoundingBox>& inputBounds)
+{
+	return Operator::CombineBounds(inputBounds).Expanded(k / 6);
+}
+
+// farther than k from the other input, the blending term is zero
+std::ostream& SmoothUnion::GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound)
+{
+	return code << "_realValue_(" << bound << ") > _realValue_(" << accumulated << ") + " << k;
+}
+
+// inside, the blend may mix in the gradient of an input that is still outside
+float SmoothUnion::CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior)
+{
+	return std::max(Largest(exterior), Largest(interior));
+}
+
+// the blending term only adds to the maximum
+BoundingBox SmoothIntersection::CombineBounds(const std::vector<BoundingBox>& inputBounds)
+{
+	BoundingBox result = inputBounds.front();
+	for (auto& b : inputBounds)
+		result = BoundingBox::Intersection(result, b);
+	return result;
+}
+
+// like Intersection, farther than k from the other input the blending term is zero
+std::ostream& SmoothIntersection::GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound)
+{
+	return code << "_realValue_(" << bound << ") > 0.0 && _realValue_(" << bound << ") > _realValue_(" << accumulated << ") + " << k;
+}
+
+// the blend is above both inputs, outside it may mix in the gradient of an input that is still inside
+float SmoothIntersection::CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior)
+{
+	return std::max(Largest(exterior), Largest(interior));
+}
+
+// like Substraction: inside the box the guard holds where accumulated > k, where the blend with -0 is accumulated itself
+std::ostream& SmoothSubstraction::GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound)
+{
+	return code << "_realValue_(" << bound << ") > " << k << " - _realValue_(" << accumulated << ")";
+}
+
+// like SmoothIntersection of the first input and the negated others
+float SmoothSubstraction::CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior)
+{
+	return std::max(Largest(exterior), Largest(interior));
+}
+
+// inside, every input is on its own side like at Substraction
+float SmoothSubstraction::CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior)
+{
+	return std::max(interior.front(), Largest(exterior, 1));
+}
@@ -2,30 +2,67 @@
 #include <string>
 #include <vector>
 #include <json.hpp>
-#include "utils.h"
+#include "core_utils.h"
+#include "BoundingBox.h"
 
 using namespace nlohmann;
 
 #define OPERATORS Union, Intersection, Substraction, SmoothUnion, SmoothIntersection, SmoothSubstraction
 
+class OperatorVisitor;
+
 class Operator
 {
 public:
-	virtual bool NodeEditorDraw() { return false; };
-	virtual bool NodeEditorPopup() { return false; };
+	/// <summary>
+	/// Calls the visitor's overload for the concrete type (see Primitive::Accept).
+	/// </summary>
+	virtual void Accept(OperatorVisitor& visitor) = 0;
 
 	virtual void SaveToJson(ordered_json& json) {};
 	virtual std::unique_ptr<Operator> clone() = 0;
 	virtual std::string GetName() = 0;
 
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) = 0;
+
+	/// <summary>
+	/// Conservative bounds of the operator's output from the bounds of its inputs (all in the operator's coordinate system). Default: union of the inputs.
+	/// </summary>
+	virtual BoundingBox CombineBounds(const std::vector<BoundingBox>& inputBounds);
+
+	/// <summary>
+	/// Upper bound of the gradient's length of the operator's output outside of it, from the bounds of its inputs outside (exterior) and
+	/// inside (interior) of them (see Primitive::GetLipschitzBound). Default: the largest exterior bound, which holds where the output
+	/// is positive only if the inputs its gradient mixes are (min, max and the smooth union, which is below both inputs).
+	/// </summary>
+	virtual float CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior);
+
+	/// <summary>
+	/// The same inside of the output. Default: the largest interior bound, for min, max and the smooth intersection.
+	/// </summary>
+	virtual float CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior);
+
+	/// <summary>
+	/// Bounding volume guards: whether an input may be skipped (and its value replaced by the distance to its bounding box)
+	/// when GenerateGuardCondition evaluates to true.
+	/// </summary>
+	virtual bool SupportsGuards() { return false; }
+
+	/// <summary>
+	/// Writes a boolean expression that is true if an input with the given bound distance can't change the result of the operator
+	/// (or replacing it with the bound only makes the result more conservative). The accumulated value is the operator applied to the previous inputs.
+	/// </summary>
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& /*accumulated*/, const std::string& /*bound*/) { return code << "false"; }
 };
 
 class Union : public Operator {
 public:
+	virtual void Accept(OperatorVisitor& visitor) override;
 	virtual std::string GetName() override { return "union"; }
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 	virtual std::unique_ptr<Operator> clone() override { return std::make_unique<Union>(*this); };
+	virtual bool SupportsGuards() override { return true; }
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound) override;
 
 	Union() {}
 	Union(ordered_json& json) {}
@@ -33,9 +70,13 @@ public:
 
 class Intersection : public Operator {
 public:
+	virtual void Accept(OperatorVisitor& visitor) override;
 	virtual std::string GetName() override { return "intersect"; }
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 	virtual std::unique_ptr<Operator> clone() override { return std::make_unique<Intersection>(*this); };
+	virtual BoundingBox CombineBounds(const std::vector<BoundingBox>& inputBounds) override;
+	virtual bool SupportsGuards() override { return true; }
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound) override;
 
 	Intersection() {}
 	Intersection(ordered_json& json) {}
@@ -43,9 +84,15 @@ public:
 
 class Substraction : public Operator {
 public:
+	virtual void Accept(OperatorVisitor& visitor) override;
 	virtual std::string GetName() override { return "substract"; }
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 	virtual std::unique_ptr<Operator> clone() override { return std::make_unique<Substraction>(*this); };
+	virtual BoundingBox CombineBounds(const std::vector<BoundingBox>& inputBounds) override { return inputBounds.front(); }
+	virtual float CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior) override;
+	virtual float CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior) override;
+	virtual bool SupportsGuards() override { return true; }
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound) override;
 
 	Substraction() {}
 	Substraction(ordered_json& json) {}
@@ -53,21 +100,25 @@ public:
 
 class SmoothOperator : public Operator {
 public:
-	virtual bool NodeEditorDraw() { return ImGui::InputFloat("k", &k); };
 	virtual void SaveToJson(ordered_json& json) override { json["k"] = k; };
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 
 	SmoothOperator() {}
 	SmoothOperator(ordered_json& json) { json.at("k").get_to<float>(k); }
-protected:
+
 	float k = 0.3f;
 };
 
 class SmoothUnion : public SmoothOperator {
 public:
+	virtual void Accept(OperatorVisitor& visitor) override;
 	virtual std::string GetName() override { return "smooth union"; }
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 	virtual std::unique_ptr<Operator> clone() override { return std::make_unique<SmoothUnion>(*this); };
+	virtual BoundingBox CombineBounds(const std::vector<BoundingBox>& inputBounds) override;
+	virtual float CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior) override;
+	virtual bool SupportsGuards() override { return true; }
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound) override;
 
 	SmoothUnion() {}
 	SmoothUnion(ordered_json& json) : SmoothOperator(json) {}
@@ -75,9 +126,14 @@ public:
 
 class SmoothIntersection : public SmoothOperator {
 public:
+	virtual void Accept(OperatorVisitor& visitor) override;
 	virtual std::string GetName() override { return "smooth intersect"; }
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 	virtual std::unique_ptr<Operator> clone() override { return std::make_unique<SmoothIntersection>(*this); };
+	virtual BoundingBox CombineBounds(const std::vector<BoundingBox>& inputBounds) override;
+	virtual float CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior) override;
+	virtual bool SupportsGuards() override { return true; }
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound) override;
 
 	SmoothIntersection() {}
 	SmoothIntersection(ordered_json& json) : SmoothOperator(json) {}
@@ -85,12 +141,29 @@ public:
 
 class SmoothSubstraction : public SmoothOperator {
 public:
+	virtual void Accept(OperatorVisitor& visitor) override;
 	virtual std::string GetName() override { return "smooth substract"; }
 	virtual std::ostream& GenerateShader(std::ostream& code, std::vector<std::string> inputRegisterNames) override;
 	virtual std::unique_ptr<Operator> clone() override { return std::make_unique<SmoothSubstraction>(*this); };
+	virtual BoundingBox CombineBounds(const std::vector<BoundingBox>& inputBounds) override { return inputBounds.front(); }
+	virtual float CombineLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior) override;
+	virtual float CombineInteriorLipschitz(const std::vector<float>& exterior, const std::vector<float>& interior) override;
+	virtual bool SupportsGuards() override { return true; }
+	virtual std::ostream& GenerateGuardCondition(std::ostream& code, const std::string& accumulated, const std::string& bound) override;
 
 	SmoothSubstraction() {}
 	SmoothSubstraction(ordered_json& json) : SmoothOperator(json) {}
 };
 
+class OperatorVisitor
+{
+public:
+	virtual void operator()(Union& op) = 0;
+	virtual void operator()(Intersection& op) = 0;
+	virtual void operator()(Substraction& op) = 0;
+	virtual void operator()(SmoothUnion& op) = 0;
+	virtual void operator()(SmoothIntersection& op) = 0;
+	virtual void operator()(SmoothSubstraction& op) = 0;
+};
+
 using OperatorTypes = utils::TypeList<Operator, OPERATORS>;
\ No newline at end of file
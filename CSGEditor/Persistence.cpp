@@ -9,7 +9,11 @@
 /// <param name="filePath">- file to write to</param>
 void Persistence::SaveToJson(Editor& nodes, std::string filePath)
 {
-	std::string nodesAsJsonStr = NodeJsonSerializer::Serialize(nodes.GetRootNodes());
+	std::vector<std::shared_ptr<Node>> roots;
+	for (auto& handle : nodes.GetRootNodes())
+		roots.push_back(handle.node->node);
+
+	std::string nodesAsJsonStr = NodeJsonSerializer::Serialize(roots);
 	std::cout << "JSON SAVE ("<<filePath<<")\n" << nodesAsJsonStr << "\n ---- \n";
 	try {
 		std::ofstream f(filePath);
@@ -35,9 +39,35 @@ void Persistence::LoadFromJson(Editor& nodes, std::string filePath)
 	std::cout << "\nLOADED: " << filePath << "\n" << content << "\n";
 	f.close();
 
+	LoadFromString(nodes, content);
+}
+
+void Persistence::LoadFromString(Editor& nodes, std::string jsonString)
+{
+	auto roots = NodeJsonSerializer::Deserialize(jsonString);
+
 	nodes.Clear();
 
-	NodeJsonSerializer::DeserializeInto(nodes, content);
+	for (auto& root : roots)
+		AddTree(nodes, root);
 
 	nodes.AutoArrange();
+}
+
+Persistence::NodeHandle Persistence::AddTree(Editor& nodes, std::shared_ptr<Node> root)
+{
+	auto opNode = std::dynamic_pointer_cast<OperatorNode>(root);
+	if (opNode == nullptr)
+		return nodes.AddNode(std::static_pointer_cast<PrimitiveNode>(root));
+
+	// the editor rebuilds the input list from the links, connect the inputs one by one in their original order
+	std::vector<std::shared_ptr<Node>> inputs(opNode->begin(), opNode->end());
+	opNode->ClearInputs();
+
+	auto opNodeHandle = nodes.AddNode(opNode);
+	for (auto& input : inputs) {
+		auto inputHandle = AddTree(nodes, input);
+		nodes.ConnectNodes(inputHandle, opNodeHandle);
+	}
+	return opNodeHandle;
 }
\ No newline at end of file
@@ -28,4 +28,17 @@ public:
 	/// <param name="nodes">- the graph editor</param>
 	/// <param name="fileName">- the file to load the graph from</param>
 	static void LoadFromJson(Editor& nodes, std::string fileName);
+
+	/// <summary>
+	/// Replaces the graph in the passed editor with the one in the json string (same format as the saved files).
+	/// </summary>
+	/// <param name="nodes">- the graph editor</param>
+	/// <param name="jsonString">- the serialized graph</param>
+	static void LoadFromString(Editor& nodes, std::string jsonString);
+
+private:
+	/// <summary>
+	/// Adds the tree under root to the editor, creating the gui nodes and links for the inputs of the operators.
+	/// </summary>
+	static NodeHandle AddTree(Editor& nodes, std::shared_ptr<Node> root);
 };
@@ -0,0 +1,54 @@
+#include "PointCloudWriter.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	// wide enough for any count, padded with spaces which PLY readers skip
+	constexpr int countWidth = 20;
+}
+
+PointCloudWriter::PointCloudWriter(const std::string& fileName) : fileName(fileName), file(fileName, std::ios::binary)
+{
+	if (!file.is_open())
+		throw std::runtime_error("Can't write " + fileName);
+	file << "ply\nformat binary_little_endian 1.0\nelement vertex ";
+	countPosition = file.tellp();
+	file << std::string(countWidth, ' ') << "\n"
+		<< "property float x\nproperty float y\nproperty float z\n"
+		<< "property float nx\nproperty float ny\nproperty float nz\n"
+		<< "end_header\n";
+}
+
+PointCloudWriter::~PointCloudWriter()
+{
+	try {
+		Close();
+	}
+	catch (...) {
+	}
+}
+
+void PointCloudWriter::Append(const SurfaceSample* samples, size_t n)
+{
+	// SurfaceSample is exactly the 6 floats of a vertex
+	static_assert(sizeof(SurfaceSample) == 6 * sizeof(float), "unexpected padding");
+	file.write(reinterpret_cast<const char*>(samples), n * sizeof(SurfaceSample)); // all supported platforms are little endian
+	if (!file)
+		throw std::runtime_error("Failed to write " + fileName);
+	count += n;
+}
+
+void PointCloudWriter::Close()
+{
+	if (!file.is_open())
+		return;
+	char text[countWidth + 1];
+	std::snprintf(text, sizeof(text), "%-*zu", countWidth, count);
+	file.seekp(countPosition);
+	file.write(text, countWidth);
+	file.close();
+	if (!file)
+		throw std::runtime_error("Failed to write " + fileName);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "SurfaceSampler.h"
+#include <fstream>
+#include <string>
+
+/// <summary>
+/// Writes points with normals to a binary little endian PLY file while they are produced (eg.: as the sink of SurfaceSampler),
+/// so the point cloud never has to fit in memory. The header reserves room for the vertex count, which Close fills in.
+/// Throws std::runtime_error if the file can't be written.
+/// </summary>
+class PointCloudWriter
+{
+public:
+	explicit PointCloudWriter(const std::string& fileName);
+	~PointCloudWriter();
+
+	void Append(const SurfaceSample* samples, size_t count);
+
+	/// <summary>
+	/// Writes the final vertex count and closes the file. Called by the destructor if needed (errors are lost there).
+	/// </summary>
+	void Close();
+
+	size_t Count() const { return count; }
+
+private:
+	std::string fileName;
+	std::ofstream file;
+	std::streampos countPosition;
+	size_t count = 0;
+};
@@ -0,0 +1,82 @@
+#include "PointQuery.h"
+#include "SdfSource.h"
+
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	void CheckOutput(QueryMask mask, const PointQueryOutput& output) {
+		bool missing = ((mask & QueryValue) && !output.value)
+			|| ((mask & QueryGradient) && (!output.gradient[0] || !output.gradient[1] || !output.gradient[2]))
+			|| ((mask & QueryHessian) && (!output.hessian[0] || !output.hessian[1] || !output.hessian[2]
+				|| !output.hessian[3] || !output.hessian[4] || !output.hessian[5]));
+		if (missing)
+			throw std::invalid_argument("PointQuery: an array of a requested result is missing.");
+	}
+
+	// scatters the parts of the dual numbers into the arrays of the output, offset is the index of the first point
+	template<int Order>
+	void Scatter(const Dual<Order>* parts, size_t offset, size_t count, QueryMask mask, const PointQueryOutput& output) {
+		using D = Dual<Order>;
+		for (size_t i = 0; i < count; ++i) {
+			const D& p = parts[i];
+			if (mask & QueryValue)
+				output.value[offset + i] = p.d[0];
+			if (mask & QueryGradient) {
+				output.gradient[0][offset + i] = p.d[D::Idx(1, 0, 0)];
+				output.gradient[1][offset + i] = p.d[D::Idx(0, 1, 0)];
+				output.gradient[2][offset + i] = p.d[D::Idx(0, 0, 1)];
+			}
+			if constexpr (Order >= 2) {
+				output.hessian[0][offset + i] = p.d[D::Idx(2, 0, 0)];
+				output.hessian[1][offset + i] = p.d[D::Idx(1, 1, 0)];
+				output.hessian[2][offset + i] = p.d[D::Idx(1, 0, 1)];
+				output.hessian[3][offset + i] = p.d[D::Idx(0, 2, 0)];
+				output.hessian[4][offset + i] = p.d[D::Idx(0, 1, 1)];
+				output.hessian[5][offset + i] = p.d[D::Idx(0, 0, 2)];
+			}
+		}
+	}
+
+	template<int Order, typename Source>
+	void EvaluateDerivatives(const Source& source, const float* x, const float* y, const float* z, size_t count,
+		QueryMask mask, const PointQueryOutput& output, ThreadPool& pool)
+	{
+		pool.ParallelFor(count, PointQuery::chunkSize, [&](size_t begin, size_t end) {
+			thread_local std::vector<Dual<Order>> parts(PointQuery::chunkSize);
+			source.template EvaluateDerivatives<Order>(x + begin, y + begin, z + begin, parts.data(), end - begin);
+			Scatter<Order>(parts.data(), begin, end - begin, mask, output);
+		});
+	}
+
+	template<typename Source>
+	void Run(const Source& source, const float* x, const float* y, const float* z, size_t count,
+		QueryMask mask, const PointQueryOutput& output, ThreadPool& pool)
+	{
+		CheckOutput(mask, output);
+		if (mask & QueryHessian) {
+			EvaluateDerivatives<2>(source, x, y, z, count, mask, output, pool);
+		}
+		else if (mask & QueryGradient) {
+			EvaluateDerivatives<1>(source, x, y, z, count, mask, output, pool);
+		}
+		else if (mask & QueryValue) {
+			// straight into the output
+			pool.ParallelFor(count, PointQuery::chunkSize * 16, [&](size_t begin, size_t end) {
+				source.Evaluate(x + begin, y + begin, z + begin, output.value + begin, end - begin);
+			});
+		}
+	}
+}
+
+void PointQuery::Evaluate(const Tape& tape, const float* x, const float* y, const float* z, size_t count,
+	QueryMask mask, const PointQueryOutput& output, ThreadPool& pool)
+{
+	Run(SdfSourceTape{ tape }, x, y, z, count, mask, output, pool);
+}
+
+void PointQuery::Evaluate(const JitSdf& jit, const float* x, const float* y, const float* z, size_t count,
+	QueryMask mask, const PointQueryOutput& output, ThreadPool& pool)
+{
+	Run(SdfSourceJit{ jit }, x, y, z, count, mask, output, pool);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Tape.h"
+#include "JitSdf.h"
+#include "ThreadPool.h"
+#include <cstdint>
+
+/// <summary>
+/// Which results a point query computes, combined with |.
+/// The gradient needs dual numbers of order 1, the Hessian of order 2, so asking only for what is used saves most of the work.
+/// </summary>
+enum QueryMask : uint32_t {
+	QueryValue = 1,
+	QueryGradient = 2,
+	QueryHessian = 4
+};
+
+inline QueryMask operator|(QueryMask a, QueryMask b) { return QueryMask(uint32_t(a) | uint32_t(b)); }
+
+/// <summary>
+/// Caller owned result arrays of a point query, one float per point each (structure of arrays).
+/// Only the arrays of the requested results are written and need to be set.
+/// </summary>
+struct PointQueryOutput {
+	float* value = nullptr;
+	float* gradient[3] = {}; // d/dx, d/dy, d/dz
+	float* hessian[6] = {}; // xx, xy, xz, yy, yz, zz
+};
+
+/// <summary>
+/// Distance, gradient and Hessian of an sdf at large point sets (particles, vertices, sample grids), for code coupling the scenes
+/// into other pipelines. The points are split into chunks across the threads of the pool, each chunk is evaluated with the batch
+/// functions of TapeEvaluator (or the native code of a JitSdf) into per thread scratch memory, so nothing is allocated per point or per call.
+/// The derivatives are exact derivatives of the sdf formulas (dual numbers), not finite differences.
+/// </summary>
+class PointQuery
+{
+public:
+	static constexpr size_t chunkSize = 1024;
+
+	/// <summary>
+	/// Evaluates the requested results at the points (x[i], y[i], z[i]) for i < count.
+	/// Throws std::invalid_argument if an array of a requested result is missing.
+	/// </summary>
+	static void Evaluate(const Tape& tape, const float* x, const float* y, const float* z, size_t count,
+		QueryMask mask, const PointQueryOutput& output, ThreadPool& pool = ThreadPool::Global());
+
+	/// <summary>
+	/// Same with the native code of jit, which falls back to its tape while compiling.
+	/// </summary>
+	static void Evaluate(const JitSdf& jit, const float* x, const float* y, const float* z, size_t count,
+		QueryMask mask, const PointQueryOutput& output, ThreadPool& pool = ThreadPool::Global());
+};
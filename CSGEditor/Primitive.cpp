@@ -1,10 +1,13 @@
 #include "Primitive.h"
-#include "Persistence.h"
+#include "MeshDistance.h"
 
 #include <algorithm>
+#include <limits>
 
-std::vector<std::string> PrimitiveTypes::names;
-bool PrimitiveTypes::nameListGenerated;
+void Sphere::Accept(PrimitiveVisitor& visitor)
+{
+    visitor(*this);
+}
 
 std::ostream& Sphere::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
 {
@@ -18,9 +21,9 @@ std::unique_ptr<Primitive> Sphere::clone()
     return copy;
 }
 
-bool Box::NodeEditorDraw()
+void Box::Accept(PrimitiveVisitor& visitor)
 {
-    return utils::InputVec3("dimensions", dimensions, 2);
+    visitor(*this);
 }
 
 std::ostream& Box::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
@@ -45,11 +48,9 @@ Box::Box(ordered_json& json)
     json.at("dimensions").get_to(dimensions);
 }
 
-bool Cylinder::NodeEditorDraw()
+void Cylinder::Accept(PrimitiveVisitor& visitor)
 {
-    return
-        ImGui::InputFloat("radius", &radius) ||
-        ImGui::InputFloat("height", &height);
+    visitor(*this);
 }
 
 std::ostream& Cylinder::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
@@ -76,11 +77,9 @@ Cylinder::Cylinder(ordered_json& json)
     json.at("height").get_to(height);
 }
 
-bool Torus::NodeEditorDraw()
+void Torus::Accept(PrimitiveVisitor& visitor)
 {
-    return
-        ImGui::InputFloat("major radius", &major_radius) ||
-        ImGui::InputFloat("minor radius", &minor_radius);
+    visitor(*this);
 }
 
 std::ostream& Torus::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
@@ -107,9 +106,9 @@ Torus::Torus(ordered_json& json)
     json.at("minor_radius").get_to(minor_radius);
 }
 
-bool Ellipsoid::NodeEditorDraw()
+void Ellipsoid::Accept(PrimitiveVisitor& visitor)
 {
-    return utils::InputVec3("radii", radii, 2);
+    visitor(*this);
 }
 
 std::ostream& Ellipsoid::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
@@ -122,6 +121,22 @@ void Ellipsoid::SaveToJson(ordered_json& json)
     json["radii"] = radii;
 }
 
+// The bound formula overestimates the distance next to the flat sides. Numerically the gradient outside stays below 1/3 of the squared ratio
+// of the longest and the shortest radius (and approaches it for flat ellipsoids), half of the squared ratio leaves a margin.
+float Ellipsoid::GetLipschitzBound()
+{
+    float ratio = std::max(radii.x, std::max(radii.y, radii.z)) / std::min(radii.x, std::min(radii.y, radii.z));
+    return std::max(1.0f, ratio * ratio / 2);
+}
+
+// the value jumps between the directions at the center, unless it is a sphere
+float Ellipsoid::GetInteriorLipschitzBound()
+{
+    if (radii.x == radii.y && radii.y == radii.z)
+        return 1.0f;
+    return std::numeric_limits<float>::infinity();
+}
+
 std::unique_ptr<Primitive> Ellipsoid::clone()
 {
     auto copy = std::make_unique<Ellipsoid>();
@@ -134,14 +149,9 @@ Ellipsoid::Ellipsoid(ordered_json& json)
     json.at("radii").get_to(radii);
 }
 
-bool Plane::NodeEditorDraw()
+void Plane::Accept(PrimitiveVisitor& visitor)
 {
-    bool changed = false;
-    if (ImGui::InputFloat3("n", &n[0], 3, ImGuiInputTextFlags_EnterReturnsTrue)) {
-        changed = true;
-        n = glm::normalize(n);
-    }
-    return changed || ImGui::InputFloat("h", &h);
+    visitor(*this);
 }
 
 std::ostream& Plane::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
@@ -167,3 +177,71 @@ std::unique_ptr<Primitive> Plane::clone()
     *copy = *this;
     return copy;
 }
+
+void Mesh::Accept(PrimitiveVisitor& visitor)
+{
+    visitor(*this);
+}
+
+// the box of the bake: a lower bound of the distance outside of it. Only used where the bake can't be sampled, the generators sample
+// GetBake() instead
+std::ostream& Mesh::GenerateShader(std::ostream& code, std::string sampleCoordVarName)
+{
+    return code << "cube(" << glm::vec3(GetParameters()) << ", _sub3_(" << sampleCoordVarName << ", _constant3_(" << GetBoundingBox().Center() << ")))";
+}
+
+BoundingBox Mesh::GetBoundingBox()
+{
+    if (!bake)
+        return BoundingBox::FromHalfSize(glm::vec3(0.5f));
+    return BoundingBox(bake->min, bake->min + bake->size);
+}
+
+// the interpolation of the bake, the unit cube is exact
+float Mesh::GetLipschitzBound()
+{
+    return bake ? DistanceBake::lipschitz : 1.0f;
+}
+
+void Mesh::SaveToJson(ordered_json& json)
+{
+    json["file"] = file;
+    json["resolution"] = resolution;
+}
+
+std::unique_ptr<Primitive> Mesh::clone()
+{
+    auto copy = std::make_unique<Mesh>();
+    *copy = *this; // the bake is shared
+    return copy;
+}
+
+Mesh::Mesh(ordered_json& json)
+{
+    json.at("file").get_to(file);
+    json.at("resolution").get_to(resolution);
+    Load();
+}
+
+void Mesh::Load()
+{
+    std::shared_ptr<const DistanceBake> loaded;
+    std::string message;
+    if (!file.empty()) {
+        try {
+            loaded = MeshDistance::Load(file, resolution, bandVoxels);
+        }
+        catch (std::exception& e) {
+            message = e.what();
+        }
+    }
+    SetLoaded(std::move(loaded), std::move(message));
+}
+
+void Mesh::SetLoaded(std::shared_ptr<const DistanceBake> bake, std::string error)
+{
+    this->bake = std::move(bake);
+    this->error = std::move(error);
+    loadedFile = file;
+    loadedResolution = resolution;
+}
@@ -1,31 +1,69 @@
 #pragma once
 #include <string>
 #include <iostream>
+#include <memory>
 #include <glm/glm.hpp>
 #include <json.hpp>
-#include "utils.h"
+#include "core_utils.h"
+#include "BoundingBox.h"
 
 using namespace nlohmann;
 
-#define PRIMITIVES Sphere, Box, Cylinder, Torus, Ellipsoid, Plane
+#define PRIMITIVES Sphere, Box, Cylinder, Torus, Ellipsoid, Plane, Mesh
+
+class PrimitiveVisitor;
+struct DistanceBake;
 
 class Primitive
 {
 public:
-	virtual bool NodeEditorDraw() { return false; };
-	virtual bool NodeEditorPopup() { return false; };
+	/// <summary>
+	/// Calls the visitor's overload for the concrete type. Lets editor-side code (parameter widgets) and evaluators handle each primitive
+	/// without the primitives knowing about them.
+	/// </summary>
+	virtual void Accept(PrimitiveVisitor& visitor) = 0;
 
 	virtual void SaveToJson(ordered_json& json) {};
 	virtual std::unique_ptr<Primitive> clone() = 0;
 	virtual std::string GetName() = 0;
 
 	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) = 0;
+
+	/// <summary>
+	/// Conservative bounds of the primitive in its own (untransformed) coordinate system. Used for the bounding volume guards of the generated sdf.
+	/// </summary>
+	virtual BoundingBox GetBoundingBox() { return BoundingBox::Infinite(); }
+
+	/// <summary>
+	/// Upper bound of the gradient's length of the primitive's formula outside of it, ie.: how many times the value can overestimate the distance
+	/// to the surface. Exact distance functions return 1. Used by the sphere tracers for safe step sizes (see LipschitzCalculatorVisitor).
+	/// </summary>
+	virtual float GetLipschitzBound() { return 1.0f; }
+
+	/// <summary>
+	/// The same inside of the primitive, where a substraction turns it into the outside of the result (see Operator::CombineLipschitz).
+	/// Exact distance functions return 1, infinity if the gradient is unbounded.
+	/// </summary>
+	virtual float GetInteriorLipschitzBound() { return 1.0f; }
+
+	/// <summary>
+	/// The parameters of the primitive packed into a vec4, in the order of the arguments of its shader function. Used by the data-driven sdf (see PrimitiveBVH).
+	/// </summary>
+	virtual glm::vec4 GetParameters() { return glm::vec4(0); }
+
+	/// <summary>
+	/// Distances sampled on a grid that replace the formula of the primitive, in its own coordinate system (see Mesh). nullptr for the
+	/// analytic primitives.
+	/// </summary>
+	virtual std::shared_ptr<const DistanceBake> GetBake() { return nullptr; }
 };
 
 class Sphere : public Primitive {
 public:
 	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
 	virtual std::string GetName() override { return "sphere"; }
+	virtual BoundingBox GetBoundingBox() override { return BoundingBox::FromHalfSize(glm::vec3(0.5f)); }
 
 	virtual std::unique_ptr<Primitive> clone() override;
 
@@ -35,77 +73,149 @@ public:
 
 class Box : public Primitive {
 public:
-	virtual bool NodeEditorDraw() override;
-
 	virtual std::ostream& GenerateShader(std::ostream&  code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
 	virtual std::string GetName() override { return "box"; }
+	virtual BoundingBox GetBoundingBox() override { return BoundingBox::FromHalfSize(dimensions * 0.5f); }
+	virtual glm::vec4 GetParameters() override { return glm::vec4(dimensions * 0.5f, 0); }
 	virtual void SaveToJson(ordered_json& json) override;
 	virtual std::unique_ptr<Primitive> clone() override;
 
 	Box() : dimensions(1.0f,1.0f,1.0f) {}
 	Box(ordered_json& json);
-private:
+
 	glm::vec3 dimensions;
 };
 
 class Cylinder : public Primitive {
 public:
-	virtual bool NodeEditorDraw() override;
-
 	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
 	virtual std::string GetName() override { return "cylinder"; }
+	virtual BoundingBox GetBoundingBox() override { return BoundingBox::FromHalfSize(glm::vec3(radius, height * 0.5f, radius)); }
+	virtual glm::vec4 GetParameters() override { return glm::vec4(radius, height, 0, 0); }
 	virtual void SaveToJson(ordered_json& json) override;
 	virtual std::unique_ptr<Primitive> clone() override;
 
 	Cylinder() : height(1.0f), radius(0.5f) {}
 	Cylinder(ordered_json& json);
-private:
+
 	float radius;
 	float height;
 };
 
 class Torus : public Primitive {
 public:
-	virtual bool NodeEditorDraw() override;
 	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
 	virtual std::string GetName() override { return "torus"; }
+	virtual BoundingBox GetBoundingBox() override { return BoundingBox::FromHalfSize(glm::vec3(major_radius + minor_radius, minor_radius, major_radius + minor_radius)); }
+	virtual glm::vec4 GetParameters() override { return glm::vec4(major_radius, minor_radius, 0, 0); }
 	virtual void SaveToJson(ordered_json& json) override;
 	virtual std::unique_ptr<Primitive> clone() override;
 
 	Torus() : major_radius(0.4f), minor_radius(0.1f)  {}
 	Torus(ordered_json& json);
-private:
+
 	float major_radius;
 	float minor_radius;
 };
 
 class Ellipsoid : public Primitive {
 public:
-	virtual bool NodeEditorDraw() override;
 	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
 	virtual std::string GetName() override { return "ellipsoid"; }
+	virtual BoundingBox GetBoundingBox() override { return BoundingBox::FromHalfSize(radii); }
+	virtual glm::vec4 GetParameters() override { return glm::vec4(radii, 0); }
+	virtual float GetLipschitzBound() override;
+	virtual float GetInteriorLipschitzBound() override;
 	virtual void SaveToJson(ordered_json& json) override;
 	virtual std::unique_ptr<Primitive> clone() override;
 
 	Ellipsoid() : radii(0.5f, 0.3f, 0.2f) {}
 	Ellipsoid(ordered_json& json);
-private:
+
 	glm::vec3 radii;
 };
 
 class Plane : public Primitive {
 public:
-	virtual bool NodeEditorDraw() override;
 	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
 	virtual std::string GetName() override { return "plane"; }
+	virtual glm::vec4 GetParameters() override { return glm::vec4(n, h); }
+	virtual float GetLipschitzBound() override { return glm::length(n); } // the normal isn't normalized by the formula
+	virtual float GetInteriorLipschitzBound() override { return glm::length(n); }
 	virtual void SaveToJson(ordered_json& json) override;
 	virtual std::unique_ptr<Primitive> clone() override;
 
 	Plane() : n(0.0f,1.0f,0.0f), h(0.0f) {}
 	Plane(ordered_json& json);
-private:
+
 	glm::vec3 n;
 	float h;
 };
 
+/// <summary>
+/// A triangle mesh read from a model file (see TriangleMesh::Read) and baked into a signed distance grid (see MeshDistance). SDFGenerator
+/// samples the bake from a 3D texture and the tape samples it on the CPU, so the mesh can be combined with the other primitives.
+/// The differentiated sdf samples the same texture with dual numbers, the data-driven sdf (PrimitiveBVH) uses the box of the bake instead. Until a file is loaded, the mesh is the
+/// unit cube everywhere.
+/// </summary>
+class Mesh : public Primitive {
+public:
+	static constexpr float bandVoxels = 3;
+
+	virtual std::ostream& GenerateShader(std::ostream& code, std::string sampleCoordVarName) override;
+	virtual void Accept(PrimitiveVisitor& visitor) override;
+	virtual std::string GetName() override { return "mesh"; }
+	virtual BoundingBox GetBoundingBox() override;
+	virtual float GetLipschitzBound() override;
+	virtual float GetInteriorLipschitzBound() override { return GetLipschitzBound(); }
+	virtual glm::vec4 GetParameters() override { return glm::vec4(0.5f * (GetBoundingBox().max - GetBoundingBox().min), 0); }
+	virtual std::shared_ptr<const DistanceBake> GetBake() override { return bake; }
+	virtual void SaveToJson(ordered_json& json) override;
+	virtual std::unique_ptr<Primitive> clone() override;
+
+	Mesh() {}
+	Mesh(ordered_json& json);
+
+	/// <summary>
+	/// Reads and bakes file on this thread (see MeshDistance::Load). If that fails, the mesh is the unit cube and error tells why.
+	/// </summary>
+	void Load();
+
+	/// <summary>
+	/// True if bake and error belong to the current file and resolution. The editor changes them in place and loads them with a MeshLoader.
+	/// </summary>
+	bool IsLoaded() const { return file.empty() || (file == loadedFile && resolution == loadedResolution); }
+
+	/// <summary>
+	/// Sets the result of loading the current file and resolution.
+	/// </summary>
+	void SetLoaded(std::shared_ptr<const DistanceBake> bake, std::string error);
+
+	std::string file;
+	int resolution = 64; // voxels along the longest side of the bake
+	std::shared_ptr<const DistanceBake> bake;
+	std::string error; // of the last load
+
+private:
+	std::string loadedFile; // the file and resolution of bake
+	int loadedResolution = 0;
+};
+
+class PrimitiveVisitor
+{
+public:
+	virtual void operator()(Sphere& sphere) = 0;
+	virtual void operator()(Box& box) = 0;
+	virtual void operator()(Cylinder& cylinder) = 0;
+	virtual void operator()(Torus& torus) = 0;
+	virtual void operator()(Ellipsoid& ellipsoid) = 0;
+	virtual void operator()(Plane& plane) = 0;
+	virtual void operator()(Mesh& mesh) = 0;
+};
+
 using PrimitiveTypes = utils::TypeList<Primitive, PRIMITIVES>;
\ No newline at end of file
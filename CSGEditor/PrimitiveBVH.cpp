@@ -0,0 +1,132 @@
+#include "PrimitiveBVH.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <glm/gtx/transform.hpp>
+
+void PrimitiveBVH::operator()(std::shared_ptr<OperatorNode> opnode)
+{
+	if (opnode->InputCount() < 1)
+		throw shader_gen_exception(shader_gen_exception::REASON::OPERATOR_HAS_NO_INPUTS, opnode);
+	if (dynamic_cast<Union*>(opnode->operatorDescription.get()) == nullptr) // only min() can be evaluated in any order
+		throw shader_gen_exception(shader_gen_exception::REASON::OPERATOR_NOT_SUPPORTED_BY_BVH, opnode);
+
+	glm::mat4 transformMatrix =
+		transformStack.top() *
+		glm::translate(opnode->translate) *
+		glm::rotate(opnode->rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(opnode->rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(opnode->rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0)) *
+		glm::scale(glm::vec3(opnode->scale));
+
+	// min(a, b) * s - r = min(a * s - r, b * s - r): the offsets and scales of the unions can be moved to the primitives
+	transformStack.push(transformMatrix);
+	offsetStack.push(offsetStack.top() + opnode->radius * scaleStack.top());
+	scaleStack.push(scaleStack.top() * opnode->scale);
+
+	for (auto input : *opnode) {
+		input->visit(this);
+	}
+
+	transformStack.pop();
+	offsetStack.pop();
+	scaleStack.pop();
+}
+
+void PrimitiveBVH::operator()(std::shared_ptr<PrimitiveNode> primnode)
+{
+	if (dynamic_cast<Mesh*>(primnode->primitive.get()) != nullptr) // bvh_sdf.frag has no samplers
+		throw shader_gen_exception(shader_gen_exception::REASON::PRIMITIVE_NOT_SUPPORTED_BY_BVH, primnode);
+
+	glm::mat4 transform = transformStack.top() * glm::translate(primnode->translate) *
+		glm::rotate(primnode->rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(primnode->rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(primnode->rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0));
+
+	GpuPrimitive prim;
+	prim.invTransform = glm::scale(glm::vec3(1 / primnode->scale)) * glm::inverse(transform);
+	prim.params = primnode->primitive->GetParameters();
+	prim.worldScale = scaleStack.top() * primnode->scale;
+	prim.radius = primnode->radius;
+	prim.offset = offsetStack.top();
+	prim.type = (int)PrimitiveTypes::GetTypeIdx(primnode->primitive->GetName());
+	primitives.push_back(prim);
+
+	primitiveBounds.push_back(primnode->primitive->GetBoundingBox()
+		.Expanded(primnode->radius)
+		.Transformed(transform * glm::scale(glm::vec3(primnode->scale)))
+		.Expanded(prim.offset));
+}
+
+void PrimitiveBVH::Build(std::shared_ptr<Node> root)
+{
+	primitives.clear();
+	primitiveBounds.clear();
+	nodes.clear();
+	transformStack = {};
+	scaleStack = {};
+	offsetStack = {};
+	transformStack.push(glm::identity<glm::mat4>());
+	scaleStack.push(1.0f);
+	offsetStack.push(0.0f);
+
+	root->visit(this);
+
+	std::vector<int> unbounded, bounded;
+	for (size_t i = 0; i < primitives.size(); ++i) {
+		if (primitiveBounds[i].IsInfinite())
+			unbounded.push_back((int)i);
+		else
+			bounded.push_back((int)i);
+	}
+	unboundedCount = (int)unbounded.size();
+
+	if (!bounded.empty()) {
+		nodes.emplace_back();
+		BuildNode(bounded, 0, (int)bounded.size(), 0);
+	}
+
+	// reorder the primitives so that every leaf references a continuous range
+	std::vector<GpuPrimitive> ordered;
+	std::vector<BoundingBox> orderedBounds;
+	ordered.reserve(primitives.size());
+	for (auto list : { &unbounded, &bounded }) {
+		for (int i : *list) {
+			ordered.push_back(primitives[i]);
+			orderedBounds.push_back(primitiveBounds[i]);
+		}
+	}
+	primitives = std::move(ordered);
+	primitiveBounds = std::move(orderedBounds);
+}
+
+void PrimitiveBVH::BuildNode(std::vector<int>& order, int first, int count, int nodeIdx)
+{
+	BoundingBox box = primitiveBounds[order[first]];
+	BoundingBox centroids(box.Center(), box.Center());
+	for (int i = first; i < first + count; ++i) {
+		box = BoundingBox::Union(box, primitiveBounds[order[i]]);
+		glm::vec3 c = primitiveBounds[order[i]].Center();
+		centroids = BoundingBox::Union(centroids, BoundingBox(c, c));
+	}
+
+	if (count <= maxLeafSize) {
+		// neighbouring threads are likely to evaluate the same leaf, evaluating one primitive type after the other reduces divergence
+		std::sort(order.begin() + first, order.begin() + first + count, [&](int a, int b) { return primitives[a].type < primitives[b].type; });
+		nodes[nodeIdx] = { box.min, unboundedCount + first, box.max, count };
+		return;
+	}
+
+	glm::vec3 extent = centroids.max - centroids.min;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	int half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+		[&](int a, int b) { return primitiveBounds[a].Center()[axis] < primitiveBounds[b].Center()[axis]; });
+
+	// children are stored next to each other
+	int left = (int)nodes.size();
+	nodes[nodeIdx] = { box.min, left, box.max, 0 };
+	nodes.resize(nodes.size() + 2);
+	BuildNode(order, first, half, left);
+	BuildNode(order, first + half, count - half, left + 1);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "NodeVisitor.h"
+#include "BoundingBox.h"
+#include <glm/glm.hpp>
+#include <stack>
+#include <vector>
+
+/// <summary>
+/// Data-driven alternative of the generated sdf for huge unions. The leaf primitives of a graph containing only (nested) unions are flattened into an array
+/// (world to primitive transform + parameters), and a bounding volume hierarchy is built over their world space bounds on the CPU.
+/// Both are uploaded by BvhBuffers into shader storage buffers read by Shaders/bvh_sdf.frag, so the size of the scene only affects the buffers, not the shader.
+/// </summary>
+class PrimitiveBVH : public NodeVisitor
+{
+public:
+	/// <summary>
+	/// Layout of a primitive in the shader storage buffer (std430, see Shaders/bvh_sdf.frag)
+	/// </summary>
+	struct GpuPrimitive {
+		glm::mat4 invTransform; // world -> primitive space, including the primitive's scale
+		glm::vec4 params; // see Primitive::GetParameters
+		float worldScale; // converts the primitive's distance to world units
+		float radius; // the primitive's own offset, in primitive space
+		float offset; // the summed offsets of the ancestor unions, in world units
+		int type; // index in PrimitiveTypes
+	};
+
+	/// <summary>
+	/// Layout of a bvh node in the shader storage buffer. Leaves have count > 0 and reference the primitives [leftFirst, leftFirst + count),
+	/// inner nodes have their children at leftFirst and leftFirst + 1.
+	/// </summary>
+	struct GpuNode {
+		glm::vec3 min;
+		int leftFirst;
+		glm::vec3 max;
+		int count;
+	};
+
+	static constexpr int maxLeafSize = 4;
+
+	void operator()(std::shared_ptr<OperatorNode> opnode) override;
+	void operator()(std::shared_ptr<PrimitiveNode> primnode) override;
+
+	/// <summary>
+	/// Collects the primitives of the graph and builds the hierarchy. Throws shader_gen_exception if the graph contains anything but unions.
+	/// </summary>
+	void Build(std::shared_ptr<Node> root);
+
+	size_t PrimitiveCount() const { return primitives.size(); }
+	size_t NodeCount() const { return nodes.size(); }
+	int UnboundedCount() const { return unboundedCount; }
+
+	const std::vector<GpuPrimitive>& GetPrimitives() const { return primitives; }
+	const std::vector<GpuNode>& GetNodes() const { return nodes; }
+
+private:
+	std::vector<GpuPrimitive> primitives;
+	std::vector<BoundingBox> primitiveBounds;
+	std::vector<GpuNode> nodes;
+	int unboundedCount = 0; // primitives without finite bounds (eg.: planes) are stored at the beginning of the array and always evaluated
+
+	// traversal state: transform of the current union, product of the scales and sum of the offsets above it
+	std::stack<glm::mat4> transformStack;
+	std::stack<float> scaleStack;
+	std::stack<float> offsetStack;
+
+	/// <summary>
+	/// Recursively splits the primitives [first, first + count) at the median of the largest centroid axis, and fills the (already allocated) node at nodeIdx.
+	/// </summary>
+	void BuildNode(std::vector<int>& order, int first, int count, int nodeIdx);
+};
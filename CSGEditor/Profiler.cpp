@@ -0,0 +1,270 @@
+#include "Profiler.h"
+#include <ImGui/imgui.h>
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+using clock_type = std::chrono::high_resolution_clock;
+
+Profiler::~Profiler()
+{
+	for (auto& [name, section] : gpuSections)
+		glDeleteQueries(ringSize, section.queries.data());
+	for (auto& [name, span] : gpuSpans)
+		for (auto& pair : span.queries)
+			glDeleteQueries(2, pair.data());
+	StopCsv();
+}
+
+void Profiler::History::Push(float v)
+{
+	values[next] = v;
+	next = (next + 1) % historySize;
+	count = std::min(count + 1, historySize);
+	last = v;
+}
+
+float Profiler::History::Average() const
+{
+	if (count == 0)
+		return 0;
+	float sum = 0;
+	for (int i = 0; i < count; ++i)
+		sum += values[i];
+	return sum / count;
+}
+
+float Profiler::History::Max() const
+{
+	float m = 0;
+	for (int i = 0; i < count; ++i)
+		m = std::max(m, values[i]);
+	return m;
+}
+
+void Profiler::NewFrame()
+{
+	auto now = clock_type::now();
+	if (hasLastFrameStart && enabled) {
+		float ms = std::chrono::duration<float, std::milli>(now - lastFrameStart).count();
+		Record(frameTimes, "cpu", "frame", ms);
+	}
+	lastFrameStart = now;
+	hasLastFrameStart = true;
+
+	for (auto& [name, section] : gpuSections)
+		ReadBack(name, section);
+	for (auto& [name, span] : gpuSpans)
+		ReadBack(name, span);
+
+	++frameIndex;
+}
+
+void Profiler::BeginGpu(const std::string& name)
+{
+	if (!enabled)
+		return;
+	assert(activeGpuSection == nullptr); // GL_TIME_ELAPSED queries can't be nested
+
+	auto it = gpuSections.find(name);
+	if (it == gpuSections.end()) {
+		it = gpuSections.emplace(name, GpuSection()).first;
+		glGenQueries(ringSize, it->second.queries.data());
+	}
+
+	auto& section = it->second;
+	// if the result in this slot still hasn't arrived after ringSize frames, it's dropped
+	section.issued[section.write] = false;
+	section.stamps[section.write] = { frameIndex, configTag };
+	glBeginQuery(GL_TIME_ELAPSED, section.queries[section.write]);
+	activeGpuSection = &section;
+}
+
+void Profiler::EndGpu()
+{
+	if (activeGpuSection == nullptr)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	activeGpuSection->issued[activeGpuSection->write] = true;
+	activeGpuSection->write = (activeGpuSection->write + 1) % ringSize;
+	activeGpuSection = nullptr;
+}
+
+void Profiler::BeginGpuSpan(const std::string& name)
+{
+	if (!enabled)
+		return;
+
+	auto it = gpuSpans.find(name);
+	if (it == gpuSpans.end()) {
+		it = gpuSpans.emplace(name, GpuSpan()).first;
+		for (auto& pair : it->second.queries)
+			glGenQueries(2, pair.data());
+	}
+
+	auto& span = it->second;
+	span.issued[span.write] = false;
+	span.stamps[span.write] = { frameIndex, configTag };
+	glQueryCounter(span.queries[span.write][0], GL_TIMESTAMP);
+	span.open = true;
+}
+
+void Profiler::EndGpuSpan(const std::string& name)
+{
+	auto it = gpuSpans.find(name);
+	if (it == gpuSpans.end() || !it->second.open)
+		return;
+
+	auto& span = it->second;
+	glQueryCounter(span.queries[span.write][1], GL_TIMESTAMP);
+	span.issued[span.write] = true;
+	span.write = (span.write + 1) % ringSize;
+	span.open = false;
+}
+
+void Profiler::BeginCpu(const std::string& name)
+{
+	cpuSections[name].start = clock_type::now();
+}
+
+void Profiler::EndCpu(const std::string& name)
+{
+	auto it = cpuSections.find(name);
+	if (it == cpuSections.end())
+		return;
+
+	float ms = std::chrono::duration<float, std::milli>(clock_type::now() - it->second.start).count();
+	Record(it->second.history, "cpu", name, ms);
+}
+
+void Profiler::AddCpuSample(const std::string& name, float milliseconds)
+{
+	Record(cpuSections[name].history, "cpu", name, milliseconds);
+}
+
+void Profiler::ReadBack(const std::string& name, GpuSection& section)
+{
+	// the oldest slot is the one that will be written next
+	for (int i = 0; i < ringSize; ++i) {
+		int slot = (section.write + i) % ringSize;
+		if (!section.issued[slot])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(section.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break; // later slots can't be ready either
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(section.queries[slot], GL_QUERY_RESULT, &ns);
+		section.issued[slot] = false;
+		Record(section.history, "gpu", name, ns / 1e6f, section.stamps[slot]);
+	}
+}
+
+void Profiler::ReadBack(const std::string& name, GpuSpan& span)
+{
+	for (int i = 0; i < ringSize; ++i) {
+		int slot = (span.write + i) % ringSize;
+		if (!span.issued[slot])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(span.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(span.queries[slot][0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(span.queries[slot][1], GL_QUERY_RESULT, &end);
+		span.issued[slot] = false;
+		Record(span.history, "gpu", name, (end - begin) / 1e6f, span.stamps[slot]);
+	}
+}
+
+void Profiler::Record(History& history, const char* kind, const std::string& name, float milliseconds)
+{
+	Record(history, kind, name, milliseconds, { frameIndex, configTag });
+}
+
+void Profiler::Record(History& history, const char* kind, const std::string& name, float milliseconds, const QueryStamp& stamp)
+{
+	history.Push(milliseconds);
+	if (csvFile.is_open()) {
+		csvFile << stamp.frame << ',' << kind << ',' << name << ',' << milliseconds << ",\"" << stamp.configTag << "\"\n";
+	}
+}
+
+bool Profiler::StartCsv(const std::string& fileName)
+{
+	StopCsv();
+	csvFile.open(fileName, std::ofstream::out);
+	if (!csvFile.is_open()) {
+		std::cerr << "Profiler: failed to open " << fileName << " for writing\n";
+		return false;
+	}
+	csvFile << "frame,kind,section,milliseconds,config\n";
+	return true;
+}
+
+void Profiler::StopCsv()
+{
+	if (csvFile.is_open())
+		csvFile.close();
+}
+
+void Profiler::DrawHistory(const std::string& label, const History& history)
+{
+	// the plot starts from the oldest sample
+	int offset = history.count < historySize ? 0 : history.next;
+	std::string overlay = label + ": " + std::to_string(history.last).substr(0, 6) + " ms (avg " + std::to_string(history.Average()).substr(0, 6) + ")";
+	ImGui::PlotLines(("##" + label).c_str(), history.values.data(), history.count, offset, overlay.c_str(), 0.0f, std::max(history.Max() * 1.1f, 0.001f), ImVec2(0, 50));
+}
+
+void Profiler::DrawUI(bool* open)
+{
+	if (!ImGui::Begin("Profiler", open)) {
+		ImGui::End();
+		return;
+	}
+
+	ImGui::Checkbox("Enabled", &enabled);
+	ImGui::SameLine();
+	if (ImGui::Button("Reset")) {
+		for (auto& [name, section] : gpuSections) section.history = History();
+		for (auto& [name, span] : gpuSpans) span.history = History();
+		for (auto& [name, section] : cpuSections) section.history = History();
+		frameTimes = History();
+	}
+
+	ImGui::PushItemWidth(200);
+	ImGui::InputText("csv file", csvPath, sizeof(csvPath));
+	ImGui::PopItemWidth();
+	ImGui::SameLine();
+	if (!csvFile.is_open()) {
+		if (ImGui::Button("Start logging"))
+			StartCsv(csvPath);
+	}
+	else if (ImGui::Button("Stop logging")) {
+		StopCsv();
+	}
+
+	ImGui::PushItemWidth(-1);
+	DrawHistory("frame (cpu)", frameTimes);
+
+	if (ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+		for (auto& [name, section] : gpuSections)
+			DrawHistory(name, section.history);
+		for (auto& [name, span] : gpuSpans)
+			DrawHistory(name, span.history);
+	}
+
+	if (ImGui::CollapsingHeader("CPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+		for (auto& [name, section] : cpuSections)
+			DrawHistory(name, section.history);
+	}
+	ImGui::PopItemWidth();
+
+	ImGui::End();
+}
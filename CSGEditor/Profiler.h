@@ -0,0 +1,124 @@
+#pragma once
+#include <GL/glew.h>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Measures where frame time goes. GPU passes are timed with rings of GL_TIME_ELAPSED queries (read back a few frames later, so the pipeline never stalls),
+/// CPU work is timed with std::chrono. Every section keeps a rolling history for the ImGui panel, and all samples can be streamed to a csv file.
+/// </summary>
+class Profiler
+{
+public:
+	Profiler() = default;
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	/// <summary>
+	/// Records the cpu time since the previous call as the "frame" entry, reads back the gpu queries that finished since then and starts the
+	/// next frame index of the csv rows. Call once at the beginning of every frame.
+	/// </summary>
+	void NewFrame();
+
+	/// <summary>
+	/// Starts timing a gpu pass. GL_TIME_ELAPSED queries can't be nested, so the previous pass has to be ended first.
+	/// </summary>
+	void BeginGpu(const std::string& name);
+	void EndGpu();
+
+	/// <summary>
+	/// Timestamp based gpu span. Unlike BeginGpu/EndGpu it can be open across frames and may contain commands issued by other code (eg.: the ImGui renderer).
+	/// </summary>
+	void BeginGpuSpan(const std::string& name);
+	void EndGpuSpan(const std::string& name);
+
+	void BeginCpu(const std::string& name);
+	void EndCpu(const std::string& name);
+
+	/// <summary>
+	/// Records an already measured cpu duration.
+	/// </summary>
+	void AddCpuSample(const std::string& name, float milliseconds);
+
+	/// <summary>
+	/// Text written to every csv row, used for telling apart the shader variants and display modes the samples were taken with.
+	/// </summary>
+	void SetConfigTag(const std::string& tag) { configTag = tag; }
+
+	bool StartCsv(const std::string& fileName);
+	void StopCsv();
+	bool IsCsvOpen() const { return csvFile.is_open(); }
+
+	void DrawUI(bool* open);
+
+	bool enabled = true;
+
+private:
+	static constexpr int ringSize = 4; // number of frames a gpu query may lag behind before its slot is reused
+	static constexpr int historySize = 240;
+
+	struct History {
+		std::array<float, historySize> values{};
+		int next = 0;
+		int count = 0;
+		float last = 0;
+
+		void Push(float v);
+		float Average() const;
+		float Max() const;
+	};
+
+	// the csv columns of a query, taken when it's issued: its result arrives frames later, maybe after the configuration changed
+	struct QueryStamp {
+		uint64_t frame = 0;
+		std::string configTag;
+	};
+
+	struct GpuSection {
+		std::array<GLuint, ringSize> queries{}; // GL_TIME_ELAPSED queries
+		std::array<bool, ringSize> issued{};
+		std::array<QueryStamp, ringSize> stamps;
+		int write = 0;
+		History history;
+	};
+
+	struct GpuSpan {
+		std::array<std::array<GLuint, 2>, ringSize> queries{}; // GL_TIMESTAMP pairs
+		std::array<bool, ringSize> issued{};
+		std::array<QueryStamp, ringSize> stamps;
+		int write = 0;
+		bool open = false;
+		History history;
+	};
+
+	struct CpuSection {
+		std::chrono::high_resolution_clock::time_point start;
+		History history;
+	};
+
+	std::map<std::string, GpuSection> gpuSections;
+	std::map<std::string, GpuSpan> gpuSpans;
+	std::map<std::string, CpuSection> cpuSections;
+	GpuSection* activeGpuSection = nullptr;
+
+	std::chrono::high_resolution_clock::time_point lastFrameStart;
+	bool hasLastFrameStart = false;
+	History frameTimes;
+
+	uint64_t frameIndex = 0;
+	std::string configTag;
+	std::ofstream csvFile;
+	char csvPath[256] = "profile.csv";
+
+	void Record(History& history, const char* kind, const std::string& name, float milliseconds);
+	void Record(History& history, const char* kind, const std::string& name, float milliseconds, const QueryStamp& stamp);
+	void ReadBack(const std::string& name, GpuSection& section);
+	void ReadBack(const std::string& name, GpuSpan& span);
+	void DrawHistory(const std::string& label, const History& history);
+};
@@ -0,0 +1,88 @@
+#include "ProgressiveFramebuffer.h"
+#include <algorithm>
+
+namespace {
+	const float background[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const float farDepth = 1.0f;
+}
+
+ProgressiveFramebuffer::~ProgressiveFramebuffer()
+{
+	Release();
+}
+
+void ProgressiveFramebuffer::Release()
+{
+	if (_id != 0)
+		glDeleteFramebuffers(1, &_id);
+	if (colorTex != 0)
+		glDeleteTextures(1, &colorTex);
+	if (depthTex != 0)
+		glDeleteTextures(1, &depthTex);
+	_id = colorTex = depthTex = 0;
+}
+
+void ProgressiveFramebuffer::Resize(glm::ivec2 size, int newTileSize)
+{
+	size = glm::max(size, glm::ivec2(1));
+	if (_id != 0 && size == glm::ivec2(_w, _h) && newTileSize == tileSize)
+		return;
+
+	Release();
+	_x = _y = 0;
+	_w = size.x;
+	_h = size.y;
+	tileSize = std::max(newTileSize, 8);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &colorTex);
+	glTextureStorage2D(colorTex, 1, GL_RGBA8, _w, _h);
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthTex);
+	glTextureStorage2D(depthTex, 1, GL_DEPTH_COMPONENT24, _w, _h);
+	for (GLuint tex : { colorTex, depthTex }) {
+		glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	glCreateFramebuffers(1, &_id);
+	glNamedFramebufferTexture(_id, GL_COLOR_ATTACHMENT0, colorTex, 0);
+	glNamedFramebufferTexture(_id, GL_DEPTH_ATTACHMENT, depthTex, 0);
+
+	// nothing has been accumulated yet, start from an empty background
+	glClearNamedFramebufferfv(_id, GL_COLOR, 0, background);
+	glClearNamedFramebufferfv(_id, GL_DEPTH, 0, &farDepth);
+
+	// split the screen into tiles, ordered so the center of the screen is refined first
+	tiles.clear();
+	for (int y = 0; y < _h; y += tileSize) {
+		for (int x = 0; x < _w; x += tileSize) {
+			tiles.push_back({ {x, y}, {std::min(tileSize, _w - x), std::min(tileSize, _h - y)} });
+		}
+	}
+	glm::vec2 center = glm::vec2(_w, _h) * 0.5f;
+	auto distToCenter = [&](const Tile& t) { return glm::length(glm::vec2(t.offset) + glm::vec2(t.size) * 0.5f - center); };
+	std::stable_sort(tiles.begin(), tiles.end(), [&](const Tile& a, const Tile& b) { return distToCenter(a) < distToCenter(b); });
+
+	Restart();
+}
+
+void ProgressiveFramebuffer::Restart()
+{
+	nextTile = 0;
+}
+
+std::vector<ProgressiveFramebuffer::Tile> ProgressiveFramebuffer::NextTiles(int budget)
+{
+	std::vector<Tile> result;
+	while (budget-- > 0 && nextTile < tiles.size()) {
+		result.push_back(tiles[nextTile++]);
+	}
+	return result;
+}
+
+void ProgressiveFramebuffer::BeginTile(const Tile& tile)
+{
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(tile.offset.x, tile.offset.y, tile.size.x, tile.size.y);
+	glClearNamedFramebufferfv(_id, GL_COLOR, 0, background);
+	glClearNamedFramebufferfv(_id, GL_DEPTH, 0, &farDepth);
+}
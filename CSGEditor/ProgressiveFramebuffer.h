@@ -0,0 +1,65 @@
+#pragma once
+#include <Dragonfly/detail/Framebuffer/FramebufferBase.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/// <summary>
+/// Offscreen color + depth target that the sphere tracer fills tile by tile over multiple frames.
+/// Since it derives from df::FramebufferBase, programs can be attached to it the same way as to df::Backbuffer.
+/// The textures keep the last (partially) finished image, so it can be presented every frame while the next one is being accumulated.
+/// </summary>
+class ProgressiveFramebuffer : public df::FramebufferBase
+{
+public:
+	struct Tile {
+		glm::ivec2 offset;
+		glm::ivec2 size;
+	};
+
+	ProgressiveFramebuffer() = default;
+	~ProgressiveFramebuffer();
+
+	ProgressiveFramebuffer(const ProgressiveFramebuffer&) = delete;
+	ProgressiveFramebuffer& operator=(const ProgressiveFramebuffer&) = delete;
+
+	/// <summary>
+	/// (Re)creates the attachments if the size or the tile size changed. Restarts accumulation in that case.
+	/// </summary>
+	void Resize(glm::ivec2 size, int tileSize);
+
+	/// <summary>
+	/// Starts rendering a new image. The previous one stays visible until its tiles are overwritten.
+	/// </summary>
+	void Restart();
+
+	bool IsComplete() const { return nextTile >= tiles.size(); }
+
+	/// <summary>
+	/// Returns the next (at most) budget tiles to render, starting from the center of the screen.
+	/// </summary>
+	std::vector<Tile> NextTiles(int budget);
+
+	/// <summary>
+	/// Restricts rendering to the given tile with the scissor test and clears its region to the background.
+	/// The sphere tracer discards the pixels that miss the surface, so the previous image would show through otherwise.
+	/// </summary>
+	void BeginTile(const Tile& tile);
+
+	/// <summary>
+	/// Fraction of tiles rendered since the last restart.
+	/// </summary>
+	float Progress() const { return tiles.empty() ? 1.0f : nextTile / (float)tiles.size(); }
+
+	GLuint GetColorTexture() const { return colorTex; }
+	GLuint GetDepthTexture() const { return depthTex; }
+
+private:
+	GLuint colorTex = 0;
+	GLuint depthTex = 0;
+	int tileSize = 0;
+
+	std::vector<Tile> tiles;
+	size_t nextTile = 0;
+
+	void Release();
+};
@@ -0,0 +1,146 @@
+#include "RayQuery.h"
+#include "SdfSource.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	// per thread memory of the packets, only grows
+	struct Packet {
+		std::vector<glm::vec3> direction, position;
+		std::vector<float> t, tFar;
+		std::vector<int32_t> steps;
+		std::vector<uint32_t> active, stillActive, hits;
+		std::vector<float> x, y, z, distances;
+		std::vector<Dual<1>> gradients;
+
+		void Resize(size_t n) {
+			direction.resize(n);
+			position.resize(n);
+			t.resize(n);
+			tFar.resize(n);
+			steps.resize(n);
+			x.resize(n);
+			y.resize(n);
+			z.resize(n);
+			distances.resize(n);
+			gradients.resize(n);
+		}
+
+		// copies the positions of the rays into the coordinate arrays
+		void Gather(const std::vector<uint32_t>& rays) {
+			for (size_t j = 0; j < rays.size(); ++j) {
+				x[j] = position[rays[j]].x;
+				y[j] = position[rays[j]].y;
+				z[j] = position[rays[j]].z;
+			}
+		}
+	};
+}
+
+template<typename Source>
+void RayQuery::CastPackets(const Source& source, const float* const origin[3], const float* const direction[3], size_t count,
+	const RayQueryOutput& output, ThreadPool& pool) const
+{
+	if (!output.t)
+		throw std::invalid_argument("RayQuery: output.t is missing.");
+
+	const float inf = std::numeric_limits<float>::infinity();
+	pool.ParallelFor(count, packetSize, [&](size_t begin, size_t end) {
+		thread_local Packet packet;
+		const size_t n = end - begin;
+		packet.Resize(n);
+		packet.active.clear();
+		packet.hits.clear();
+
+		// clip to the bounds
+		for (uint32_t i = 0; i < n; ++i) {
+			glm::vec3 o(origin[0][begin + i], origin[1][begin + i], origin[2][begin + i]);
+			glm::vec3 d = glm::normalize(glm::vec3(direction[0][begin + i], direction[1][begin + i], direction[2][begin + i]));
+			float tNear, tFar;
+			packet.steps[i] = 0;
+			packet.t[i] = inf;
+			if (std::isnan(d.x) || !bounds.IntersectRay(o, 1.0f / d, tNear, tFar)) // NaN for zero directions
+				continue;
+			tNear = std::max(tNear, 0.0f);
+			tFar = std::min(tFar, maxDist);
+			if (tNear > tFar)
+				continue;
+			packet.direction[i] = d;
+			packet.t[i] = tNear;
+			packet.tFar[i] = tFar;
+			packet.position[i] = o + d * tNear;
+			packet.active.push_back(i);
+		}
+
+		// sphere tracing, the rays still marching advance together
+		while (!packet.active.empty()) {
+			packet.Gather(packet.active);
+			source.Evaluate(packet.x.data(), packet.y.data(), packet.z.data(), packet.distances.data(), packet.active.size());
+
+			packet.stillActive.clear();
+			for (size_t j = 0; j < packet.active.size(); ++j) {
+				uint32_t i = packet.active[j];
+				float dist = packet.distances[j];
+				if (dist <= stopDist) {
+					packet.hits.push_back(i);
+					continue;
+				}
+				packet.t[i] += dist;
+				packet.position[i] += packet.direction[i] * dist;
+				++packet.steps[i];
+				if (packet.steps[i] < maxSteps && packet.t[i] <= packet.tFar[i])
+					packet.stillActive.push_back(i);
+				else
+					packet.t[i] = inf; // left the bounds or out of steps
+			}
+			std::swap(packet.active, packet.stillActive);
+		}
+
+		// misses
+		for (uint32_t i = 0; i < n; ++i) {
+			if (output.steps)
+				output.steps[begin + i] = packet.steps[i];
+			output.t[begin + i] = packet.t[i];
+			if (packet.t[i] != inf)
+				continue;
+			for (int axis = 0; axis < 3; ++axis) {
+				if (output.position[axis])
+					output.position[axis][begin + i] = inf;
+				if (output.normal[axis])
+					output.normal[axis][begin + i] = 0;
+			}
+		}
+
+		// hits
+		for (uint32_t i : packet.hits)
+			for (int axis = 0; axis < 3; ++axis)
+				if (output.position[axis])
+					output.position[axis][begin + i] = packet.position[i][axis];
+		if (!output.normal[0] && !output.normal[1] && !output.normal[2])
+			return;
+		packet.Gather(packet.hits);
+		source.template EvaluateDerivatives<1>(packet.x.data(), packet.y.data(), packet.z.data(), packet.gradients.data(), packet.hits.size());
+		for (size_t j = 0; j < packet.hits.size(); ++j) {
+			const Dual<1>& g = packet.gradients[j];
+			glm::vec3 normal = glm::normalize(glm::vec3(g.d[1], g.d[2], g.d[3]));
+			for (int axis = 0; axis < 3; ++axis)
+				if (output.normal[axis])
+					output.normal[axis][begin + packet.hits[j]] = normal[axis];
+		}
+	});
+}
+
+void RayQuery::Cast(const Tape& tape, const float* const origin[3], const float* const direction[3], size_t count,
+	const RayQueryOutput& output, ThreadPool& pool) const
+{
+	CastPackets(SdfSourceTape{ tape }, origin, direction, count, output, pool);
+}
+
+void RayQuery::Cast(const JitSdf& jit, const float* const origin[3], const float* const direction[3], size_t count,
+	const RayQueryOutput& output, ThreadPool& pool) const
+{
+	CastPackets(SdfSourceJit{ jit }, origin, direction, count, output, pool);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Tape.h"
+#include "JitSdf.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <cstdint>
+
+/// <summary>
+/// Caller owned result arrays of a ray query, one element per ray (structure of arrays). Only t is required.
+/// </summary>
+struct RayQueryOutput {
+	float* t = nullptr; // distance along the (normalized) direction to the hit, infinity for rays that miss
+	float* position[3] = {}; // hit point, infinity for misses
+	float* normal[3] = {}; // normalized gradient at the hit point (dual numbers), 0 for misses
+	int32_t* steps = nullptr; // sphere tracing steps taken
+};
+
+/// <summary>
+/// Casts batches of rays against an sdf (depth sensors, lidar, visibility), with the sphere tracing of Shaders/trace.frag.
+/// The rays are split into packets of packetSize across the threads of the pool, the rays of a packet that are still marching advance
+/// together, so each step is one batch evaluation. Rays are clipped to bounds first: rays missing it cost nothing,
+/// the others start marching where they enter and stop where they leave it.
+/// </summary>
+class RayQuery
+{
+public:
+	static constexpr size_t packetSize = 256;
+
+	// same defaults as trace.frag
+	int maxSteps = 500;
+	float stopDist = 0.0001f;
+	float maxDist = 1000.0f;
+
+	/// <summary>
+	/// Region containing the surface, typically the bounds of the root from BoundsCalculatorVisitor. Infinite means no clipping.
+	/// </summary>
+	BoundingBox bounds = BoundingBox::Infinite();
+
+	/// <summary>
+	/// Traces the rays origin[i] + t * direction[i] for i < count, the directions don't need to be normalized.
+	/// Throws std::invalid_argument if output.t is missing.
+	/// </summary>
+	void Cast(const Tape& tape, const float* const origin[3], const float* const direction[3], size_t count,
+		const RayQueryOutput& output, ThreadPool& pool = ThreadPool::Global()) const;
+
+	/// <summary>
+	/// Same with the native code of jit, which falls back to its tape while compiling.
+	/// </summary>
+	void Cast(const JitSdf& jit, const float* const origin[3], const float* const direction[3], size_t count,
+		const RayQueryOutput& output, ThreadPool& pool = ThreadPool::Global()) const;
+
+private:
+	template<typename Source>
+	void CastPackets(const Source& source, const float* const origin[3], const float* const direction[3], size_t count,
+		const RayQueryOutput& output, ThreadPool& pool) const;
+};
@@ -0,0 +1,179 @@
+#include "ReferenceSDF.h"
+#include "BoundsCalculatorVisitor.h"
+#include "DistanceBake.h"
+#include "exceptions.h"
+
+#include <glm/gtx/transform.hpp>
+
+namespace {
+	struct PrimitiveFormula : public PrimitiveVisitor {
+		glm::vec3 p;
+		float result = 0;
+		void operator()(Sphere&) override { result = ReferenceSDF::sphere(0.5f, p); }
+		void operator()(Box& box) override { result = ReferenceSDF::cube(box.dimensions * 0.5f, p); }
+		void operator()(Cylinder& c) override { result = ReferenceSDF::cylinder(c.radius, c.height, p); }
+		void operator()(Torus& t) override { result = ReferenceSDF::torus(t.major_radius, t.minor_radius, p); }
+		void operator()(Ellipsoid& e) override { result = ReferenceSDF::ellipsoid(e.radii, p); }
+		void operator()(Plane& plane) override { result = ReferenceSDF::plane(plane.n, plane.h, p); }
+		void operator()(Mesh& mesh) override { result = mesh.bake ? mesh.bake->Sample(p) : ReferenceSDF::cube(glm::vec3(0.5f), p); }
+	};
+
+	struct OperatorFormula : public OperatorVisitor {
+		float a, b;
+		float result = 0;
+		void operator()(Union&) override { result = glm::min(a, b); }
+		void operator()(Intersection&) override { result = glm::max(a, b); }
+		void operator()(Substraction&) override { result = glm::max(a, -b); }
+		void operator()(SmoothUnion& o) override { result = ReferenceSDF::smooth_union(a, b, o.k); }
+		void operator()(SmoothIntersection& o) override { result = ReferenceSDF::smooth_intersection(a, b, o.k); }
+		void operator()(SmoothSubstraction& o) override { result = ReferenceSDF::smooth_substraction(a, b, o.k); }
+	};
+
+	// the conditions of Operator::GenerateGuardCondition
+	struct GuardFormula : public OperatorVisitor {
+		float accumulated, bound;
+		bool result = false;
+		void operator()(Union&) override { result = bound > accumulated; }
+		void operator()(Intersection&) override { result = bound > 0 && bound > accumulated; }
+		void operator()(Substraction&) override { result = bound > -accumulated; }
+		void operator()(SmoothUnion& o) override { result = bound > accumulated + o.k; }
+		void operator()(SmoothIntersection& o) override { result = bound > 0 && bound > accumulated + o.k; }
+		void operator()(SmoothSubstraction& o) override { result = bound > o.k - accumulated; }
+	};
+}
+
+void ReferenceSDF::operator()(std::shared_ptr<OperatorNode> opnode)
+{
+	if (opnode->InputCount() < 1)
+		throw shader_gen_exception(shader_gen_exception::REASON::OPERATOR_HAS_NO_INPUTS, opnode);
+
+	glm::mat4 transformMatrix =
+		transformStack.top() *
+		glm::translate(opnode->translate) *
+		glm::rotate(opnode->rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(opnode->rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(opnode->rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0)) *
+		glm::scale(glm::vec3(opnode->scale));
+	transformStack.push(transformMatrix);
+
+	OperatorFormula op;
+	bool guarded = useBoundingGuards && opnode->operatorDescription->SupportsGuards();
+	for (size_t i = 0; i < opnode->InputCount(); ++i) {
+		if (!guarded || i == 0 || !Guard(opnode, (*opnode)[i], op.result))
+			(*opnode)[i]->visit(this);
+		if (i == 0) {
+			op.result = value;
+			continue;
+		}
+		op.a = op.result;
+		op.b = value;
+		opnode->operatorDescription->Accept(op);
+	}
+	transformStack.pop();
+
+	value = op.result * opnode->scale - opnode->radius;
+}
+
+void ReferenceSDF::operator()(std::shared_ptr<PrimitiveNode> primnode)
+{
+	glm::mat4 transform = transformStack.top() * glm::translate(primnode->translate) *
+		glm::rotate(primnode->rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(primnode->rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(primnode->rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0));
+
+	PrimitiveFormula formula;
+	formula.p = glm::vec3(glm::inverse(transform) * glm::vec4(pos, 1)) / primnode->scale;
+	primnode->primitive->Accept(formula);
+	value = (formula.result - primnode->radius) * primnode->scale;
+}
+
+bool ReferenceSDF::Guard(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<Node> input, float accumulated)
+{
+	BoundingBox box = bounds.at(input.get()).Transformed(transformStack.top());
+	if (box.IsInfinite())
+		return false;
+	box = box.Expanded(1e-4f * (1 + glm::length(box.max - box.min))); // the margin of SDFGenerator::VisitGuarded
+
+	GuardFormula guard;
+	guard.accumulated = accumulated;
+	guard.bound = glm::length(glm::max(glm::abs(pos - box.Center()) - box.HalfSize(), 0.0f)) / glm::length(glm::vec3(transformStack.top()[0]));
+	opnode->operatorDescription->Accept(guard);
+	if (guard.result)
+		value = guard.bound;
+	return guard.result;
+}
+
+float ReferenceSDF::Evaluate(std::shared_ptr<Node> root, glm::vec3 pos)
+{
+	this->pos = pos;
+	if (useBoundingGuards && boundsRoot != root.get()) {
+		bounds = BoundsCalculatorVisitor().CalculateBounds(root);
+		boundsRoot = root.get();
+	}
+	transformStack = {};
+	transformStack.push(glm::identity<glm::mat4>());
+	root->visit(this);
+	return value;
+}
+
+float ReferenceSDF::cube(glm::vec3 size, glm::vec3 point)
+{
+	glm::vec3 dist = glm::abs(point) - size;
+	if (dist.x < 0 && dist.y < 0 && dist.z < 0) {
+		return glm::max(dist.x, glm::max(dist.y, dist.z));
+	}
+	else {
+		return glm::length(glm::max(dist, 0.0f));
+	}
+}
+
+float ReferenceSDF::sphere(float radius, glm::vec3 point)
+{
+	return glm::length(point) - radius;
+}
+
+float ReferenceSDF::cylinder(float radius, float height, glm::vec3 point)
+{
+	float hd = glm::length(glm::vec2(point.x, point.z)) - radius;
+	float vd = glm::abs(point.y) - height * 0.5f;
+	if (vd > 0.0f && hd > 0.0f)
+		return glm::length(glm::vec2(hd, vd));
+	return glm::max(vd, hd);
+}
+
+float ReferenceSDF::torus(float major_radius, float minor_radius, glm::vec3 point)
+{
+	glm::vec2 q = glm::vec2(glm::length(glm::vec2(point.x, point.z)) - major_radius, point.y);
+	return glm::length(q) - minor_radius;
+}
+
+float ReferenceSDF::ellipsoid(glm::vec3 radii, glm::vec3 point)
+{
+	float k0 = glm::length(point / radii);
+	float k1 = glm::length(point / (radii * radii));
+	return k0 * (k0 - 1) / k1;
+}
+
+float ReferenceSDF::plane(glm::vec3 n, float h, glm::vec3 point)
+{
+	return glm::dot(point, n) + h;
+}
+
+float ReferenceSDF::smooth_union(float d1, float d2, float k)
+{
+	float h = glm::max(k - glm::abs(d1 - d2), 0.0f) / k;
+	return glm::min(d1, d2) - h * h * h * k / 6;
+}
+
+float ReferenceSDF::smooth_intersection(float d1, float d2, float k)
+{
+	float h = glm::max(k - glm::abs(d1 - d2), 0.0f) / k;
+	return glm::max(d1, d2) + h * h * h * k / 6;
+}
+
+float ReferenceSDF::smooth_substraction(float d1, float d2, float k)
+{
+	d2 = -d2;
+	float h = glm::max(k - glm::abs(d1 - d2), 0.0f) / k;
+	return glm::max(d1, d2) + h * h * h * k / 6;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "NodeVisitor.h"
+#include "BoundingBox.h"
+#include <glm/glm.hpp>
+#include <stack>
+#include <unordered_map>
+
+/// <summary>
+/// Scalar, line by line port of Shaders/primitives.frag and of the code generated by SDFGenerator, evaluated by walking the graph.
+/// Slow, only used as the ground truth when checking the CPU evaluators (csgtool verify) and the guards (csgtool guards).
+/// </summary>
+class ReferenceSDF : public NodeVisitor
+{
+public:
+	void operator()(std::shared_ptr<OperatorNode> opnode) override;
+	void operator()(std::shared_ptr<PrimitiveNode> primnode) override;
+
+	/// <summary>
+	/// Port of SDFGenerator::useBoundingGuards: inputs after the first one are replaced by the distance to their bounding box where the
+	/// guard condition of the operator (Operator::GenerateGuardCondition) holds.
+	/// </summary>
+	bool useBoundingGuards = false;
+
+	/// <summary>
+	/// The value of the sdf with the given root at pos.
+	/// </summary>
+	float Evaluate(std::shared_ptr<Node> root, glm::vec3 pos);
+
+	static float cube(glm::vec3 size, glm::vec3 point);
+	static float sphere(float radius, glm::vec3 point);
+	static float cylinder(float radius, float height, glm::vec3 point);
+	static float torus(float major_radius, float minor_radius, glm::vec3 point);
+	static float ellipsoid(glm::vec3 radii, glm::vec3 point);
+	static float plane(glm::vec3 n, float h, glm::vec3 point);
+	static float smooth_union(float d1, float d2, float k);
+	static float smooth_intersection(float d1, float d2, float k);
+	static float smooth_substraction(float d1, float d2, float k);
+
+private:
+	glm::vec3 pos;
+	std::stack<glm::mat4> transformStack;
+	float value = 0; // the value of the last visited node
+	const Node* boundsRoot = nullptr; // the graph the bounds were calculated for
+	std::unordered_map<const Node*, BoundingBox> bounds;
+
+	// if the guard of the operator holds for the input at pos, sets the value to its bound
+	bool Guard(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<Node> input, float accumulated);
+};
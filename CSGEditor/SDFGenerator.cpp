@@ -1,5 +1,6 @@
 #include "SDFGenerator.h"
 
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -9,10 +10,47 @@
 #define NOT_ASSIGNED -1
 
 void SDFGenerator::operator()(std::shared_ptr<OperatorNode> opnode)
+{
+	if (!useLevelOfDetail) {
+		GenerateOperator(opnode);
+		return;
+	}
+
+	// generate the subtree separately: the register holding its value is only known afterwards
+	std::stringstream subtreeCode;
+	std::swap(code, subtreeCode);
+	GenerateOperator(opnode);
+	std::swap(code, subtreeCode);
+
+	BoundingBox box = bounds.at(opnode.get()).Transformed(transformStack.top());
+	if (box.IsInfinite()) {
+		code << subtreeCode.str();
+		return;
+	}
+
+	// the box can't be farther from the subtree's surface than its half diagonal, if the pixel footprint is larger than that, the box is used instead
+	float error = glm::length(box.HalfSize());
+	float unitScale = glm::length(glm::vec3(transformStack.top()[0])); // the box is in world space, the register in the parent's units
+	std::string regName = regNamePrefix + std::to_string(TraversalId(opnode));
+
+	code << "if (" << lodRadiusName << " > " << error << ") {\n";
+	code << regName << " = r_cube(" << box.HalfSize() << ", " << sampleCoordName << " - " << box.Center() << ") / " << unitScale << ";\n";
+	code << "} else {\n";
+	code << subtreeCode.str();
+	code << "}\n";
+}
+
+void SDFGenerator::GenerateOperator(std::shared_ptr<OperatorNode> opnode)
 {
 	if (opnode->InputCount() < 1)
 		throw shader_gen_exception(shader_gen_exception::REASON::OPERATOR_HAS_NO_INPUTS, opnode);
 
+	auto baked = bakes.find(opnode.get());
+	if (baked != bakes.end() && baked->second != nullptr) {
+		GenerateBaked(opnode, baked->second);
+		return;
+	}
+
 	// create current transform matrix for this node and save it to the stack
 	glm::mat4 transformMatrix = 
 		transformStack.top() *
@@ -25,9 +63,37 @@ void SDFGenerator::operator()(std::shared_ptr<OperatorNode> opnode)
 	transformStack.push(transformMatrix);
 
 	// traverse children, generate their code
-	for (auto nb : *opnode) {
-		nb->visit(this);
+	bool guarded = useBoundingGuards && opnode->operatorDescription->SupportsGuards();
+	int accumulator = NOT_ASSIGNED; // holds the operator applied to the inputs generated so far, only needed for guarding more than two inputs
+	std::string accumulatedName;
+	for (int i = 0; i < opnode->InputCount(); ++i) {
+		auto input = (*opnode)[i];
+		if (!guarded || i == 0) {
+			input->visit(this);
+			if (!guarded)
+				continue;
+		}
+		else {
+			VisitGuarded(opnode, input, accumulatedName);
+		}
+
+		std::string inputName = regNamePrefix + std::to_string(TraversalId(input));
+		if (i == 0 && opnode->InputCount() > 2) {
+			accumulator = AllocateRegister();
+			accumulatedName = regNamePrefix + std::to_string(accumulator);
+			code << accumulatedName << " = " << inputName << ";\n";
+		}
+		else if (i == 0) {
+			accumulatedName = inputName;
+		}
+		else if (accumulator != NOT_ASSIGNED && i + 1 < opnode->InputCount()) {
+			code << accumulatedName << " = (";
+			opnode->operatorDescription->GenerateShader(code, { accumulatedName, inputName });
+			code << ");\n";
+		}
 	}
+	if (accumulator != NOT_ASSIGNED)
+		FreeRegister(accumulator);
 
 	transformStack.pop();
 
@@ -63,6 +129,33 @@ void SDFGenerator::operator()(std::shared_ptr<OperatorNode> opnode)
 	TraversalId(opnode->FirstInput()) = NOT_ASSIGNED;
 }
 
+void SDFGenerator::GenerateBaked(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<const DistanceBake> bake)
+{
+	int& reg = TraversalId(opnode);
+	reg = AllocateRegister();
+	std::string regName = regNamePrefix + std::to_string(reg);
+
+	// move the sampling point into the parent's coordinate system, where the subtree was baked
+	auto invTransform = glm::inverse(transformStack.top());
+	createdInvVar = true;
+	code << invTransformVarName << "[0] = " << createVec4(invTransform[0]) << ";\n";
+	code << invTransformVarName << "[1] = " << createVec4(invTransform[1]) << ";\n";
+	code << invTransformVarName << "[2] = " << createVec4(invTransform[2]) << ";\n";
+	code << invTransformVarName << "[3] = " << createVec4(invTransform[3]) << ";\n";
+	code << transfSampleCoordName << " = (" << invTransformVarName << " * vec4(" << sampleCoordName << ",1)).xyz;\n";
+	code << regName << " = ";
+	GenerateBakeLookup(bake);
+	code << ";\n";
+}
+
+void SDFGenerator::GenerateBakeLookup(std::shared_ptr<const DistanceBake> bake)
+{
+	size_t sampler = std::find(usedBakes.begin(), usedBakes.end(), bake) - usedBakes.begin();
+	if (sampler == usedBakes.size())
+		usedBakes.push_back(bake);
+	code << "r_baked(" << BakeSamplerName(sampler) << ", " << transfSampleCoordName << ", " << bake->min << ", " << bake->size << ", " << bake->band << ")";
+}
+
 void SDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primnode)
 {
 	int& reg = TraversalId(primnode);
@@ -78,11 +171,7 @@ void SDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primnode)
 
 	auto invTransform = glm::inverse(transform); // inverse for moving the sampling point instead of the primitive
  
-	if (!createdInvVar) { // define variables for holding the inv transf mtx + the sampling coordinate
-		code << "mat4 " << invTransformVarName << ";\n";
-		code << "vec3 " << transfSampleCoordName << ";\n";
-		createdInvVar = true;
-	}
+	createdInvVar = true; // the variables holding the inv transf mtx + the sampling coordinate are declared at the beginning of the function
 
 	// fill inv transf mtx
 	code << invTransformVarName << "[0] = " << createVec4(invTransform[0]) << ";\n";
@@ -93,13 +182,14 @@ void SDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primnode)
 	// compute sampling coordinate for sampling the primitive in its basic (non-transformed) form
 	code << transfSampleCoordName << " = " << "(" << invTransformVarName << " * vec4(" << sampleCoordName << ",1)).xyz / "<<primnode->scale<<";\n";
 
-	if (reg == registerCount) { // declare variable for storing result if it hasn't been declared yet.
-		registerCount++;
-		code << "float " << regName << ";\n";
+	code << regName << " = (";
+	if (auto bake = primnode->primitive->GetBake()) {
+		GenerateBakeLookup(bake); // imported meshes
+	}
+	else {
+		code << "r_";
+		primnode->primitive->GenerateShader(code, transfSampleCoordName); // call primitive shader generation 
 	}
-
-	code << regName << " = (r_";
-	primnode->primitive->GenerateShader(code, transfSampleCoordName); // call primitive shader generation 
 
 	if (primnode->radius != 0) 
 		code << " - " << primnode->radius; // offset
@@ -110,22 +200,80 @@ void SDFGenerator::operator()(std::shared_ptr<PrimitiveNode> primnode)
 
 std::string SDFGenerator::GenerateFromRoot(std::shared_ptr<Node> root)
 {
-	code.clear();
+	code.str("");
 	createdInvVar = false;
 	createdTempVec3 = false;
 	nextRegister = 0;
 	freeRegisters.clear();
+	usedBakes.clear();
 	while (!transformStack.empty())
 		transformStack.pop();
 	transformStack.push(glm::identity<glm::mat4>());
 
-	code << "float sdf(vec3 pos) {\n";
+	if (useBoundingGuards || useLevelOfDetail)
+		bounds = BoundsCalculatorVisitor().CalculateBounds(root);
+
 	root->visit(this);
 	transformStack.pop();
 
-	code << "return " << regNamePrefix << TraversalId(root) << ";\n}\n";
+	// variables are declared at the beginning of the function, because guarded code is generated inside if blocks
+	std::stringstream function;
+	if (!usedBakes.empty()) {
+		for (size_t i = 0; i < usedBakes.size(); ++i)
+			function << "uniform sampler3D " << BakeSamplerName(i) << ";\n";
+		// the texture inside the baked box (see DistanceBake::Sample), a lower bound of the distance outside of it
+		function << "float r_baked(sampler3D bake, vec3 p, vec3 bmin, vec3 bsize, float band) {\n";
+		function << "vec3 outside = max(abs(p - (bmin + 0.5 * bsize)) - 0.5 * bsize, 0.0);\n";
+		function << "if (outside != vec3(0)) return length(outside) + band;\n";
+		function << "return texture(bake, (p - bmin) / bsize).r;\n}\n";
+	}
+	// sdf_lod also receives the radius of the pixel footprint at the sampling point, sdf() always uses full detail
+	if (useLevelOfDetail)
+		function << "float sdf_lod(vec3 pos, float " << lodRadiusName << ") {\n";
+	else
+		function << "float sdf(vec3 pos) {\n";
+	if (createdInvVar) { // define variables for holding the inv transf mtx + the sampling coordinate
+		function << "mat4 " << invTransformVarName << ";\n";
+		function << "vec3 " << transfSampleCoordName << ";\n";
+	}
+	for (int i = 0; i < nextRegister; ++i)
+		function << "float " << regNamePrefix << i << ";\n";
+
+	function << code.str();
+	function << "return " << regNamePrefix << TraversalId(root) << ";\n}\n";
+	if (useLevelOfDetail)
+		function << "float sdf(vec3 pos) { return sdf_lod(pos, 0.0); }\n";
+	else
+		function << "float sdf_lod(vec3 pos, float " << lodRadiusName << ") { return sdf(pos); }\n";
 	TraversalId(root) = NOT_ASSIGNED;
-	return ShaderLibManager::GenerateFromTemplate(code.str(), false); //TODO: move templating to primitive/operator code generator
+	return ShaderLibManager::GenerateFromTemplate(function.str(), false); //TODO: move templating to primitive/operator code generator
+}
+
+void SDFGenerator::VisitGuarded(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<Node> input, const std::string& accumulatedName)
+{
+	// generate the input's code separately: the register holding its value is only known afterwards
+	std::stringstream inputCode;
+	std::swap(code, inputCode);
+	input->visit(this);
+	std::swap(code, inputCode);
+
+	BoundingBox box = bounds.at(input.get()).Transformed(transformStack.top());
+	if (box.IsInfinite()) {
+		code << inputCode.str();
+		return;
+	}
+	box = box.Expanded(1e-4f * (1 + glm::length(box.max - box.min))); // make up for the rounding of the printed constants
+
+	// the registers hold distances in the operator's units, the box is in world space
+	float unitScale = glm::length(glm::vec3(transformStack.top()[0]));
+	std::string inputName = regNamePrefix + std::to_string(TraversalId(input));
+
+	code << inputName << " = _constant_(r_box_bound(" << sampleCoordName << ", " << box.Center() << ", " << box.HalfSize() << ") / " << unitScale << ");\n";
+	code << "if (!(";
+	opnode->operatorDescription->GenerateGuardCondition(code, accumulatedName, inputName);
+	code << ")) {\n";
+	code << inputCode.str();
+	code << "}\n";
 }
 
 int SDFGenerator::AllocateRegister()
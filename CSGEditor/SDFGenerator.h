@@ -1,8 +1,9 @@
 #pragma once
 
 #include "NodeVisitor.h"
-#include "Editor.h"
-#include "utils.h"
+#include "BoundsCalculatorVisitor.h"
+#include "DistanceBake.h"
+#include "core_utils.h"
 #include <vector>
 #include <stack>
 #include <string>
@@ -27,6 +28,30 @@ public:
 	/// <returns> the glsl code of the sdf</returns>
 	std::string GenerateFromRoot(std::shared_ptr<Node> root);
 
+	/// <summary>
+	/// If true, the inputs of operators are only evaluated if the distance to their bounding box can change the result (see Operator::GenerateGuardCondition).
+	/// </summary>
+	bool useBoundingGuards = false;
+
+	/// <summary>
+	/// If true, every operator subtree gets its bounding box as a proxy, which is used instead of the subtree when the pixel footprint
+	/// passed to sdf_lod() is larger than the proxy's error.
+	/// </summary>
+	bool useLevelOfDetail = false;
+
+	/// <summary>
+	/// Operator subtrees that are sampled from a baked distance texture instead of being evaluated (see SubtreeBaker). The bake of the i-th
+	/// element of GetUsedBakes() is read from the sampler3D uniform BakeSamplerName(i) of the generated code. The bakes of the primitives
+	/// (see Primitive::GetBake) are sampled the same way.
+	/// </summary>
+	std::unordered_map<const Node*, std::shared_ptr<const DistanceBake>> bakes;
+
+	/// <summary>
+	/// The bakes the last generated sdf samples, in the order of their samplers.
+	/// </summary>
+	const std::vector<std::shared_ptr<const DistanceBake>>& GetUsedBakes() const { return usedBakes; }
+	static std::string BakeSamplerName(size_t index) { return "baked_distance" + std::to_string(index); }
+
 private:
 	std::stringstream code;
 	int nextRegister = 0;
@@ -40,14 +65,33 @@ private:
 	bool createdTempVec3 = false;
 	std::string tempVec3Name = "tmpv3";
 
-	int registerCount = 0;
+	std::unordered_map<const Node*, BoundingBox> bounds; // bounds of every node in its parent's coordinate system, only calculated if guards are used
+	std::vector<std::shared_ptr<const DistanceBake>> usedBakes;
 
 	const std::string regNamePrefix = "var";
 	const std::string sampleCoordName = "pos";
 	const std::string transfSampleCoordName = "posTransf";
+	const std::string lodRadiusName = "lod_radius";
+
+	void GenerateOperator(std::shared_ptr<OperatorNode> opnode);
+
+	/// <summary>
+	/// Generates the lookup of a baked subtree: the bake is in the parent's coordinate system and units, like the subtree's register.
+	/// </summary>
+	void GenerateBaked(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<const DistanceBake> bake);
+
+	/// <summary>
+	/// Writes the r_baked call sampling the bake at the transformed sampling coordinate, assigns a sampler to the bake if it has none yet.
+	/// </summary>
+	void GenerateBakeLookup(std::shared_ptr<const DistanceBake> bake);
 
 	int AllocateRegister();
 	void FreeRegister(int id);
 
+	/// <summary>
+	/// Generates the code of an operator's input inside an if block, which is skipped if the distance to the input's bounding box can't change the operator's result.
+	/// </summary>
+	void VisitGuarded(std::shared_ptr<OperatorNode> opnode, std::shared_ptr<Node> input, const std::string& accumulatedName);
+
 	std::string createVec4(glm::vec4 v);
 };
\ No newline at end of file
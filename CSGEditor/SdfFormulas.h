@@ -0,0 +1,87 @@
+#pragma once
+#include "SimdFloat.h"
+
+/// <summary>
+/// C++ counterpart of the _TEMPLATE_ functions of Shaders/primitives.frag, written once for any number type N, like the glsl templates.
+/// N needs the arithmetic operators (also with float constants on either side), a conversion from float and the functions
+/// realValue, dmin, dmax, dabs, dsqrt and select (per lane choice by a mask computed from real values, found by argument dependent lookup).
+/// Overloads for simd::vfloat are below, the dual numbers provide their own.
+/// </summary>
+namespace sdf {
+
+	inline simd::vfloat realValue(simd::vfloat a) { return a; }
+	inline simd::vfloat dmin(simd::vfloat a, simd::vfloat b) { return simd::min(a, b); }
+	inline simd::vfloat dmax(simd::vfloat a, simd::vfloat b) { return simd::max(a, b); }
+	inline simd::vfloat dabs(simd::vfloat a) { return simd::abs(a); }
+	inline simd::vfloat dsqrt(simd::vfloat a) { return simd::sqrt(a); }
+
+	template<typename N>
+	N dlength(const N& x, const N& y) {
+		return dsqrt(x * x + y * y);
+	}
+
+	template<typename N>
+	N dlength(const N& x, const N& y, const N& z) {
+		return dsqrt(x * x + y * y + z * z);
+	}
+
+	template<typename N>
+	N cube(float hx, float hy, float hz, const N& x, const N& y, const N& z) { // half size
+		N dx = dabs(x) - hx;
+		N dy = dabs(y) - hy;
+		N dz = dabs(z) - hz;
+		auto inside = (realValue(dx) < 0.0f) & (realValue(dy) < 0.0f) & (realValue(dz) < 0.0f);
+		return select(inside,
+			dmax(dx, dmax(dy, dz)),
+			dlength(dmax(dx, N(0.0f)), dmax(dy, N(0.0f)), dmax(dz, N(0.0f))));
+	}
+
+	template<typename N>
+	N sphere(float radius, const N& x, const N& y, const N& z) {
+		return dlength(x, y, z) - radius;
+	}
+
+	template<typename N>
+	N cylinder(float radius, float height, const N& x, const N& y, const N& z) {
+		N hd = dlength(x, z) - radius;
+		N vd = dabs(y) - height * 0.5f;
+		return select((realValue(vd) > 0.0f) & (realValue(hd) > 0.0f), dlength(hd, vd), dmax(vd, hd));
+	}
+
+	template<typename N>
+	N torus(float majorRadius, float minorRadius, const N& x, const N& y, const N& z) {
+		N qx = dlength(x, z) - majorRadius;
+		return dlength(qx, y) - minorRadius;
+	}
+
+	template<typename N>
+	N ellipsoid(float rx, float ry, float rz, const N& x, const N& y, const N& z) {
+		N k0 = dlength(x / rx, y / ry, z / rz);
+		N k1 = dlength(x / (rx * rx), y / (ry * ry), z / (rz * rz));
+		return k0 * (k0 - 1.0f) / k1;
+	}
+
+	template<typename N>
+	N plane(float nx, float ny, float nz, float h, const N& x, const N& y, const N& z) {
+		return x * nx + y * ny + z * nz + h;
+	}
+
+	template<typename N>
+	N smooth_union(const N& d1, const N& d2, float k) {
+		N h = dmax(k - dabs(d1 - d2), N(0.0f)) / k;
+		return dmin(d1, d2) - h * (h * (h * (k / 6)));
+	}
+
+	template<typename N>
+	N smooth_intersection(const N& d1, const N& d2, float k) {
+		N h = dmax(k - dabs(d1 - d2), N(0.0f)) / k;
+		return dmax(d1, d2) + h * (h * (h * (k / 6)));
+	}
+
+	template<typename N>
+	N smooth_substraction(const N& d1, const N& d2In, float k) {
+		N d2 = -d2In;
+		N h = dmax(k - dabs(d1 - d2), N(0.0f)) / k;
+		return dmax(d1, d2) + h * (h * (h * (k / 6)));
+	}
+}
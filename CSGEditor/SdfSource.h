@@ -0,0 +1,33 @@
+#pragma once
+#include "TapeEvaluator.h"
+#include "JitSdf.h"
+
+/// <summary>
+/// The batch evaluation functions of a tape, so the queries can be written once for the tape and for its native code (SdfSourceJit).
+/// Both have the contracts of TapeEvaluator::Evaluate and TapeEvaluator::EvaluateDerivatives.
+/// </summary>
+struct SdfSourceTape {
+	const Tape& tape;
+
+	void Evaluate(const float* x, const float* y, const float* z, float* distances, size_t count) const {
+		TapeEvaluator::Evaluate(tape, x, y, z, distances, count);
+	}
+
+	template<int Order>
+	void EvaluateDerivatives(const float* x, const float* y, const float* z, Dual<Order>* results, size_t count) const {
+		TapeEvaluator::EvaluateDerivatives<Order>(tape, x, y, z, results, count);
+	}
+};
+
+struct SdfSourceJit {
+	const JitSdf& jit;
+
+	void Evaluate(const float* x, const float* y, const float* z, float* distances, size_t count) const {
+		jit.Evaluate(x, y, z, distances, count);
+	}
+
+	template<int Order>
+	void EvaluateDerivatives(const float* x, const float* y, const float* z, Dual<Order>* results, size_t count) const {
+		jit.EvaluateDerivatives<Order>(x, y, z, results, count);
+	}
+};
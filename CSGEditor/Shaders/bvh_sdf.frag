@@ -0,0 +1,105 @@
+//?#version 460
+
+// Data-driven sdf used instead of the generated one for huge unions (see PrimitiveBVH).
+// The primitives and the bounding volume hierarchy are read from shader storage buffers, so the shader doesn't depend on the scene.
+
+// indices in PrimitiveTypes
+#define PRIMITIVE_SPHERE 0
+#define PRIMITIVE_BOX 1
+#define PRIMITIVE_CYLINDER 2
+#define PRIMITIVE_TORUS 3
+#define PRIMITIVE_ELLIPSOID 4
+#define PRIMITIVE_PLANE 5
+
+struct BvhPrimitive {
+	mat4 inv_transform; // world -> primitive space
+	vec4 params;
+	float world_scale;
+	float radius;
+	float offset;
+	int type;
+};
+
+struct BvhNode {
+	vec3 bmin;
+	int left_first; // first primitive for leaves, first child for inner nodes
+	vec3 bmax;
+	int count; // 0 for inner nodes
+};
+
+layout(std430, binding = 0) readonly buffer PrimitiveBuffer {
+	BvhPrimitive primitives[];
+};
+
+layout(std430, binding = 1) readonly buffer NodeBuffer {
+	ivec4 bvh_header; // unbounded primitive count, node count
+	BvhNode bvh_nodes[];
+};
+
+const int bvh_stack_size = 32;
+
+float bvh_eval_primitive(int idx, vec3 pos) {
+	BvhPrimitive prim = primitives[idx];
+	vec3 p = (prim.inv_transform * vec4(pos, 1)).xyz;
+	float d;
+	switch (prim.type) {
+	case PRIMITIVE_SPHERE: d = r_sphere(0.5, p); break;
+	case PRIMITIVE_BOX: d = r_cube(prim.params.xyz, p); break;
+	case PRIMITIVE_CYLINDER: d = r_cylinder(prim.params.x, prim.params.y, p); break;
+	case PRIMITIVE_TORUS: d = r_torus(prim.params.x, prim.params.y, p); break;
+	case PRIMITIVE_ELLIPSOID: d = r_ellipsoid(prim.params.xyz, p); break;
+	default: d = r_plane(prim.params.xyz, prim.params.w, p); break;
+	}
+	return (d - prim.radius) * prim.world_scale - prim.offset;
+}
+
+float bvh_node_bound(int idx, vec3 pos) {
+	vec3 bmin = bvh_nodes[idx].bmin;
+	vec3 bmax = bvh_nodes[idx].bmax;
+	return r_box_bound(pos, (bmin + bmax) * 0.5, (bmax - bmin) * 0.5);
+}
+
+float sdf(vec3 pos) {
+	float best = 1e30;
+	for (int i = 0; i < bvh_header.x; ++i) {
+		best = min(best, bvh_eval_primitive(i, pos));
+	}
+	if (bvh_header.y == 0)
+		return best;
+
+	// nodes whose box is farther than the closest primitive found so far are skipped, the closer child is visited first
+	int stack[bvh_stack_size];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		int idx = stack[--sp];
+		if (bvh_node_bound(idx, pos) >= best)
+			continue;
+
+		BvhNode node = bvh_nodes[idx];
+		if (node.count > 0) {
+			for (int i = node.left_first; i < node.left_first + node.count; ++i) {
+				best = min(best, bvh_eval_primitive(i, pos));
+			}
+			continue;
+		}
+
+		int closer = node.left_first;
+		int farther = node.left_first + 1;
+		float closer_dist = bvh_node_bound(closer, pos);
+		float farther_dist = bvh_node_bound(farther, pos);
+		if (farther_dist < closer_dist) {
+			int tmp = closer; closer = farther; farther = tmp;
+			float tmpd = closer_dist; closer_dist = farther_dist; farther_dist = tmpd;
+		}
+		if (farther_dist < best && sp < bvh_stack_size)
+			stack[sp++] = farther;
+		if (closer_dist < best && sp < bvh_stack_size)
+			stack[sp++] = closer;
+	}
+	return best;
+}
+
+float sdf_lod(vec3 pos, float lod_radius) {
+	return sdf(pos);
+}
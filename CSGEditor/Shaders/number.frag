@@ -35,6 +35,9 @@ float r_dsin(float a) { return sin(a); }
 float r_dcos(float a) { return cos(a); }
 float r_ddot(vec3 a, vec3 b) { return dot(a,b); }
 
+// distance to an axis aligned box, used by the bounding volume guards of the generated sdf (0 inside the box)
+float r_box_bound(vec3 p, vec3 center, vec3 half_size) { return length(max(abs(p - center) - half_size, 0.0)); }
+
 #ifdef DERIVATIVES_ENABLED
 struct dnum {
     float d[SIZE];
@@ -0,0 +1,17 @@
+#version 460
+
+// Copies the image accumulated by tiled rendering to the screen, together with its depth,
+// so the gizmos drawn afterwards are still depth tested against the surface.
+
+uniform sampler2D color_tex;
+uniform sampler2D depth_tex;
+
+layout(location = 0) in vec2 fs_in_tex;
+out vec4 fs_out_col;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	fs_out_col = texelFetch(color_tex, texel, 0);
+	gl_FragDepth = texelFetch(depth_tex, texel, 0).r;
+}
@@ -17,11 +17,13 @@ uniform int display_mode;
 uniform float vis_multiplier = 0.1f; // multiplier for adjusting strength of curvatures or normal differences
 uniform int use_auto_diff = 0;
 uniform float eps = 0.01; // epsilon value used for numeric approximations
+uniform float lod_pixel_radius = 0; // radius of a pixel's footprint at unit distance from the camera, multiplied by the level of detail scale
 
 layout(location = 0) in vec2 fs_in_tex;
 out vec4 fs_out_col;
 
 float sdf(vec3 pos);
+float sdf_lod(vec3 pos, float lod_radius); // may substitute subtrees smaller than lod_radius with proxies
 
 // sphere tracing settings
 const int max_steps = 500;
@@ -148,14 +150,14 @@ void main()
 	// sphere tracing
 	vec3 pos = eye_pos;
 	vec3 prev_pos = pos;
-	float dist = sdf(pos);
+	float dist = sdf_lod(pos, 0);
 	float t = 0;
 	while(steps > 0 && dist > stop_dist && t < max_dist) {
 		--steps;
 		prev_pos = pos;
 		pos += ray * dist;
 		t += dist;
-		dist = sdf(pos);
+		dist = sdf_lod(pos, t * lod_pixel_radius);
 	}
 
 	// out of steps
@@ -0,0 +1,139 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+/// <summary>
+/// Minimal wrapper over the widest float vector available at compile time (AVX: 8 lanes, SSE2: 4 lanes, otherwise scalar).
+/// The CPU evaluators are written against it once, the lane count only changes the loop step.
+/// Only the operations needed by the sdf formulas of Shaders/primitives.frag are implemented.
+/// </summary>
+namespace simd {
+
+#if defined(__AVX__)
+
+	struct vmask { __m256 v; };
+
+	struct vfloat {
+		static constexpr int width = 8;
+		__m256 v;
+
+		vfloat() = default;
+		vfloat(__m256 v) : v(v) {}
+		vfloat(float f) : v(_mm256_set1_ps(f)) {}
+
+		static vfloat Load(const float* p) { return _mm256_loadu_ps(p); }
+		void Store(float* p) const { _mm256_storeu_ps(p, v); }
+	};
+
+	inline vfloat operator+(vfloat a, vfloat b) { return _mm256_add_ps(a.v, b.v); }
+	inline vfloat operator-(vfloat a, vfloat b) { return _mm256_sub_ps(a.v, b.v); }
+	inline vfloat operator*(vfloat a, vfloat b) { return _mm256_mul_ps(a.v, b.v); }
+	inline vfloat operator/(vfloat a, vfloat b) { return _mm256_div_ps(a.v, b.v); }
+	inline vfloat operator-(vfloat a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+	inline vfloat min(vfloat a, vfloat b) { return _mm256_min_ps(a.v, b.v); }
+	inline vfloat max(vfloat a, vfloat b) { return _mm256_max_ps(a.v, b.v); }
+	inline vfloat abs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+	inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a.v); }
+
+	inline vmask operator<(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline vmask operator>(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline vmask operator<=(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline vmask operator>=(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	inline vmask operator&(vmask a, vmask b) { return { _mm256_and_ps(a.v, b.v) }; }
+	inline vmask operator|(vmask a, vmask b) { return { _mm256_or_ps(a.v, b.v) }; }
+	inline vmask operator!(vmask a) { return { _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+	inline bool any(vmask m) { return _mm256_movemask_ps(m.v) != 0; }
+	inline bool all(vmask m) { return _mm256_movemask_ps(m.v) == 0xFF; }
+
+	/// <summary>
+	/// Per lane: m ? a : b
+	/// </summary>
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+	struct vmask { __m128 v; };
+
+	struct vfloat {
+		static constexpr int width = 4;
+		__m128 v;
+
+		vfloat() = default;
+		vfloat(__m128 v) : v(v) {}
+		vfloat(float f) : v(_mm_set1_ps(f)) {}
+
+		static vfloat Load(const float* p) { return _mm_loadu_ps(p); }
+		void Store(float* p) const { _mm_storeu_ps(p, v); }
+	};
+
+	inline vfloat operator+(vfloat a, vfloat b) { return _mm_add_ps(a.v, b.v); }
+	inline vfloat operator-(vfloat a, vfloat b) { return _mm_sub_ps(a.v, b.v); }
+	inline vfloat operator*(vfloat a, vfloat b) { return _mm_mul_ps(a.v, b.v); }
+	inline vfloat operator/(vfloat a, vfloat b) { return _mm_div_ps(a.v, b.v); }
+	inline vfloat operator-(vfloat a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+	inline vfloat min(vfloat a, vfloat b) { return _mm_min_ps(a.v, b.v); }
+	inline vfloat max(vfloat a, vfloat b) { return _mm_max_ps(a.v, b.v); }
+	inline vfloat abs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+	inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a.v); }
+
+	inline vmask operator<(vfloat a, vfloat b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+	inline vmask operator>(vfloat a, vfloat b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+	inline vmask operator<=(vfloat a, vfloat b) { return { _mm_cmple_ps(a.v, b.v) }; }
+	inline vmask operator>=(vfloat a, vfloat b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+	inline vmask operator&(vmask a, vmask b) { return { _mm_and_ps(a.v, b.v) }; }
+	inline vmask operator|(vmask a, vmask b) { return { _mm_or_ps(a.v, b.v) }; }
+	inline vmask operator!(vmask a) { return { _mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1))) }; }
+	inline bool any(vmask m) { return _mm_movemask_ps(m.v) != 0; }
+	inline bool all(vmask m) { return _mm_movemask_ps(m.v) == 0xF; }
+
+	/// <summary>
+	/// Per lane: m ? a : b
+	/// </summary>
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+
+#else
+
+	struct vmask { bool v; };
+
+	struct vfloat {
+		static constexpr int width = 1;
+		float v;
+
+		vfloat() = default;
+		vfloat(float f) : v(f) {}
+
+		static vfloat Load(const float* p) { return *p; }
+		void Store(float* p) const { *p = v; }
+	};
+
+	inline vfloat operator+(vfloat a, vfloat b) { return a.v + b.v; }
+	inline vfloat operator-(vfloat a, vfloat b) { return a.v - b.v; }
+	inline vfloat operator*(vfloat a, vfloat b) { return a.v * b.v; }
+	inline vfloat operator/(vfloat a, vfloat b) { return a.v / b.v; }
+	inline vfloat operator-(vfloat a) { return -a.v; }
+	inline vfloat min(vfloat a, vfloat b) { return b.v < a.v ? b.v : a.v; }
+	inline vfloat max(vfloat a, vfloat b) { return b.v > a.v ? b.v : a.v; }
+	inline vfloat abs(vfloat a) { return std::fabs(a.v); }
+	inline vfloat sqrt(vfloat a) { return std::sqrt(a.v); }
+
+	inline vmask operator<(vfloat a, vfloat b) { return { a.v < b.v }; }
+	inline vmask operator>(vfloat a, vfloat b) { return { a.v > b.v }; }
+	inline vmask operator<=(vfloat a, vfloat b) { return { a.v <= b.v }; }
+	inline vmask operator>=(vfloat a, vfloat b) { return { a.v >= b.v }; }
+	inline vmask operator&(vmask a, vmask b) { return { a.v && b.v }; }
+	inline vmask operator|(vmask a, vmask b) { return { a.v || b.v }; }
+	inline vmask operator!(vmask a) { return { !a.v }; }
+	inline bool any(vmask m) { return m.v; }
+	inline bool all(vmask m) { return m.v; }
+
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return m.v ? a : b; }
+
+#endif
+
+	inline vfloat length(vfloat x, vfloat y) { return sqrt(x * x + y * y); }
+	inline vfloat length(vfloat x, vfloat y, vfloat z) { return sqrt(x * x + y * y + z * z); }
+}
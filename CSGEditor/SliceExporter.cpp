@@ -0,0 +1,337 @@
+#include "SliceExporter.h"
+#include "TapeEvaluator.h"
+#include "TapeSimplifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	// a tile of a slice, the unit of work of the evaluation
+	struct Tile {
+		size_t slice;
+		int x0, y0, x1, y1;
+	};
+
+	// a vertex of the contours: the crossing of a grid edge, keyed by the edge
+	struct Crossing {
+		uint64_t edge;
+		glm::vec2 grid; // in pixel coordinates
+	};
+
+	// key of the edge from pixel (x, y) to its right (vertical = false) or lower (vertical = true) neighbour
+	uint64_t EdgeKey(int x, int y, bool vertical, int width) {
+		return (((uint64_t)y * width + x) << 1) | (vertical ? 1 : 0);
+	}
+}
+
+SlicePlane SlicePlane::Across(const BoundingBox& box, int axis, float offset, int resolution)
+{
+	if (axis < 0 || axis > 2 || resolution < 1)
+		throw std::invalid_argument("SlicePlane: the axis must be 0, 1 or 2 and the resolution positive.");
+	int right = axis == 0 ? 1 : 0;
+	int up = axis == 2 ? 1 : 2;
+	glm::vec3 size = box.max - box.min;
+	float pixel = std::max(size[right], size[up]) / resolution;
+
+	SlicePlane plane;
+	plane.width = std::max(1, (int)std::ceil(size[right] / pixel - 1e-3f));
+	plane.height = std::max(1, (int)std::ceil(size[up] / pixel - 1e-3f));
+	plane.origin = box.min;
+	plane.origin[axis] = offset;
+	plane.origin[up] = box.max[up];
+	plane.u = glm::vec3(0);
+	plane.u[right] = plane.width * pixel;
+	plane.v = glm::vec3(0);
+	plane.v[up] = -plane.height * pixel;
+	return plane;
+}
+
+std::vector<Slice> SliceExporter::Export(const Tape& tape, const std::vector<SlicePlane>& planes, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = SliceStats();
+	stats.slices = planes.size();
+
+	std::vector<Slice> slices(planes.size());
+	std::vector<Tile> tiles;
+	for (size_t s = 0; s < planes.size(); ++s) {
+		const SlicePlane& plane = planes[s];
+		if (plane.width < 1 || plane.height < 1)
+			throw std::invalid_argument("SliceExporter: a slice has no pixels.");
+		slices[s].plane = plane;
+		slices[s].distances.resize(size_t(plane.width) * plane.height);
+		for (int y = 0; y < plane.height; y += tileSize)
+			for (int x = 0; x < plane.width; x += tileSize)
+				tiles.push_back({ s, x, y, std::min(x + tileSize, plane.width), std::min(y + tileSize, plane.height) });
+		stats.samples += slices[s].distances.size();
+	}
+	stats.tiles = tiles.size();
+
+	auto wholeTape = std::make_shared<const Tape>(tape);
+	std::atomic<size_t> simplified{ 0 };
+	pool.ParallelFor(tiles.size(), 1, [&](size_t begin, size_t end) {
+		thread_local std::vector<float> x, y, z, d;
+		thread_local std::vector<TapeChoice> choices;
+		for (size_t i = begin; i < end; ++i) {
+			const Tile& tile = tiles[i];
+			Slice& slice = slices[tile.slice];
+			const SlicePlane& plane = slice.plane;
+
+			// the box around the centers of the pixels of the tile
+			glm::vec3 corners[4] = {
+				plane.Point((tile.x0 + 0.5f) / plane.width, (tile.y0 + 0.5f) / plane.height),
+				plane.Point((tile.x1 - 0.5f) / plane.width, (tile.y0 + 0.5f) / plane.height),
+				plane.Point((tile.x0 + 0.5f) / plane.width, (tile.y1 - 0.5f) / plane.height),
+				plane.Point((tile.x1 - 0.5f) / plane.width, (tile.y1 - 0.5f) / plane.height),
+			};
+			BoundingBox box(corners[0], corners[0]);
+			for (const glm::vec3& c : corners) {
+				box.min = glm::min(box.min, c);
+				box.max = glm::max(box.max, c);
+			}
+			TapeEvaluator::EvaluateInterval(tape, box, &choices);
+			std::unique_ptr<Tape> tileTape;
+			if (TapeSimplifier::CanSimplify(choices)) {
+				tileTape = std::make_unique<Tape>(TapeSimplifier::Simplify(tape, choices));
+				++simplified;
+			}
+
+			size_t n = size_t(tile.x1 - tile.x0) * (tile.y1 - tile.y0);
+			x.resize(n);
+			y.resize(n);
+			z.resize(n);
+			d.resize(n);
+			size_t k = 0;
+			for (int py = tile.y0; py < tile.y1; ++py) {
+				for (int px = tile.x0; px < tile.x1; ++px, ++k) {
+					glm::vec3 p = plane.Point((px + 0.5f) / plane.width, (py + 0.5f) / plane.height);
+					x[k] = p.x;
+					y[k] = p.y;
+					z[k] = p.z;
+				}
+			}
+			TapeEvaluator::Evaluate(tileTape ? *tileTape : tape, x.data(), y.data(), z.data(), d.data(), n);
+			k = 0;
+			for (int py = tile.y0; py < tile.y1; ++py)
+				for (int px = tile.x0; px < tile.x1; ++px)
+					slice.distances[size_t(py) * plane.width + px] = d[k++];
+		}
+	});
+	stats.simplifiedTiles = simplified;
+
+	std::atomic<size_t> vertices{ 0 }, refined{ 0 };
+	pool.ParallelFor(slices.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t s = begin; s < end; ++s) {
+			size_t sliceVertices = 0, sliceRefined = 0;
+			ExtractContours(tape, slices[s], sliceVertices, sliceRefined);
+			vertices += sliceVertices;
+			refined += sliceRefined;
+		}
+	});
+	stats.vertices = vertices;
+	stats.refined = refined;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return slices;
+}
+
+void SliceExporter::ExtractContours(const Tape& tape, Slice& slice, size_t& vertexCount, size_t& refinedCount) const
+{
+	const SlicePlane& plane = slice.plane;
+	const int width = plane.width, height = plane.height;
+	auto inside = [&](int x, int y) { return slice.At(x, y) < 0; };
+
+	// the crossings of the grid edges, at the zero of the linear interpolation
+	std::vector<Crossing> crossings;
+	std::unordered_map<uint64_t, uint32_t> crossingOf;
+	auto crossing = [&](int x, int y, bool vertical) {
+		uint64_t key = EdgeKey(x, y, vertical, width);
+		auto it = crossingOf.find(key);
+		if (it != crossingOf.end())
+			return it->second;
+		float a = slice.At(x, y), b = vertical ? slice.At(x, y + 1) : slice.At(x + 1, y);
+		float t = a / (a - b);
+		glm::vec2 grid = glm::vec2(x, y) + (vertical ? glm::vec2(0, t) : glm::vec2(t, 0));
+		crossingOf.emplace(key, (uint32_t)crossings.size());
+		crossings.push_back({ key, grid });
+		return (uint32_t)crossings.size() - 1;
+	};
+
+	// marching squares: the edges of a cell in cyclic order, a segment goes from a crossing entering the inside to one leaving it
+	std::vector<std::pair<uint32_t, uint32_t>> segments;
+	for (int y = 0; y + 1 < height; ++y) {
+		for (int x = 0; x + 1 < width; ++x) {
+			const int cx[4] = { x, x + 1, x + 1, x };
+			const int cy[4] = { y, y, y + 1, y + 1 };
+			bool in[4];
+			int mask = 0;
+			for (int c = 0; c < 4; ++c) {
+				in[c] = inside(cx[c], cy[c]);
+				mask |= in[c] ? 1 << c : 0;
+			}
+			if (mask == 0 || mask == 15)
+				continue;
+
+			uint32_t ids[4];
+			bool entering[4];
+			int count = 0;
+			for (int e = 0; e < 4; ++e) {
+				int a = e, b = (e + 1) % 4;
+				if (in[a] == in[b])
+					continue;
+				// edges 0 and 2 are horizontal, 1 and 3 vertical, keyed by their upper or left end
+				bool vertical = e % 2 == 1;
+				ids[count] = crossing(std::min(cx[a], cx[b]), std::min(cy[a], cy[b]), vertical);
+				entering[count] = in[b];
+				++count;
+			}
+
+			// at saddles the inside corners are connected if the average is inside: the pairs then go around the outside corners
+			bool connected = count == 4 && (slice.At(x, y) + slice.At(x + 1, y) + slice.At(x + 1, y + 1) + slice.At(x, y + 1)) < 0;
+			for (int i = 0; i < count; ++i) {
+				int j = (i + 1) % count;
+				if (entering[i] && !connected)
+					segments.emplace_back(ids[i], ids[j]);
+				else if (!entering[i] && connected)
+					segments.emplace_back(ids[j], ids[i]);
+			}
+		}
+	}
+
+	// Newton steps inside the plane from the interpolated positions, all vertices in one batch per step
+	glm::vec3 normal = plane.Normal();
+	glm::vec2 pixel(glm::length(plane.u) / width, glm::length(plane.v) / height);
+	glm::vec3 unitU = glm::normalize(plane.u), unitV = glm::normalize(plane.v);
+	auto world = [&](glm::vec2 grid) { return plane.Point((grid.x + 0.5f) / width, (grid.y + 0.5f) / height); };
+	size_t n = crossings.size();
+	std::vector<glm::vec3> positions(n);
+	std::vector<float> x(n), y(n), z(n);
+	std::vector<Dual<1>> values(n);
+	std::vector<uint32_t> moving(n);
+	for (size_t i = 0; i < n; ++i) {
+		positions[i] = world(crossings[i].grid);
+		moving[i] = (uint32_t)i;
+	}
+	float limit = tolerance * std::min(pixel.x, pixel.y);
+	std::vector<bool> converged(n, false);
+	for (int iteration = 0; iteration <= newtonIterations && !moving.empty(); ++iteration) {
+		for (size_t k = 0; k < moving.size(); ++k) {
+			x[k] = positions[moving[k]].x;
+			y[k] = positions[moving[k]].y;
+			z[k] = positions[moving[k]].z;
+		}
+		TapeEvaluator::EvaluateDerivatives<1>(tape, x.data(), y.data(), z.data(), values.data(), moving.size());
+		size_t still = 0;
+		for (size_t k = 0; k < moving.size(); ++k) {
+			uint32_t i = moving[k];
+			const Dual<1>& v = values[k];
+			if (std::abs(v.d[0]) <= limit) {
+				converged[i] = true;
+				continue;
+			}
+			glm::vec3 gradient(v.d[1], v.d[2], v.d[3]);
+			gradient -= normal * glm::dot(normal, gradient);
+			float g2 = glm::dot(gradient, gradient);
+			if (iteration == newtonIterations || !(g2 > 0) || !std::isfinite(g2))
+				continue;
+			positions[i] -= gradient * (v.d[0] / g2);
+			moving[still++] = i;
+		}
+		moving.resize(still);
+	}
+
+	// the vertices in the coordinates of the slice, refined ones only if they stayed within a pixel of the interpolation
+	std::vector<glm::vec2> points(n);
+	size_t refined = 0;
+	for (size_t i = 0; i < n; ++i) {
+		glm::vec2 interpolated = (crossings[i].grid + 0.5f) * pixel;
+		glm::vec3 offset = positions[i] - plane.origin;
+		glm::vec2 projected(glm::dot(offset, unitU), glm::dot(offset, unitV));
+		bool near = glm::all(glm::lessThanEqual(glm::abs(projected - interpolated), pixel));
+		points[i] = converged[i] && near ? projected : interpolated;
+		refined += converged[i] && near ? 1 : 0;
+	}
+
+	// chains the segments: every crossing starts at most one segment and ends at most one
+	std::vector<int64_t> next(n, -1);
+	std::vector<bool> hasPrevious(n, false);
+	for (auto& [from, to] : segments) {
+		next[from] = to;
+		hasPrevious[to] = true;
+	}
+	std::vector<bool> used(n, false);
+	auto follow = [&](uint32_t first) {
+		Contour contour;
+		int64_t i = first;
+		while (i >= 0 && !used[i]) {
+			used[i] = true;
+			contour.points.push_back(points[i]);
+			i = next[i];
+		}
+		contour.closed = i == first;
+		slice.contours.push_back(std::move(contour));
+	};
+	for (uint32_t i = 0; i < n; ++i) // open lines first, from their start on the border
+		if (!hasPrevious[i] && next[i] >= 0)
+			follow(i);
+	for (uint32_t i = 0; i < n; ++i)
+		if (!used[i] && next[i] >= 0)
+			follow(i);
+
+	vertexCount = n;
+	refinedCount = refined;
+}
+
+Image SliceExporter::DistanceImage(const Slice& slice)
+{
+	Image image(slice.plane.width, slice.plane.height);
+	for (int y = 0; y < image.height; ++y)
+		for (int x = 0; x < image.width; ++x)
+			image.At(x, y) = glm::vec4(glm::vec3(slice.At(x, y)), 1);
+	return image;
+}
+
+Image SliceExporter::ColorImage(const Slice& slice, float bandWidth)
+{
+	const float pi = 3.14159265f;
+	float pixel = glm::length(slice.plane.u) / slice.plane.width;
+	Image image(slice.plane.width, slice.plane.height);
+	for (int y = 0; y < image.height; ++y) {
+		for (int x = 0; x < image.width; ++x) {
+			float d = slice.At(x, y);
+			glm::vec3 color = d > 0 ? glm::vec3(0.9f, 0.6f, 0.3f) : glm::vec3(0.4f, 0.7f, 0.85f);
+			color *= 0.8f + 0.2f * std::cos(2 * pi * d / bandWidth);
+			color = glm::mix(color, glm::vec3(1), glm::clamp(1.5f - std::abs(d) / pixel, 0.0f, 1.0f));
+			image.At(x, y) = glm::vec4(color, 1);
+		}
+	}
+	return image;
+}
+
+void SliceExporter::WriteSvg(const Slice& slice, const std::string& fileName)
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+		throw std::runtime_error("Can't write " + fileName);
+	float w = glm::length(slice.plane.u), h = glm::length(slice.plane.v);
+	file << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << slice.plane.width << "\" height=\"" << slice.plane.height
+		<< "\" viewBox=\"0 0 " << w << ' ' << h << "\">\n";
+	file << "<g fill=\"none\" stroke=\"black\" stroke-width=\"" << w / slice.plane.width << "\">\n";
+	file.precision(8);
+	for (const Contour& contour : slice.contours) {
+		if (contour.points.empty())
+			continue;
+		file << "<path d=\"M";
+		for (const glm::vec2& p : contour.points)
+			file << ' ' << p.x << ' ' << p.y;
+		file << (contour.closed ? " Z\"/>\n" : "\"/>\n");
+	}
+	file << "</g>\n</svg>\n";
+	if (!file)
+		throw std::runtime_error("Failed to write " + fileName);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "Tape.h"
+#include "BoundingBox.h"
+#include "ImageIO.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// A rectangle of a plane sampled with width x height pixels. Pixel (x, y) has its center at Point((x + 0.5) / width, (y + 0.5) / height),
+/// rows go from top to bottom like in Image. u and v must be orthogonal.
+/// </summary>
+struct SlicePlane {
+	glm::vec3 origin = glm::vec3(0); // the top left corner
+	glm::vec3 u = glm::vec3(1, 0, 0); // the top edge, from left to right
+	glm::vec3 v = glm::vec3(0, -1, 0); // the left edge, from top to bottom
+	int width = 512;
+	int height = 512;
+
+	glm::vec3 Point(float s, float t) const { return origin + s * u + t * v; }
+	glm::vec3 Normal() const { return glm::normalize(glm::cross(u, v)); }
+
+	/// <summary>
+	/// The cross section of box perpendicular to axis (0, 1, 2 for x, y, z) at offset along it, with square pixels and resolution pixels
+	/// on its longer side. Looks down the axis: z is up for the x and y axes, y is up for the z axis.
+	/// </summary>
+	static SlicePlane Across(const BoundingBox& box, int axis, float offset, int resolution);
+};
+
+/// <summary>
+/// A polyline of the zero set in the coordinates of a slice: lengths along u and v from the origin, like the pixels. The inside is on the
+/// left of the direction of the line as seen on the image (counter-clockwise around solids, clockwise around holes), closed lines don't
+/// repeat their first point.
+/// </summary>
+struct Contour {
+	std::vector<glm::vec2> points;
+	bool closed = false; // open lines end at the border of the slice
+};
+
+struct Slice {
+	SlicePlane plane;
+	std::vector<float> distances; // at the pixel centers, row by row
+	std::vector<Contour> contours;
+
+	float At(int x, int y) const { return distances[size_t(y) * plane.width + x]; }
+};
+
+struct SliceStats {
+	size_t slices = 0;
+	size_t tiles = 0;
+	size_t simplifiedTiles = 0; // tiles evaluated with a shorter tape than the whole one
+	size_t samples = 0;
+	size_t vertices = 0; // of the contours
+	size_t refined = 0; // vertices moved onto the zero set by the Newton steps, the others stay where the samples interpolate it
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Cross sections of a tape: the distance at every pixel of a plane, and the contours of the zero set.
+///
+/// The pixels of every slice are split into tiles that are evaluated in parallel, all slices at once. A tile gets the tape simplified
+/// to the operands that can win inside the box around it (see IntervalOctree), so tiles away from the surface evaluate few primitives.
+/// The contours are extracted per slice with marching squares between the pixel centers (saddles are resolved by the average of the
+/// corners), their vertices interpolated on the edges are then moved onto the zero set by Newton steps inside the plane, with gradients
+/// of dual numbers evaluated in batches. Vertices that don't converge within a pixel keep the interpolated position.
+/// </summary>
+class SliceExporter
+{
+public:
+	int tileSize = 32; // pixels per side of a tile
+	int newtonIterations = 4;
+	float tolerance = 1e-3f; // |f| of the refined vertices, relative to the size of a pixel
+
+	std::vector<Slice> Export(const Tape& tape, const std::vector<SlicePlane>& planes, ThreadPool& pool = ThreadPool::Global());
+
+	const SliceStats& Stats() const { return stats; }
+
+	/// <summary>
+	/// The distances in every color channel (alpha is 1), for EXR files.
+	/// </summary>
+	static Image DistanceImage(const Slice& slice);
+
+	/// <summary>
+	/// The distances as colors: orange outside, blue inside, darker bands every bandWidth and a white line at the surface.
+	/// </summary>
+	static Image ColorImage(const Slice& slice, float bandWidth);
+
+	/// <summary>
+	/// The contours as SVG paths in the coordinates of the slice, the image is as large as the slice in pixels.
+	/// Throws std::runtime_error if the file can't be written.
+	/// </summary>
+	static void WriteSvg(const Slice& slice, const std::string& fileName);
+
+private:
+	SliceStats stats;
+
+	void ExtractContours(const Tape& tape, Slice& slice, size_t& vertices, size_t& refined) const;
+};
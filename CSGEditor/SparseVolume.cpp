@@ -0,0 +1,397 @@
+#include "SparseVolume.h"
+#include "MarchingCubes.h"
+#include "TapeEvaluator.h"
+#include "TapeSimplifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	constexpr uint32_t leafVoxels = SparseVolume::leafSize * SparseVolume::leafSize * SparseVolume::leafSize;
+
+	// Morton codes of coordinates with up to 21 bits, the children of an octree node are visited in this order
+	uint64_t Spread(uint32_t v) {
+		uint64_t x = v & 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffull;
+		x = (x | x << 16) & 0x1f0000ff0000ffull;
+		x = (x | x << 8) & 0x100f00f00f00f00full;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	}
+
+	uint64_t Morton(glm::uvec3 p) { return Spread(p.x) | Spread(p.y) << 1 | Spread(p.z) << 2; }
+
+	uint64_t AlignUp(uint64_t offset) { return (offset + SparseVolumeHeader::alignment - 1) / SparseVolumeHeader::alignment * SparseVolumeHeader::alignment; }
+
+	// voxels are addressed by their integer coordinates, their centers are computed from them the same way everywhere
+	struct VolumeGrid {
+		glm::vec3 origin;
+		float voxelSize;
+
+		glm::vec3 Center(glm::uvec3 v) const { return origin + (glm::vec3(v) + 0.5f) * voxelSize; }
+		// the box through the centers of the size^3 voxels at min
+		BoundingBox Box(glm::uvec3 min, uint32_t size) const { return BoundingBox(Center(min), Center(min + glm::uvec3(size - 1))); }
+	};
+
+	// the output of a block, in the order of the file
+	struct BlockResult {
+		std::vector<SparseVolumeLeaf> leaves;
+		std::vector<float> data; // leafStride / sizeof(float) per leaf
+		std::vector<glm::uvec4> tiles;
+
+		size_t Bytes() const { return leaves.capacity() * sizeof(SparseVolumeLeaf) + data.capacity() * sizeof(float) + tiles.capacity() * sizeof(glm::uvec4); }
+	};
+
+	// descends the octree with interval arithmetic, skipping the nodes outside the band and recording the ones inside as tiles
+	struct BandOctree {
+		const VolumeGrid& grid;
+		float band;
+		std::vector<glm::uvec4>& tiles;
+		size_t tests = 0;
+		std::vector<TapeChoice> choices;
+
+		BandOctree(const VolumeGrid& grid, float band, std::vector<glm::uvec4>& tiles) : grid(grid), band(band), tiles(tiles) {}
+
+		// calls onNode(tape, min) for the nodes of stopSize that may have voxels in the band, with a tape valid inside them
+		template<typename F>
+		void Visit(const Tape& tape, glm::uvec3 min, uint32_t size, uint32_t stopSize, F&& onNode) {
+			++tests;
+			Interval value = TapeEvaluator::EvaluateInterval(tape, grid.Box(min, size), &choices);
+			if (value.lower >= band)
+				return;
+			if (value.upper <= -band) {
+				tiles.emplace_back(min, size);
+				return;
+			}
+			Tape simplified;
+			const Tape* nodeTape = &tape;
+			if (TapeSimplifier::CanSimplify(choices)) {
+				simplified = TapeSimplifier::Simplify(tape, choices);
+				nodeTape = &simplified;
+			}
+			if (size == stopSize) {
+				onNode(*nodeTape, min);
+				return;
+			}
+			uint32_t half = size / 2;
+			for (uint32_t c = 0; c < 8; ++c)
+				Visit(*nodeTape, min + glm::uvec3(c & 1, (c >> 1) & 1, (c >> 2) & 1) * half, half, stopSize, onNode);
+		}
+	};
+
+	// samples the leaves of a block
+	struct LeafSampler {
+		const VolumeGrid& grid;
+		float band;
+		bool gradients;
+		std::vector<float> x, y, z, values;
+		std::vector<Dual<1>> derivatives;
+		size_t samples = 0, gradientSamples = 0;
+
+		LeafSampler(const VolumeGrid& grid, float band, bool gradients) : grid(grid), band(band), gradients(gradients) {}
+
+		size_t Bytes() const {
+			return (x.capacity() + y.capacity() + z.capacity() + values.capacity()) * sizeof(float)
+				+ derivatives.capacity() * sizeof(Dual<1>);
+		}
+
+		void Leaf(const Tape& tape, glm::uvec3 min, BlockResult& result) {
+			x.resize(leafVoxels);
+			y.resize(leafVoxels);
+			z.resize(leafVoxels);
+			values.resize(leafVoxels);
+			for (uint32_t i = 0; i < leafVoxels; ++i) {
+				glm::vec3 p = grid.Center(min + glm::uvec3(i % 8, i / 8 % 8, i / 64));
+				x[i] = p.x;
+				y[i] = p.y;
+				z[i] = p.z;
+			}
+			TapeEvaluator::Evaluate(tape, x.data(), y.data(), z.data(), values.data(), leafVoxels);
+			samples += leafVoxels;
+
+			// a leaf without voxels in the band is background or a tile, like the nodes that were pruned
+			bool allOutside = std::all_of(values.begin(), values.end(), [&](float v) { return v >= band; });
+			bool allInside = std::all_of(values.begin(), values.end(), [&](float v) { return v <= -band; });
+			if (allOutside)
+				return;
+			if (allInside) {
+				result.tiles.emplace_back(min, SparseVolume::leafSize);
+				return;
+			}
+
+			SparseVolumeLeaf leaf{};
+			leaf.origin[0] = min.x;
+			leaf.origin[1] = min.y;
+			leaf.origin[2] = min.z;
+			size_t first = result.data.size();
+			result.data.resize(first + (gradients ? 4 : 1) * leafVoxels);
+			float* data = result.data.data() + first;
+			for (uint32_t i = 0; i < leafVoxels; ++i) {
+				if (std::abs(values[i]) < band) {
+					leaf.activeMask[i / 64] |= 1ull << (i % 64);
+					++leaf.activeCount;
+				}
+				data[i] = glm::clamp(values[i], -band, band);
+			}
+			result.leaves.push_back(leaf);
+			if (gradients)
+				Gradients(tape, data + leafVoxels);
+		}
+
+		// the derivatives of the unclamped sdf, central differences where they are not defined (eg.: on the faces of a box)
+		void Gradients(const Tape& tape, float* planes) {
+			derivatives.resize(leafVoxels);
+			TapeEvaluator::EvaluateDerivatives<1>(tape, x.data(), y.data(), z.data(), derivatives.data(), leafVoxels);
+			gradientSamples += leafVoxels;
+			for (uint32_t i = 0; i < leafVoxels; ++i) {
+				glm::vec3 g(derivatives[i].d[1], derivatives[i].d[2], derivatives[i].d[3]);
+				if (!std::isfinite(g.x) || !std::isfinite(g.y) || !std::isfinite(g.z)) {
+					const float step = grid.voxelSize * 1e-2f;
+					for (int axis = 0; axis < 3; ++axis) {
+						float p[3] = { x[i], y[i], z[i] }, m[3] = { x[i], y[i], z[i] }, d[2];
+						p[axis] += step;
+						m[axis] -= step;
+						TapeEvaluator::Evaluate(tape, &p[0], &p[1], &p[2], &d[0], 1);
+						TapeEvaluator::Evaluate(tape, &m[0], &m[1], &m[2], &d[1], 1);
+						g[axis] = (d[0] - d[1]) / (2 * step);
+					}
+					gradientSamples += 6;
+				}
+				planes[i] = g.x;
+				planes[leafVoxels + i] = g.y;
+				planes[2 * leafVoxels + i] = g.z;
+			}
+		}
+	};
+}
+
+void SparseVolume::Write(const Tape& tape, const BoundingBox& box, uint32_t depth, const std::string& fileName, ThreadPool& pool)
+{
+	if (depth < 3 || depth > maxDepth)
+		throw std::invalid_argument("SparseVolume: the depth has to be between 3 and " + std::to_string(maxDepth) + ".");
+	if (!(bandVoxels > 0))
+		throw std::invalid_argument("SparseVolume: the band has to be wider than 0 voxels.");
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = SparseVolumeStats();
+
+	BoundingBox cube = MarchingCubes::GridCube(box);
+	VolumeGrid grid{ cube.min, (cube.max.x - cube.min.x) / float(1u << depth) };
+	const float band = bandVoxels * grid.voxelSize;
+	const uint32_t octreeDepth = std::min(blockDepth, depth - 3);
+	const uint32_t blockSize = 1u << (depth - octreeDepth);
+	const uint32_t channels = gradients ? 4 : 1;
+	const uint64_t leafStride = uint64_t(channels) * leafVoxels * sizeof(float);
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Can't write " + fileName);
+	SparseVolumeHeader header{};
+	std::memcpy(header.magic, SparseVolumeHeader::magicValue, sizeof(header.magic));
+	header.leafSize = leafSize;
+	header.channels = channels;
+	header.depth = depth;
+	header.origin[0] = grid.origin.x;
+	header.origin[1] = grid.origin.y;
+	header.origin[2] = grid.origin.z;
+	header.voxelSize = grid.voxelSize;
+	header.band = band;
+	header.dataOffset = SparseVolumeHeader::alignment;
+	header.leafStride = leafStride;
+	file.write(std::vector<char>(header.dataOffset, 0).data(), header.dataOffset); // the header is written last
+
+	// the coarse levels on this thread, then the blocks in parallel
+	std::vector<glm::uvec4> tiles;
+	std::vector<std::pair<glm::uvec3, std::shared_ptr<const Tape>>> blocks;
+	BandOctree coarse(grid, band, tiles);
+	coarse.Visit(tape, glm::uvec3(0), 1u << depth, blockSize, [&](const Tape& blockTape, glm::uvec3 min) {
+		blocks.emplace_back(min, std::make_shared<Tape>(blockTape));
+	});
+	stats.blocks = blocks.size();
+
+	// finished blocks wait here until the ones before them are written
+	std::mutex writeMutex;
+	std::vector<BlockResult> waiting(blocks.size());
+	std::vector<bool> ready(blocks.size(), false);
+	std::vector<SparseVolumeLeaf> leaves;
+	size_t nextBlock = 0, waitingBytes = 0, peakWaitingBytes = 0;
+	std::atomic<size_t> pruningTests{ coarse.tests }, samples{ 0 }, gradientSamples{ 0 };
+	std::vector<size_t> scratchBytes(pool.ThreadCount(), 0);
+
+	auto write = [&](BlockResult& result) {
+		file.write(reinterpret_cast<const char*>(result.data.data()), result.data.size() * sizeof(float));
+		leaves.insert(leaves.end(), result.leaves.begin(), result.leaves.end());
+		tiles.insert(tiles.end(), result.tiles.begin(), result.tiles.end());
+	};
+
+	pool.ParallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+		LeafSampler sampler(grid, band, gradients);
+		for (size_t b = begin; b < end; ++b) {
+			BlockResult result;
+			BandOctree octree(grid, band, result.tiles);
+			octree.Visit(*blocks[b].second, blocks[b].first, blockSize, leafSize, [&](const Tape& leafTape, glm::uvec3 min) {
+				sampler.Leaf(leafTape, min, result);
+			});
+			pruningTests += octree.tests;
+
+			std::lock_guard<std::mutex> lock(writeMutex);
+			scratchBytes[ThreadPool::ThreadIndex()] = std::max(scratchBytes[ThreadPool::ThreadIndex()], sampler.Bytes() + result.Bytes());
+			if (b != nextBlock) {
+				waitingBytes += result.Bytes();
+				peakWaitingBytes = std::max(peakWaitingBytes, waitingBytes);
+				waiting[b] = std::move(result);
+				ready[b] = true;
+				continue;
+			}
+			write(result);
+			for (++nextBlock; nextBlock < blocks.size() && ready[nextBlock]; ++nextBlock) {
+				write(waiting[nextBlock]);
+				waitingBytes -= waiting[nextBlock].Bytes();
+				waiting[nextBlock] = BlockResult();
+			}
+		}
+		samples += sampler.samples;
+		gradientSamples += sampler.gradientSamples;
+	});
+
+	// the leaves were written in Morton order, the tables follow the data
+	header.leafCount = leaves.size();
+	header.tileCount = tiles.size();
+	header.leafOffset = AlignUp(header.dataOffset + header.leafCount * leafStride);
+	header.tileOffset = AlignUp(header.leafOffset + header.leafCount * sizeof(SparseVolumeLeaf));
+	header.fileSize = header.tileOffset + header.tileCount * sizeof(glm::uvec4);
+	auto pad = [&](uint64_t offset) {
+		file.write(std::vector<char>(offset - (uint64_t)file.tellp(), 0).data(), offset - (uint64_t)file.tellp());
+	};
+	pad(header.leafOffset);
+	file.write(reinterpret_cast<const char*>(leaves.data()), leaves.size() * sizeof(SparseVolumeLeaf));
+	pad(header.tileOffset);
+	file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(glm::uvec4));
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.close();
+	if (!file)
+		throw std::runtime_error("Failed to write " + fileName);
+
+	stats.pruningTests = pruningTests;
+	stats.leaves = leaves.size();
+	for (auto& leaf : leaves)
+		stats.activeVoxels += leaf.activeCount;
+	stats.tiles = tiles.size();
+	stats.samples = samples;
+	stats.gradientSamples = gradientSamples;
+	stats.bytes = header.fileSize;
+	stats.peakBytes = peakWaitingBytes + leaves.capacity() * sizeof(SparseVolumeLeaf) + tiles.capacity() * sizeof(glm::uvec4);
+	for (size_t bytes : scratchBytes)
+		stats.peakBytes += bytes;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+SparseVolumeFile::SparseVolumeFile(const std::string& fileName)
+{
+#ifdef _WIN32
+	file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+		file = nullptr;
+		throw std::runtime_error("Can't open " + fileName);
+	}
+	size = (size_t)fileSize.QuadPart;
+	mapping = size >= sizeof(SparseVolumeHeader) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	data = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+	file = open(fileName.c_str(), O_RDONLY);
+	struct stat status;
+	if (file < 0 || fstat(file, &status) != 0) {
+		if (file >= 0)
+			close(file);
+		file = -1;
+		throw std::runtime_error("Can't open " + fileName);
+	}
+	size = (size_t)status.st_size;
+	if (size >= sizeof(SparseVolumeHeader)) {
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+		data = mapped == MAP_FAILED ? nullptr : static_cast<const char*>(mapped);
+	}
+#endif
+	if (data == nullptr || std::memcmp(Header().magic, SparseVolumeHeader::magicValue, sizeof(Header().magic)) != 0
+		|| Header().fileSize > size || Header().leafSize != SparseVolume::leafSize) {
+		Unmap();
+		throw std::runtime_error(fileName + " is not a sparse volume file");
+	}
+}
+
+SparseVolumeFile::~SparseVolumeFile()
+{
+	Unmap();
+}
+
+void SparseVolumeFile::Unmap()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	mapping = file = nullptr;
+#else
+	if (data)
+		munmap(const_cast<char*>(data), size);
+	if (file >= 0)
+		close(file);
+	file = -1;
+#endif
+	data = nullptr;
+}
+
+int64_t SparseVolumeFile::FindLeaf(glm::uvec3 voxel) const
+{
+	glm::uvec3 origin = voxel / SparseVolume::leafSize * SparseVolume::leafSize;
+	uint64_t code = Morton(origin / SparseVolume::leafSize);
+	const SparseVolumeLeaf* first = &Leaf(0);
+	const SparseVolumeLeaf* last = first + LeafCount();
+	auto leafCode = [](const SparseVolumeLeaf& leaf) {
+		return Morton(glm::uvec3(leaf.origin[0], leaf.origin[1], leaf.origin[2]) / SparseVolume::leafSize);
+	};
+	auto it = std::lower_bound(first, last, code, [&](const SparseVolumeLeaf& leaf, uint64_t c) { return leafCode(leaf) < c; });
+	return it != last && leafCode(*it) == code ? it - first : -1;
+}
+
+float SparseVolumeFile::Value(glm::uvec3 voxel) const
+{
+	int64_t leaf = FindLeaf(voxel);
+	if (leaf >= 0) {
+		glm::uvec3 local = voxel % SparseVolume::leafSize;
+		return LeafData((size_t)leaf)[local.x + 8 * local.y + 64 * local.z];
+	}
+	auto tiles = reinterpret_cast<const glm::uvec4*>(data + Header().tileOffset);
+	for (size_t i = 0; i < Header().tileCount; ++i) // a linear search, good enough for spot checks
+		if (glm::all(glm::greaterThanEqual(voxel, glm::uvec3(tiles[i]))) && glm::all(glm::lessThan(voxel, glm::uvec3(tiles[i]) + tiles[i].w)))
+			return -Header().band;
+	return Header().band;
+}
+
+glm::vec3 SparseVolumeFile::VoxelCenter(glm::uvec3 voxel) const
+{
+	const SparseVolumeHeader& h = Header();
+	return glm::vec3(h.origin[0], h.origin[1], h.origin[2]) + (glm::vec3(voxel) + 0.5f) * h.voxelSize;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include "Tape.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// The header at the start of a sparse volume file. All fields and arrays are little endian and the arrays start at multiples of
+/// SparseVolumeHeader::alignment, so a mapped file can be read in place:
+///  - leafCount leaf records at leafOffset: SparseVolumeLeaf, sorted by the Morton code of their origin (binary searchable)
+///  - leafCount data blocks at dataOffset, leafStride bytes each: 512 floats of clamped distance, then 3 * 512 floats of gradient (x, y, z
+///    planes) if channels is 4. Voxel (x, y, z) of a leaf is element x + 8 * y + 64 * z.
+///  - tileCount tiles at tileOffset: { x, y, z, size } as uint32, cubes of voxels that are entirely inside (distance below -band).
+/// Voxels outside the leaves and the tiles are outside the surface, with a distance of at least band.
+/// </summary>
+struct SparseVolumeHeader {
+	static constexpr char magicValue[8] = { 'C', 'S', 'G', 'V', 'O', 'L', '0', '1' };
+	static constexpr uint64_t alignment = 4096;
+
+	char magic[8];
+	uint32_t leafSize; // 8: voxels per axis of a leaf
+	uint32_t channels; // 1: distance, 4: distance and gradient
+	uint32_t depth; // 2^depth voxels per axis
+	uint32_t reserved;
+	float origin[3]; // corner of the volume, voxel (x, y, z) is centered at origin + (x + 0.5, y + 0.5, z + 0.5) * voxelSize
+	float voxelSize;
+	float band; // distances are clamped to [-band, band], voxels with smaller |distance| are active
+	float padding;
+	uint64_t leafCount;
+	uint64_t tileCount;
+	uint64_t leafOffset;
+	uint64_t dataOffset;
+	uint64_t leafStride;
+	uint64_t tileOffset;
+	uint64_t fileSize;
+};
+
+struct SparseVolumeLeaf {
+	uint32_t origin[3]; // in voxels, multiples of 8
+	uint32_t activeCount;
+	uint64_t activeMask[8]; // bit i of the 512 is set if voxel i is in the band
+};
+
+struct SparseVolumeStats {
+	size_t blocks = 0; // octree nodes built in parallel
+	size_t pruningTests = 0; // interval evaluations
+	size_t leaves = 0;
+	size_t activeVoxels = 0;
+	size_t tiles = 0;
+	size_t samples = 0; // voxels evaluated, the gradients are counted separately
+	size_t gradientSamples = 0;
+	size_t bytes = 0; // size of the file
+	size_t peakBytes = 0; // the leaves waiting for their turn and the per thread scratch memory
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Samples the sdf on a narrow band of a virtual grid of 2^depth voxels per axis, stored like a VDB tree: only the leaves of 8^3 voxels
+/// near the surface are kept, the regions entirely inside are kept as tiles and everything else is background outside the surface.
+///
+/// The octree is descended with interval arithmetic (simplifying the tape on the way like BrickOctree), pruning the nodes whose distance
+/// is outside [-band, band]. The nodes of blockDepth are finished in parallel and their leaves are written in a fixed (Morton) order,
+/// so the file is the same with any thread count. Gradients are the derivatives of the unclamped sdf (see TapeEvaluator::EvaluateDerivatives).
+/// </summary>
+class SparseVolume
+{
+public:
+	static constexpr uint32_t leafSize = 8;
+	static constexpr uint32_t maxDepth = 21;
+
+	float bandVoxels = 3; // half width of the band in voxels
+	uint32_t blockDepth = 4; // octree depth of the parallel tasks, lowered if needed to keep a leaf per block
+	bool gradients = false; // 4 channels instead of 1
+
+	/// <summary>
+	/// Writes the volume of the cube around box (see MarchingCubes::GridCube) with 2^depth voxels per axis into fileName.
+	/// Throws std::invalid_argument for depths outside [3, maxDepth] and std::runtime_error if the file can't be written.
+	/// </summary>
+	void Write(const Tape& tape, const BoundingBox& box, uint32_t depth, const std::string& fileName, ThreadPool& pool = ThreadPool::Global());
+
+	const SparseVolumeStats& Stats() const { return stats; }
+
+private:
+	SparseVolumeStats stats;
+};
+
+/// <summary>
+/// A sparse volume file mapped into memory read only. Throws std::runtime_error if the file can't be mapped or isn't a sparse volume.
+/// </summary>
+class SparseVolumeFile
+{
+public:
+	explicit SparseVolumeFile(const std::string& fileName);
+	~SparseVolumeFile();
+
+	SparseVolumeFile(const SparseVolumeFile&) = delete;
+	SparseVolumeFile& operator=(const SparseVolumeFile&) = delete;
+
+	const SparseVolumeHeader& Header() const { return *reinterpret_cast<const SparseVolumeHeader*>(data); }
+	size_t LeafCount() const { return Header().leafCount; }
+	const SparseVolumeLeaf& Leaf(size_t i) const { return reinterpret_cast<const SparseVolumeLeaf*>(data + Header().leafOffset)[i]; }
+
+	/// <summary>
+	/// The 512 distances of the i-th leaf, followed by the gradient planes if there are 4 channels.
+	/// </summary>
+	const float* LeafData(size_t i) const { return reinterpret_cast<const float*>(data + Header().dataOffset + i * Header().leafStride); }
+
+	/// <summary>
+	/// Index of the leaf containing the voxel, -1 if there isn't one.
+	/// </summary>
+	int64_t FindLeaf(glm::uvec3 voxel) const;
+
+	/// <summary>
+	/// The stored distance of the voxel: from its leaf, -band in the tiles, band elsewhere. Searches the tiles linearly.
+	/// </summary>
+	float Value(glm::uvec3 voxel) const;
+
+	glm::vec3 VoxelCenter(glm::uvec3 voxel) const;
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+
+	void Unmap();
+};
@@ -0,0 +1,189 @@
+#include "SurfaceSampler.h"
+#include "TapeEvaluator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace {
+	// points of the cell being sampled, with the value and gradient at them
+	struct CellWork {
+		std::vector<float> x, y, z;
+		std::vector<Dual<1>> d;
+
+		void Resize(size_t n) {
+			x.resize(n);
+			y.resize(n);
+			z.resize(n);
+			d.resize(n);
+		}
+
+		void RandomPoints(const BoundingBox& box, size_t n, std::mt19937& rng) {
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = box.min.x + (box.max.x - box.min.x) * unit(rng);
+				y[i] = box.min.y + (box.max.y - box.min.y) * unit(rng);
+				z[i] = box.min.z + (box.max.z - box.min.z) * unit(rng);
+			}
+		}
+
+		// moves the points inside the shell |f| < delta * |grad f| to the front, returns their count
+		size_t KeepShell(size_t n, float delta) {
+			size_t kept = 0;
+			for (size_t i = 0; i < n; ++i) {
+				const Dual<1>& v = d[i];
+				if (std::abs(v.d[0]) < delta * std::sqrt(v.d[1] * v.d[1] + v.d[2] * v.d[2] + v.d[3] * v.d[3]))
+					Move(i, kept++);
+			}
+			return kept;
+		}
+
+		void Move(size_t from, size_t to) {
+			x[to] = x[from];
+			y[to] = y[from];
+			z[to] = z[from];
+			d[to] = d[from];
+		}
+	};
+
+	bool Contains(const BoundingBox& box, glm::vec3 p) {
+		return glm::all(glm::greaterThanEqual(p, box.min)) && glm::all(glm::lessThanEqual(p, box.max));
+	}
+
+	float ShellDelta(const BoundingBox& box, float shellWidth) {
+		glm::vec3 size = box.max - box.min;
+		return shellWidth * std::min(size.x, std::min(size.y, size.z));
+	}
+}
+
+size_t SurfaceSampler::Sample(const Tape& tape, const BoundingBox& box, size_t count, const Sink& sink, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = SamplerStats();
+
+	IntervalOctree octree;
+	octree.Build(tape, box, octreeDepth, pool);
+	std::vector<uint32_t> surfaceCells = octree.SurfaceCells();
+	stats.surfaceCells = surfaceCells.size();
+	if (surfaceCells.empty() || count == 0)
+		return 0;
+
+	std::atomic<size_t> seeds{ 0 }, projected{ 0 }, rejected{ 0 };
+	auto cellRng = [&](size_t cell, unsigned int pass) {
+		std::seed_seq sequence{ seed, (unsigned int)cell, pass };
+		return std::mt19937(sequence);
+	};
+
+	// surface area in each cell, from the fraction of random points in the shell: the shell has a volume of area * 2 * delta
+	std::vector<float> areas(surfaceCells.size());
+	pool.ParallelFor(surfaceCells.size(), 16, [&](size_t begin, size_t end) {
+		thread_local CellWork work;
+		work.Resize(seedsPerBatch);
+		for (size_t c = begin; c < end; ++c) {
+			const OctreeCell& cell = octree.Cells()[surfaceCells[c]];
+			auto rng = cellRng(c, 0);
+			work.RandomPoints(cell.box, seedsPerBatch, rng);
+			TapeEvaluator::EvaluateDerivatives<1>(*cell.tape, work.x.data(), work.y.data(), work.z.data(), work.d.data(), seedsPerBatch);
+			float delta = ShellDelta(cell.box, shellWidth);
+			glm::vec3 size = cell.box.max - cell.box.min;
+			areas[c] = float(work.KeepShell(seedsPerBatch, delta)) / seedsPerBatch * (size.x * size.y * size.z) / (2 * delta);
+		}
+		seeds += (end - begin) * seedsPerBatch;
+	});
+	double totalArea = 0;
+	for (float a : areas)
+		totalArea += a;
+	stats.surfaceArea = float(totalArea);
+	if (totalArea == 0)
+		return 0;
+
+	std::mutex sinkMutex;
+	size_t delivered = 0;
+	std::vector<std::vector<SurfaceSample>> buffers(pool.ThreadCount());
+	auto flush = [&](std::vector<SurfaceSample>& buffer) {
+		std::lock_guard<std::mutex> lock(sinkMutex);
+		sink(buffer.data(), buffer.size());
+		delivered += buffer.size();
+		buffer.clear();
+	};
+
+	pool.ParallelFor(surfaceCells.size(), 16, [&](size_t begin, size_t end) {
+		thread_local CellWork work;
+		work.Resize(seedsPerBatch);
+		std::vector<SurfaceSample>& buffer = buffers[ThreadPool::ThreadIndex()];
+		size_t localSeeds = 0, localProjected = 0, localRejected = 0;
+
+		for (size_t c = begin; c < end; ++c) {
+			const OctreeCell& cell = octree.Cells()[surfaceCells[c]];
+			const Tape& cellTape = *cell.tape;
+			const float delta = ShellDelta(cell.box, shellWidth);
+			auto rng = cellRng(c, 1);
+
+			// the share of the cell, rounded randomly so the total is count on average
+			double share = count * (areas[c] / totalArea);
+			size_t quota = size_t(share) + (std::uniform_real_distribution<double>(0, 1)(rng) < share - std::floor(share) ? 1 : 0);
+
+			size_t accepted = 0;
+			for (int batch = 0; batch < maxBatches && accepted < quota; ++batch) {
+				work.RandomPoints(cell.box, seedsPerBatch, rng);
+				TapeEvaluator::EvaluateDerivatives<1>(cellTape, work.x.data(), work.y.data(), work.z.data(), work.d.data(), seedsPerBatch);
+				localSeeds += seedsPerBatch;
+				size_t n = work.KeepShell(seedsPerBatch, delta);
+				localProjected += n;
+
+				// Newton iteration on the points still moving, which are kept at the front of the arrays
+				for (int iteration = 0; n > 0; ++iteration) {
+					size_t moving = 0;
+					for (size_t i = 0; i < n; ++i) {
+						const Dual<1>& v = work.d[i];
+						glm::vec3 p(work.x[i], work.y[i], work.z[i]);
+						glm::vec3 gradient(v.d[1], v.d[2], v.d[3]);
+						float g2 = glm::dot(gradient, gradient);
+						if (!(g2 > 0) || !std::isfinite(g2)) {
+							++localRejected; // singular formula, eg.: the gradient of the box exactly on its surface
+							continue;
+						}
+						if (std::abs(v.d[0]) <= tolerance) {
+							if (accepted < quota) {
+								buffer.push_back({ p, gradient / std::sqrt(g2) });
+								++accepted;
+							}
+							continue;
+						}
+						p -= gradient * (v.d[0] / g2);
+						if (iteration == newtonIterations || !Contains(cell.box, p)) {
+							++localRejected; // the tape of the cell is only valid inside of it
+							continue;
+						}
+						work.x[moving] = p.x;
+						work.y[moving] = p.y;
+						work.z[moving] = p.z;
+						++moving;
+					}
+					n = moving;
+					if (n > 0)
+						TapeEvaluator::EvaluateDerivatives<1>(cellTape, work.x.data(), work.y.data(), work.z.data(), work.d.data(), n);
+				}
+			}
+			if (buffer.size() >= bufferSize)
+				flush(buffer);
+		}
+
+		seeds += localSeeds;
+		projected += localProjected;
+		rejected += localRejected;
+	});
+	for (auto& buffer : buffers)
+		if (!buffer.empty())
+			flush(buffer);
+
+	stats.seeds = seeds;
+	stats.projected = projected;
+	stats.rejected = rejected;
+	stats.samples = delivered;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return delivered;
+}
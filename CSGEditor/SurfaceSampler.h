@@ -0,0 +1,63 @@
+#pragma once
+#include "Tape.h"
+#include "IntervalOctree.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <glm/glm.hpp>
+
+struct SurfaceSample {
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+struct SamplerStats {
+	size_t surfaceCells = 0;
+	size_t seeds = 0; // points evaluated to find seeds near the surface
+	size_t projected = 0; // seeds that went through the Newton iteration
+	size_t rejected = 0; // projected seeds that did not converge inside their cell
+	size_t samples = 0;
+	float surfaceArea = 0; // estimated from the seeds
+	double milliseconds = 0;
+};
+
+/// <summary>
+/// Uniformly distributed points on the zero set of a tape with their normals, for training and validation sets.
+///
+/// The surface cells of an IntervalOctree split the work: every cell gets a share of the samples proportional to the area of the
+/// surface inside it, estimated from the fraction of random points of the cell that lie in a thin shell around the surface.
+/// A cell then draws random points, keeps the ones inside the shell and projects them with Newton steps p -= f * grad f / |grad f|^2
+/// (gradients from dual numbers), evaluating only the simplified tape of the cell. Projected points that did not converge or left
+/// the cell are rejected. Points of a thin shell project to a uniform density on a surface patch that is small compared to its curvature,
+/// so together with the per cell shares the samples are close to uniform over the whole surface.
+///
+/// Cells are processed in parallel. Their samples are collected in per thread buffers that are handed to a sink when they are full,
+/// so arbitrarily many samples can be streamed to disk with bounded memory.
+/// </summary>
+class SurfaceSampler
+{
+public:
+	/// <summary>
+	/// Receives the samples in batches, called by one thread at a time.
+	/// </summary>
+	using Sink = std::function<void(const SurfaceSample* samples, size_t count)>;
+
+	uint32_t octreeDepth = 6; // deeper gives more uniform samples, but cells with few samples waste most of their seeds
+	int newtonIterations = 8;
+	float tolerance = 1e-5f; // |f| of accepted samples
+	float shellWidth = 0.125f; // half width of the seed shell, relative to the cell size
+	size_t seedsPerBatch = 64; // random points per try of a cell
+	int maxBatches = 256; // tries per cell before it gives up on its share
+	size_t bufferSize = 1 << 16; // samples per thread before they are passed to the sink
+	unsigned int seed = 1;
+
+	/// <summary>
+	/// Streams about count samples of the surface inside box (must be finite) to sink, returns the number of samples.
+	/// </summary>
+	size_t Sample(const Tape& tape, const BoundingBox& box, size_t count, const Sink& sink, ThreadPool& pool = ThreadPool::Global());
+
+	const SamplerStats& Stats() const { return stats; }
+
+private:
+	SamplerStats stats;
+};
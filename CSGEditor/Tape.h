@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct DistanceBake;
+
+/// <summary>
+/// Operations of the CPU sdf tape. The primitive operations evaluate the functions of Shaders/primitives.frag (Mesh samples the
+/// DistanceBake of an imported mesh like r_baked), the others combine registers.
+/// </summary>
+enum class TapeOpCode : uint8_t {
+	Sphere, Box, Cylinder, Torus, Ellipsoid, Plane, Mesh,
+	Union, Intersection, Substraction, SmoothUnion, SmoothIntersection, SmoothSubstraction,
+	ScaleOffset
+};
+
+/// <summary>
+/// One step of the tape. Primitives write (f(invTransform * pos) - radius) * scale into out,
+/// binary operators write op(a, b) into out and ScaleOffset writes a * scale - offset (the scale and offset of operator nodes).
+/// </summary>
+struct TapeInstruction {
+	TapeOpCode op;
+	uint32_t out = 0;
+	uint32_t a = 0;
+	uint32_t b = 0;
+	uint32_t primitive = 0; // index into Tape::primitives
+	float k = 0; // smoothing of the smooth operators
+	float scale = 1;
+	float offset = 0;
+
+	bool IsPrimitive() const { return op <= TapeOpCode::Mesh; }
+};
+
+/// <summary>
+/// Which operand of a binary instruction decides its value inside a region, found by the interval evaluation.
+/// A: out = a, B: out = b (-b for the subtractions), Both: the operation must be evaluated.
+/// </summary>
+enum class TapeChoice : uint8_t { Both, A, B };
+
+/// <summary>
+/// Per primitive data referenced by the primitive instructions.
+/// </summary>
+struct TapePrimitive {
+	glm::mat4 invTransform; // world -> primitive space, including the division by the primitive's scale
+	glm::vec4 params; // see Primitive::GetParameters
+	float scale; // converts the primitive's distance to the units of its parent
+	float radius; // the primitive's offset, in its own units
+	const DistanceBake* bake = nullptr; // the distances of a Mesh, kept alive by Tape::bakes
+};
+
+/// <summary>
+/// The sdf of a graph flattened into a list of register operations (see TapeGenerator), evaluated on the CPU by TapeEvaluator.
+/// Evaluating the instructions in order gives the same value as the sdf generated by SDFGenerator, in the result register.
+/// </summary>
+struct Tape {
+	std::vector<TapeInstruction> instructions;
+	std::vector<TapePrimitive> primitives;
+	uint32_t registerCount = 0;
+	uint32_t resultRegister = 0;
+	float lipschitz = 1.0f; // bound of the gradient's length outside the surface, prunes the cells far from it (see LipschitzCalculatorVisitor)
+	std::vector<std::shared_ptr<const DistanceBake>> bakes; // referenced by the primitives of the Mesh instructions
+};
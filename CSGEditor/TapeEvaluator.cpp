@@ -0,0 +1,190 @@
+#include "TapeEvaluator.h"
+#include "DistanceBake.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+	constexpr size_t vectorsPerBlock = TapeEvaluator::blockSize / simd::vfloat::width;
+	static_assert(TapeEvaluator::blockSize % simd::vfloat::width == 0, "the block must consist of whole vectors");
+
+	// register file of the calling thread, only grows
+	std::vector<simd::vfloat>& Registers(size_t count) {
+		thread_local std::vector<simd::vfloat> registers;
+		if (registers.size() < count)
+			registers.resize(count);
+		return registers;
+	}
+
+	std::vector<Interval>& IntervalRegisters(size_t count) {
+		thread_local std::vector<Interval> registers;
+		if (registers.size() < count)
+			registers.resize(count);
+		return registers;
+	}
+}
+
+float TapeEvaluator::Evaluate(const Tape& tape, glm::vec3 p)
+{
+	float d;
+	Evaluate(tape, &p.x, &p.y, &p.z, &d, 1);
+	return d;
+}
+
+void TapeEvaluator::Evaluate(const Tape& tape, const float* x, const float* y, const float* z, float* distances, size_t count)
+{
+	if (tape.instructions.empty())
+		return;
+
+	auto& registers = Registers(tape.registerCount * vectorsPerBlock);
+	simd::vfloat vx[vectorsPerBlock], vy[vectorsPerBlock], vz[vectorsPerBlock];
+	alignas(32) float tail[3][blockSize];
+	alignas(32) float result[blockSize];
+
+	for (size_t begin = 0; begin < count; begin += blockSize) {
+		size_t n = std::min(blockSize, count - begin);
+		const float* bx = x + begin;
+		const float* by = y + begin;
+		const float* bz = z + begin;
+		if (n < blockSize) { // pad the last block by repeating its last point
+			for (size_t i = 0; i < blockSize; ++i) {
+				size_t src = std::min(i, n - 1);
+				tail[0][i] = bx[src];
+				tail[1][i] = by[src];
+				tail[2][i] = bz[src];
+			}
+			bx = tail[0];
+			by = tail[1];
+			bz = tail[2];
+		}
+
+		for (size_t i = 0; i < vectorsPerBlock; ++i) {
+			vx[i] = simd::vfloat::Load(bx + i * simd::vfloat::width);
+			vy[i] = simd::vfloat::Load(by + i * simd::vfloat::width);
+			vz[i] = simd::vfloat::Load(bz + i * simd::vfloat::width);
+		}
+
+		EvaluateBlock(tape, vx, vy, vz, registers.data(), vectorsPerBlock);
+
+		const simd::vfloat* res = registers.data() + tape.resultRegister * vectorsPerBlock;
+		if (n == blockSize) {
+			for (size_t i = 0; i < vectorsPerBlock; ++i)
+				res[i].Store(distances + begin + i * simd::vfloat::width);
+		}
+		else {
+			for (size_t i = 0; i < vectorsPerBlock; ++i)
+				res[i].Store(result + i * simd::vfloat::width);
+			std::copy(result, result + n, distances + begin);
+		}
+	}
+}
+
+void TapeEvaluator::EvaluateParallel(const Tape& tape, const float* x, const float* y, const float* z, float* distances, size_t count, ThreadPool& pool)
+{
+	// large enough chunks to hide the scheduling, small enough to balance tapes of different cost
+	const size_t grain = blockSize * 64;
+	pool.ParallelFor(count, grain, [&](size_t begin, size_t end) {
+		Evaluate(tape, x + begin, y + begin, z + begin, distances + begin, end - begin);
+	});
+}
+
+Interval TapeEvaluator::EvaluateInterval(const Tape& tape, const BoundingBox& box, std::vector<TapeChoice>* choices)
+{
+	if (tape.instructions.empty())
+		return Interval::Everything();
+
+	auto& registers = IntervalRegisters(tape.registerCount);
+	Interval x(box.min.x, box.max.x), y(box.min.y, box.max.y), z(box.min.z, box.max.z);
+	if (!choices) {
+		EvaluateBlock(tape, &x, &y, &z, registers.data(), 1);
+		return registers[tape.resultRegister];
+	}
+
+	choices->resize(tape.instructions.size());
+	for (size_t i = 0; i < tape.instructions.size(); ++i) {
+		const TapeInstruction& ins = tape.instructions[i];
+		(*choices)[i] = ins.IsPrimitive() || ins.op == TapeOpCode::ScaleOffset ? TapeChoice::Both
+			: Choose(ins, registers[ins.a], registers[ins.b]);
+		EvaluateInstruction(tape, ins, &x, &y, &z, registers.data(), 1);
+	}
+	return registers[tape.resultRegister];
+}
+
+TapeChoice TapeEvaluator::Choose(const TapeInstruction& ins, const Interval& a, const Interval& b)
+{
+	// the smooth operators only equal min / max where the operands are at least k apart
+	float k = 0;
+	Interval other = b;
+	switch (ins.op) {
+	case TapeOpCode::SmoothUnion:
+		k = ins.k;
+		[[fallthrough]];
+	case TapeOpCode::Union:
+		if (a.upper + k <= b.lower)
+			return TapeChoice::A;
+		if (b.upper + k <= a.lower)
+			return TapeChoice::B;
+		return TapeChoice::Both;
+	case TapeOpCode::SmoothSubstraction:
+		k = ins.k;
+		other = -b;
+		break;
+	case TapeOpCode::Substraction:
+		other = -b;
+		break;
+	case TapeOpCode::SmoothIntersection:
+		k = ins.k;
+		break;
+	default:
+		break;
+	}
+
+	// max(a, other)
+	if (a.lower >= other.upper + k)
+		return TapeChoice::A;
+	if (other.lower >= a.upper + k)
+		return TapeChoice::B;
+	return TapeChoice::Both;
+}
+
+void TapeEvaluator::SampleBake(const DistanceBake& bake, simd::vfloat x, simd::vfloat y, simd::vfloat z, simd::vfloat& value, simd::vfloat gradient[3])
+{
+	constexpr int width = simd::vfloat::width;
+	alignas(32) float lanes[3][width], values[width], gradients[3][width];
+	x.Store(lanes[0]);
+	y.Store(lanes[1]);
+	z.Store(lanes[2]);
+	for (int i = 0; i < width; ++i) {
+		glm::vec3 g;
+		values[i] = bake.Sample(glm::vec3(lanes[0][i], lanes[1][i], lanes[2][i]), g);
+		for (int axis = 0; axis < 3; ++axis)
+			gradients[axis][i] = g[axis];
+	}
+	value = simd::vfloat::Load(values);
+	for (int axis = 0; axis < 3; ++axis)
+		gradient[axis] = simd::vfloat::Load(gradients[axis]);
+}
+
+simd::vfloat TapeEvaluator::SampleBake(const DistanceBake& bake, simd::vfloat x, simd::vfloat y, simd::vfloat z)
+{
+	constexpr int width = simd::vfloat::width;
+	alignas(32) float lanes[3][width], values[width];
+	x.Store(lanes[0]);
+	y.Store(lanes[1]);
+	z.Store(lanes[2]);
+	for (int i = 0; i < width; ++i)
+		values[i] = bake.Sample(glm::vec3(lanes[0][i], lanes[1][i], lanes[2][i]));
+	return simd::vfloat::Load(values);
+}
+
+Interval TapeEvaluator::SampleBake(const DistanceBake& bake, const Interval& x, const Interval& y, const Interval& z)
+{
+	// the gradient is at most DistanceBake::lipschitz long (1 outside the box)
+	glm::vec3 lower(x.lower, y.lower, z.lower), upper(x.upper, y.upper, z.upper);
+	float center = bake.Sample(0.5f * (lower + upper));
+	float radius = DistanceBake::lipschitz * 0.5f * glm::length(upper - lower);
+	if (!std::isfinite(radius))
+		return Interval::Everything();
+	return Interval(center - radius, center + radius);
+}
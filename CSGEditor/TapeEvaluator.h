@@ -0,0 +1,205 @@
+#pragma once
+#include "Tape.h"
+#include "SdfFormulas.h"
+#include "Interval.h"
+#include "Dual.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <vector>
+
+struct DistanceBake;
+
+/// <summary>
+/// Evaluates a Tape on the CPU for batches of points given as separate x, y, z arrays (structure of arrays).
+/// Points are processed in blocks: every instruction runs over the whole block with simd::vfloat before moving on to the next one,
+/// so the dispatch cost of the tape is shared by blockSize points.
+/// </summary>
+class TapeEvaluator
+{
+public:
+	static constexpr size_t blockSize = 64;
+
+	/// <summary>
+	/// Distance at a single point. Convenient, but much slower per point than the batch version.
+	/// </summary>
+	static float Evaluate(const Tape& tape, glm::vec3 p);
+
+	/// <summary>
+	/// Writes the distance at the points (x[i], y[i], z[i]) into distances[i] for i < count, on the calling thread.
+	/// </summary>
+	static void Evaluate(const Tape& tape, const float* x, const float* y, const float* z, float* distances, size_t count);
+
+	/// <summary>
+	/// Same as Evaluate, with the points split across the threads of the pool.
+	/// </summary>
+	static void EvaluateParallel(const Tape& tape, const float* x, const float* y, const float* z, float* distances, size_t count,
+		ThreadPool& pool = ThreadPool::Global());
+
+	/// <summary>
+	/// Value and partial derivatives up to Order at the points, on the calling thread. Evaluated with simd lanes of dual numbers,
+	/// so a derivative order costs about as much as the dual multiplications it needs, not a finite difference stencil.
+	/// </summary>
+	template<int Order>
+	static void EvaluateDerivatives(const Tape& tape, const float* x, const float* y, const float* z, Dual<Order>* results, size_t count);
+
+	/// <summary>
+	/// Bounds of the distance over the box: the value at any point of the box is inside the returned interval.
+	/// If choices is given, it receives one entry per instruction, telling which operand wins everywhere in the box (see TapeSimplifier).
+	/// </summary>
+	static Interval EvaluateInterval(const Tape& tape, const BoundingBox& box, std::vector<TapeChoice>* choices = nullptr);
+
+	/// <summary>
+	/// Runs the instructions for n values of the number type N (simd vectors, dual numbers of them or intervals) per coordinate.
+	/// registers must hold tape.registerCount * n values, the result is in registers[tape.resultRegister * n + i].
+	/// </summary>
+	template<typename N>
+	static void EvaluateBlock(const Tape& tape, const N* x, const N* y, const N* z, N* registers, size_t n);
+
+private:
+	static TapeChoice Choose(const TapeInstruction& ins, const Interval& a, const Interval& b);
+
+	template<typename N>
+	static void EvaluateInstruction(const Tape& tape, const TapeInstruction& ins, const N* x, const N* y, const N* z, N* registers, size_t n);
+
+	// the Mesh instruction: DistanceBake::Sample lane by lane, with the gradient of the interpolation for the dual numbers
+	static void SampleBake(const DistanceBake& bake, simd::vfloat x, simd::vfloat y, simd::vfloat z, simd::vfloat& value, simd::vfloat gradient[3]);
+	static simd::vfloat SampleBake(const DistanceBake& bake, simd::vfloat x, simd::vfloat y, simd::vfloat z);
+	static Interval SampleBake(const DistanceBake& bake, const Interval& x, const Interval& y, const Interval& z);
+	template<int Order>
+	static Dual<Order, simd::vfloat> SampleBake(const DistanceBake& bake, const Dual<Order, simd::vfloat>& x, const Dual<Order, simd::vfloat>& y,
+		const Dual<Order, simd::vfloat>& z);
+};
+
+template<int Order>
+inline void TapeEvaluator::EvaluateDerivatives(const Tape& tape, const float* x, const float* y, const float* z, Dual<Order>* results, size_t count)
+{
+	using D = Dual<Order, simd::vfloat>;
+	constexpr size_t width = simd::vfloat::width;
+	constexpr size_t vectorsPerBlock = blockSize / width;
+	if (tape.instructions.empty() || count == 0)
+		return;
+
+	thread_local std::vector<D> registers;
+	if (registers.size() < tape.registerCount * vectorsPerBlock)
+		registers.resize(tape.registerCount * vectorsPerBlock);
+
+	D p[3][vectorsPerBlock];
+	alignas(32) float lanes[3][blockSize];
+	alignas(32) float parts[D::size][blockSize];
+	for (size_t begin = 0; begin < count; begin += blockSize) {
+		size_t n = std::min(blockSize, count - begin);
+		for (size_t i = 0; i < blockSize; ++i) { // the last block is padded by repeating its last point
+			size_t src = begin + std::min(i, n - 1);
+			lanes[0][i] = x[src];
+			lanes[1][i] = y[src];
+			lanes[2][i] = z[src];
+		}
+		for (int axis = 0; axis < 3; ++axis)
+			for (size_t v = 0; v < vectorsPerBlock; ++v)
+				p[axis][v] = D::Variable(simd::vfloat::Load(lanes[axis] + v * width), axis);
+
+		EvaluateBlock(tape, p[0], p[1], p[2], registers.data(), vectorsPerBlock);
+
+		const D* res = registers.data() + tape.resultRegister * vectorsPerBlock;
+		for (size_t v = 0; v < vectorsPerBlock; ++v)
+			for (int k = 0; k < D::size; ++k)
+				res[v].d[k].Store(parts[k] + v * width);
+		for (size_t i = 0; i < n; ++i)
+			for (int k = 0; k < D::size; ++k)
+				results[begin + i].d[k] = parts[k][i];
+	}
+}
+
+template<typename N>
+inline void TapeEvaluator::EvaluateBlock(const Tape& tape, const N* x, const N* y, const N* z, N* registers, size_t n)
+{
+	for (const TapeInstruction& ins : tape.instructions)
+		EvaluateInstruction(tape, ins, x, y, z, registers, n);
+}
+
+template<typename N>
+inline void TapeEvaluator::EvaluateInstruction(const Tape& tape, const TapeInstruction& ins, const N* x, const N* y, const N* z, N* registers, size_t n)
+{
+	N* out = registers + ins.out * n;
+
+	if (ins.IsPrimitive()) {
+		const TapePrimitive& prim = tape.primitives[ins.primitive];
+		const glm::mat4& m = prim.invTransform;
+		const glm::vec4& p = prim.params;
+		// the switch is outside of the loop, so each loop only contains the formula of one primitive
+		auto forEachPoint = [&](auto&& f) {
+			for (size_t i = 0; i < n; ++i) {
+				N px = x[i] * m[0][0] + y[i] * m[1][0] + z[i] * m[2][0] + m[3][0];
+				N py = x[i] * m[0][1] + y[i] * m[1][1] + z[i] * m[2][1] + m[3][1];
+				N pz = x[i] * m[0][2] + y[i] * m[1][2] + z[i] * m[2][2] + m[3][2];
+				out[i] = (f(px, py, pz) - prim.radius) * prim.scale;
+			}
+		};
+		switch (ins.op) {
+		case TapeOpCode::Sphere:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return sdf::sphere(0.5f, px, py, pz); });
+			break;
+		case TapeOpCode::Box:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return sdf::cube(p.x, p.y, p.z, px, py, pz); });
+			break;
+		case TapeOpCode::Cylinder:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return sdf::cylinder(p.x, p.y, px, py, pz); });
+			break;
+		case TapeOpCode::Torus:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return sdf::torus(p.x, p.y, px, py, pz); });
+			break;
+		case TapeOpCode::Ellipsoid:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return sdf::ellipsoid(p.x, p.y, p.z, px, py, pz); });
+			break;
+		case TapeOpCode::Mesh:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return SampleBake(*prim.bake, px, py, pz); });
+			break;
+		default:
+			forEachPoint([&](const N& px, const N& py, const N& pz) { return sdf::plane(p.x, p.y, p.z, p.w, px, py, pz); });
+			break;
+		}
+		return;
+	}
+
+	// unqualified, so the overloads of dual numbers are found too
+	using sdf::dmin;
+	using sdf::dmax;
+	const N* a = registers + ins.a * n;
+	const N* b = registers + ins.b * n;
+	switch (ins.op) {
+	case TapeOpCode::Union:
+		for (size_t i = 0; i < n; ++i) out[i] = dmin(a[i], b[i]);
+		break;
+	case TapeOpCode::Intersection:
+		for (size_t i = 0; i < n; ++i) out[i] = dmax(a[i], b[i]);
+		break;
+	case TapeOpCode::Substraction:
+		for (size_t i = 0; i < n; ++i) out[i] = dmax(a[i], -b[i]);
+		break;
+	case TapeOpCode::SmoothUnion:
+		for (size_t i = 0; i < n; ++i) out[i] = sdf::smooth_union(a[i], b[i], ins.k);
+		break;
+	case TapeOpCode::SmoothIntersection:
+		for (size_t i = 0; i < n; ++i) out[i] = sdf::smooth_intersection(a[i], b[i], ins.k);
+		break;
+	case TapeOpCode::SmoothSubstraction:
+		for (size_t i = 0; i < n; ++i) out[i] = sdf::smooth_substraction(a[i], b[i], ins.k);
+		break;
+	case TapeOpCode::ScaleOffset:
+		for (size_t i = 0; i < n; ++i) out[i] = a[i] * ins.scale - ins.offset;
+		break;
+	default:
+		break;
+	}
+}
+
+template<int Order>
+inline Dual<Order, simd::vfloat> TapeEvaluator::SampleBake(const DistanceBake& bake, const Dual<Order, simd::vfloat>& x, const Dual<Order, simd::vfloat>& y,
+	const Dual<Order, simd::vfloat>& z)
+{
+	// the first order Taylor polynomial at the point: the interpolation is linear along each axis, its mixed derivatives are left out
+	simd::vfloat value, gradient[3];
+	SampleBake(bake, x.d[0], y.d[0], z.d[0], value, gradient);
+	return (x - x.d[0]) * gradient[0] + (y - y.d[0]) * gradient[1] + (z - z.d[0]) * gradient[2] + value;
+}
@@ -0,0 +1,154 @@
+#include "TapeGenerator.h"
+#include "LipschitzCalculatorVisitor.h"
+#include "exceptions.h"
+
+#include <glm/gtx/transform.hpp>
+#include <algorithm>
+
+namespace {
+	struct PrimitiveOpCode : public PrimitiveVisitor {
+		TapeOpCode op = TapeOpCode::Sphere;
+		void operator()(Sphere&) override { op = TapeOpCode::Sphere; }
+		void operator()(Box&) override { op = TapeOpCode::Box; }
+		void operator()(Cylinder&) override { op = TapeOpCode::Cylinder; }
+		void operator()(Torus&) override { op = TapeOpCode::Torus; }
+		void operator()(Ellipsoid&) override { op = TapeOpCode::Ellipsoid; }
+		void operator()(Plane&) override { op = TapeOpCode::Plane; }
+		void operator()(Mesh& mesh) override { op = mesh.bake ? TapeOpCode::Mesh : TapeOpCode::Box; } // the unit cube until it's loaded
+	};
+
+	struct OperatorOpCode : public OperatorVisitor {
+		TapeOpCode op = TapeOpCode::Union;
+		float k = 0;
+		bool smooth = false;
+		void operator()(Union&) override { op = TapeOpCode::Union; }
+		void operator()(Intersection&) override { op = TapeOpCode::Intersection; }
+		void operator()(Substraction&) override { op = TapeOpCode::Substraction; }
+		void operator()(SmoothUnion& o) override { op = TapeOpCode::SmoothUnion; k = o.k; smooth = true; }
+		void operator()(SmoothIntersection& o) override { op = TapeOpCode::SmoothIntersection; k = o.k; smooth = true; }
+		void operator()(SmoothSubstraction& o) override { op = TapeOpCode::SmoothSubstraction; k = o.k; smooth = true; }
+	};
+}
+
+void TapeGenerator::operator()(std::shared_ptr<OperatorNode> opnode)
+{
+	if (opnode->InputCount() < 1)
+		throw shader_gen_exception(shader_gen_exception::REASON::OPERATOR_HAS_NO_INPUTS, opnode);
+
+	OperatorOpCode opCode;
+	opnode->operatorDescription->Accept(opCode);
+	if (opCode.smooth && opnode->InputCount() != 2)
+		throw shader_gen_exception(shader_gen_exception::REASON::SMOOTH_OPERATOR_NEEDS_EXACTLY_TWO_INPUTS, opnode);
+
+	glm::mat4 transformMatrix =
+		transformStack.top() *
+		glm::translate(opnode->translate) *
+		glm::rotate(opnode->rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(opnode->rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(opnode->rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0)) *
+		glm::scale(glm::vec3(opnode->scale));
+
+	transformStack.push(transformMatrix);
+
+	// the n-ary operators are folded from the left, like the nested _dmin_/_dmax_ calls of the glsl code
+	uint32_t reg = 0;
+	for (size_t i = 0; i < opnode->InputCount(); ++i) {
+		auto input = (*opnode)[i];
+		input->visit(this);
+		uint32_t inputReg = (uint32_t)TraversalId(input);
+		TraversalId(input) = -1;
+
+		if (i == 0) {
+			reg = inputReg; // reuse the register of the first input
+			continue;
+		}
+
+		TapeInstruction instruction;
+		instruction.op = opCode.op;
+		instruction.out = reg;
+		instruction.a = reg;
+		instruction.b = inputReg;
+		instruction.k = opCode.k;
+		tape.instructions.push_back(instruction);
+		FreeRegister(inputReg);
+	}
+
+	transformStack.pop();
+
+	if (opnode->scale != 1 || opnode->radius != 0) {
+		TapeInstruction instruction;
+		instruction.op = TapeOpCode::ScaleOffset;
+		instruction.out = reg;
+		instruction.a = reg;
+		instruction.scale = opnode->scale;
+		instruction.offset = opnode->radius;
+		tape.instructions.push_back(instruction);
+	}
+
+	TraversalId(opnode) = (int)reg;
+}
+
+void TapeGenerator::operator()(std::shared_ptr<PrimitiveNode> primnode)
+{
+	glm::mat4 transform = transformStack.top() * glm::translate(primnode->translate) *
+		glm::rotate(primnode->rotate.z / 180 * glm::pi<float>(), glm::vec3(0, 0, 1)) *
+		glm::rotate(primnode->rotate.y / 180 * glm::pi<float>(), glm::vec3(0, 1, 0)) *
+		glm::rotate(primnode->rotate.x / 180 * glm::pi<float>(), glm::vec3(1, 0, 0));
+
+	TapePrimitive prim;
+	prim.invTransform = glm::scale(glm::vec3(1 / primnode->scale)) * glm::inverse(transform);
+	prim.params = primnode->primitive->GetParameters();
+	prim.scale = primnode->scale;
+	prim.radius = primnode->radius;
+
+	PrimitiveOpCode opCode;
+	primnode->primitive->Accept(opCode);
+	if (opCode.op == TapeOpCode::Mesh) {
+		auto bake = primnode->primitive->GetBake();
+		prim.bake = bake.get();
+		if (std::find(tape.bakes.begin(), tape.bakes.end(), bake) == tape.bakes.end())
+			tape.bakes.push_back(bake);
+	}
+
+	TapeInstruction instruction;
+	instruction.op = opCode.op;
+	instruction.out = AllocateRegister();
+	instruction.primitive = (uint32_t)tape.primitives.size();
+	tape.primitives.push_back(prim);
+	tape.instructions.push_back(instruction);
+
+	TraversalId(primnode) = (int)instruction.out;
+}
+
+Tape TapeGenerator::GenerateFromRoot(std::shared_ptr<Node> root)
+{
+	tape = Tape();
+	nextRegister = 0;
+	freeRegisters.clear();
+	transformStack = {};
+	transformStack.push(glm::identity<glm::mat4>());
+
+	root->visit(this);
+
+	tape.resultRegister = (uint32_t)TraversalId(root);
+	tape.registerCount = nextRegister;
+	tape.lipschitz = LipschitzCalculatorVisitor().CalculateLipschitz(root).at(root.get());
+	TraversalId(root) = -1;
+	return std::move(tape);
+}
+
+uint32_t TapeGenerator::AllocateRegister()
+{
+	if (freeRegisters.size() > 0) {
+		uint32_t r = freeRegisters.back();
+		freeRegisters.pop_back();
+		return r;
+	}
+
+	return nextRegister++;
+}
+
+void TapeGenerator::FreeRegister(uint32_t id)
+{
+	freeRegisters.push_back(id);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "NodeVisitor.h"
+#include "Tape.h"
+#include <stack>
+#include <vector>
+
+/// <summary>
+/// Lowers a graph to a Tape for the CPU evaluators. Follows the traversal of SDFGenerator: every instruction corresponds to a statement of the
+/// generated glsl sdf (without the optional bounding volume guards and level of detail), registers are reused the same way.
+/// </summary>
+class TapeGenerator : public NodeVisitor
+{
+public:
+	void operator()(std::shared_ptr<OperatorNode> opnode) override;
+	void operator()(std::shared_ptr<PrimitiveNode> primnode) override;
+
+	/// <summary>
+	/// Generates the tape of the sdf with the given root. Throws shader_gen_exception for the same invalid graphs as SDFGenerator.
+	/// </summary>
+	Tape GenerateFromRoot(std::shared_ptr<Node> root);
+
+private:
+	Tape tape;
+	std::stack<glm::mat4> transformStack;
+
+	uint32_t nextRegister = 0;
+	std::vector<uint32_t> freeRegisters;
+
+	uint32_t AllocateRegister();
+	void FreeRegister(uint32_t id);
+};
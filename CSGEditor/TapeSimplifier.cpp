@@ -0,0 +1,119 @@
+#include "TapeSimplifier.h"
+
+#include <algorithm>
+#include <limits>
+
+bool TapeSimplifier::CanSimplify(const std::vector<TapeChoice>& choices)
+{
+	return std::any_of(choices.begin(), choices.end(), [](TapeChoice c) { return c != TapeChoice::Both; });
+}
+
+Tape TapeSimplifier::Simplify(const Tape& tape, const std::vector<TapeChoice>& choices)
+{
+	const size_t count = tape.instructions.size();
+	const int none = -1;
+
+	// every instruction defines a value, a decided instruction forwards the value of its operand instead
+	// (registers are reused by the generator, so they can't be forwarded directly)
+	std::vector<TapeInstruction> instructions = tape.instructions;
+	std::vector<int> inputs(count * 2, none); // values read by each kept instruction
+	std::vector<int> registerValue(tape.registerCount, none);
+	std::vector<bool> defines(count, true);
+
+	for (size_t i = 0; i < count; ++i) {
+		TapeInstruction& ins = instructions[i];
+		int value = (int)i;
+		if (!ins.IsPrimitive()) {
+			int a = registerValue[ins.a];
+			int b = registerValue[ins.b];
+			bool negated = ins.op == TapeOpCode::Substraction || ins.op == TapeOpCode::SmoothSubstraction;
+			if (ins.op == TapeOpCode::ScaleOffset) {
+				inputs[i * 2] = a;
+			}
+			else if (choices[i] == TapeChoice::A) {
+				value = a;
+				defines[i] = false;
+			}
+			else if (choices[i] == TapeChoice::B && !negated) {
+				value = b;
+				defines[i] = false;
+			}
+			else if (choices[i] == TapeChoice::B) { // -b
+				ins.op = TapeOpCode::ScaleOffset;
+				ins.scale = -1;
+				ins.offset = 0;
+				inputs[i * 2] = b;
+			}
+			else {
+				inputs[i * 2] = a;
+				inputs[i * 2 + 1] = b;
+			}
+		}
+		registerValue[ins.out] = value;
+	}
+
+	// keep what the result depends on
+	int resultValue = registerValue[tape.resultRegister];
+	std::vector<bool> needed(count, false);
+	needed[resultValue] = true;
+	for (size_t i = count; i-- > 0;) {
+		if (!needed[i] || !defines[i])
+			continue;
+		for (int j = 0; j < 2; ++j)
+			if (inputs[i * 2 + j] != none)
+				needed[inputs[i * 2 + j]] = true;
+	}
+
+	// last reader of each value, its register can be reused from then on
+	std::vector<size_t> lastUse(count, 0);
+	for (size_t i = 0; i < count; ++i)
+		if (needed[i] && defines[i])
+			for (int j = 0; j < 2; ++j)
+				if (inputs[i * 2 + j] != none)
+					lastUse[inputs[i * 2 + j]] = i;
+	lastUse[resultValue] = std::numeric_limits<size_t>::max();
+
+	Tape result;
+	std::vector<uint32_t> valueRegister(count, 0);
+	std::vector<uint32_t> freeRegisters;
+	std::vector<int> primitiveIndex(tape.primitives.size(), none);
+	for (size_t i = 0; i < count; ++i) {
+		if (!needed[i] || !defines[i])
+			continue;
+
+		TapeInstruction ins = instructions[i];
+		if (ins.IsPrimitive()) {
+			if (primitiveIndex[ins.primitive] == none) {
+				primitiveIndex[ins.primitive] = (int)result.primitives.size();
+				result.primitives.push_back(tape.primitives[ins.primitive]);
+			}
+			ins.primitive = primitiveIndex[ins.primitive];
+		}
+		else {
+			ins.a = valueRegister[inputs[i * 2]];
+			ins.b = inputs[i * 2 + 1] != none ? valueRegister[inputs[i * 2 + 1]] : ins.a;
+		}
+
+		// the evaluator reads and writes element by element, so the output may take the register of an input read for the last time
+		for (int j = 0; j < 2; ++j) {
+			int input = inputs[i * 2 + j];
+			if (input != none && lastUse[input] == i && (j == 0 || input != inputs[i * 2])) {
+				freeRegisters.push_back(valueRegister[input]);
+			}
+		}
+		if (freeRegisters.empty()) {
+			ins.out = result.registerCount++;
+		}
+		else {
+			ins.out = freeRegisters.back();
+			freeRegisters.pop_back();
+		}
+		valueRegister[i] = ins.out;
+		result.instructions.push_back(ins);
+	}
+
+	result.resultRegister = valueRegister[resultValue];
+	result.lipschitz = tape.lipschitz; // removing inputs of min and max can only lower it
+	result.bakes = tape.bakes;
+	return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Tape.h"
+#include <vector>
+
+/// <summary>
+/// Specializes a tape to a region, using the choices recorded by TapeEvaluator::EvaluateInterval over that region:
+/// binary instructions with a decided operand are replaced by that operand, and everything that no longer reaches the result is removed.
+/// Inside the region the simplified tape gives the same values as the original one (the removed smooth terms are exactly 0 there).
+/// </summary>
+class TapeSimplifier
+{
+public:
+	/// <summary>
+	/// choices must have one entry per instruction of tape. Registers are reallocated and only the used primitives are kept.
+	/// </summary>
+	static Tape Simplify(const Tape& tape, const std::vector<TapeChoice>& choices);
+
+	/// <summary>
+	/// True if Simplify would remove something.
+	/// </summary>
+	static bool CanSimplify(const std::vector<TapeChoice>& choices);
+};
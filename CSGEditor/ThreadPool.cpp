@@ -0,0 +1,118 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+	thread_local size_t threadIndex = 0;
+	thread_local bool insideJob = false;
+}
+
+ThreadPool& ThreadPool::Global()
+{
+	static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+	return pool;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	for (unsigned int i = 1; i < threadCount; ++i)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (auto& t : workers)
+		t.join();
+}
+
+size_t ThreadPool::ThreadIndex()
+{
+	return threadIndex;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	if (count == 0)
+		return;
+	grain = std::max<size_t>(grain, 1);
+
+	// nested calls would wait for workers that are busy with the outer job
+	if (insideJob || workers.empty() || count <= grain) {
+		for (size_t begin = 0; begin < count; begin += grain)
+			body(begin, std::min(count, begin + grain));
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(submitMutex);
+	Job current;
+	current.body = &body;
+	current.count = count;
+	current.grain = grain;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &current;
+		++generation;
+	}
+	jobAvailable.notify_all();
+
+	insideJob = true;
+	RunChunks(current);
+	insideJob = false;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		job = nullptr; // workers waking up from now on won't join
+		jobDone.wait(lock, [&] { return busyWorkers == 0; });
+	}
+
+	if (current.error)
+		std::rethrow_exception(current.error);
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+	threadIndex = index;
+	insideJob = true;
+
+	unsigned long long seenGeneration = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		jobAvailable.wait(lock, [&] { return stopping || (job != nullptr && generation != seenGeneration); });
+		if (stopping)
+			return;
+
+		seenGeneration = generation;
+		Job* current = job;
+		++busyWorkers;
+		lock.unlock();
+
+		RunChunks(*current);
+
+		lock.lock();
+		if (--busyWorkers == 0)
+			jobDone.notify_all();
+	}
+}
+
+void ThreadPool::RunChunks(Job& job)
+{
+	while (true) {
+		size_t begin = job.next.fetch_add(job.grain);
+		if (begin >= job.count)
+			return;
+		try {
+			(*job.body)(begin, std::min(job.count, begin + job.grain));
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(job.errorMutex);
+			if (!job.error)
+				job.error = std::current_exception();
+			job.next = job.count; // skip the remaining chunks
+		}
+	}
+}
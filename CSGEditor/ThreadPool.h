@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of worker threads for the data parallel parts of the CPU evaluators (batch evaluation, rendering, meshing).
+/// Work is split into chunks that the threads grab from a shared counter, so uneven chunks (eg.: tiles with mostly empty space) balance out.
+/// </summary>
+class ThreadPool
+{
+public:
+	/// <summary>
+	/// The pool shared by the whole process, with one thread per hardware thread (the calling thread counts as one of them).
+	/// </summary>
+	static ThreadPool& Global();
+
+	explicit ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>
+	/// Number of threads taking part in a ParallelFor, including the calling thread.
+	/// </summary>
+	size_t ThreadCount() const { return workers.size() + 1; }
+
+	/// <summary>
+	/// Calls body(begin, end) for consecutive chunks of [0, count) of at most grain elements, and returns when all of them are done.
+	/// The first exception thrown by body is rethrown here. Calls from inside a body run on the calling thread only.
+	/// </summary>
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+	/// <summary>
+	/// Index of the current thread in [0, ThreadCount()): 0 for any thread outside the pool. Lets bodies pick per thread scratch memory.
+	/// </summary>
+	static size_t ThreadIndex();
+
+private:
+	struct Job {
+		const std::function<void(size_t, size_t)>* body;
+		size_t count;
+		size_t grain;
+		std::atomic<size_t> next{ 0 };
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobDone;
+	Job* job = nullptr;
+	unsigned long long generation = 0;
+	int busyWorkers = 0;
+	bool stopping = false;
+
+	std::mutex submitMutex; // one job at a time
+
+	void WorkerLoop(size_t index);
+	static void RunChunks(Job& job);
+};
@@ -0,0 +1,202 @@
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+	std::mutex importerMutex;
+	TriangleMesh::Importer importer;
+
+	std::string Extension(const std::string& fileName) {
+		std::string extension = fileName.substr(std::min(fileName.size(), fileName.rfind('.')));
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return extension;
+	}
+
+	// splits a polygon of the file into a fan of triangles
+	void AddPolygon(TriangleMesh& mesh, const std::vector<uint32_t>& polygon, const std::string& fileName) {
+		for (uint32_t index : polygon)
+			if (index >= mesh.positions.size())
+				throw std::runtime_error(fileName + " has a face with a vertex index out of range.");
+		for (size_t i = 2; i < polygon.size(); ++i) {
+			mesh.indices.push_back(polygon[0]);
+			mesh.indices.push_back(polygon[i - 1]);
+			mesh.indices.push_back(polygon[i]);
+		}
+	}
+
+	TriangleMesh ReadObj(std::ifstream& file, const std::string& fileName) {
+		TriangleMesh mesh;
+		std::vector<uint32_t> polygon;
+		std::string line, word;
+		while (std::getline(file, line)) {
+			std::istringstream words(line);
+			words >> word;
+			if (word == "v") {
+				glm::vec3 p;
+				words >> p.x >> p.y >> p.z;
+				mesh.positions.push_back(p);
+			}
+			else if (word == "f") {
+				polygon.clear();
+				while (words >> word) { // v, v/vt, v//vn or v/vt/vn, negative indices count back from the last vertex
+					long index = std::strtol(word.c_str(), nullptr, 10);
+					polygon.push_back((uint32_t)(index < 0 ? (long)mesh.positions.size() + index : index - 1));
+				}
+				AddPolygon(mesh, polygon, fileName);
+			}
+			word.clear();
+		}
+		return mesh;
+	}
+
+	size_t PlySize(const std::string& type) {
+		if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+			return 1;
+		if (type == "short" || type == "ushort" || type == "int16" || type == "uint16")
+			return 2;
+		if (type == "int" || type == "uint" || type == "float" || type == "int32" || type == "uint32" || type == "float32")
+			return 4;
+		if (type == "double" || type == "float64")
+			return 8;
+		return 0;
+	}
+
+	double PlyValue(const char* data, const std::string& type) {
+		auto read = [&](auto value) { std::memcpy(&value, data, sizeof(value)); return (double)value; };
+		switch (PlySize(type)) {
+		case 1: return type[0] == 'u' ? read(uint8_t()) : read(int8_t());
+		case 2: return type[0] == 'u' ? read(uint16_t()) : read(int16_t());
+		case 4: return type[0] == 'f' ? read(float()) : type[0] == 'u' ? read(uint32_t()) : read(int32_t());
+		default: return read(double());
+		}
+	}
+
+	// binary little endian only, like the files of MeshWriter. Every platform the tools build for is little endian
+	TriangleMesh ReadPly(std::ifstream& file, const std::string& fileName) {
+		struct Property {
+			std::string name, type, countType; // countType is set for lists
+		};
+		struct Element {
+			std::string name;
+			size_t count = 0;
+			std::vector<Property> properties;
+		};
+		std::vector<Element> elements;
+		std::string line, word;
+		bool binary = false;
+		while (std::getline(file, line) && line.rfind("end_header", 0) != 0) {
+			std::istringstream words(line);
+			words >> word;
+			if (word == "format") {
+				words >> word;
+				binary = word == "binary_little_endian";
+			}
+			else if (word == "element") {
+				elements.emplace_back();
+				words >> elements.back().name >> elements.back().count;
+			}
+			else if (word == "property" && !elements.empty()) {
+				Property property;
+				words >> property.type;
+				if (property.type == "list")
+					words >> property.countType >> property.type;
+				words >> property.name;
+				if (PlySize(property.type) == 0 || (!property.countType.empty() && PlySize(property.countType) == 0))
+					throw std::runtime_error(fileName + " has a property of unknown type: " + line);
+				elements.back().properties.push_back(property);
+			}
+		}
+		if (!binary)
+			throw std::runtime_error(fileName + " is not a binary little endian PLY file.");
+
+		TriangleMesh mesh;
+		std::vector<char> buffer;
+		std::vector<uint32_t> polygon;
+		for (const Element& element : elements) {
+			for (size_t i = 0; i < element.count; ++i) {
+				glm::vec3 p(0);
+				polygon.clear();
+				for (const Property& property : element.properties) {
+					size_t size = PlySize(property.type);
+					if (!property.countType.empty()) {
+						buffer.resize(PlySize(property.countType));
+						file.read(buffer.data(), buffer.size());
+						size_t count = (size_t)PlyValue(buffer.data(), property.countType);
+						buffer.resize(count * size);
+						file.read(buffer.data(), buffer.size());
+						if (element.name == "face" && (property.name == "vertex_indices" || property.name == "vertex_index"))
+							for (size_t k = 0; k < count; ++k)
+								polygon.push_back((uint32_t)PlyValue(buffer.data() + k * size, property.type));
+						continue;
+					}
+					char value[8];
+					file.read(value, size);
+					if (element.name == "vertex" && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+						p[property.name[0] - 'x'] = (float)PlyValue(value, property.type);
+				}
+				if (!file)
+					throw std::runtime_error(fileName + " is shorter than its header says.");
+				if (element.name == "vertex")
+					mesh.positions.push_back(p);
+				else if (element.name == "face")
+					AddPolygon(mesh, polygon, fileName);
+			}
+		}
+		return mesh;
+	}
+}
+
+BoundingBox TriangleMesh::Bounds() const
+{
+	if (indices.empty())
+		return BoundingBox();
+	BoundingBox box(positions[indices[0]], positions[indices[0]]);
+	for (uint32_t index : indices) {
+		box.min = glm::min(box.min, positions[index]);
+		box.max = glm::max(box.max, positions[index]);
+	}
+	return box;
+}
+
+TriangleMesh TriangleMesh::Read(const std::string& fileName)
+{
+	Importer custom;
+	{
+		std::lock_guard<std::mutex> lock(importerMutex);
+		custom = importer;
+	}
+
+	TriangleMesh mesh;
+	if (custom) {
+		mesh = custom(fileName);
+	}
+	else {
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Can't open " + fileName);
+		std::string extension = Extension(fileName);
+		if (extension == ".obj")
+			mesh = ReadObj(file, fileName);
+		else if (extension == ".ply")
+			mesh = ReadPly(file, fileName);
+		else
+			throw std::runtime_error(fileName + " is neither .obj nor .ply, and there is no importer for other formats.");
+	}
+
+	if (mesh.TriangleCount() == 0)
+		throw std::runtime_error(fileName + " has no triangles.");
+	return mesh;
+}
+
+void TriangleMesh::SetImporter(Importer replacement)
+{
+	std::lock_guard<std::mutex> lock(importerMutex);
+	importer = std::move(replacement);
+}
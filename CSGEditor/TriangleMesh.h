@@ -0,0 +1,36 @@
+#pragma once
+#include "BoundingBox.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// An indexed triangle mesh, three indices per triangle, counter-clockwise seen from outside (the winding of MeshChunk).
+/// </summary>
+struct TriangleMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	size_t TriangleCount() const { return indices.size() / 3; }
+
+	/// <summary>
+	/// Bounds of the vertices that are used by a triangle, an empty box at the origin if there are none.
+	/// </summary>
+	BoundingBox Bounds() const;
+
+	using Importer = std::function<TriangleMesh(const std::string& fileName)>;
+
+	/// <summary>
+	/// Reads the triangles of a model file with the importer given to SetImporter, or with the built in readers of OBJ files and of binary
+	/// little endian PLY files (like the ones MeshWriter writes) if there is none. Polygons are split into fans.
+	/// Throws std::runtime_error if the file can't be read, or has no triangles.
+	/// </summary>
+	static TriangleMesh Read(const std::string& fileName);
+
+	/// <summary>
+	/// Replaces the built in readers, eg.: with assimp in the editor. An empty importer restores them.
+	/// </summary>
+	static void SetImporter(Importer importer);
+};
@@ -4,10 +4,15 @@
 #include "Persistence.h"
 #include "exceptions.h"
 #include "ShaderLibManager.h"
+#include "BenchmarkSceneGenerator.h"
+#include "AssimpImporter.h"
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <codecvt>
 #include <string>
+#include <sstream>
 #include <nfd.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform2.hpp>
@@ -22,45 +27,72 @@ GLuint App::initSphereTracerVao()
 
 void App::GenerateShaders(std::shared_ptr<Node> root)
 {
-	if (root != nullptr) {
+	if (root != nullptr && useBvh) {
+		GenerateBvhShader(root);
+	}
+	else if (root != nullptr) {
 		shaderReady = true; // will be overwritten to false in case an error occurs
 		SDFGenerator gen;
+		gen.useBoundingGuards = useBoundingGuards;
+		gen.useLevelOfDetail = useLevelOfDetail;
+		FindBakes(root, gen.bakes);
 		try {
+			// generate every source first, so that code generation, file io and linking can be timed separately
+			profiler.BeginCpu("codegen");
 			std::string sdf = gen.GenerateFromRoot(root);
+			std::string constants = ShaderLibManager::GenerateConstants(enableDerivatives ? derivativeOrder : 0);
+			std::string chainRuleFuncs, dsdf;
+			std::vector<std::shared_ptr<const DistanceBake>> usedBakes = gen.GetUsedBakes();
+			if (enableDerivatives) {
+				std::vector<std::string> func = { "sqrt(x)", "1/(2*sqrt(x))", "-1.0/4 * 1/sqrt(x*x*x)", "3.0/8 * 1/sqrt(x*x*x*x*x)" };
+				chainRuleFuncs += ShaderLibManager::GenerateChainRuleFunc("dsqrt", func, derivativeOrder);
+				func = { "sin(x)", "cos(x)", "-sin(x)", "-cos(x)" };
+				chainRuleFuncs += ShaderLibManager::GenerateChainRuleFunc("dsin", func, derivativeOrder);
+				func = { "cos(x)", "-sin(x)", "-cos(x)", "sin(x)" };
+				chainRuleFuncs += ShaderLibManager::GenerateChainRuleFunc("dcos", func, derivativeOrder);
+
+				DifferentiatedSDFGenerator dgen;
+				dgen.useBoundingGuards = useBoundingGuards;
+				dgen.declaredBakes = usedBakes;
+				dsdf = dgen.GenerateFromRoot(root);
+				usedBakes = dgen.GetUsedBakes(); // meshes inside baked subtrees add their own bakes
+			}
+			profiler.EndCpu("codegen");
+
+			profiler.BeginCpu("file io");
 			std::ofstream file("Shaders/tmp/sdf.frag", std::ofstream::out);
 			file << sdf;
 			std::cout << "\nSDF UPDATE:\n" << sdf;
 			file.close();
 
 			std::ofstream constantsFile("Shaders/tmp/constants.frag", std::ofstream::out);
-			constantsFile << ShaderLibManager::GenerateConstants(enableDerivatives ? derivativeOrder : 0);
+			constantsFile << constants;
 			constantsFile.close();
 
 			if (enableDerivatives) {
-				std::vector<std::string> func = { "sqrt(x)", "1/(2*sqrt(x))", "-1.0/4 * 1/sqrt(x*x*x)", "3.0/8 * 1/sqrt(x*x*x*x*x)" };
-				std::string dsqrt = ShaderLibManager::GenerateChainRuleFunc("dsqrt", func, derivativeOrder);
-				func = { "sin(x)", "cos(x)", "-sin(x)", "-cos(x)" };
-				std::string dsin = ShaderLibManager::GenerateChainRuleFunc("dsin", func, derivativeOrder);
-				func = { "cos(x)", "-sin(x)", "-cos(x)", "sin(x)" };
-				std::string dcos = ShaderLibManager::GenerateChainRuleFunc("dcos", func, derivativeOrder);
-
 				std::ofstream chainFuncFile("Shaders/tmp/libgen.frag", std::ofstream::out);
-				chainFuncFile << dsqrt << dsin << dcos;
+				chainFuncFile << chainRuleFuncs;
 				chainFuncFile.close();
 
-				DifferentiatedSDFGenerator dgen;
-				std::string dsdf = dgen.GenerateFromRoot(root);
 				std::ofstream file("Shaders/tmp/dsdf.frag", std::ofstream::out);
 				file << dsdf;
 				std::cout << "\n\nDSDF:\n" << dsdf;
 				file.close();
 			}
+			profiler.EndCpu("file io");
 
+			profiler.BeginCpu("link");
 			sphereTracerProgram = std::make_unique<decltype(sphereTracerProgram)::element_type>("RaymarchingProgram");
 			*sphereTracerProgram << "Shaders/trace.vert"_vert << "Shaders/tmp/constants.frag"_frag << "Shaders/number.frag"_frag << "Shaders/tmp/primitives_real.frag"_frag << "Shaders/tmp/sdf.frag"_frag;
 			if (enableDerivatives)
 				*sphereTracerProgram << "Shaders/tmp/libgen.frag"_frag << "Shaders/tmp/primitives_dual.frag"_frag << "Shaders/tmp/dsdf.frag"_frag;
 			*sphereTracerProgram << "Shaders/trace.frag"_frag << df::LinkProgram;
+			glFinish(); // drivers may link lazily, make sure the measured time contains the whole link
+			profiler.EndCpu("link");
+
+			shaderUsesLevelOfDetail = useLevelOfDetail;
+			shaderUsesBvh = false;
+			bakeTextures.Upload(usedBakes);
 
 			std::string errors = sphereTracerProgram->GetErrors();
 			std::cerr << errors;
@@ -85,6 +117,105 @@ void App::GenerateShaders(std::shared_ptr<Node> root)
 	redrawNeeded = 2;
 }
 
+void App::FindBakes(std::shared_ptr<Node> root, std::unordered_map<const Node*, std::shared_ptr<const DistanceBake>>& bakes)
+{
+	// the baked nodes that are not inside another baked node, the ones without a finished bake are evaluated until it's ready
+	std::vector<const Node*> baked;
+	std::function<void(std::shared_ptr<Node>)> visit = [&](std::shared_ptr<Node> node) {
+		auto opnode = std::dynamic_pointer_cast<OperatorNode>(node);
+		if (opnode == nullptr)
+			return;
+		if (opnode->baked && opnode->InputCount() > 0) {
+			baked.push_back(opnode.get());
+			bakes[opnode.get()] = baker.Find(opnode);
+			return;
+		}
+		for (auto& input : *opnode)
+			visit(input);
+	};
+	visit(root);
+	baker.Retain(baked);
+}
+
+void App::LoadMeshes(std::shared_ptr<Node> root)
+{
+	std::function<void(std::shared_ptr<Node>)> visit = [&](std::shared_ptr<Node> node) {
+		if (auto opnode = std::dynamic_pointer_cast<OperatorNode>(node)) {
+			for (auto& input : *opnode)
+				visit(input);
+			return;
+		}
+		auto primnode = std::dynamic_pointer_cast<PrimitiveNode>(node);
+		Mesh* mesh = primnode ? dynamic_cast<Mesh*>(primnode->primitive.get()) : nullptr;
+		if (mesh == nullptr || mesh->IsLoaded())
+			return;
+		std::shared_ptr<const DistanceBake> bake;
+		std::string error;
+		if (meshLoader.Find(mesh->file, mesh->resolution, Mesh::bandVoxels, bake, error)) {
+			mesh->SetLoaded(std::move(bake), std::move(error));
+			generatorSettingsChanged = true; // regenerate with the new bake
+		}
+	};
+	if (root)
+		visit(root);
+}
+
+void App::GenerateBvhShader(std::shared_ptr<Node> root)
+{
+	shaderReady = true;
+	try {
+		profiler.BeginCpu("bvh build");
+		bvh.Build(root);
+		profiler.EndCpu("bvh build");
+		std::cout << "\nBVH UPDATE: " << bvh.PrimitiveCount() << " primitives, " << bvh.NodeCount() << " nodes\n";
+
+		profiler.BeginCpu("bvh upload");
+		bvhBuffers.Upload(bvh);
+		glFinish();
+		profiler.EndCpu("bvh upload");
+
+		// the shader doesn't depend on the scene, it's only linked when switching to this mode
+		if (!shaderUsesBvh) {
+			profiler.BeginCpu("link");
+			std::ofstream constantsFile("Shaders/tmp/constants.frag", std::ofstream::out);
+			constantsFile << ShaderLibManager::GenerateConstants(0); // the data-driven sdf has no dual variant
+			constantsFile.close();
+
+			sphereTracerProgram = std::make_unique<decltype(sphereTracerProgram)::element_type>("RaymarchingProgram");
+			*sphereTracerProgram << "Shaders/trace.vert"_vert << "Shaders/tmp/constants.frag"_frag << "Shaders/number.frag"_frag << "Shaders/tmp/primitives_real.frag"_frag
+				<< "Shaders/bvh_sdf.frag"_frag << "Shaders/trace.frag"_frag << df::LinkProgram;
+			glFinish();
+			profiler.EndCpu("link");
+			std::cerr << sphereTracerProgram->GetErrors();
+
+			shaderUsesBvh = true;
+			shaderUsesLevelOfDetail = false;
+		}
+
+		GL_CHECK;
+		currentShaderGenException = std::nullopt;
+	}
+	catch (shader_gen_exception& e) {
+		std::cerr << "Failed to build the bvh. Does the graph contain operators other than union, or meshes?\n";
+		currentShaderGenException = e;
+		shaderReady = false;
+	}
+}
+
+void App::GenerateBenchmarkScene()
+{
+	try {
+		ordered_json scene = BenchmarkSceneGenerator::Generate(benchmarkPrimitiveCount);
+		Persistence::LoadFromString(editor, scene.dump());
+		editor.FocusContent();
+		currentFileName = {};
+	}
+	catch (std::exception& e) {
+		errorMessageQueue.push(std::string("Failed to generate benchmark scene.\n") + e.what());
+		shaderReady = false;
+	}
+}
+
 GLuint App::initDirVao()
 {
 	dirVbo.constructImmutable(std::vector<Vertex>{ 
@@ -127,6 +258,14 @@ void App::DrawUI()
 			if (ImGui::MenuItem("Open")) {
 				Open();
 			}
+			ImGui::Separator();
+			ImGui::PushItemWidth(100);
+			if (ImGui::InputInt("primitives", &benchmarkPrimitiveCount, 1000, 10000))
+				benchmarkPrimitiveCount = std::max(benchmarkPrimitiveCount, 1);
+			ImGui::PopItemWidth();
+			if (ImGui::MenuItem("Generate benchmark scene")) {
+				GenerateBenchmarkScene();
+			}
 			ImGui::EndMenu();
 		}
 		if (ImGui::BeginMenu("View")) {
@@ -142,6 +281,7 @@ void App::DrawUI()
 			if (ImGui::Checkbox("Directions", &showDirections)) {
 				redrawNeeded = 2;
 			}
+			ImGui::Checkbox("Profiler", &showProfiler);
 			ImGui::EndMenu();
 		}
 		if (ImGui::BeginMenu("Derivatives")) {
@@ -157,10 +297,48 @@ void App::DrawUI()
 			ImGui::PopItemWidth();
 			ImGui::EndMenu();
 		}
+		if (ImGui::BeginMenu("Generator")) {
+			if (ImGui::Checkbox("Data-driven (bvh, unions only)", &useBvh)) {
+				generatorSettingsChanged = true;
+			}
+			if (ImGui::Checkbox("Bounding volume guards", &useBoundingGuards)) {
+				generatorSettingsChanged = true;
+			}
+			if (ImGui::Checkbox("Level of detail", &useLevelOfDetail)) {
+				generatorSettingsChanged = true;
+			}
+			if (useLevelOfDetail) {
+				ImGui::PushItemWidth(100);
+				if (ImGui::InputFloat("LOD scale", &lodScale, 0.25f, 1.0f, 2))
+					redrawNeeded = 2;
+				ImGui::PopItemWidth();
+			}
+			ImGui::PushItemWidth(100);
+			if (ImGui::InputInt("Bake resolution", &baker.resolution, 16, 64)) { // of the nodes marked as baked
+				baker.resolution = std::clamp(baker.resolution, 16, 512);
+				generatorSettingsChanged = true;
+			}
+			if (ImGui::InputFloat("Bake band (voxels)", &baker.bandVoxels, 0.5f, 1.0f, 1)) {
+				baker.bandVoxels = std::clamp(baker.bandVoxels, 1.0f, 8.0f);
+				generatorSettingsChanged = true;
+			}
+			ImGui::PopItemWidth();
+			ImGui::EndMenu();
+		}
 		if (ImGui::BeginMenu("Visualization")) {
 			ImGui::PushItemWidth(100);
 			ImGui::Checkbox("Realtime", &realtime);
 
+			if (ImGui::Checkbox("Tiled rendering", &tiledRendering))
+				redrawNeeded = 2;
+			if (tiledRendering) {
+				if (ImGui::InputInt("tile size", &tileSize, 16, 64))
+					tileSize = std::max(tileSize, 16);
+				if (ImGui::InputInt("tiles per frame", &tilesPerFrame, 1, 8))
+					tilesPerFrame = std::max(tilesPerFrame, 1);
+				ImGui::ProgressBar(progressiveFramebuffer.Progress(), ImVec2(100, 0));
+			}
+
 			if (enableDerivatives && displayMode != DisplayMode::GAUSSIAN_CURVATURE && displayMode != DisplayMode::MEAN_CURVATURE ||
 				enableDerivatives && derivativeOrder > 1)
 				if (ImGui::Checkbox("Use automatic differentiation", &useAutoDiff))
@@ -217,7 +395,9 @@ void App::DrawUI()
 		ImGui::Text(errorText.c_str());
 		ImGui::SetCursorPos(pos);
 		if (ImGui::InvisibleButton("err_jump", size)) {
-			editor.SelectNode(currentShaderGenException.value().source());
+			auto guiNode = currentShaderGenException.value().source()->guiNode.lock();
+			if (guiNode != nullptr)
+				editor.SelectNode(guiNode);
 		}
 	}
 
@@ -265,6 +445,9 @@ void App::DrawUI()
 	}
 
 	ImGui::End();
+
+	if (showProfiler)
+		profiler.DrawUI(&showProfiler);
 }
 
 bool App::isShaderGenerationPending()
@@ -278,6 +461,13 @@ void App::Update()
 	if (redrawKeysDown > 0)
 		redrawNeeded = 2;
 
+	if (baker.TakeFinished()) // regenerate with the new bake
+		generatorSettingsChanged = true;
+	for (auto& error : baker.TakeErrors())
+		errorMessageQueue.push(error);
+	if (meshLoader.TakeFinished() || editor.IsDirty()) // queues the changed meshes, takes the finished ones
+		LoadMeshes(editor.GetCurrentRoot());
+
 	if (isShaderGenerationPending()) {
 		if (0 >= shaderGenerationCountdown--) {
 			manualGenerateShaders = false;
@@ -287,27 +477,101 @@ void App::Update()
 	}
 }
 
+std::string App::GetProfilerConfigTag()
+{
+	static const char* displayModeNames[] = { "shaded", "steps", "normals", "gaussian", "mean", "normal error" };
+	std::stringstream tag;
+	tag << "derivatives=" << (enableDerivatives ? derivativeOrder : 0)
+		<< ";autodiff=" << (enableDerivatives && useAutoDiff)
+		<< ";bvh=" << (shaderUsesBvh ? (int)bvh.PrimitiveCount() : 0)
+		<< ";guards=" << useBoundingGuards
+		<< ";lod=" << (useLevelOfDetail ? lodScale : 0)
+		<< ";mode=" << displayModeNames[(int)displayMode]
+		<< ";size=" << cam.GetSize().x << "x" << cam.GetSize().y;
+	return tag.str();
+}
+
+template<typename Framebuffer>
+void App::DrawSphereTracer(Framebuffer& target)
+{
+	target << *sphereTracerProgram
+		<< "eye_pos" << cam.GetEye()
+		<< "inv_view_proj" << cam.GetInverseViewProj()
+		<< "view_proj" << cam.GetViewProj()
+		<< "to_light" << dirToLight
+		<< "display_mode" << (int)displayMode
+		<< "vis_multiplier" << visMultiplier
+		<< "eps" << approx_eps;
+	if (enableDerivatives && !shaderUsesBvh) // workaround: if autodiff is disabled the shader compiler optimizes out this uniform because it's unused
+		target << *sphereTracerProgram << "use_auto_diff" << (int)useAutoDiff;
+	if (shaderUsesBvh)
+		bvhBuffers.Bind();
+	if (!shaderUsesBvh && bakeTextures.Count() > 0) {
+		bakeTextures.Bind();
+		for (size_t i = 0; i < bakeTextures.Count(); ++i)
+			target << *sphereTracerProgram << SDFGenerator::BakeSamplerName(i) << (int)(BakeTextures::firstUnit + i);
+	}
+	if (shaderUsesLevelOfDetail) { // same workaround, the pixel footprint is only used by the proxies
+		float pixelRadius = 1.0f / (cam.GetProj()[1][1] * cam.GetSize().y); // half of a pixel's height at unit distance
+		target << *sphereTracerProgram << "lod_pixel_radius" << pixelRadius * lodScale;
+	}
+	*sphereTracerProgram << sphereTracerVaoArrays;	//Rendering: Ensures that both the vao and program is attached
+	GL_CHECK;
+	sphereTracerProgram->Render();
+}
+
+void App::RenderTiled()
+{
+	progressiveFramebuffer.Resize(cam.GetSize(), tileSize);
+	if (redrawNeeded > 0) // something changed since the last image, start accumulating a new one
+		progressiveFramebuffer.Restart();
+
+	// sphere trace a few tiles into the accumulation framebuffer
+	auto tiles = progressiveFramebuffer.NextTiles(tilesPerFrame);
+	if (!tiles.empty()) {
+		profiler.BeginGpu("trace");
+		for (auto& tile : tiles) {
+			progressiveFramebuffer.BeginTile(tile);
+			DrawSphereTracer(progressiveFramebuffer);
+		}
+		glDisable(GL_SCISSOR_TEST);
+		profiler.EndGpu();
+	}
+
+	// present the accumulated image
+	profiler.BeginGpu("present");
+	glBindTextureUnit(0, progressiveFramebuffer.GetColorTexture());
+	glBindTextureUnit(1, progressiveFramebuffer.GetDepthTexture());
+	df::Backbuffer << presentProgram
+		<< "color_tex" << 0
+		<< "depth_tex" << 1;
+	presentProgram << sphereTracerVaoArrays;
+	GL_CHECK;
+	presentProgram.Render();
+	profiler.EndGpu();
+}
+
 void App::Render()
 {
-	if (realtime || redrawNeeded > 0) {
+	// everything since the end of the previous Render() call was ImGui rendering and presenting
+	profiler.EndGpuSpan("ui + present");
+	profiler.NewFrame();
+	profiler.SetConfigTag(GetProfilerConfigTag());
+
+	bool tilesPending = tiledRendering && shaderReady && !progressiveFramebuffer.IsComplete();
+	if (realtime || redrawNeeded > 0 || tilesPending) {
 		// Draw sphere traced model
 		df::Backbuffer << df::Clear(1.0f, 1.0f, 1.0f);
-		if (shaderReady) {
-			df::Backbuffer << *sphereTracerProgram
-				<< "eye_pos" << cam.GetEye()
-				<< "inv_view_proj" << cam.GetInverseViewProj()
-				<< "view_proj" << cam.GetViewProj()
-				<< "to_light" << dirToLight
-				<< "display_mode" << (int)displayMode
-				<< "vis_multiplier" << visMultiplier
-				<< "eps" << approx_eps;
-			if (enableDerivatives) // workaround: if autodiff is disabled the shader compiler optimizes out this uniform because it's unused
-				df::Backbuffer << *sphereTracerProgram << "use_auto_diff" << (int)useAutoDiff;
-			*sphereTracerProgram << sphereTracerVaoArrays;	//Rendering: Ensures that both the vao and program is attached
-			GL_CHECK;
-			sphereTracerProgram->Render();
+		if (shaderReady && tiledRendering) {
+			RenderTiled();
+		}
+		else if (shaderReady) {
+			profiler.BeginGpu("trace");
+			DrawSphereTracer(df::Backbuffer);
+			profiler.EndGpu();
 		}
 
+		profiler.BeginGpu("gizmos");
 		// Draw directional gizmo in upper left corner:
 		if (showDirections) {
 			glDisable(GL_DEPTH_TEST);
@@ -331,10 +595,13 @@ void App::Render()
 			GL_CHECK;
 			gizmoProgram.Render();
 		}
+		profiler.EndGpu();
 
 		if(redrawNeeded > 0)
 			redrawNeeded--;
 	}
+
+	profiler.BeginGpuSpan("ui + present");
 }
 
 void App::Save(bool forceAskFileName)
@@ -405,7 +672,8 @@ App::App(df::Sample& sam, float aspect) :
 	sphereTracerVaoArrays(initSphereTracerVao(), GL_TRIANGLE_STRIP, 3, 0u),
 	dirVaoArrays(initDirVao(), GL_LINES, 6u, 0u),
 	axesVaoArrays(initAxesVao(), GL_LINES, 6u, 0u),
-	gizmoProgram("GizmoProgram")
+	gizmoProgram("GizmoProgram"),
+	presentProgram("PresentProgram")
 {
 	SDL_GL_SetSwapInterval(1); // enable vsync
 
@@ -418,6 +686,10 @@ App::App(df::Sample& sam, float aspect) :
 	std::cout << gizmoProgram.GetErrors();
 	GL_CHECK;
 
+	presentProgram << "Shaders/trace.vert"_vert << "Shaders/present.frag"_frag << df::LinkProgram;
+	std::cout << presentProgram.GetErrors();
+	GL_CHECK;
+
 	cam.SetView(glm::vec3(0, 1, 3), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
 
 	ImGui::SetWindowSize("Editor", ImVec2(600, 700));
@@ -433,6 +705,7 @@ App::App(df::Sample& sam, float aspect) :
 	}
 
 	ShaderLibManager::GeneratePrimitiveLibs();
+	TriangleMesh::SetImporter(AssimpImporter::Read); // the Mesh primitives read any format assimp knows
 }
 
 App::~App()
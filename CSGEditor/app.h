@@ -8,6 +8,13 @@
 #include "Editor.h"
 
 #include "exceptions.h"
+#include "Profiler.h"
+#include "ProgressiveFramebuffer.h"
+#include "PrimitiveBVH.h"
+#include "BvhBuffers.h"
+#include "DistanceBake.h"
+#include "MeshDistance.h"
+#include "BakeTextures.h"
 
 #include <chrono>
 #include <queue>
@@ -24,6 +31,9 @@ private:
 	// The shader used for drawing the axes and the direction gizmo
 	df::ShaderProgramVF gizmoProgram;
 
+	// The shader copying the image of the tiled renderer to the screen
+	df::ShaderProgramVF presentProgram;
+
 	// These contain a single triangle covering the screen. 
 	// Used for running the sphere tracing fragment shader over each screen pixel.
 	eltecg::ogl::ArrayBuffer sphereTracerVbo;
@@ -62,15 +72,52 @@ private:
 
 	bool showAxes = true; // if true, the axes gizmo will be drawn
 	bool showDirections = true; // if true, the direction gizmo will be drawn
+	bool showProfiler = false; // if true, the profiler window with the frame time graphs will be drawn
+
+	// Times the render passes and the shader generation steps
+	Profiler profiler;
+	std::string GetProfilerConfigTag(); // describes the current shader variant and display mode for the csv log
 	
 	// The epsilon used for approximating first and second derivatives
 	float approx_eps = 0.01f;
 
 	bool realtime = true; // if false, the displayed image will only be redrawn when there is a change
+
+	// Tiled progressive rendering: only tilesPerFrame tiles of the image are sphere traced each frame,
+	// so the editor stays responsive (and driver watchdogs are not triggered) even with very expensive shaders
+	bool tiledRendering = false;
+	int tileSize = 128;
+	int tilesPerFrame = 4;
+	ProgressiveFramebuffer progressiveFramebuffer;
+	void RenderTiled();
+
+	template<typename Framebuffer>
+	void DrawSphereTracer(Framebuffer& target);
 	bool useAutoDiff = false; // whether to use numeric approximation or automatic differentiation for computing derivatives
 	bool enableDerivatives = false; // whether to include the dual library and dual sdf in the generated shader
 	int derivativeOrder = 1;
 
+	bool useBoundingGuards = true; // whether the generated sdf skips the subtrees whose bounding box is farther than the closest distance found so far
+	// Data-driven sdf for huge unions: the primitives and a bvh over them are uploaded into buffers, the shader only has to be linked once
+	bool useBvh = false;
+	bool shaderUsesBvh = false; // true if the current shader is the data-driven one
+	PrimitiveBVH bvh;
+	BvhBuffers bvhBuffers;
+	void GenerateBvhShader(std::shared_ptr<Node> root);
+
+	bool useLevelOfDetail = false; // whether the generated sdf replaces subtrees covering less than a pixel with their bounding box
+	bool shaderUsesLevelOfDetail = false; // useLevelOfDetail at the time the current shader was generated
+	float lodScale = 1.0f; // multiplier for the pixel footprint, larger values switch to proxies sooner
+
+	// Operator nodes marked as baked are sampled from distance textures, which are rebaked in the background when the subtree changes
+	SubtreeBaker baker;
+	BakeTextures bakeTextures;
+	void FindBakes(std::shared_ptr<Node> root, std::unordered_map<const Node*, std::shared_ptr<const DistanceBake>>& bakes);
+
+	// Mesh primitives whose file or resolution changed in the editor are loaded in the background, the shader is regenerated when they are ready
+	MeshLoader meshLoader;
+	void LoadMeshes(std::shared_ptr<Node> root);
+
 	bool generatorSettingsChanged = false; // signals if any setting that affects shader generation (eg.: derivative order) was changed
 	std::optional<shader_gen_exception> currentShaderGenException; // the exception after a failed shader generation attempt, used for displaying error in editor
 
@@ -97,6 +144,9 @@ public:
 	void Save(bool forceAskFileName = false);
 	void Open();
 
+	int benchmarkPrimitiveCount = 10000;
+	void GenerateBenchmarkScene();
+
 	bool HandleKeyDown(const SDL_KeyboardEvent& key);
 	bool HandleKeyUp(const SDL_KeyboardEvent& key);
 	bool HandleMouseMotion(const SDL_MouseMotionEvent& mouse);
@@ -0,0 +1,17 @@
+#include "core_utils.h"
+
+std::ostream& operator<<(std::ostream& s, const glm::vec3& v) {
+	return s << "vec3(" << v.x << ',' << v.y << ',' << v.z << ')';
+}
+
+void glm::to_json(ordered_json& j, const glm::vec3& v)
+{
+	j = { {"x", v.x}, { "y", v.y }, { "z", v.z } };
+}
+
+void glm::from_json(const ordered_json& j, glm::vec3& v)
+{
+	v.x = j["x"].get<float>();
+	v.y = j["y"].get<float>();
+	v.z = j["z"].get<float>();
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <glm/vec3.hpp>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <json.hpp>
+
+using namespace nlohmann;
+
+/// <summary>
+/// Helpers shared by the graph model and the generators. Unlike utils.h, this file must not depend on the GUI.
+/// </summary>
+namespace utils {
+
+	template<typename BaseType, typename... SubTypes>
+	class TypeList {
+	private:
+
+		template<typename T>
+		static std::unique_ptr<BaseType> TryCreate(ordered_json& json, std::string typeName) {
+			if (T().GetName() == typeName) {
+				return std::unique_ptr<T>(new T(json));
+			}
+			throw std::runtime_error("Attempting to create unknown type from typelist.");
+		}
+
+		template<typename T, typename... types>
+		static std::unique_ptr<BaseType> TryCreate(ordered_json& json, std::string typeName, typename std::enable_if<sizeof...(types) >= 1, int>::type = 0) {
+
+			if (T().GetName() == typeName) {
+				return std::make_unique<T>(json);
+			}
+			return TryCreate<types...>(json, typeName);
+		}
+
+	public:
+		static std::unique_ptr<BaseType> Create(ordered_json& json, std::string typeName) {
+			return TryCreate<SubTypes...>(json, typeName);
+		}
+
+
+	private:
+		template<typename T>
+		static void GetListOfTypeNames(std::vector<std::string>& v) {
+			v.push_back(T().GetName());
+		}
+
+		template<typename T, typename... types>
+		static void GetListOfTypeNames(std::vector<std::string>& v, typename std::enable_if<sizeof...(types) >= 1, int>::type = 0) {
+			v.push_back(T().GetName());
+			GetListOfTypeNames<types...>(v);
+		}
+
+		inline static bool nameListGenerated = false;
+		inline static std::vector<std::string> names;
+
+	public:
+		static std::vector<std::string>& GetListOfTypeNames() {
+			if (nameListGenerated)
+				return names;
+
+			GetListOfTypeNames<SubTypes...>(names);
+			nameListGenerated = true;
+			return names;
+		}
+
+	private:
+		template<typename T>
+		static std::unique_ptr<BaseType> TryCreate(size_t type_idx, size_t idx) {
+			if (idx == type_idx) {
+				return std::make_unique<T>();
+			}
+			throw std::runtime_error("Attempting to create unknown type from typelist.");
+		}
+
+		template<typename T, typename... types>
+		static std::unique_ptr<BaseType> TryCreate(size_t type_idx, size_t idx, typename std::enable_if<sizeof...(types) >= 1, int>::type = 0) {
+			if (idx == type_idx) {
+				return std::make_unique<T>();
+			}
+			return TryCreate<types...>(type_idx, idx + 1);
+		}
+
+	public:
+		static std::unique_ptr<BaseType> Create(size_t type_idx) {
+			return TryCreate<SubTypes...>(type_idx, 0);
+		}
+
+		static size_t GetTypeIdx(std::string name) {
+			auto& n = GetListOfTypeNames();
+			return std::distance(n.begin(), std::find(n.begin(), n.end(), name));
+		}
+	};
+
+}
+
+/// <summary>
+/// Writes the vector as a glsl vec3 constructor, used by the code generators.
+/// </summary>
+std::ostream& operator<<(std::ostream& s, const glm::vec3& v);
+
+namespace glm {
+	void to_json(ordered_json& j, const glm::vec3& v);
+	void from_json(const ordered_json& j, glm::vec3& v);
+}
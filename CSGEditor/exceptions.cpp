@@ -1 +1,4 @@
 #include "exceptions.h"
+#include "Node.h"
+
+shader_gen_exception::shader_gen_exception(REASON reason, std::shared_ptr<Node> source) : _reason(reason), _source(source) {}
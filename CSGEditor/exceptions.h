@@ -4,24 +4,24 @@
 
 #include "forward_declarations.h"
 
-#include "Editor.h"
-#include "Operator.h"
-
 class shader_gen_exception : public std::exception {
 public:
-	enum class REASON { OPERATOR_HAS_NO_INPUTS, SMOOTH_OPERATOR_NEEDS_EXACTLY_TWO_INPUTS };
+	enum class REASON { OPERATOR_HAS_NO_INPUTS, SMOOTH_OPERATOR_NEEDS_EXACTLY_TWO_INPUTS, OPERATOR_NOT_SUPPORTED_BY_BVH, PRIMITIVE_NOT_SUPPORTED_BY_BVH };
 	const char* what() const noexcept {
 		return "Shader generation failed";
 	}
 
-	shader_gen_exception(REASON reason, std::shared_ptr<OperatorNode> source) : _reason(reason), _source(source->guiNode.lock()) {}
+	shader_gen_exception(REASON reason, std::shared_ptr<Node> source);
 
 	REASON reason() const { return _reason; }
-	Editor::NodeHandle source() const { return _source; }
+	/// <summary>
+	/// The node that caused the error. The editor can find its gui node through Node::guiNode.
+	/// </summary>
+	std::shared_ptr<Node> source() const { return _source; }
 
 private:
 	REASON _reason;
-	std::shared_ptr<GuiNode> _source;
+	std::shared_ptr<Node> _source;
 };
 
 class partial_shader_gen_exception : public std::exception {
@@ -44,7 +44,3 @@ namespace utils {
 
 	
 }
-
-std::ostream& operator<<(std::ostream& s, const glm::vec3& v) {
-	return s << "vec3(" << v.x << ',' << v.y << ',' << v.z << ')';
-}
\ No newline at end of file
@@ -0,0 +1,1877 @@
+// Headless front end of the core library: code generation and benchmarks without the editor (eg.: on build or render servers).
+#include "NodeJsonSerializer.h"
+#include "SDFGenerator.h"
+#include "DifferentiatedSDFGenerator.h"
+#include "PrimitiveBVH.h"
+#include "BenchmarkSceneGenerator.h"
+#include "TapeGenerator.h"
+#include "TapeEvaluator.h"
+#include "ReferenceSDF.h"
+#include "Dual.h"
+#include "IntervalOctree.h"
+#include "CpuRenderer.h"
+#include "JitSdf.h"
+#include "PointQuery.h"
+#include "RayQuery.h"
+#include "SurfaceSampler.h"
+#include "PointCloudWriter.h"
+#include "BoundsCalculatorVisitor.h"
+#include "LipschitzCalculatorVisitor.h"
+#include "MarchingCubes.h"
+#include "DualContouring.h"
+#include "MeshWriter.h"
+#include "DistanceBake.h"
+#include "SparseVolume.h"
+#include "TriangleMesh.h"
+#include "MeshDistance.h"
+#include "MassIntegrator.h"
+#include "SliceExporter.h"
+#include "exceptions.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/component_wise.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+	using Args = std::vector<std::string>;
+
+	// thrown with the expected arguments of the command
+	struct usage_error : std::runtime_error {
+		using std::runtime_error::runtime_error;
+	};
+
+	bool HasFlag(const Args& args, const std::string& flag) {
+		return std::find(args.begin(), args.end(), flag) != args.end();
+	}
+
+	// value of an option given as --name=value
+	std::string OptionValue(const Args& args, const std::string& name, const std::string& defaultValue) {
+		for (auto& a : args)
+			if (a.rfind(name + "=", 0) == 0)
+				return a.substr(name.size() + 1);
+		return defaultValue;
+	}
+
+	// "x,y,z"
+	glm::vec3 ParseVec3(const std::string& s) {
+		glm::vec3 v;
+		if (std::sscanf(s.c_str(), "%f,%f,%f", &v.x, &v.y, &v.z) != 3)
+			throw std::runtime_error("expected x,y,z instead of " + s);
+		return v;
+	}
+
+	// the random trees are generated to have a surface (see BenchmarkSceneGenerator::GenerateRandomTree), a check of an empty one tests nothing
+	bool EmptyRandomScene(const std::string& fileName, size_t surface) {
+		if (surface != 0 || fileName.rfind("random:", 0) != 0)
+			return false;
+		std::cerr << fileName << " has no surface\n";
+		return true;
+	}
+
+	// positional arguments are the ones not starting with "--"
+	std::vector<std::string> Positionals(const Args& args) {
+		std::vector<std::string> result;
+		for (auto& a : args)
+			if (a.rfind("--", 0) != 0)
+				result.push_back(a);
+		return result;
+	}
+
+	// a graph file, or a generated scene: "bench:<primitive count>" (see BenchmarkSceneGenerator::Generate) or "random:<primitive count>[:seed]"
+	std::shared_ptr<Node> LoadRoot(const std::string& fileName) {
+		std::string content;
+		if (fileName.rfind("bench:", 0) == 0) {
+			content = BenchmarkSceneGenerator::Generate(std::stoi(fileName.substr(6))).dump();
+		}
+		else if (fileName.rfind("random:", 0) == 0) {
+			size_t seedPos = fileName.find(':', 7);
+			unsigned int seed = seedPos == std::string::npos ? 1 : std::stoul(fileName.substr(seedPos + 1));
+			content = BenchmarkSceneGenerator::GenerateRandomTree(std::stoi(fileName.substr(7, seedPos - 7)), seed).dump();
+		}
+		else {
+			std::ifstream f(fileName);
+			if (!f.is_open())
+				throw std::runtime_error("can't open " + fileName);
+			content.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>{});
+		}
+
+		auto roots = NodeJsonSerializer::Deserialize(content);
+		if (roots.empty())
+			throw std::runtime_error(fileName + " contains no nodes");
+		return roots.front();
+	}
+
+	template<typename F>
+	double MeasureMs(F&& f) {
+		auto start = std::chrono::high_resolution_clock::now();
+		f();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	int Codegen(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() != 1)
+			throw usage_error("codegen <graph.json> [--dual] [--guards] [--lod]");
+
+		auto root = LoadRoot(pos[0]);
+		if (HasFlag(args, "--dual")) {
+			DifferentiatedSDFGenerator generator;
+			generator.useBoundingGuards = HasFlag(args, "--guards");
+			std::cout << generator.GenerateFromRoot(root);
+		}
+		else {
+			SDFGenerator generator;
+			generator.useBoundingGuards = HasFlag(args, "--guards");
+			generator.useLevelOfDetail = HasFlag(args, "--lod");
+			std::cout << generator.GenerateFromRoot(root);
+		}
+		return 0;
+	}
+
+	int Scene(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() < 2)
+			throw usage_error("scene <primitive count> <out.json> [seed]");
+
+		unsigned int seed = pos.size() > 2 ? std::stoul(pos[2]) : 1;
+		std::ofstream f(pos[1]);
+		f << std::setw(4) << BenchmarkSceneGenerator::Generate(std::stoi(pos[0]), seed);
+		return 0;
+	}
+
+	int Bench(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() != 1)
+			throw usage_error("bench <primitive count>");
+
+		std::string sceneJson;
+		std::vector<std::shared_ptr<Node>> roots;
+		std::string code;
+		PrimitiveBVH bvh;
+
+		std::cout << "scene generation: " << MeasureMs([&] { sceneJson = BenchmarkSceneGenerator::Generate(std::stoi(pos[0])).dump(); }) << " ms\n";
+		std::cout << "deserialization:  " << MeasureMs([&] { roots = NodeJsonSerializer::Deserialize(sceneJson); }) << " ms\n";
+		std::cout << "sdf generation:   " << MeasureMs([&] { code = SDFGenerator().GenerateFromRoot(roots.front()); }) << " ms (" << code.size() << " characters)\n";
+		std::cout << "guarded sdf:      " << MeasureMs([&] {
+			SDFGenerator generator;
+			generator.useBoundingGuards = true;
+			code = generator.GenerateFromRoot(roots.front());
+		}) << " ms (" << code.size() << " characters)\n";
+		std::cout << "bvh build:        " << MeasureMs([&] { bvh.Build(roots.front()); }) << " ms (" << bvh.PrimitiveCount() << " primitives, " << bvh.NodeCount() << " nodes)\n";
+		return 0;
+	}
+
+	// uniformly distributed points around the bounds of the graph, in separate coordinate arrays
+	struct PointSet {
+		std::vector<float> x, y, z;
+	};
+
+	// the bounds of the graph with some margin, or a fixed box around the origin for unbounded graphs
+	BoundingBox SceneBox(std::shared_ptr<Node> root) {
+		BoundingBox box = BoundsCalculatorVisitor().CalculateBounds(root).at(root.get());
+		if (box.IsInfinite())
+			box = BoundingBox::FromHalfSize(glm::vec3(5));
+		return box.Expanded(0.25f * glm::length(box.HalfSize()));
+	}
+
+	PointSet RandomPoints(std::shared_ptr<Node> root, size_t count, unsigned int seed = 1) {
+		BoundingBox box = SceneBox(root);
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		PointSet points;
+		for (auto* coords : { &points.x, &points.y, &points.z })
+			coords->resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			glm::vec3 p = box.min + (box.max - box.min) * glm::vec3(unit(rng), unit(rng), unit(rng));
+			points.x[i] = p.x;
+			points.y[i] = p.y;
+			points.z[i] = p.z;
+		}
+		return points;
+	}
+
+	// rays from a sphere around the graph towards random points of its bounds
+	void RandomRays(std::shared_ptr<Node> root, size_t count, std::vector<float> origins[3], std::vector<float> directions[3]) {
+		BoundingBox box = SceneBox(root);
+		PointSet targets = RandomPoints(root, count, 1), starts = RandomPoints(root, count, 2);
+		for (int axis = 0; axis < 3; ++axis) {
+			origins[axis].resize(count);
+			directions[axis].resize(count);
+		}
+		float radius = 2 * glm::length(box.HalfSize());
+		for (size_t i = 0; i < count; ++i) {
+			glm::vec3 target(targets.x[i], targets.y[i], targets.z[i]);
+			glm::vec3 origin = box.Center() + radius * glm::normalize(glm::vec3(starts.x[i], starts.y[i], starts.z[i]) - box.Center());
+			for (int axis = 0; axis < 3; ++axis) {
+				origins[axis][i] = origin[axis];
+				directions[axis][i] = target[axis] - origin[axis];
+			}
+		}
+	}
+
+	// compares the tape evaluator to the straightforward port of the shader formulas
+	int Verify(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("verify <graph.json | random:<count>[:seed] | bench:<count>> [point count]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 100000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		PointSet points = RandomPoints(root, count);
+
+		std::vector<float> distances(count);
+		TapeEvaluator::EvaluateParallel(tape, points.x.data(), points.y.data(), points.z.data(), distances.data(), count);
+
+		ReferenceSDF reference;
+		double maxError = 0;
+		size_t failures = 0;
+		for (size_t i = 0; i < count; ++i) {
+			float expected = reference.Evaluate(root, glm::vec3(points.x[i], points.y[i], points.z[i]));
+			double error = std::abs((double)distances[i] - expected);
+			// the tape folds the primitive's scale into its matrix, so only rounding differences are allowed
+			double tolerance = 1e-4 * (1 + std::abs(expected));
+			if (!(error <= tolerance) && !(std::isnan(expected) && std::isnan(distances[i]))) {
+				if (failures++ < 10)
+					std::cerr << "mismatch at (" << points.x[i] << ", " << points.y[i] << ", " << points.z[i] << "): " << distances[i] << " != " << expected << '\n';
+			}
+			if (error > maxError)
+				maxError = error;
+		}
+
+		std::cout << tape.instructions.size() << " instructions, " << tape.registerCount << " registers, " << count << " points: "
+			<< failures << " mismatches, max error " << maxError << '\n';
+		return failures == 0 ? 0 : 1;
+	}
+
+	// compares the port of the guarded code (SDFGenerator::useBoundingGuards) to the unguarded one: skipping an input must never change
+	// the sign of the distance, and for exact distances only make it smaller. Without a graph, on intersections and substractions whose
+	// inputs overlap partly
+	int Guards(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() > 2)
+			throw usage_error("guards [graph.json | random:<count>[:seed] | bench:<count>] [point count]");
+
+		std::vector<std::shared_ptr<Node>> roots;
+		std::vector<std::string> names;
+		if (!pos.empty()) {
+			roots.push_back(LoadRoot(pos[0]));
+			names.push_back(pos[0]);
+		}
+		else {
+			ordered_json box = { { "primitive", "box" }, { "dimensions", glm::vec3(1, 1, 1) } };
+			ordered_json sphere = { { "primitive", "sphere" }, { "translate", glm::vec3(0.3f, 0.2f, 0) }, { "scale", 1.3f } };
+			ordered_json cylinder = { { "primitive", "cylinder" }, { "radius", 0.2f }, { "height", 2.0f } };
+			auto op = [](const char* name, std::vector<ordered_json> inputs, float scale = 1) {
+				ordered_json j = { { "operator", name }, { "scale", scale }, { "inputs", inputs } };
+				if (std::string(name).rfind("smooth", 0) == 0)
+					j["k"] = 0.2f;
+				return j;
+			};
+			ordered_json scenes = ordered_json::array({
+				op("intersect", { box, sphere }),
+				op("substract", { box, sphere }),
+				op("smooth intersect", { box, sphere }),
+				op("smooth substract", { box, sphere }),
+				op("intersect", { box, sphere, cylinder }, 2),
+				op("substract", { box, sphere, cylinder }, 0.5f),
+				op("union", { op("intersect", { sphere, box }), op("smooth substract", { sphere, cylinder, box }) }),
+			});
+			roots = NodeJsonSerializer::Deserialize(scenes.dump());
+			for (auto& scene : scenes)
+				names.push_back(scene["operator"].get<std::string>() + " of " + std::to_string(scene["inputs"].size()) + " inputs");
+		}
+
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 100000;
+		bool ok = true;
+		for (size_t r = 0; r < roots.size(); ++r) {
+			std::shared_ptr<Node> root = roots[r];
+			PointSet points = RandomPoints(root, count);
+			ReferenceSDF unguarded, guarded;
+			guarded.useBoundingGuards = true;
+			size_t wrongSigns = 0, larger = 0, approximated = 0;
+			for (size_t i = 0; i < count; ++i) {
+				glm::vec3 p(points.x[i], points.y[i], points.z[i]);
+				float exact = unguarded.Evaluate(root, p), bound = guarded.Evaluate(root, p);
+				float tolerance = 1e-4f * (1 + std::abs(exact));
+				bool wrongSign = (exact > tolerance && !(bound > 0)) || (exact < -tolerance && !(bound < 0));
+				if (wrongSign && wrongSigns++ < 10)
+					std::cerr << "at (" << p.x << ", " << p.y << ", " << p.z << "): guarded " << bound << ", unguarded " << exact << '\n';
+				larger += std::abs(bound) > std::abs(exact) + tolerance ? 1 : 0;
+				approximated += bound != exact ? 1 : 0;
+			}
+			std::cout << names[r] << ":\n  " << count << " points: " << wrongSigns << " with a wrong sign, " << larger << " with a larger distance, "
+				<< approximated << " replaced by a bound\n";
+			// the sdf of an ellipsoid can be below the distance to its box, the scenes only use exact distances
+			ok = ok && wrongSigns == 0 && (!pos.empty() || larger == 0);
+		}
+		return ok ? 0 : 1;
+	}
+
+	int EvalBench(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("evalbench <graph.json | random:<count>[:seed] | bench:<count>> [point count]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 1000000;
+		Tape tape;
+		double generationMs = MeasureMs([&] { tape = TapeGenerator().GenerateFromRoot(root); });
+		PointSet points = RandomPoints(root, count);
+		std::vector<float> distances(count);
+
+		std::cout << "tape: " << tape.instructions.size() << " instructions, " << tape.registerCount << " registers, generated in " << generationMs << " ms\n";
+		std::cout << "simd width: " << simd::vfloat::width << ", threads: " << ThreadPool::Global().ThreadCount() << '\n';
+
+		double singleMs = MeasureMs([&] { TapeEvaluator::Evaluate(tape, points.x.data(), points.y.data(), points.z.data(), distances.data(), count); });
+		std::cout << "single thread: " << count / singleMs / 1e3 << " M points/s\n";
+
+		double parallelMs = MeasureMs([&] { TapeEvaluator::EvaluateParallel(tape, points.x.data(), points.y.data(), points.z.data(), distances.data(), count); });
+		std::cout << "all threads:   " << count / parallelMs / 1e3 << " M points/s\n";
+		return 0;
+	}
+
+	// compiles the native code of a graph, compares it to the tape and measures both
+	int Jit(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("jit <graph.json | random:<count>[:seed] | bench:<count>> [point count] [--order=<max derivative order>]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 1000000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		PointSet points = RandomPoints(root, count);
+
+		JitSdf jit;
+		jit.maxOrder = std::stoi(OptionValue(args, "--order", "1"));
+		bool native = false;
+		double compileMs = MeasureMs([&] {
+			jit.Compile(tape);
+			native = jit.Wait();
+		});
+		if (!native) {
+			std::cerr << jit.Error() << '\n';
+			return 1;
+		}
+		std::cout << jit.LibraryPath() << (jit.FromCache() ? " loaded from the cache" : " compiled") << " in " << compileMs << " ms\n";
+
+		// the generated code computes the same operations, only fused multiply adds may round differently
+		std::vector<float> expected(count), actual(count);
+		TapeEvaluator::EvaluateParallel(tape, points.x.data(), points.y.data(), points.z.data(), expected.data(), count);
+		jit.EvaluateParallel(points.x.data(), points.y.data(), points.z.data(), actual.data(), count);
+		size_t failures = 0;
+		for (size_t i = 0; i < count; ++i)
+			if (!(std::abs(expected[i] - actual[i]) <= 1e-4f * (1 + std::abs(expected[i]))))
+				++failures;
+
+		size_t derivativeCount = std::min<size_t>(count, 100000);
+		if (jit.maxOrder >= 1) {
+			std::vector<Dual<1>> tapeParts(derivativeCount), nativeParts(derivativeCount);
+			TapeEvaluator::EvaluateDerivatives<1>(tape, points.x.data(), points.y.data(), points.z.data(), tapeParts.data(), derivativeCount);
+			jit.EvaluateDerivatives<1>(points.x.data(), points.y.data(), points.z.data(), nativeParts.data(), derivativeCount);
+			for (size_t i = 0; i < derivativeCount; ++i)
+				for (int k = 0; k < Dual<1>::size; ++k)
+					if (!(std::abs(tapeParts[i].d[k] - nativeParts[i].d[k]) <= 1e-3f * (1 + std::abs(tapeParts[i].d[k])))) {
+						++failures;
+						break;
+					}
+		}
+		std::cout << failures << " mismatches\n";
+
+		double tapeMs = MeasureMs([&] { TapeEvaluator::Evaluate(tape, points.x.data(), points.y.data(), points.z.data(), expected.data(), count); });
+		double nativeMs = MeasureMs([&] { jit.Evaluate(points.x.data(), points.y.data(), points.z.data(), actual.data(), count); });
+		std::cout << "tape:   " << count / tapeMs / 1e3 << " M points/s\n"
+			<< "native: " << count / nativeMs / 1e3 << " M points/s\n";
+		if (jit.maxOrder >= 1) {
+			std::vector<Dual<1>> parts(derivativeCount);
+			double tapeDualMs = MeasureMs([&] { TapeEvaluator::EvaluateDerivatives<1>(tape, points.x.data(), points.y.data(), points.z.data(), parts.data(), derivativeCount); });
+			double nativeDualMs = MeasureMs([&] { jit.EvaluateDerivatives<1>(points.x.data(), points.y.data(), points.z.data(), parts.data(), derivativeCount); });
+			std::cout << "gradients, tape:   " << derivativeCount / tapeDualMs / 1e3 << " M points/s\n"
+				<< "gradients, native: " << derivativeCount / nativeDualMs / 1e3 << " M points/s\n";
+		}
+		return failures == 0 ? 0 : 1;
+	}
+
+	// measures the point query for each derivative mask and checks it against the single threaded evaluation of the tape
+	int Query(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("query <graph.json | random:<count>[:seed] | bench:<count>> [point count] [--jit]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 1000000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		PointSet points = RandomPoints(root, count);
+
+		JitSdf jit;
+		if (HasFlag(args, "--jit")) {
+			jit.maxOrder = 2;
+			jit.Compile(tape);
+			if (!jit.Wait())
+				std::cerr << "using the tape: " << jit.Error() << '\n';
+		}
+
+		std::vector<float> arrays[10];
+		for (auto& a : arrays)
+			a.resize(count);
+		PointQueryOutput output;
+		output.value = arrays[0].data();
+		for (int i = 0; i < 3; ++i)
+			output.gradient[i] = arrays[1 + i].data();
+		for (int i = 0; i < 6; ++i)
+			output.hessian[i] = arrays[4 + i].data();
+
+		const std::pair<const char*, QueryMask> masks[] = {
+			{ "value:    ", QueryValue },
+			{ "gradient: ", QueryValue | QueryGradient },
+			{ "hessian:  ", QueryValue | QueryGradient | QueryHessian },
+		};
+		for (auto& [name, mask] : masks) {
+			double ms = MeasureMs([&] {
+				if (HasFlag(args, "--jit"))
+					PointQuery::Evaluate(jit, points.x.data(), points.y.data(), points.z.data(), count, mask, output);
+				else
+					PointQuery::Evaluate(tape, points.x.data(), points.y.data(), points.z.data(), count, mask, output);
+			});
+			std::cout << name << count / ms / 1e3 << " M points/s\n";
+		}
+
+		// the arrays hold the results of the last mask
+		size_t checked = std::min<size_t>(count, 10000), failures = 0;
+		std::vector<Dual<2>> expected(checked);
+		TapeEvaluator::EvaluateDerivatives<2>(tape, points.x.data(), points.y.data(), points.z.data(), expected.data(), checked);
+		const int parts[10][3] = { {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {2, 0, 0}, {1, 1, 0}, {1, 0, 1}, {0, 2, 0}, {0, 1, 1}, {0, 0, 2} };
+		for (size_t i = 0; i < checked; ++i) {
+			for (int k = 0; k < 10; ++k) {
+				float e = expected[i].Partial(parts[k][0], parts[k][1], parts[k][2]);
+				if (!(std::abs(arrays[k][i] - e) <= 1e-3f * (1 + std::abs(e)))) {
+					++failures;
+					break;
+				}
+			}
+		}
+		std::cout << failures << " mismatches\n";
+		return failures == 0 ? 0 : 1;
+	}
+
+	// rays from a sphere around the scene towards random points of its box: measures the ray query and checks that clipping the rays
+	// to the bounds changes nothing
+	int RayCast(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("raycast <graph.json | random:<count>[:seed] | bench:<count>> [ray count] [--jit]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 100000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		std::vector<float> origins[3], directions[3];
+		RandomRays(root, count, origins, directions);
+		const float* origin[3] = { origins[0].data(), origins[1].data(), origins[2].data() };
+		const float* direction[3] = { directions[0].data(), directions[1].data(), directions[2].data() };
+
+		JitSdf jit;
+		if (HasFlag(args, "--jit")) {
+			jit.Compile(tape);
+			if (!jit.Wait())
+				std::cerr << "using the tape: " << jit.Error() << '\n';
+		}
+
+		std::vector<float> t(count), clippedT(count), normals[3];
+		std::vector<int32_t> steps(count), clippedSteps(count);
+		for (auto& n : normals)
+			n.resize(count);
+		RayQueryOutput output, clippedOutput;
+		output.t = t.data();
+		output.steps = steps.data();
+		clippedOutput.t = clippedT.data();
+		clippedOutput.steps = clippedSteps.data();
+		for (int axis = 0; axis < 3; ++axis)
+			clippedOutput.normal[axis] = normals[axis].data();
+
+		RayQuery query, clipped;
+		clipped.bounds = BoundsCalculatorVisitor().CalculateBounds(root).at(root.get());
+		auto cast = [&](const RayQuery& q, const RayQueryOutput& o) {
+			return MeasureMs([&] {
+				if (HasFlag(args, "--jit"))
+					q.Cast(jit, origin, direction, count, o);
+				else
+					q.Cast(tape, origin, direction, count, o);
+			});
+		};
+		double ms = cast(query, output), clippedMs = cast(clipped, clippedOutput);
+
+		size_t hits = 0, totalSteps = 0, clippedTotalSteps = 0, failures = 0;
+		for (size_t i = 0; i < count; ++i) {
+			hits += std::isinf(clippedT[i]) ? 0 : 1;
+			totalSteps += steps[i];
+			clippedTotalSteps += clippedSteps[i];
+			bool sameHit = std::isinf(t[i]) == std::isinf(clippedT[i]);
+			if (!sameHit || (!std::isinf(t[i]) && std::abs(t[i] - clippedT[i]) > 1e-3f * (1 + t[i])))
+				++failures;
+		}
+		std::cout << hits << " of " << count << " rays hit\n"
+			<< "unclipped: " << count / ms / 1e3 << " M rays/s, " << double(totalSteps) / count << " steps per ray\n"
+			<< "clipped:   " << count / clippedMs / 1e3 << " M rays/s, " << double(clippedTotalSteps) / count << " steps per ray, with normals\n"
+			<< failures << " rays differ\n";
+		// grazing rays may pass or hit depending on where the marching starts
+		return failures <= count / 1000 && !EmptyRandomScene(pos[0], hits) ? 0 : 1;
+	}
+
+	// streams surface samples to a PLY file and checks a subset of them against the complete tape
+	int Sample(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() < 2 || pos.size() > 3)
+			throw usage_error("sample <graph.json | random:<count>[:seed] | bench:<count>> <out.ply> [sample count] [--depth=6]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 2 ? std::stoul(pos[2]) : 1000000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+
+		SurfaceSampler sampler;
+		sampler.octreeDepth = std::stoul(OptionValue(args, "--depth", "6"));
+		PointCloudWriter writer(pos[1]);
+		std::vector<SurfaceSample> checked;
+		size_t written = sampler.Sample(tape, SceneBox(root), count, [&](const SurfaceSample* samples, size_t n) {
+			writer.Append(samples, n);
+			for (size_t i = 0; i < n && checked.size() < 100000; i += 97)
+				checked.push_back(samples[i]);
+		});
+		writer.Close();
+
+		const SamplerStats& stats = sampler.Stats();
+		std::cout << written << " samples in " << stats.milliseconds << " ms (" << written / stats.milliseconds / 1e3 << " M samples/s), "
+			<< stats.surfaceCells << " surface cells, estimated area " << stats.surfaceArea << '\n'
+			<< stats.seeds << " seeds, " << stats.projected << " projected, " << stats.rejected << " rejected\n";
+
+		// the samples must be on the surface of the whole sdf, not only of their cell's tape
+		std::vector<float> x, y, z;
+		for (auto& s : checked) {
+			x.push_back(s.position.x);
+			y.push_back(s.position.y);
+			z.push_back(s.position.z);
+		}
+		std::vector<Dual<1>> values(checked.size());
+		TapeEvaluator::EvaluateDerivatives<1>(tape, x.data(), y.data(), z.data(), values.data(), checked.size());
+		size_t failures = 0;
+		for (size_t i = 0; i < checked.size(); ++i) {
+			glm::vec3 normal = glm::normalize(glm::vec3(values[i].d[1], values[i].d[2], values[i].d[3]));
+			if (!(std::abs(values[i].d[0]) <= 10 * sampler.tolerance) || !(glm::dot(normal, checked[i].normal) > 0.99f))
+				++failures;
+		}
+		std::cout << failures << " of " << checked.size() << " checked samples are off the surface\n";
+		return failures == 0 ? 0 : 1;
+	}
+
+	// checks the analytic Lipschitz bound of a graph against gradients at random points, and shows how often sphere tracing with steps of the
+	// value passes the first surface, against a reference with a quarter of the steps the sampled maximum allows (the analytic bound may be
+	// too loose for a reference in reasonable time)
+	int Lipschitz(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 3)
+			throw usage_error("lipschitz <graph.json | random:<count>[:seed] | bench:<count>> [sample count] [ray count]");
+
+		auto root = LoadRoot(pos[0]);
+		size_t sampleCount = pos.size() > 1 ? std::stoul(pos[1]) : 1000000;
+		size_t count = pos.size() > 2 ? std::stoul(pos[2]) : 100000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+
+		auto bounds = LipschitzCalculatorVisitor().CalculateLipschitz(root);
+		size_t above = 0, below = 0;
+		for (auto& [node, l] : bounds) {
+			above += l > 1 ? 1 : 0;
+			below += l < 1 ? 1 : 0;
+		}
+		float sampled = LipschitzCalculatorVisitor::SampleLipschitz(tape, SceneBox(root), sampleCount);
+		std::cout << "analytic bound: " << tape.lipschitz << " (" << above << " of " << bounds.size() << " subtrees above 1, " << below << " below)\n"
+			<< "sampled maximum: " << sampled << " at " << sampleCount << " points outside\n";
+
+		std::vector<float> origins[3], directions[3];
+		RandomRays(root, count, origins, directions);
+		const float* origin[3] = { origins[0].data(), origins[1].data(), origins[2].data() };
+		const float* direction[3] = { directions[0].data(), directions[1].data(), directions[2].data() };
+
+		RayQuery query;
+		query.bounds = BoundsCalculatorVisitor().CalculateBounds(root).at(root.get());
+		const float inf = std::numeric_limits<float>::infinity();
+
+		// reference: every step is a quarter of value / sampled maximum
+		const float referenceScale = 0.25f / std::max(sampled, 1.0f);
+		std::vector<float> referenceT(count, inf), t(count, 0.0f);
+		std::vector<glm::vec3> positions(count);
+		std::vector<uint32_t> active;
+		for (uint32_t i = 0; i < count; ++i) {
+			glm::vec3 d = glm::normalize(glm::vec3(directions[0][i], directions[1][i], directions[2][i]));
+			float tNear, tFar;
+			if (query.bounds.IntersectRay(glm::vec3(origins[0][i], origins[1][i], origins[2][i]), 1.0f / d, tNear, tFar) && tFar >= 0) {
+				t[i] = std::max(tNear, 0.0f);
+				active.push_back(i);
+			}
+		}
+		PointSet points;
+		std::vector<float> values;
+		double referenceMs = MeasureMs([&] {
+			for (int step = 0; step < 64 * query.maxSteps && !active.empty(); ++step) {
+				points.x.clear();
+				points.y.clear();
+				points.z.clear();
+				for (uint32_t i : active) {
+					glm::vec3 d = glm::normalize(glm::vec3(directions[0][i], directions[1][i], directions[2][i]));
+					glm::vec3 p = glm::vec3(origins[0][i], origins[1][i], origins[2][i]) + d * t[i];
+					points.x.push_back(p.x);
+					points.y.push_back(p.y);
+					points.z.push_back(p.z);
+				}
+				values.resize(active.size());
+				TapeEvaluator::Evaluate(tape, points.x.data(), points.y.data(), points.z.data(), values.data(), active.size());
+				size_t kept = 0;
+				for (size_t j = 0; j < active.size(); ++j) {
+					uint32_t i = active[j];
+					if (values[j] <= query.stopDist)
+						referenceT[i] = t[i];
+					else if ((t[i] += values[j] * referenceScale) < query.maxDist)
+						active[kept++] = i;
+				}
+				active.resize(kept);
+			}
+		});
+		std::cout << "reference:          " << count / referenceMs / 1e3 << " M rays/s\n";
+
+		std::vector<float> hitT(count);
+		std::vector<int32_t> steps(count);
+		RayQueryOutput output;
+		output.t = hitT.data();
+		output.steps = steps.data();
+		double ms = MeasureMs([&] { query.Cast(tape, origin, direction, count, output); });
+
+		size_t totalSteps = 0, outOfSteps = 0, overshoots = 0, differences = 0;
+		for (size_t i = 0; i < count; ++i) {
+			totalSteps += steps[i];
+			float tolerance = 1e-3f * (1 + referenceT[i]);
+			if (steps[i] == query.maxSteps)
+				++outOfSteps; // rays grazing a surface
+			else if (!std::isinf(referenceT[i]) && hitT[i] > referenceT[i] + tolerance)
+				++overshoots; // passed the first surface or missed it
+			else if (std::isinf(referenceT[i]) != std::isinf(hitT[i]) || std::abs(hitT[i] - referenceT[i]) > tolerance)
+				++differences;
+		}
+		std::cout << "steps of the value: " << count / ms / 1e3 << " M rays/s, " << double(totalSteps) / count << " steps per ray, "
+			<< outOfSteps << " out of steps, " << overshoots << " overshooting and " << differences << " other rays differ\n";
+		// the tracers step by the value: overshoots show where the bound formulas overestimate the distance, they don't fail the check
+		int result = sampled <= 1.001f * tape.lipschitz ? 0 : 1;
+		return result;
+	}
+
+	// peak resident memory of the process since the last ResetPeakMemory in MB, 0 where it can't be read
+	double PeakMemoryMb() {
+#ifdef __linux__
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line))
+			if (line.rfind("VmHWM:", 0) == 0)
+				return std::stod(line.substr(6)) / 1024;
+#endif
+		return 0;
+	}
+
+	void ResetPeakMemory() {
+#ifdef __linux__
+		std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+	}
+
+	// the chunks of a mesher joined by their vertex keys
+	struct WeldedMesh {
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		std::unordered_map<uint64_t, uint32_t> vertexOfKey;
+
+		void Append(const MeshChunk& chunk) {
+			std::vector<uint32_t> welded(chunk.VertexCount());
+			for (size_t i = 0; i < chunk.VertexCount(); ++i) {
+				auto [it, inserted] = vertexOfKey.try_emplace(chunk.keys[i], (uint32_t)positions.size());
+				if (inserted)
+					positions.push_back(chunk.positions[i]);
+				welded[i] = it->second;
+			}
+			for (uint32_t i : chunk.indices)
+				indices.push_back(welded[i]);
+		}
+
+		// edges that aren't used exactly once in each direction: 0 for a closed, consistently oriented manifold
+		size_t OpenEdges() const {
+			std::unordered_map<uint64_t, int> directed;
+			for (size_t t = 0; t < indices.size(); t += 3)
+				for (int k = 0; k < 3; ++k)
+					++directed[uint64_t(indices[t + k]) << 32 | indices[t + (k + 1) % 3]];
+			size_t open = 0;
+			for (auto& [edge, count] : directed) {
+				auto reverse = directed.find(edge >> 32 | edge << 32);
+				if (count != 1 || reverse == directed.end() || reverse->second != 1)
+					++open;
+			}
+			return open;
+		}
+
+		// edges used by an odd number of triangles: 0 for a closed mesh, which may still have edges shared by 4 triangles
+		size_t BorderEdges() const {
+			std::unordered_map<uint64_t, int> undirected;
+			for (size_t t = 0; t < indices.size(); t += 3)
+				for (int k = 0; k < 3; ++k) {
+					uint32_t a = indices[t + k], b = indices[t + (k + 1) % 3];
+					++undirected[uint64_t(std::min(a, b)) << 32 | std::max(a, b)];
+				}
+			size_t border = 0;
+			for (auto& [edge, count] : undirected)
+				border += count % 2;
+			return border;
+		}
+	};
+
+	// octree marching cubes at increasing resolutions, with the throughput and memory of each. --check welds the chunks and verifies the mesh
+	int Mesh(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty())
+			throw usage_error("mesh <graph.json | random:<count>[:seed] | bench:<count>> [depth ...] [--pruning=interval|distance] [--check]");
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		std::vector<uint32_t> depths;
+		for (size_t i = 1; i < pos.size(); ++i)
+			depths.push_back(std::stoul(pos[i]));
+		if (depths.empty())
+			depths = { 6, 7, 8 };
+		std::string pruning = OptionValue(args, "--pruning", "interval");
+		if (pruning != "interval" && pruning != "distance")
+			throw usage_error("--pruning must be interval or distance");
+		bool check = HasFlag(args, "--check");
+
+		int result = 0;
+		for (uint32_t depth : depths) {
+			MarchingCubes mesher;
+			mesher.pruning = pruning == "distance" ? MeshPruning::Distance : MeshPruning::Interval;
+			WeldedMesh mesh;
+			uint64_t hash = 14695981039346656037ull;
+			auto sink = [&](const MeshChunk& chunk, uint64_t& h, bool weld) {
+				for (size_t i = 0; i < chunk.indices.size(); ++i)
+					h = (h ^ chunk.keys[chunk.indices[i]]) * 1099511628211ull;
+				if (weld)
+					mesh.Append(chunk);
+			};
+			ResetPeakMemory();
+			mesher.Extract(tape, box, depth, [&](const MeshChunk& chunk) { sink(chunk, hash, check); });
+			const MesherStats& stats = mesher.Stats();
+			std::cout << (1u << depth) << "^3: " << stats.triangles << " triangles in " << stats.milliseconds << " ms, "
+				<< stats.samples / stats.milliseconds / 1e3 << " M samples/s, " << stats.triangles / stats.milliseconds / 1e3 << " M triangles/s, "
+				<< stats.blocks << " blocks, " << stats.bricks << " bricks, " << stats.pruningTests << " pruning tests, peak "
+				<< stats.peakBytes / 1048576.0 << " MB in the mesher, " << PeakMemoryMb() << " MB process\n";
+			if (EmptyRandomScene(pos[0], stats.triangles))
+				result = 1;
+			if (!check)
+				continue;
+
+			// closed and oriented, vertices on the surface up to the interpolation error, the same output with another thread count
+			size_t open = mesh.OpenEdges();
+			std::vector<float> x, y, z, values(mesh.positions.size());
+			for (auto& p : mesh.positions) {
+				x.push_back(p.x);
+				y.push_back(p.y);
+				z.push_back(p.z);
+			}
+			TapeEvaluator::EvaluateParallel(tape, x.data(), y.data(), z.data(), values.data(), values.size());
+			float cellSize = (MarchingCubes::GridCube(box).max.x - MarchingCubes::GridCube(box).min.x) / float(1u << depth), maxError = 0;
+			for (float v : values)
+				maxError = std::max(maxError, std::abs(v) / cellSize);
+			ThreadPool otherPool(3);
+			uint64_t otherHash = 14695981039346656037ull;
+			MarchingCubes(mesher).Extract(tape, box, depth, [&](const MeshChunk& chunk) { sink(chunk, otherHash, false); }, otherPool);
+			std::cout << "  " << mesh.positions.size() << " welded vertices, " << open << " open edges, largest |distance| at a vertex "
+				<< maxError << " cells, " << (hash == otherHash ? "same" : "different") << " output with 3 threads\n";
+			if (open != 0 || maxError > 1 || hash != otherHash)
+				result = 1;
+		}
+		return result;
+	}
+
+	// mean and largest |distance| at the triangle centers in cells, marching cubes cuts edges and corners off by up to a cell
+	std::pair<double, double> CenterDeviation(const Tape& tape, const WeldedMesh& mesh, float cellSize) {
+		std::vector<float> x, y, z, values(mesh.indices.size() / 3);
+		for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+			glm::vec3 center = (mesh.positions[mesh.indices[t]] + mesh.positions[mesh.indices[t + 1]] + mesh.positions[mesh.indices[t + 2]]) / 3.0f;
+			x.push_back(center.x);
+			y.push_back(center.y);
+			z.push_back(center.z);
+		}
+		TapeEvaluator::EvaluateParallel(tape, x.data(), y.data(), z.data(), values.data(), values.size());
+		double sum = 0, largest = 0;
+		for (float v : values) {
+			sum += std::abs(v) / cellSize;
+			largest = std::max(largest, double(std::abs(v)) / cellSize);
+		}
+		return { values.empty() ? 0 : sum / values.size(), largest };
+	}
+
+	// dual contouring against marching cubes at the same resolutions: triangles, time and how far the triangles are from the surface.
+	// --check also verifies that the mesh is closed and doesn't depend on the thread count
+	int DualContour(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty())
+			throw usage_error("dualcontour <graph.json | random:<count>[:seed] | bench:<count>> [depth ...] [--error=<cells>] [--check]");
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		std::vector<uint32_t> depths;
+		for (size_t i = 1; i < pos.size(); ++i)
+			depths.push_back(std::stoul(pos[i]));
+		if (depths.empty())
+			depths = { 6, 7, 8 };
+		bool check = HasFlag(args, "--check");
+
+		int result = 0;
+		for (uint32_t depth : depths) {
+			float cellSize = (MarchingCubes::GridCube(box).max.x - MarchingCubes::GridCube(box).min.x) / float(1u << depth);
+			DualContouring mesher;
+			mesher.maxError = std::stof(OptionValue(args, "--error", std::to_string(mesher.maxError)));
+			WeldedMesh mesh, marched;
+			uint64_t hash = 14695981039346656037ull;
+			auto sink = [&](const MeshChunk& chunk, uint64_t& h, WeldedMesh* weld) {
+				for (size_t i = 0; i < chunk.indices.size(); ++i)
+					h = (h ^ chunk.keys[chunk.indices[i]]) * 1099511628211ull;
+				if (weld)
+					weld->Append(chunk);
+			};
+			mesher.Extract(tape, box, depth, [&](const MeshChunk& chunk) { sink(chunk, hash, &mesh); });
+			const DualContouringStats& stats = mesher.Stats();
+			MarchingCubes marchingCubes;
+			marchingCubes.Extract(tape, box, depth, [&](const MeshChunk& chunk) { marched.Append(chunk); });
+
+			auto [mean, largest] = CenterDeviation(tape, mesh, cellSize);
+			auto [marchedMean, marchedLargest] = CenterDeviation(tape, marched, cellSize);
+			std::cout << (1u << depth) << "^3: " << stats.triangles << " triangles in " << stats.milliseconds << " ms, "
+				<< stats.crossings << " crossings, " << stats.cells << " cells merged into " << stats.leaves << " vertices, "
+				<< stats.blocks << " blocks, peak " << stats.peakBytes / 1048576.0 << " MB in the mesher\n"
+				<< "  marching cubes: " << marchingCubes.Stats().triangles << " triangles in " << marchingCubes.Stats().milliseconds << " ms ("
+				<< double(marchingCubes.Stats().triangles) / std::max<size_t>(stats.triangles, 1) << "x)\n"
+				<< "  |distance| at the triangle centers: " << mean << " mean, " << largest << " largest cells, marching cubes "
+				<< marchedMean << " mean, " << marchedLargest << " largest\n";
+			if (EmptyRandomScene(pos[0], stats.triangles))
+				result = 1;
+			if (!check)
+				continue;
+
+			// a cell has one vertex even where two sheets pass through it, so some edges are shared by 4 triangles
+			size_t open = mesh.OpenEdges(), border = mesh.BorderEdges();
+			ThreadPool otherPool(3);
+			uint64_t otherHash = 14695981039346656037ull;
+			DualContouring(mesher).Extract(tape, box, depth, [&](const MeshChunk& chunk) { sink(chunk, otherHash, nullptr); }, otherPool);
+			std::cout << "  " << mesh.positions.size() << " welded vertices, " << border << " border edges, " << open - border
+				<< " non-manifold edges, " << (hash == otherHash ? "same" : "different") << " output with 3 threads\n";
+			if (border != 0 || hash != otherHash)
+				result = 1;
+		}
+		return result;
+	}
+
+	// reads back what MeshWriter wrote, positions and indices only
+	WeldedMesh ReadMesh(const std::string& fileName) {
+		TriangleMesh read = TriangleMesh::Read(fileName);
+		WeldedMesh mesh;
+		mesh.positions = std::move(read.positions);
+		mesh.indices = std::move(read.indices);
+		return mesh;
+	}
+
+	// meshes a graph straight into a PLY or OBJ file. --check reads the file back and compares it with the welded chunks
+	int Export(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() < 2 || pos.size() > 3)
+			throw usage_error("export <graph.json | random:<count>[:seed] | bench:<count>> <out.ply | out.obj> [depth] [--dual] [--normals] [--curvatures] [--no-weld] [--check]");
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		uint32_t depth = pos.size() > 2 ? std::stoul(pos[2]) : 8;
+		bool normals = HasFlag(args, "--normals"), curvatures = HasFlag(args, "--curvatures"), check = HasFlag(args, "--check");
+
+		WeldedMesh welded;
+		MeshWriter writer(pos[1], MeshWriter::FormatOf(pos[1]), normals, !HasFlag(args, "--no-weld"), curvatures);
+		auto sink = [&](const MeshChunk& chunk) {
+			writer.Append(chunk);
+			if (check)
+				welded.Append(chunk);
+		};
+		ResetPeakMemory();
+		double ms = MeasureMs([&] {
+			if (HasFlag(args, "--dual")) {
+				DualContouring mesher;
+				mesher.normals = normals;
+				mesher.curvatures = curvatures;
+				mesher.Extract(tape, box, depth, sink);
+			}
+			else {
+				MarchingCubes mesher;
+				mesher.normals = normals;
+				mesher.curvatures = curvatures;
+				mesher.Extract(tape, box, depth, sink);
+			}
+			writer.Close();
+		});
+		const MeshWriterStats& stats = writer.Stats();
+		std::cout << stats.triangles << " triangles and " << stats.vertices << " vertices (" << stats.weldedVertices << " welded) in "
+			<< stats.chunks << " chunks, " << stats.bytes / 1048576.0 << " MB written in " << ms << " ms, peak " << stats.peakBytes / 1048576.0
+			<< " MB in the writer, " << PeakMemoryMb() << " MB process\n";
+		if (!check)
+			return 0;
+
+		// without welding the vertices on the borders of the chunks are repeated
+		WeldedMesh read = ReadMesh(pos[1]);
+		bool same = read.indices.size() == welded.indices.size() && (read.positions.size() == welded.positions.size() || HasFlag(args, "--no-weld"));
+		for (size_t i = 0; same && i < read.indices.size(); ++i)
+			same = read.positions[read.indices[i]] == welded.positions[welded.indices[i]];
+		std::cout << "  read back " << read.indices.size() / 3 << " triangles and " << read.positions.size() << " vertices, "
+			<< (same ? "same as" : "different from") << " the welded chunks, " << read.BorderEdges() << " border edges\n";
+		return same ? 0 : 1;
+	}
+
+	// the operator nodes marked as baked, the ones inside another baked node are skipped like in the editor
+	void FindBakedNodes(std::shared_ptr<Node> node, std::vector<std::shared_ptr<OperatorNode>>& baked) {
+		auto opnode = std::dynamic_pointer_cast<OperatorNode>(node);
+		if (opnode == nullptr)
+			return;
+		if (opnode->baked) {
+			baked.push_back(opnode);
+			return;
+		}
+		for (auto& input : *opnode)
+			FindBakedNodes(input, baked);
+	}
+
+	int Bake(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() != 1)
+			throw usage_error("bake <graph.json | random:<count>[:seed] | bench:<count>> [--resolution=96] [--band=3] [--samples=200000] [--glsl]");
+
+		auto root = LoadRoot(pos[0]);
+		int resolution = std::stoi(OptionValue(args, "--resolution", "96"));
+		float bandVoxels = std::stof(OptionValue(args, "--band", "3"));
+		size_t sampleCount = std::stoul(OptionValue(args, "--samples", "200000"));
+
+		std::vector<std::shared_ptr<OperatorNode>> nodes;
+		FindBakedNodes(root, nodes);
+		if (nodes.empty()) { // bake the whole graph
+			auto opnode = std::dynamic_pointer_cast<OperatorNode>(root);
+			if (opnode == nullptr)
+				throw std::runtime_error("the root is not an operator and no node is marked as baked");
+			nodes.push_back(opnode);
+		}
+
+		SDFGenerator generator;
+		bool lowerBound = true;
+		std::mt19937 rng(1);
+		for (auto& node : nodes) {
+			BakeStats stats;
+			auto bake = std::make_shared<DistanceBake>(SubtreeBaker::Bake(node, resolution, bandVoxels, ThreadPool::Global(), &stats));
+			generator.bakes[node.get()] = bake;
+			float voxel = bake->VoxelSize();
+			std::cout << bake->resolution.x << "x" << bake->resolution.y << "x" << bake->resolution.z << " voxels of " << voxel << ", band "
+				<< bake->band << ", " << bake->Bytes() / 1048576.0 << " MB: " << stats.prunedBricks << " of " << stats.bricks
+				<< " bricks pruned, " << stats.samples << " samples in " << stats.milliseconds << " ms\n";
+
+			// random points in the box grown by half, against the subtree evaluated as it is
+			std::vector<float> x(sampleCount), y(sampleCount), z(sampleCount), exact(sampleCount);
+			std::uniform_real_distribution<float> unit(-0.25f, 1.25f);
+			for (size_t i = 0; i < sampleCount; ++i) {
+				glm::vec3 p = bake->min + glm::vec3(unit(rng), unit(rng), unit(rng)) * bake->size;
+				x[i] = p.x;
+				y[i] = p.y;
+				z[i] = p.z;
+			}
+			TapeEvaluator::EvaluateParallel(TapeGenerator().GenerateFromRoot(node), x.data(), y.data(), z.data(), exact.data(), sampleCount);
+
+			size_t near = 0, wrongSign = 0, overOutside = 0;
+			double sumError = 0;
+			float maxError = 0;
+			for (size_t i = 0; i < sampleCount; ++i) {
+				glm::vec3 p(x[i], y[i], z[i]);
+				float sampled = bake->Sample(p);
+				bool inside = glm::all(glm::greaterThanEqual(p, bake->min)) && glm::all(glm::lessThanEqual(p, bake->min + bake->size));
+				if (!inside && sampled > exact[i] + 1e-4f * bake->band)
+					++overOutside;
+				if (std::abs(exact[i]) > voxel && (sampled < 0) != (exact[i] < 0))
+					++wrongSign;
+				if (inside && std::abs(exact[i]) < bake->band - voxel) {
+					float error = std::abs(sampled - exact[i]);
+					++near;
+					sumError += error;
+					maxError = std::max(maxError, error);
+				}
+			}
+			std::cout << "  " << near << " samples in the band: mean error " << sumError / std::max<size_t>(near, 1) / voxel << " voxels, max "
+				<< maxError / voxel << " voxels; " << wrongSign << " wrong signs farther than a voxel, " << overOutside
+				<< " overestimates outside the box\n";
+			lowerBound &= overOutside == 0;
+		}
+
+		if (HasFlag(args, "--glsl"))
+			std::cout << generator.GenerateFromRoot(root);
+		return lowerBound ? 0 : 1;
+	}
+
+	int Volume(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() < 2 || pos.size() > 3)
+			throw usage_error("volume <graph.json | random:<count>[:seed] | bench:<count>> <out.vol> [depth] [--band=3] [--gradients] [--check]");
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		uint32_t depth = pos.size() > 2 ? std::stoul(pos[2]) : 9;
+
+		SparseVolume volume;
+		volume.bandVoxels = std::stof(OptionValue(args, "--band", "3"));
+		volume.gradients = HasFlag(args, "--gradients");
+		ResetPeakMemory();
+		volume.Write(tape, box, depth, pos[1]);
+		const SparseVolumeStats& stats = volume.Stats();
+		std::cout << (1u << depth) << "^3: " << stats.leaves << " leaves, " << stats.activeVoxels << " active voxels, " << stats.tiles
+			<< " inside tiles, " << stats.bytes / 1048576.0 << " MB in " << stats.milliseconds << " ms, " << stats.samples / stats.milliseconds / 1e3
+			<< " M samples/s (" << stats.gradientSamples << " gradients), " << stats.blocks << " blocks, " << stats.pruningTests
+			<< " pruning tests, peak " << stats.peakBytes / 1048576.0 << " MB in the builder, " << PeakMemoryMb() << " MB process\n";
+		if (!HasFlag(args, "--check"))
+			return 0;
+
+		// random voxels of the mapped file against the tape, leaves hold the clamped distances, the rest is at least band away
+		SparseVolumeFile file(pos[1]);
+		const SparseVolumeHeader& header = file.Header();
+		const size_t count = 200000;
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<uint32_t> coordinate(0, (1u << depth) - 1);
+		std::vector<glm::uvec3> voxels(count);
+		std::vector<float> x(count), y(count), z(count), exact(count);
+		for (size_t i = 0; i < count; ++i) {
+			// half of them in leaves, so the band is checked at high depths too
+			if (i % 2 == 0 && file.LeafCount() > 0) {
+				const SparseVolumeLeaf& leaf = file.Leaf(rng() % file.LeafCount());
+				voxels[i] = glm::uvec3(leaf.origin[0], leaf.origin[1], leaf.origin[2]) + glm::uvec3(rng() % 8, rng() % 8, rng() % 8);
+			}
+			else {
+				voxels[i] = glm::uvec3(coordinate(rng), coordinate(rng), coordinate(rng));
+			}
+			glm::vec3 p = file.VoxelCenter(voxels[i]);
+			x[i] = p.x;
+			y[i] = p.y;
+			z[i] = p.z;
+		}
+		TapeEvaluator::EvaluateParallel(tape, x.data(), y.data(), z.data(), exact.data(), count);
+		const float tolerance = 1e-3f * header.band;
+		size_t inLeaves = 0, wrongLeafValues = 0, wrongBackground = 0, badGradients = 0;
+		for (size_t i = 0; i < count; ++i) {
+			int64_t leaf = file.FindLeaf(voxels[i]);
+			if (leaf < 0) {
+				float value = i % 2 == 0 ? header.band : file.Value(voxels[i]); // the tiles are only searched for the uniform half
+				if (value > 0 ? exact[i] < header.band - tolerance : exact[i] > -header.band + tolerance)
+					++wrongBackground;
+				continue;
+			}
+			++inLeaves;
+			glm::uvec3 local = voxels[i] % 8u;
+			size_t index = local.x + 8 * local.y + 64 * local.z;
+			const float* data = file.LeafData((size_t)leaf);
+			if (std::abs(data[index] - glm::clamp(exact[i], -header.band, header.band)) > tolerance)
+				++wrongLeafValues;
+			if (header.channels == 4) {
+				float length = glm::length(glm::vec3(data[512 + index], data[1024 + index], data[1536 + index]));
+				if (!(length > 0.5f && length < 2.0f))
+					++badGradients;
+			}
+		}
+
+		// the same file with another thread count
+		std::string otherName = pos[1] + ".threads";
+		ThreadPool otherPool(3);
+		SparseVolume(volume).Write(tape, box, depth, otherName, otherPool);
+		std::ifstream a(pos[1], std::ios::binary), b(otherName, std::ios::binary);
+		bool same = std::equal(std::istreambuf_iterator<char>(a), std::istreambuf_iterator<char>(), std::istreambuf_iterator<char>(b),
+			std::istreambuf_iterator<char>());
+		a.close();
+		b.close();
+		std::remove(otherName.c_str());
+
+		std::cout << "  " << inLeaves << " of " << count << " checked voxels in leaves, " << wrongLeafValues << " wrong values, "
+			<< wrongBackground << " wrong background or tile voxels, " << badGradients << " gradients with a length outside [0.5, 2], "
+			<< (same ? "same" : "different") << " file with 3 threads\n";
+		return wrongLeafValues == 0 && wrongBackground == 0 && same ? 0 : 1;
+	}
+
+	// distance to the triangle without the region tests of TriangleBVH: the projection onto the plane if it's inside, else the closest edge
+	float BruteTriangleDistance(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+		glm::vec3 n = glm::cross(b - a, c - a);
+		if (glm::dot(n, n) > 0) {
+			glm::vec3 q = p - glm::dot(p - a, n) / glm::dot(n, n) * n;
+			if (glm::dot(glm::cross(b - a, q - a), n) >= 0 && glm::dot(glm::cross(c - b, q - b), n) >= 0 && glm::dot(glm::cross(a - c, q - c), n) >= 0)
+				return glm::distance(p, q);
+		}
+		auto segment = [&](glm::vec3 s, glm::vec3 e) {
+			float t = glm::dot(e - s, e - s) > 0 ? glm::clamp(glm::dot(p - s, e - s) / glm::dot(e - s, e - s), 0.0f, 1.0f) : 0.0f;
+			return glm::distance(p, s + t * (e - s));
+		};
+		return std::min({ segment(a, b), segment(b, c), segment(c, a) });
+	}
+
+	// signed distance by looping over every triangle: negative where the winding number is above 0.5
+	float BruteSignedDistance(const TriangleMesh& mesh, glm::vec3 p) {
+		float distance = std::numeric_limits<float>::infinity();
+		double solidAngle = 0;
+		for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+			glm::vec3 a = mesh.positions[mesh.indices[t]], b = mesh.positions[mesh.indices[t + 1]], c = mesh.positions[mesh.indices[t + 2]];
+			distance = std::min(distance, BruteTriangleDistance(p, a, b, c));
+			glm::vec3 u = a - p, v = b - p, w = c - p;
+			float lu = glm::length(u), lv = glm::length(v), lw = glm::length(w);
+			solidAngle += 2 * std::atan2(glm::dot(u, glm::cross(v, w)), lu * lv * lw + glm::dot(u, v) * lw + glm::dot(v, w) * lu + glm::dot(w, u) * lv);
+		}
+		return solidAngle / (4 * glm::pi<double>()) > 0.5 ? -distance : distance;
+	}
+
+	// bakes a model file like the Mesh primitive: checks the bvh and the bake against brute force, then a graph subtracting a sphere from the
+	// mesh on every evaluator
+	int ImportMesh(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() != 1)
+			throw usage_error("import <model.obj | model.ply> [--resolution=64] [--band=3] [--samples=2000] [--glsl]");
+
+		int resolution = std::stoi(OptionValue(args, "--resolution", "64"));
+		float bandVoxels = std::stof(OptionValue(args, "--band", "3"));
+		size_t sampleCount = std::stoul(OptionValue(args, "--samples", "2000"));
+		TriangleMesh mesh = TriangleMesh::Read(pos[0]);
+		BoundingBox bounds = mesh.Bounds();
+		std::unique_ptr<TriangleBVH> bvh;
+		double buildMs = MeasureMs([&] { bvh = std::make_unique<TriangleBVH>(mesh); });
+		std::cout << mesh.TriangleCount() << " triangles, " << mesh.positions.size() << " vertices, bvh of " << bvh->NodeCount() << " nodes in "
+			<< buildMs << " ms\n";
+
+		// random points of the bounds grown by a quarter on every side
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> unit(-0.25f, 1.25f);
+		std::vector<glm::vec3> points(sampleCount);
+		for (glm::vec3& p : points)
+			p = bounds.min + glm::vec3(unit(rng), unit(rng), unit(rng)) * (bounds.max - bounds.min);
+		std::vector<float> brute(sampleCount);
+		double bruteMs = MeasureMs([&] {
+			ThreadPool::Global().ParallelFor(sampleCount, 16, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					brute[i] = BruteSignedDistance(mesh, points[i]);
+			});
+		});
+		float maxDistanceError = 0;
+		size_t windingMismatches = 0;
+		double queryMs = MeasureMs([&] {
+			for (size_t i = 0; i < sampleCount; ++i) {
+				float distance = bvh->Distance(points[i]);
+				maxDistanceError = std::max(maxDistanceError, std::abs(distance - std::abs(brute[i])));
+				if ((bvh->WindingNumber(points[i]) > 0.5f) != (brute[i] < 0))
+					++windingMismatches;
+			}
+		});
+		float longest = glm::compMax(bounds.max - bounds.min);
+		std::cout << "bvh against brute force at " << sampleCount << " points: max distance error " << maxDistanceError / longest
+			<< " of the size, " << windingMismatches << " different signs; " << queryMs * 1e3 / sampleCount << " us per point, brute force "
+			<< bruteMs * 1e3 / sampleCount << " us\n";
+
+		BakeStats stats;
+		DistanceBake bake = MeshDistance::Bake(mesh, resolution, bandVoxels, ThreadPool::Global(), &stats);
+		float voxel = bake.VoxelSize();
+		std::cout << bake.resolution.x << "x" << bake.resolution.y << "x" << bake.resolution.z << " voxels of " << voxel << ", " << bake.Bytes() / 1048576.0
+			<< " MB: " << stats.prunedBricks << " of " << stats.bricks << " bricks pruned, " << stats.samples << " samples in " << stats.milliseconds << " ms\n";
+
+		// random voxels of the bake, their stored value against the clamped brute force distance at their center
+		size_t wrongVoxels = 0;
+		float maxVoxelError = 0;
+		std::uniform_int_distribution<size_t> voxelIndex(0, bake.values.size() - 1);
+		for (size_t i = 0; i < sampleCount; ++i) {
+			size_t v = voxelIndex(rng);
+			glm::ivec3 c((int)(v % bake.resolution.x), (int)(v / bake.resolution.x % bake.resolution.y), (int)(v / bake.resolution.x / bake.resolution.y));
+			float exact = glm::clamp(BruteSignedDistance(mesh, bake.min + (glm::vec3(c) + 0.5f) * voxel), -bake.band, bake.band);
+			float error = std::abs(bake.values[v] - exact);
+			maxVoxelError = std::max(maxVoxelError, error);
+			if (error > 1e-3f * voxel)
+				++wrongVoxels;
+		}
+		std::cout << "bake against brute force at " << sampleCount << " voxels: max error " << maxVoxelError / voxel << " voxels, " << wrongVoxels
+			<< " off by more than 0.001 voxels\n";
+
+		// the mesh primitive in a graph: the tape against the reference, the intervals against the samples in their boxes
+		glm::vec3 center = bounds.Center() + 0.5f * (bounds.max - bounds.min);
+		ordered_json sphere = { { "primitive", "sphere" }, { "translate", center }, { "scale", 0.5f * longest } };
+		ordered_json model = { { "primitive", "mesh" }, { "file", pos[0] }, { "resolution", resolution } };
+		ordered_json graph = ordered_json::array({ { { "operator", "substract" }, { "inputs", { model, sphere } } } });
+		auto root = NodeJsonSerializer::Deserialize(graph.dump()).front();
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		ReferenceSDF reference;
+		float maxTapeError = 0;
+		for (const glm::vec3& p : points)
+			maxTapeError = std::max(maxTapeError, std::abs(TapeEvaluator::Evaluate(tape, p) - reference.Evaluate(root, p)));
+
+		size_t intervalViolations = 0;
+		std::uniform_real_distribution<float> boxSize(0, 4 * voxel);
+		for (size_t i = 0; i < sampleCount / 16; ++i) {
+			BoundingBox box(points[i], points[i] + glm::vec3(boxSize(rng), boxSize(rng), boxSize(rng)));
+			Interval bound = TapeEvaluator::EvaluateInterval(tape, box);
+			std::uniform_real_distribution<float> t(0, 1);
+			for (int k = 0; k < 64; ++k) {
+				float value = TapeEvaluator::Evaluate(tape, box.min + glm::vec3(t(rng), t(rng), t(rng)) * (box.max - box.min));
+				if (value < bound.lower - 1e-5f * longest || value > bound.upper + 1e-5f * longest)
+					++intervalViolations;
+			}
+		}
+
+		SDFGenerator generator;
+		std::string glsl = generator.GenerateFromRoot(root);
+		std::cout << "graph: max tape error " << maxTapeError << ", " << intervalViolations << " samples outside their intervals, " << generator.GetUsedBakes().size()
+			<< " sampler(s) in the shader\n";
+		if (HasFlag(args, "--glsl"))
+			std::cout << glsl;
+
+		bool ok = maxDistanceError <= 1e-4f * longest && windingMismatches == 0 && wrongVoxels == 0 && maxTapeError <= 1e-5f * longest
+			&& intervalViolations == 0 && generator.GetUsedBakes().size() == 1;
+		return ok ? 0 : 1;
+	}
+
+	// integrates a graph with MassIntegrator and checks it against Monte Carlo integration, or without a graph, shapes with known properties
+	int Mass(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() > 1)
+			throw usage_error("mass [graph.json | random:<count>[:seed] | bench:<count>] [--depth=5] [--levels=4] [--tolerance=1e-3] [--points=4000000]");
+
+		MassIntegrator integrator;
+		integrator.octreeDepth = std::stoul(OptionValue(args, "--depth", "5"));
+		integrator.maxLevels = std::stoi(OptionValue(args, "--levels", "4"));
+		integrator.tolerance = std::stod(OptionValue(args, "--tolerance", "1e-3"));
+		auto print = [&](const MassProperties& m) {
+			const MassStats& stats = integrator.Stats();
+			std::cout << "volume " << m.volume << " +- " << m.volumeError << ", area " << m.area << " +- " << m.areaError << ", centroid ("
+				<< m.centroid.x << ", " << m.centroid.y << ", " << m.centroid.z << ")\ninertia diagonal (" << m.inertia[0][0] << ", " << m.inertia[1][1]
+				<< ", " << m.inertia[2][2] << "), off diagonal (" << m.inertia[1][0] << ", " << m.inertia[2][0] << ", " << m.inertia[2][1] << ")\n"
+				<< stats.insideCells << " inside cells, " << stats.boundaryCells << " boundary cells, " << stats.evaluations << " evaluations, "
+				<< stats.unconverged << " unconverged subcells in " << stats.milliseconds << " ms\n";
+		};
+
+		if (pos.empty()) {
+			// a sphere of radius 1 and a 1 x 2 x 3 box around (1, 2, 3): volume, area, centroid and principal moments
+			struct Shape {
+				ordered_json json;
+				double volume, area;
+				glm::dvec3 centroid, inertia;
+			};
+			const double pi = glm::pi<double>();
+			std::vector<Shape> shapes = {
+				{ { { "primitive", "sphere" }, { "scale", 2.0f } }, 4 * pi / 3, 4 * pi, glm::dvec3(0), glm::dvec3(0.4 * 4 * pi / 3) },
+				{ { { "primitive", "box" }, { "translate", glm::vec3(1, 2, 3) }, { "dimensions", glm::vec3(1, 2, 3) } }, 6, 22, glm::dvec3(1, 2, 3),
+					glm::dvec3(6.5, 5, 2.5) },
+			};
+			bool ok = true;
+			for (const Shape& shape : shapes) {
+				auto root = NodeJsonSerializer::Deserialize(ordered_json::array({ shape.json }).dump()).front();
+				MassProperties m = integrator.Integrate(TapeGenerator().GenerateFromRoot(root), SceneBox(root));
+				std::cout << shape.json.dump() << ":\n";
+				print(m);
+				double volumeError = std::abs(m.volume - shape.volume) / shape.volume, areaError = std::abs(m.area - shape.area) / shape.area;
+				double centroidError = glm::length(m.centroid - shape.centroid), inertiaError = 0;
+				for (int i = 0; i < 3; ++i)
+					for (int j = 0; j < 3; ++j)
+						inertiaError = std::max(inertiaError, std::abs(m.inertia[i][j] - (i == j ? shape.inertia[i] : 0)) / glm::compMax(shape.inertia));
+				std::cout << "relative errors: volume " << volumeError << ", area " << areaError << ", inertia " << inertiaError << "; centroid off by "
+					<< centroidError << '\n';
+				ok = ok && volumeError <= 10 * integrator.tolerance && areaError <= 10 * integrator.tolerance && inertiaError <= 10 * integrator.tolerance
+					&& centroidError <= 10 * integrator.tolerance;
+			}
+			return ok ? 0 : 1;
+		}
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		MassProperties m = integrator.Integrate(tape, box);
+		print(m);
+
+		// Monte Carlo estimates of the volume and the first moments, with their standard errors
+		size_t count = std::stoul(OptionValue(args, "--points", "4000000"));
+		PointSet points = RandomPoints(root, count, 7);
+		std::vector<float> values(count);
+		double monteCarloMs = MeasureMs([&] {
+			TapeEvaluator::EvaluateParallel(tape, points.x.data(), points.y.data(), points.z.data(), values.data(), count);
+		});
+		glm::dvec3 size = glm::dvec3(box.max - box.min);
+		double boxVolume = size.x * size.y * size.z;
+		size_t insideCount = 0;
+		glm::dvec3 first(0);
+		for (size_t i = 0; i < count; ++i) {
+			if (values[i] < 0) {
+				++insideCount;
+				first += glm::dvec3(points.x[i], points.y[i], points.z[i]);
+			}
+		}
+		double fraction = double(insideCount) / count;
+		double volume = fraction * boxVolume, volumeSigma = boxVolume * std::sqrt(fraction * (1 - fraction) / count);
+		glm::dvec3 centroid = insideCount > 0 ? first / double(insideCount) : glm::dvec3(0);
+		// the centroid of n points has a standard error of about the radius of the solid over sqrt(n)
+		double centroidSigma = glm::length(size) / std::sqrt(double(std::max<size_t>(insideCount, 1)));
+		std::cout << "monte carlo with " << count << " points in " << monteCarloMs << " ms: volume " << volume << " +- " << volumeSigma
+			<< ", centroid (" << centroid.x << ", " << centroid.y << ", " << centroid.z << ")\n";
+
+		bool ok = std::abs(m.volume - volume) <= 4 * volumeSigma + m.volumeError + integrator.tolerance * volume
+			&& (insideCount == 0 || glm::length(m.centroid - centroid) <= 4 * centroidSigma);
+		return ok ? 0 : 1;
+	}
+
+	// cross sections of a graph along an axis: distance images, contours, and checks of both against the tape
+	int CrossSection(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() != 2)
+			throw usage_error("slice <graph.json | random:<count>[:seed] | bench:<count>> <out prefix> [--axis=z] [--count=8] [--resolution=1024] [--no-files]");
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		std::string axisName = OptionValue(args, "--axis", "z");
+		int axis = axisName == "x" ? 0 : axisName == "y" ? 1 : axisName == "z" ? 2 : -1;
+		if (axis < 0)
+			throw usage_error("slice: --axis must be x, y or z");
+		int count = std::stoi(OptionValue(args, "--count", "8"));
+		int resolution = std::stoi(OptionValue(args, "--resolution", "1024"));
+
+		// evenly spaced through the box, away from its faces
+		std::vector<SlicePlane> planes;
+		for (int i = 0; i < count; ++i)
+			planes.push_back(SlicePlane::Across(box, axis, glm::mix(box.min[axis], box.max[axis], (i + 0.5f) / count), resolution));
+		SliceExporter exporter;
+		std::vector<Slice> slices = exporter.Export(tape, planes);
+		const SliceStats& stats = exporter.Stats();
+		std::cout << stats.slices << " slices of " << planes[0].width << "x" << planes[0].height << " in " << stats.milliseconds << " ms ("
+			<< stats.samples / stats.milliseconds / 1e3 << " M samples/s), " << stats.simplifiedTiles << " of " << stats.tiles
+			<< " tiles simplified, " << stats.vertices << " contour vertices, " << stats.refined << " refined\n";
+
+		std::mt19937 rng(5);
+		float maxPixelError = 0, maxVertexError = 0, maxAreaError = 0;
+		size_t openContours = 0, counterClockwise = 0, clockwise = 0;
+		for (size_t s = 0; s < slices.size(); ++s) {
+			const Slice& slice = slices[s];
+			const SlicePlane& plane = slice.plane;
+			float pixel = glm::length(plane.u) / plane.width;
+
+			// the simplified tiles against the whole tape
+			std::uniform_int_distribution<int> px(0, plane.width - 1), py(0, plane.height - 1);
+			for (int i = 0; i < 1000; ++i) {
+				int x = px(rng), y = py(rng);
+				glm::vec3 p = plane.Point((x + 0.5f) / plane.width, (y + 0.5f) / plane.height);
+				maxPixelError = std::max(maxPixelError, std::abs(slice.At(x, y) - TapeEvaluator::Evaluate(tape, p)));
+			}
+
+			// the vertices on the zero set, the area inside the contours against the inside pixels
+			glm::vec3 unitU = glm::normalize(plane.u), unitV = glm::normalize(plane.v);
+			double contourArea = 0, perimeter = 0;
+			for (const Contour& contour : slice.contours) {
+				double area = 0;
+				for (size_t i = 0; i < contour.points.size(); ++i) {
+					glm::vec2 a = contour.points[i], b = contour.points[(i + 1) % contour.points.size()];
+					area += 0.5 * (double(b.x) * a.y - double(a.x) * b.y); // positive counter-clockwise, y goes down
+					perimeter += glm::length(b - a);
+					glm::vec3 p = plane.origin + a.x * unitU + a.y * unitV;
+					maxVertexError = std::max(maxVertexError, std::abs(TapeEvaluator::Evaluate(tape, p)) / pixel);
+				}
+				openContours += contour.closed ? 0 : 1;
+				counterClockwise += area > 0 ? 1 : 0;
+				clockwise += area < 0 ? 1 : 0;
+				contourArea += area;
+			}
+			size_t insidePixels = std::count_if(slice.distances.begin(), slice.distances.end(), [](float d) { return d < 0; });
+			double pixelArea = insidePixels * double(pixel) * pixel;
+			// counting the pixels is off by up to about half a pixel along the border
+			if (perimeter > 0)
+				maxAreaError = std::max(maxAreaError, float(std::abs(contourArea - pixelArea) / (perimeter * pixel)));
+
+			if (!HasFlag(args, "--no-files")) {
+				std::string name = pos[1] + "_" + std::to_string(s);
+				ImageIO::Write(SliceExporter::DistanceImage(slice), name + ".exr");
+				ImageIO::Write(SliceExporter::ColorImage(slice, 32 * pixel), name + ".png");
+				SliceExporter::WriteSvg(slice, name + ".svg");
+			}
+		}
+		std::cout << "max pixel error " << maxPixelError << ", max vertex error " << maxVertexError << " pixels, contour area off by "
+			<< maxAreaError << " pixels per border pixel; " << openContours << " open contours, " << counterClockwise << " around solids and "
+			<< clockwise << " around holes\n";
+		return maxPixelError <= 1e-5f * glm::length(box.max - box.min) && maxVertexError <= 0.05f && openContours == 0 && maxAreaError <= 0.5f ? 0 : 1;
+	}
+
+	// curvatures of the mesh vertices: against the closed forms of a sphere and a torus, or against central differences of a graph
+	int Curvature(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() > 2)
+			throw usage_error("curvature [graph.json | random:<count>[:seed] | bench:<count>] [depth] [--dual]");
+		uint32_t depth = pos.size() > 1 ? std::stoul(pos[1]) : 7;
+		bool dual = HasFlag(args, "--dual");
+		auto extract = [&](const Tape& tape, const BoundingBox& box, bool curvatures, const std::function<void(const MeshChunk&)>& sink) {
+			if (dual) {
+				DualContouring mesher;
+				mesher.normals = !curvatures;
+				mesher.curvatures = curvatures;
+				mesher.Extract(tape, box, depth, sink);
+			}
+			else {
+				MarchingCubes mesher;
+				mesher.normals = !curvatures;
+				mesher.curvatures = curvatures;
+				mesher.Extract(tape, box, depth, sink);
+			}
+		};
+
+		if (pos.empty()) {
+			// a sphere of radius 1 and a torus of radii 1 and 0.4 around y. At a vertex p they are the curvatures of the level set through
+			// p: a sphere of radius |p|, a torus whose tube has the radius s of the distance to the center circle. The principal
+			// directions of the torus are the meridian (k1 = 1 / s) and the parallel
+			struct Shape {
+				ordered_json json;
+				float radius; // the smallest radius of curvature, errors are relative to it
+				std::function<glm::vec2(glm::vec3)> curvatures; // gaussian and mean
+				std::function<glm::vec3(glm::vec3)> direction; // of k1, (0, 0, 0) where all directions are principal
+			};
+			auto torus = [](glm::vec3 p, glm::vec2& q, float& rho, float& s) {
+				rho = glm::length(glm::vec2(p.x, p.z));
+				q = glm::vec2(rho - 1, p.y);
+				s = glm::length(q);
+			};
+			std::vector<Shape> shapes = {
+				{ { { "primitive", "sphere" }, { "scale", 2.0f } }, 1,
+					[](glm::vec3 p) { float r = glm::length(p); return glm::vec2(1 / (r * r), -1 / r); },
+					[](glm::vec3) { return glm::vec3(0); } },
+				{ { { "primitive", "torus" }, { "major_radius", 1.0 }, { "minor_radius", 0.4 } }, 0.4f,
+					[&](glm::vec3 p) {
+						glm::vec2 q;
+						float rho, s;
+						torus(p, q, rho, s);
+						float k1 = 1 / s, k2 = q.x / (s * rho);
+						return glm::vec2(k1 * k2, -0.5f * (k1 + k2));
+					},
+					[&](glm::vec3 p) {
+						glm::vec2 q;
+						float rho, s;
+						torus(p, q, rho, s);
+						return glm::vec3(-q.y * p.x / rho, q.x, -q.y * p.z / rho) / s;
+					} },
+			};
+			bool ok = true;
+			for (const Shape& shape : shapes) {
+				auto root = NodeJsonSerializer::Deserialize(ordered_json::array({ shape.json }).dump()).front();
+				Tape tape = TapeGenerator().GenerateFromRoot(root);
+				size_t vertices = 0;
+				float gaussianError = 0, meanError = 0, directionError = 0, tangentError = 0;
+				extract(tape, SceneBox(root), true, [&](const MeshChunk& chunk) {
+					for (size_t i = 0; i < chunk.VertexCount(); ++i) {
+						glm::vec3 p = chunk.positions[i], n = chunk.normals[i];
+						glm::vec3 d1 = chunk.principalDirections[0][i], d2 = chunk.principalDirections[1][i];
+						glm::vec2 exact = shape.curvatures(p);
+						gaussianError = std::max(gaussianError, std::abs(chunk.gaussianCurvatures[i] - exact.x) * shape.radius * shape.radius);
+						meanError = std::max(meanError, std::abs(chunk.meanCurvatures[i] - exact.y) * shape.radius);
+						glm::vec3 direction = shape.direction(p);
+						if (direction != glm::vec3(0))
+							directionError = std::max(directionError, 1 - std::abs(glm::dot(d1, direction)));
+						tangentError = std::max({ tangentError, std::abs(glm::dot(d1, n)), std::abs(glm::dot(d2, n)), std::abs(glm::dot(d1, d2)),
+							std::abs(glm::length(d1) - 1), std::abs(glm::length(d2) - 1) });
+					}
+					vertices += chunk.VertexCount();
+				});
+				std::cout << shape.json.dump() << ": " << vertices << " vertices, relative errors: gaussian " << gaussianError << ", mean " << meanError
+					<< "; principal direction off by " << directionError << " (1 - cos), directions " << tangentError << " from orthonormal\n";
+				ok = ok && gaussianError <= 1e-3f && meanError <= 1e-3f && directionError <= 1e-4f && tangentError <= 1e-4f;
+			}
+			return ok ? 0 : 1;
+		}
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+		double normalsMs = MeasureMs([&] { extract(tape, box, false, [](const MeshChunk&) {}); });
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> curvatures; // gaussian and mean
+		double curvaturesMs = MeasureMs([&] {
+			extract(tape, box, true, [&](const MeshChunk& chunk) {
+				positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+				for (size_t i = 0; i < chunk.VertexCount(); ++i)
+					curvatures.emplace_back(chunk.gaussianCurvatures[i], chunk.meanCurvatures[i]);
+			});
+		});
+		std::cout << positions.size() << " vertices in " << curvaturesMs << " ms with curvatures, " << normalsMs << " ms with normals only\n";
+
+		// the curvatures of the renderer from a Hessian of central differences, at up to 10000 vertices: they differ near the edges
+		// of the CSG, where the differences straddle a kink
+		float h = 1e-3f * glm::length(box.max - box.min);
+		size_t step = std::max<size_t>(1, positions.size() / 10000), compared = 0, close = 0;
+		for (size_t i = 0; i < positions.size(); i += step) {
+			auto gradient = [&](glm::vec3 p) {
+				glm::vec3 g;
+				for (int axis = 0; axis < 3; ++axis) {
+					glm::vec3 offset(0);
+					offset[axis] = h;
+					g[axis] = (TapeEvaluator::Evaluate(tape, p + offset) - TapeEvaluator::Evaluate(tape, p - offset)) / (2 * h);
+				}
+				return g;
+			};
+			glm::vec3 p = positions[i], g = gradient(p);
+			glm::mat3 hessian;
+			for (int axis = 0; axis < 3; ++axis) {
+				glm::vec3 offset(0);
+				offset[axis] = h;
+				hessian[axis] = (gradient(p + offset) - gradient(p - offset)) / (2 * h);
+			}
+			float length = glm::length(g);
+			glm::vec3 n = g / length;
+			float trace = hessian[0][0] + hessian[1][1] + hessian[2][2];
+			float mean = -0.5f * (trace - glm::dot(n, hessian * n)) / length;
+			++compared;
+			close += std::abs(mean - curvatures[i].y) <= 0.05f * std::max(std::abs(mean), 1 / glm::length(box.max - box.min)) ? 1 : 0;
+		}
+		auto [minGaussian, maxGaussian] = std::minmax_element(curvatures.begin(), curvatures.end(), [](glm::vec2 a, glm::vec2 b) { return a.x < b.x; });
+		auto [minMean, maxMean] = std::minmax_element(curvatures.begin(), curvatures.end(), [](glm::vec2 a, glm::vec2 b) { return a.y < b.y; });
+		if (!curvatures.empty())
+			std::cout << "gaussian curvature " << minGaussian->x << " to " << maxGaussian->x << ", mean curvature " << minMean->y << " to "
+				<< maxMean->y << '\n';
+		std::cout << close << " of " << compared << " mean curvatures within 5% of central differences\n";
+		return 0;
+	}
+
+	// a function using every operation of Dual, its partial derivatives of order n are checked against central differences of order n-1
+	template<int Order>
+	Dual<Order, double> DualTestFunction(double x, double y, double z) {
+		using D = Dual<Order, double>;
+		D X = D::Variable(x, 0), Y = D::Variable(y, 1), Z = D::Variable(z, 2);
+		return dsin(X * Y) * dsqrt(X * X + Z * Z + 1.0) / (dcos(Z) + 2.0) + X / Y - dabs(Z * 0.5);
+	}
+
+	template<int Order>
+	double DualLibraryError(const PointSet& points) {
+		const double h = 1e-5;
+		double maxError = 0;
+		for (size_t i = 0; i < points.x.size(); ++i) {
+			double p[3] = { points.x[i], points.y[i], points.z[i] };
+			auto value = DualTestFunction<Order>(p[0], p[1], p[2]);
+			for (int x = 0; x <= Order; ++x) {
+				for (int y = 0; x + y <= Order; ++y) {
+					for (int z = 0; x + y + z <= Order; ++z) {
+						int m[3] = { x, y, z };
+						if (x + y + z < Order) {
+							// lower parts must not depend on the order
+							double error = std::abs(value.Partial(x, y, z) - DualTestFunction<Order - 1>(p[0], p[1], p[2]).Partial(x, y, z));
+							maxError = std::max(maxError, error / (1 + std::abs(value.Partial(x, y, z))));
+							continue;
+						}
+						int axis = x > 0 ? 0 : (y > 0 ? 1 : 2);
+						--m[axis];
+						double plus[3] = { p[0], p[1], p[2] }, minus[3] = { p[0], p[1], p[2] };
+						plus[axis] += h;
+						minus[axis] -= h;
+						double difference = (DualTestFunction<Order - 1>(plus[0], plus[1], plus[2]).Partial(m[0], m[1], m[2]) -
+							DualTestFunction<Order - 1>(minus[0], minus[1], minus[2]).Partial(m[0], m[1], m[2])) / (2 * h);
+						double error = std::abs(value.Partial(x, y, z) - difference);
+						maxError = std::max(maxError, error / (1 + std::abs(difference)));
+					}
+				}
+			}
+		}
+		return maxError;
+	}
+
+	std::vector<Dual<2>> EvaluateTapeDual(const Tape& tape, const PointSet& points) {
+		std::vector<Dual<2>> result(points.x.size());
+		TapeEvaluator::EvaluateDerivatives(tape, points.x.data(), points.y.data(), points.z.data(), result.data(), result.size());
+		return result;
+	}
+
+	// checks the dual number library, then the derivatives of a graph against central differences
+	int DualCheck(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("dualcheck <graph.json | random:<count>[:seed] | bench:<count>> [point count]");
+
+		PointSet libraryPoints;
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> coord(0.5f, 2.0f);
+		for (int i = 0; i < 1000; ++i) {
+			libraryPoints.x.push_back(coord(rng));
+			libraryPoints.y.push_back(coord(rng));
+			libraryPoints.z.push_back(coord(rng) * (i % 2 ? 1 : -1));
+		}
+		double libraryErrors[] = { DualLibraryError<1>(libraryPoints), DualLibraryError<2>(libraryPoints),
+			DualLibraryError<3>(libraryPoints), DualLibraryError<4>(libraryPoints) };
+		bool libraryOk = true;
+		for (int order = 1; order <= 4; ++order) {
+			std::cout << "order " << order << ": max relative error " << libraryErrors[order - 1] << '\n';
+			libraryOk &= libraryErrors[order - 1] < 1e-5;
+		}
+
+		auto root = LoadRoot(pos[0]);
+		size_t count = pos.size() > 1 ? std::stoul(pos[1]) : 10000;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		PointSet points = RandomPoints(root, count);
+
+		const float h = 1e-3f;
+		auto duals = EvaluateTapeDual(tape, points);
+		std::vector<Dual<2>> shifted[3][2];
+		for (int axis = 0; axis < 3; ++axis) {
+			for (int side = 0; side < 2; ++side) {
+				PointSet p = points;
+				for (float& c : axis == 0 ? p.x : (axis == 1 ? p.y : p.z))
+					c += side == 0 ? h : -h;
+				shifted[axis][side] = EvaluateTapeDual(tape, p);
+			}
+		}
+
+		std::vector<float> distances(count);
+		TapeEvaluator::Evaluate(tape, points.x.data(), points.y.data(), points.z.data(), distances.data(), count);
+
+		// differences are wrong across the creases of min/max and the primitives, so a small fraction of mismatches is expected
+		size_t valueFailures = 0, gradientFailures = 0, hessianFailures = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (!(std::abs(duals[i].d[0] - distances[i]) <= 1e-5f * (1 + std::abs(distances[i]))))
+				++valueFailures;
+			bool gradientOk = true, hessianOk = true;
+			for (int axis = 0; axis < 3; ++axis) {
+				int e[3] = { axis == 0, axis == 1, axis == 2 };
+				float difference = (shifted[axis][0][i].d[0] - shifted[axis][1][i].d[0]) / (2 * h);
+				float derivative = duals[i].Partial(e[0], e[1], e[2]);
+				gradientOk &= std::abs(derivative - difference) <= 1e-2f * (1 + std::abs(difference));
+				for (int other = 0; other < 3; ++other) {
+					int f[3] = { other == 0, other == 1, other == 2 };
+					float secondDifference = (shifted[axis][0][i].Partial(f[0], f[1], f[2]) - shifted[axis][1][i].Partial(f[0], f[1], f[2])) / (2 * h);
+					float second = duals[i].Partial(e[0] + f[0], e[1] + f[1], e[2] + f[2]);
+					hessianOk &= std::abs(second - secondDifference) <= 1e-2f * (1 + std::abs(secondDifference));
+				}
+			}
+			gradientFailures += !gradientOk;
+			hessianFailures += !hessianOk;
+		}
+
+		std::cout << tape.instructions.size() << " instructions, " << count << " points: "
+			<< valueFailures << " value mismatches, " << gradientFailures << " gradient and " << hessianFailures << " hessian mismatches against differences\n";
+		bool tapeOk = valueFailures == 0 && gradientFailures <= count / 100 && hessianFailures <= count / 100;
+		return libraryOk && tapeOk ? 0 : 1;
+	}
+
+	// interval octree against sampling the centers of all cells of the finest level
+	int Octree(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.empty() || pos.size() > 2)
+			throw usage_error("octree <graph.json | random:<count>[:seed] | bench:<count>> [depth]");
+
+		auto root = LoadRoot(pos[0]);
+		uint32_t depth = pos.size() > 1 ? std::stoul(pos[1]) : 7;
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+		BoundingBox box = SceneBox(root);
+
+		IntervalOctree fullTapes;
+		fullTapes.simplifyTapes = false;
+		double fullTapesMs = MeasureMs([&] { fullTapes.Build(tape, box, depth); });
+		IntervalOctree octree;
+		double octreeMs = MeasureMs([&] { octree.Build(tape, box, depth); });
+		size_t counts[3] = {};
+		for (auto& cell : octree.Cells())
+			++counts[(int)cell.state];
+		auto surface = octree.SurfaceCells();
+		size_t surfaceCells = surface.size();
+		size_t surfaceInstructions = 0;
+		for (uint32_t i : surface)
+			surfaceInstructions += octree.Cells()[i].tape->instructions.size();
+
+		size_t resolution = size_t(1) << depth;
+		size_t gridCount = resolution * resolution * resolution;
+		glm::vec3 cellSize = (box.max - box.min) / float(resolution);
+		PointSet grid;
+		for (auto* coords : { &grid.x, &grid.y, &grid.z })
+			coords->reserve(gridCount);
+		for (size_t k = 0; k < resolution; ++k) {
+			for (size_t j = 0; j < resolution; ++j) {
+				for (size_t i = 0; i < resolution; ++i) {
+					glm::vec3 p = box.min + cellSize * (glm::vec3(i, j, k) + 0.5f);
+					grid.x.push_back(p.x);
+					grid.y.push_back(p.y);
+					grid.z.push_back(p.z);
+				}
+			}
+		}
+		std::vector<float> distances(gridCount);
+		double gridMs = MeasureMs([&] { TapeEvaluator::EvaluateParallel(tape, grid.x.data(), grid.y.data(), grid.z.data(), distances.data(), gridCount); });
+
+		// every sample must agree with the cell containing it, and the simplified tape of the cell must give the same value
+		size_t wrong = 0;
+		for (size_t i = 0; i < gridCount; ++i) {
+			glm::vec3 p(grid.x[i], grid.y[i], grid.z[i]);
+			const OctreeCell& cell = octree.Cells()[octree.FindLeaf(p)];
+			if ((cell.state == CellState::Inside && !(distances[i] < 0)) || (cell.state == CellState::Outside && !(distances[i] > 0))) {
+				if (wrong++ < 10)
+					std::cerr << "sample " << p << " = " << distances[i] << " in a cell proven " << (cell.state == CellState::Inside ? "inside" : "outside") << '\n';
+			}
+			else if (cell.state == CellState::Ambiguous) {
+				float simplified = TapeEvaluator::Evaluate(*cell.tape, p);
+				if (!(std::abs(simplified - distances[i]) <= 1e-6f * (1 + std::abs(distances[i]))) && wrong++ < 10)
+					std::cerr << "sample " << p << " = " << distances[i] << ", the tape of its cell gives " << simplified << '\n';
+			}
+		}
+
+		std::cout << tape.instructions.size() << " instructions, depth " << depth << " (" << resolution << "^3 = " << gridCount << " finest cells)\n";
+		std::cout << "octree: " << octreeMs << " ms, " << octree.Cells().size() << " interval evaluations ("
+			<< counts[(int)CellState::Inside] << " inside, " << counts[(int)CellState::Outside] << " outside, " << counts[(int)CellState::Ambiguous] << " ambiguous), "
+			<< surfaceCells << " surface cells (" << 100.0 * surfaceCells / gridCount << "% of the grid)\n";
+		std::cout << "        " << fullTapesMs << " ms without simplified tapes, surface cells evaluate "
+			<< (surfaceCells ? double(surfaceInstructions) / surfaceCells : 0.0) << " instructions on average\n";
+		std::cout << "grid:   " << gridMs << " ms for the cell centers\n";
+		std::cout << wrong << " samples contradict their cell\n";
+		return wrong == 0 && !EmptyRandomScene(pos[0], surfaceCells) ? 0 : 1;
+	}
+
+	// sphere traces the graph on the CPU like the editor's viewport
+	int Render(const Args& args) {
+		auto pos = Positionals(args);
+		if (pos.size() != 2)
+			throw usage_error("render <graph.json | random:<count>[:seed] | bench:<count>> <out.png | out.exr> [--mode=shaded|steps|normals|gaussian|mean|normal-error]\n"
+				"    [--size=<width>x<height>] [--eye=x,y,z] [--at=x,y,z] [--autodiff] [--eps=0.01] [--vis=0.1] [--tile=16] [--compare=<reference.exr>] [--tolerance=0.01]");
+
+		auto root = LoadRoot(pos[0]);
+		Tape tape = TapeGenerator().GenerateFromRoot(root);
+
+		const std::map<std::string, DisplayMode> modes = {
+			{ "shaded", DisplayMode::Shaded }, { "steps", DisplayMode::Steps }, { "normals", DisplayMode::Normals },
+			{ "gaussian", DisplayMode::GaussianCurvature }, { "mean", DisplayMode::MeanCurvature }, { "normal-error", DisplayMode::NormalError }
+		};
+		CpuRenderer renderer;
+		std::string mode = OptionValue(args, "--mode", "shaded");
+		if (modes.count(mode) == 0)
+			throw std::runtime_error("unknown display mode " + mode);
+		renderer.displayMode = modes.at(mode);
+		renderer.useAutoDiff = HasFlag(args, "--autodiff");
+		renderer.eps = std::stof(OptionValue(args, "--eps", "0.01"));
+		renderer.visMultiplier = std::stof(OptionValue(args, "--vis", "0.1"));
+		renderer.tileSize = std::max(1, std::stoi(OptionValue(args, "--tile", "16")));
+
+		int width = 0, height = 0;
+		if (std::sscanf(OptionValue(args, "--size", "800x600").c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+			throw std::runtime_error("expected --size=<width>x<height>");
+
+		// the editor's camera: 45 degrees, near 0.1, far 1000; by default the whole graph is in view
+		const float fovY = glm::radians(45.0f);
+		BoundingBox box = BoundsCalculatorVisitor().CalculateBounds(root).at(root.get());
+		if (box.IsInfinite())
+			box = SceneBox(root);
+		glm::vec3 at = ParseVec3(OptionValue(args, "--at", "0,0,0"));
+		glm::vec3 eye;
+		if (OptionValue(args, "--at", "").empty())
+			at = box.Center();
+		if (OptionValue(args, "--eye", "").empty()) {
+			float radius = glm::length(box.HalfSize());
+			eye = at + glm::normalize(glm::vec3(0.5f, 0.6f, 1.0f)) * (radius / std::sin(fovY * 0.5f));
+		}
+		else {
+			eye = ParseVec3(OptionValue(args, "--eye", ""));
+		}
+		glm::mat4 viewProj = glm::perspective(fovY, float(width) / height, 0.1f, 1000.0f) * glm::lookAt(eye, at, glm::vec3(0, 1, 0));
+
+		Image image = renderer.Render(tape, eye, viewProj, width, height);
+		ImageIO::Write(image, pos[1]);
+
+		const RenderStats& stats = renderer.Stats();
+		std::cout << width << "x" << height << ", " << tape.instructions.size() << " instructions, " << ThreadPool::Global().ThreadCount() << " threads: "
+			<< stats.milliseconds << " ms, " << stats.rays / stats.milliseconds / 1e3 << " M rays/s, "
+			<< double(stats.sdfEvaluations) / stats.rays << " sdf evaluations per ray\n";
+
+		std::string reference = OptionValue(args, "--compare", "");
+		if (reference.empty())
+			return 0;
+
+		// regression check against an earlier render
+		Image expected = ImageIO::ReadExr(reference);
+		if (expected.width != width || expected.height != height)
+			throw std::runtime_error(reference + " has a different size");
+		float tolerance = std::stof(OptionValue(args, "--tolerance", "0.01"));
+		size_t different = 0;
+		float maxDifference = 0;
+		for (size_t i = 0; i < image.pixels.size(); ++i) {
+			glm::vec4 a = glm::clamp(image.pixels[i], 0.0f, 1.0f), b = glm::clamp(expected.pixels[i], 0.0f, 1.0f);
+			float difference = glm::compMax(glm::abs(a - b));
+			if (!(difference <= tolerance)) // NaN counts as different
+				++different;
+			if (difference > maxDifference)
+				maxDifference = difference;
+		}
+		std::cout << different << " of " << image.pixels.size() << " pixels differ by more than " << tolerance << " (max " << maxDifference << ")\n";
+		// silhouette pixels may flip between hit and miss with different rounding
+		return different <= image.pixels.size() / 1000 ? 0 : 1;
+	}
+
+	const std::map<std::string, std::function<int(const Args&)>> commands = {
+		{ "codegen", Codegen },
+		{ "scene", Scene },
+		{ "bench", Bench },
+		{ "verify", Verify },
+		{ "guards", Guards },
+		{ "evalbench", EvalBench },
+		{ "jit", Jit },
+		{ "query", Query },
+		{ "raycast", RayCast },
+		{ "lipschitz", Lipschitz },
+		{ "sample", Sample },
+		{ "dualcheck", DualCheck },
+		{ "octree", Octree },
+		{ "mesh", Mesh },
+		{ "dualcontour", DualContour },
+		{ "export", Export },
+		{ "bake", Bake },
+		{ "volume", Volume },
+		{ "import", ImportMesh },
+		{ "mass", Mass },
+		{ "slice", CrossSection },
+		{ "curvature", Curvature },
+		{ "render", Render },
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || commands.count(argv[1]) == 0) {
+		std::cerr << "usage: csgtool <command> [arguments]\ncommands:";
+		for (auto& [name, command] : commands)
+			std::cerr << ' ' << name;
+		std::cerr << '\n';
+		return 1;
+	}
+
+	Args args(argv + 2, argv + argc);
+	try {
+		return commands.at(argv[1])(args);
+	}
+	catch (usage_error& e) {
+		std::cerr << "usage: csgtool " << e.what() << '\n';
+	}
+	catch (shader_gen_exception& e) {
+		std::cerr << e.what() << " (reason " << (int)e.reason() << ")\n";
+	}
+	catch (std::exception& e) {
+		std::cerr << "error: " << e.what() << '\n';
+	}
+	return 1;
+}